@@ -542,3 +542,62 @@ if test x"$Ac_cachevar" = x"yes"; then
 fi
 undefine([Ac_cachevar])dnl
 ])# PGAC_SSE42_CRC32_INTRINSICS
+
+
+# PGAC_AVX2_INTRINSICS
+# -----------------------
+# Check if the compiler supports the x86 AVX2 instructions needed to compute
+# data page checksums, using the _mm256_mullo_epi32 and _mm256_srli_epi32
+# intrinsic functions.
+#
+# An optional compiler flag can be passed as argument (e.g. -mavx2). If the
+# intrinsics are supported, sets pgac_avx2_intrinsics, and CFLAGS_AVX2.
+AC_DEFUN([PGAC_AVX2_INTRINSICS],
+[define([Ac_cachevar], [AS_TR_SH([pgac_cv_avx2_intrinsics_$1])])dnl
+AC_CACHE_CHECK([for _mm256_mullo_epi32 and _mm256_srli_epi32 with CFLAGS=$1], [Ac_cachevar],
+[pgac_save_CFLAGS=$CFLAGS
+CFLAGS="$pgac_save_CFLAGS $1"
+AC_LINK_IFELSE([AC_LANG_PROGRAM([#include <immintrin.h>],
+  [__m256i x = _mm256_set1_epi32(0);
+   x = _mm256_xor_si256(_mm256_mullo_epi32(x, x), _mm256_srli_epi32(x, 17));
+   /* return computed value, to prevent the above being optimized away */
+   return _mm256_extract_epi32(x, 0) == 0;])],
+  [Ac_cachevar=yes],
+  [Ac_cachevar=no])
+CFLAGS="$pgac_save_CFLAGS"])
+if test x"$Ac_cachevar" = x"yes"; then
+  CFLAGS_AVX2="$1"
+  pgac_avx2_intrinsics=yes
+fi
+undefine([Ac_cachevar])dnl
+])# PGAC_AVX2_INTRINSICS
+
+
+# PGAC_AVX512_INTRINSICS
+# -----------------------
+# Check if the compiler supports the x86 AVX-512F instructions needed to
+# compute data page checksums, using the _mm512_mullo_epi32 and
+# _mm512_srli_epi32 intrinsic functions.
+#
+# An optional compiler flag can be passed as argument (e.g. -mavx512f). If
+# the intrinsics are supported, sets pgac_avx512_intrinsics, and
+# CFLAGS_AVX512.
+AC_DEFUN([PGAC_AVX512_INTRINSICS],
+[define([Ac_cachevar], [AS_TR_SH([pgac_cv_avx512_intrinsics_$1])])dnl
+AC_CACHE_CHECK([for _mm512_mullo_epi32 and _mm512_srli_epi32 with CFLAGS=$1], [Ac_cachevar],
+[pgac_save_CFLAGS=$CFLAGS
+CFLAGS="$pgac_save_CFLAGS $1"
+AC_LINK_IFELSE([AC_LANG_PROGRAM([#include <immintrin.h>],
+  [__m512i x = _mm512_set1_epi32(0);
+   x = _mm512_xor_si512(_mm512_mullo_epi32(x, x), _mm512_srli_epi32(x, 17));
+   /* return computed value, to prevent the above being optimized away */
+   return _mm512_reduce_add_epi32(x) == 0;])],
+  [Ac_cachevar=yes],
+  [Ac_cachevar=no])
+CFLAGS="$pgac_save_CFLAGS"])
+if test x"$Ac_cachevar" = x"yes"; then
+  CFLAGS_AVX512="$1"
+  pgac_avx512_intrinsics=yes
+fi
+undefine([Ac_cachevar])dnl
+])# PGAC_AVX512_INTRINSICS
@@ -54,8 +54,26 @@ WHERE relation = ANY(ARRAY['bttest_a', 'bttest_a_idx', 'bttest_b', 'bttest_b_idx
     AND pid = pg_backend_pid();
 COMMIT;
 
+-- suffix truncation: an index whose leading column separates the keys
+-- keeps only that column in its pivot tuples, so it is shallower than one
+-- on the same keys in the other order, where nothing can be truncated
+CREATE EXTENSION pageinspect;
+CREATE TABLE bttest_trunc(id int4, pad text);
+CREATE INDEX bttest_trunc_idx ON bttest_trunc (id, pad);
+CREATE INDEX bttest_trunc_full_idx ON bttest_trunc (pad, id);
+INSERT INTO bttest_trunc SELECT i, repeat('x', 500) FROM generate_series(1, 1000) i;
+CREATE INDEX bttest_trunc_build_idx ON bttest_trunc (id, pad);
+SELECT bt_index_check('bttest_trunc_idx');
+SELECT bt_index_parent_check('bttest_trunc_idx');
+SELECT bt_index_parent_check('bttest_trunc_full_idx');
+SELECT bt_index_parent_check('bttest_trunc_build_idx');
+SELECT (bt_metap('bttest_trunc_idx')).level < (bt_metap('bttest_trunc_full_idx')).level AS split_shallower,
+       (bt_metap('bttest_trunc_build_idx')).level < (bt_metap('bttest_trunc_full_idx')).level AS build_shallower;
+
 -- cleanup
 DROP TABLE bttest_a;
 DROP TABLE bttest_b;
+DROP TABLE bttest_trunc;
+DROP EXTENSION pageinspect;
 DROP OWNED BY bttest_role; -- permissions
 DROP ROLE bttest_role;
@@ -334,6 +334,7 @@ explain_ExecutorEnd(QueryDesc *queryDesc)
 			ExplainPrintPlan(es, queryDesc);
 			if (es->analyze && auto_explain_log_triggers)
 				ExplainPrintTriggers(es, queryDesc);
+			ExplainPrintJIT(es, queryDesc);
 			ExplainEndOutput(es);
 
 			/* Remove last line break */
@@ -0,0 +1,31 @@
+/* contrib/pg_buffercache/pg_buffercache--1.3--1.4.sql */
+
+-- complain if script is sourced in psql, rather than via ALTER EXTENSION
+\echo Use "ALTER EXTENSION pg_buffercache UPDATE TO '1.4'" to load this file. \quit
+
+CREATE FUNCTION pg_buffercache_strategy(
+    OUT policy text,
+    OUT allocs int8,
+    OUT ring_reuses int8,
+    OUT clock_ticks int8,
+    OUT promotions int8,
+    OUT demotions int8,
+    OUT protected_buffers int4)
+AS 'MODULE_PATHNAME', 'pg_buffercache_strategy'
+LANGUAGE C PARALLEL SAFE;
+
+-- Don't want this to be available to public.
+REVOKE ALL ON FUNCTION pg_buffercache_strategy() FROM PUBLIC;
+GRANT EXECUTE ON FUNCTION pg_buffercache_strategy() TO pg_monitor;
+
+CREATE FUNCTION pg_buffercache_numa(
+    OUT node int4,
+    OUT buffers int4,
+    OUT local_hits int8,
+    OUT remote_hits int8)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME', 'pg_buffercache_numa'
+LANGUAGE C PARALLEL SAFE;
+
+REVOKE ALL ON FUNCTION pg_buffercache_numa() FROM PUBLIC;
+GRANT EXECUTE ON FUNCTION pg_buffercache_numa() TO pg_monitor;
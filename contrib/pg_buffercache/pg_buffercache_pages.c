@@ -13,6 +13,7 @@
 #include "funcapi.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
+#include "utils/builtins.h"
 
 
 #define NUM_BUFFERCACHE_PAGES_MIN_ELEM	8
@@ -237,3 +238,102 @@ pg_buffercache_pages(PG_FUNCTION_ARGS)
 	else
 		SRF_RETURN_DONE(funcctx);
 }
+
+/*
+ * Function returning the buffer replacement policy in effect and cumulative
+ * statistics about its activity.
+ */
+PG_FUNCTION_INFO_V1(pg_buffercache_strategy);
+
+Datum
+pg_buffercache_strategy(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	BufferStrategyStats stats;
+	Datum		values[7];
+	bool		nulls[7];
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	StrategyGetStats(&stats);
+
+	switch (buffer_replacement_policy)
+	{
+		case BUFFER_REPLACEMENT_CLOCK:
+			values[0] = CStringGetTextDatum("clock");
+			break;
+		case BUFFER_REPLACEMENT_2Q:
+			values[0] = CStringGetTextDatum("2q");
+			break;
+		default:
+			elog(ERROR, "unrecognized buffer replacement policy: %d",
+				 buffer_replacement_policy);
+	}
+	values[1] = Int64GetDatum((int64) stats.allocs);
+	values[2] = Int64GetDatum((int64) stats.ring_reuses);
+	values[3] = Int64GetDatum((int64) stats.clock_ticks);
+	values[4] = Int64GetDatum((int64) stats.promotions);
+	values[5] = Int64GetDatum((int64) stats.demotions);
+	values[6] = Int32GetDatum((int32) stats.protected_buffers);
+	memset(nulls, 0, sizeof(nulls));
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
+/*
+ * Function returning one row per NUMA node that shared buffers are
+ * partitioned across, with the number of buffers on the node and how many
+ * hits on them came from backends running on the same node or on another.
+ * Returns no rows if shared buffers aren't partitioned.
+ */
+PG_FUNCTION_INFO_V1(pg_buffercache_numa);
+
+Datum
+pg_buffercache_numa(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		MemoryContext oldcontext;
+		TupleDesc	tupdesc;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+			elog(ERROR, "return type must be a row type");
+		funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+		funcctx->max_calls = BufferNumaNodes;
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+
+	if (funcctx->call_cntr < funcctx->max_calls)
+	{
+		int			os_node;
+		int			nbuffers;
+		uint64		local_hits;
+		uint64		remote_hits;
+		Datum		values[4];
+		bool		nulls[4];
+		HeapTuple	tuple;
+
+		BufferNumaGetStats((int) funcctx->call_cntr, &os_node, &nbuffers,
+						   &local_hits, &remote_hits);
+
+		values[0] = Int32GetDatum(os_node);
+		values[1] = Int32GetDatum(nbuffers);
+		values[2] = Int64GetDatum((int64) local_hits);
+		values[3] = Int64GetDatum((int64) remote_hits);
+		memset(nulls, 0, sizeof(nulls));
+
+		tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
+		SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+	}
+	else
+		SRF_RETURN_DONE(funcctx);
+}
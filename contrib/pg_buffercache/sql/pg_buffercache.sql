@@ -0,0 +1,66 @@
+CREATE EXTENSION pg_buffercache;
+
+-- The server runs with the 2q policy, and only 128 buffers
+SELECT policy, allocs > 0 AS allocs, ring_reuses >= 0 AS ring_reuses,
+       clock_ticks >= 0 AS clock_ticks, promotions >= 0 AS promotions,
+       demotions >= 0 AS demotions,
+       protected_buffers BETWEEN 0 AND 0.75 * 128 AS protected_buffers
+  FROM pg_buffercache_strategy();
+
+-- Twelve tables of 27 pages each, together about two and a half times
+-- shared_buffers, but each small enough to be read without a buffer ring
+DO $$
+BEGIN
+  FOR i IN 1..12 LOOP
+    EXECUTE format('CREATE TABLE buffercache_cold_%s AS
+                      SELECT g AS a, repeat(''x'', 500) AS b
+                        FROM generate_series(1, 400) g', i);
+  END LOOP;
+END
+$$;
+
+-- A small table that is read over and over
+CREATE TABLE buffercache_hot AS SELECT g AS a FROM generate_series(1, 2000) g;
+SELECT count(*) FROM buffercache_hot;
+SELECT count(*) FROM buffercache_hot;
+SELECT count(*) FROM buffercache_hot;
+SELECT count(*) FROM buffercache_hot;
+SELECT count(*) FROM buffercache_hot;
+
+CREATE TEMP TABLE buffercache_before AS
+  SELECT * FROM pg_buffercache_strategy();
+
+-- Read each of the other tables once.  The clock sweep has to find victims
+-- for their pages; it must promote the pages of the hot table, which were
+-- used again while on probation, and evict the pages used once instead.
+DO $$
+DECLARE
+  n int;
+BEGIN
+  FOR i IN 1..12 LOOP
+    EXECUTE format('SELECT count(*) FROM buffercache_cold_%s', i) INTO n;
+  END LOOP;
+END
+$$;
+
+SELECT s.allocs > b.allocs AS allocated,
+       s.clock_ticks > b.clock_ticks AS swept,
+       s.promotions > b.promotions AS promoted,
+       s.protected_buffers BETWEEN 1 AND 0.75 * 128 AS protected
+  FROM pg_buffercache_strategy() s, buffercache_before b;
+
+SELECT count(*) = pg_relation_size('buffercache_hot') / 8192 AS hot_cached
+  FROM pg_buffercache
+ WHERE relfilenode = pg_relation_filenode('buffercache_hot') AND
+       reldatabase = (SELECT oid FROM pg_database
+                       WHERE datname = current_database()) AND
+       relforknumber = 0;
+
+DROP TABLE buffercache_hot;
+DO $$
+BEGIN
+  FOR i IN 1..12 LOOP
+    EXECUTE format('DROP TABLE buffercache_cold_%s', i);
+  END LOOP;
+END
+$$;
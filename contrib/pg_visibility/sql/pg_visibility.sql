@@ -72,6 +72,33 @@ select count(*) > 0 from pg_visibility_map_summary('test_partition');
 select * from pg_check_frozen('test_partition'); -- hopefully none
 select pg_truncate_visibility_map('test_partition');
 
+-- pages that vacuum marks all-visible get frozen at the same time
+create table eager_freeze (a int);
+insert into eager_freeze select generate_series(1, 1000);
+vacuum eager_freeze;
+select all_visible > 0, all_visible = all_frozen
+  from pg_visibility_map_summary('eager_freeze');
+select * from pg_check_frozen('eager_freeze'); -- hopefully none
+drop table eager_freeze;
+
+-- a row lock on an all-frozen page must keep an aggressive vacuum from
+-- skipping the page, even if the rest of the table can be skipped
+create table freeze_lock (a int);
+insert into freeze_lock select generate_series(1, 20000);
+vacuum (freeze) freeze_lock;
+select all_visible > 0, all_visible = all_frozen
+  from pg_visibility_map_summary('freeze_lock');
+begin;
+select a from freeze_lock where a = 1 for share;
+commit;
+select all_visible - all_frozen as not_frozen
+  from pg_visibility_map_summary('freeze_lock');
+vacuum (freeze) freeze_lock;
+select all_visible > 0, all_visible = all_frozen
+  from pg_visibility_map_summary('freeze_lock');
+select * from pg_check_frozen('freeze_lock'); -- hopefully none
+drop table freeze_lock;
+
 -- cleanup
 drop table test_partitioned;
 drop view test_view;
@@ -90,6 +90,8 @@ static HeapScanDesc heap_beginscan_internal(Relation relation,
 						bool is_samplescan,
 						bool temp_snap);
 static BlockNumber heap_parallelscan_nextpage(HeapScanDesc scan);
+static Buffer heap_read_page(HeapScanDesc scan, BlockNumber page);
+static void heap_release_readahead(HeapScanDesc scan);
 static HeapTuple heap_prepare_insert(Relation relation, HeapTuple tup,
 					TransactionId xid, CommandId cid, int options);
 static XLogRecPtr log_heap_update(Relation reln, Buffer oldbuf,
@@ -297,6 +299,7 @@ initscan(HeapScanDesc scan, ScanKey key, bool keep_startblock)
 	ItemPointerSetInvalid(&scan->rs_ctup.t_self);
 	scan->rs_cbuf = InvalidBuffer;
 	scan->rs_cblock = InvalidBlockNumber;
+	scan->rs_ra_next = scan->rs_ra_nbuffers = 0;
 
 	/* page-at-a-time fields are always invalid when not rs_inited */
 
@@ -334,6 +337,77 @@ heap_setscanlimits(HeapScanDesc scan, BlockNumber startBlk, BlockNumber numBlks)
 	scan->rs_numblocks = numBlks;
 }
 
+/*
+ * heap_read_page - pin a page for heapgetpage()
+ *
+ * A plain heap scan that proceeds forward page by page reads the requested
+ * page together with the following pages it is going to visit, with a
+ * single ReadBufferRange() call rather than one read per page, and keeps
+ * them pinned in rs_ra_buffers until it gets to them.  The readahead stops
+ * where the scan will wrap around or end, and pins no more buffers than the
+ * scan's access strategy ring can spare.
+ */
+static Buffer
+heap_read_page(HeapScanDesc scan, BlockNumber page)
+{
+	BlockNumber endblock;
+	int			nblocks;
+
+	if (scan->rs_ra_next < scan->rs_ra_nbuffers)
+	{
+		if (page == scan->rs_ra_block)
+		{
+			scan->rs_ra_block++;
+			return scan->rs_ra_buffers[scan->rs_ra_next++];
+		}
+
+		/* The scan went elsewhere, so we don't need these pages */
+		heap_release_readahead(scan);
+	}
+
+	/*
+	 * Bitmap, sample and parallel scans don't visit consecutive pages, nor
+	 * do scans with a limited page range.  Otherwise read ahead only if the
+	 * scan is at its start page or just moved forward by one page.
+	 */
+	if (scan->rs_bitmapscan || scan->rs_samplescan ||
+		scan->rs_parallel != NULL ||
+		scan->rs_numblocks != InvalidBlockNumber ||
+		(scan->rs_cblock == InvalidBlockNumber ?
+		 page != scan->rs_startblock : page != scan->rs_cblock + 1))
+		return ReadBufferExtended(scan->rs_rd, MAIN_FORKNUM, page,
+								  RBM_NORMAL, scan->rs_strategy);
+
+	/* A forward scan continues to the end, or else to where it started */
+	endblock = (page >= scan->rs_startblock) ?
+		scan->rs_nblocks : scan->rs_startblock;
+
+	nblocks = Min(endblock - page, MAX_IO_COMBINE_BLOCKS);
+	nblocks = Min(nblocks, GetAccessStrategyPinLimit(scan->rs_strategy));
+	if (nblocks <= 1)
+		return ReadBufferExtended(scan->rs_rd, MAIN_FORKNUM, page,
+								  RBM_NORMAL, scan->rs_strategy);
+
+	ReadBufferRange(scan->rs_rd, MAIN_FORKNUM, page, nblocks,
+					scan->rs_strategy, scan->rs_ra_buffers);
+	scan->rs_ra_nbuffers = nblocks;
+	scan->rs_ra_next = 1;
+	scan->rs_ra_block = page + 1;
+
+	return scan->rs_ra_buffers[0];
+}
+
+/*
+ * heap_release_readahead - release pages heap_read_page() read ahead
+ */
+static void
+heap_release_readahead(HeapScanDesc scan)
+{
+	while (scan->rs_ra_next < scan->rs_ra_nbuffers)
+		ReleaseBuffer(scan->rs_ra_buffers[scan->rs_ra_next++]);
+	scan->rs_ra_next = scan->rs_ra_nbuffers = 0;
+}
+
 /*
  * heapgetpage - subroutine for heapgettup()
  *
@@ -370,8 +444,7 @@ heapgetpage(HeapScanDesc scan, BlockNumber page)
 	CHECK_FOR_INTERRUPTS();
 
 	/* read page using selected strategy */
-	scan->rs_cbuf = ReadBufferExtended(scan->rs_rd, MAIN_FORKNUM, page,
-									   RBM_NORMAL, scan->rs_strategy);
+	scan->rs_cbuf = heap_read_page(scan, page);
 	scan->rs_cblock = page;
 
 	if (!scan->rs_pageatatime)
@@ -1520,6 +1593,7 @@ heap_rescan(HeapScanDesc scan,
 	 */
 	if (BufferIsValid(scan->rs_cbuf))
 		ReleaseBuffer(scan->rs_cbuf);
+	heap_release_readahead(scan);
 
 	/*
 	 * reinitialize scan descriptor
@@ -1584,6 +1658,7 @@ heap_endscan(HeapScanDesc scan)
 	 */
 	if (BufferIsValid(scan->rs_cbuf))
 		ReleaseBuffer(scan->rs_cbuf);
+	heap_release_readahead(scan);
 
 	/*
 	 * decrement relation reference count and free scan descriptor storage
@@ -1820,6 +1895,67 @@ heap_getnext(HeapScanDesc scan, ScanDirection direction)
 	return &(scan->rs_ctup);
 }
 
+/* ----------------
+ *		heap_getnextbatch	- retrieve the rest of the current page's tuples
+ *
+ *		Moves the scan forward as heap_getnext would, then returns in tuples[]
+ *		that tuple and all the remaining visible tuples on the same page, up
+ *		to maxtuples.  The return value is the number of tuples returned;
+ *		zero means the scan is complete.
+ *
+ *		This is only supported for forward, page-at-a-time scans without scan
+ *		keys.  Since visibility has already been checked for the whole page
+ *		by heapgetpage, this simply hands out the rs_vistuples entries,
+ *		avoiding the per-tuple overhead of heap_getnext.  The returned tuples
+ *		point into the page held by scan->rs_cbuf, so they remain valid only
+ *		until the scan is advanced or ended; the scan is left positioned on
+ *		the last tuple returned.
+ * ----------------
+ */
+int
+heap_getnextbatch(HeapScanDesc scan, HeapTuple tuples, int maxtuples)
+{
+	HeapTuple	tuple;
+	Page		dp;
+	int			ntuples;
+
+	Assert(scan->rs_pageatatime);
+	Assert(scan->rs_nkeys == 0);
+	Assert(maxtuples > 0);
+
+	/* Fetch the first tuple, moving on to the next page if needed */
+	tuple = heap_getnext(scan, ForwardScanDirection);
+	if (tuple == NULL)
+		return 0;
+	tuples[0] = *tuple;
+	ntuples = 1;
+
+	/* Then hand out the rest of the page's visible tuples */
+	dp = BufferGetPage(scan->rs_cbuf);
+	while (ntuples < maxtuples && scan->rs_cindex + 1 < scan->rs_ntuples)
+	{
+		OffsetNumber lineoff;
+		ItemId		lpp;
+
+		lineoff = scan->rs_vistuples[++scan->rs_cindex];
+		lpp = PageGetItemId(dp, lineoff);
+		Assert(ItemIdIsNormal(lpp));
+
+		tuple = &tuples[ntuples++];
+		tuple->t_data = (HeapTupleHeader) PageGetItem(dp, lpp);
+		tuple->t_len = ItemIdGetLength(lpp);
+		ItemPointerSet(&(tuple->t_self), scan->rs_cblock, lineoff);
+		tuple->t_tableOid = scan->rs_ctup.t_tableOid;
+
+		pgstat_count_heap_getnext(scan->rs_rd);
+	}
+
+	/* Leave the scan positioned on the last tuple returned */
+	scan->rs_ctup = tuples[ntuples - 1];
+
+	return ntuples;
+}
+
 /*
  *	heap_fetch		- retrieve tuple with given tid
  *
@@ -5120,7 +5256,12 @@ failed:
 	if (HEAP_XMAX_IS_LOCKED_ONLY(new_infomask))
 		tuple->t_data->t_ctid = *tid;
 
-	/* Clear only the all-frozen bit on visibility map if needed */
+	/*
+	 * Clear only the all-frozen bit on visibility map if needed.  This also
+	 * resets the map page's freeze horizon, since our XID isn't covered by
+	 * it; visibilitymap_clear reports that as a change too, so that redo
+	 * does the same.
+	 */
 	if (PageIsAllVisible(page) &&
 		visibilitymap_clear(relation, block, vmbuffer,
 							VISIBILITYMAP_ALL_FROZEN))
@@ -7184,6 +7325,51 @@ heap_tuple_needs_eventual_freeze(HeapTupleHeader tuple)
 	return false;
 }
 
+/*
+ * heap_tuple_oldest_unfrozen_xid
+ *
+ * Return the oldest of the XID fields of a tuple (xmin, xmax, xvac) that will
+ * eventually require freezing, or FrozenTransactionId if there is none; this
+ * is the tuple's contribution to a visibility map freeze horizon.  If xmax is
+ * a MultiXactId, InvalidTransactionId is returned, since the horizon doesn't
+ * track those.
+ */
+TransactionId
+heap_tuple_oldest_unfrozen_xid(HeapTupleHeader tuple)
+{
+	TransactionId oldest = FrozenTransactionId;
+	TransactionId xid;
+
+	xid = HeapTupleHeaderGetXmin(tuple);
+	if (TransactionIdIsNormal(xid))
+		oldest = xid;
+
+	if (tuple->t_infomask & HEAP_XMAX_IS_MULTI)
+	{
+		if (MultiXactIdIsValid(HeapTupleHeaderGetRawXmax(tuple)))
+			return InvalidTransactionId;
+	}
+	else
+	{
+		xid = HeapTupleHeaderGetRawXmax(tuple);
+		if (TransactionIdIsNormal(xid) &&
+			(!TransactionIdIsNormal(oldest) ||
+			 TransactionIdPrecedes(xid, oldest)))
+			oldest = xid;
+	}
+
+	if (tuple->t_infomask & HEAP_MOVED)
+	{
+		xid = HeapTupleHeaderGetXvac(tuple);
+		if (TransactionIdIsNormal(xid) &&
+			(!TransactionIdIsNormal(oldest) ||
+			 TransactionIdPrecedes(xid, oldest)))
+			oldest = xid;
+	}
+
+	return oldest;
+}
+
 /*
  * heap_tuple_needs_freeze
  *
@@ -7437,7 +7623,8 @@ log_heap_freeze(Relation reln, Buffer buffer, TransactionId cutoff_xid,
  */
 XLogRecPtr
 log_heap_visible(RelFileNode rnode, Buffer heap_buffer, Buffer vm_buffer,
-				 TransactionId cutoff_xid, uint8 vmflags)
+				 TransactionId cutoff_xid, TransactionId oldest_xid,
+				 uint8 vmflags)
 {
 	xl_heap_visible xlrec;
 	XLogRecPtr	recptr;
@@ -7447,6 +7634,7 @@ log_heap_visible(RelFileNode rnode, Buffer heap_buffer, Buffer vm_buffer,
 	Assert(BufferIsValid(vm_buffer));
 
 	xlrec.cutoff_xid = cutoff_xid;
+	xlrec.oldest_xid = oldest_xid;
 	xlrec.flags = vmflags;
 	XLogBeginInsert();
 	XLogRegisterData((char *) &xlrec, SizeOfHeapVisible);
@@ -8067,7 +8255,7 @@ heap_xlog_visible(XLogReaderState *record)
 
 		/* initialize the page if it was read as zeros */
 		if (PageIsNew(vmpage))
-			PageInit(vmpage, BLCKSZ, 0);
+			visibilitymap_page_init(vmpage);
 
 		/*
 		 * XLogReadBufferForRedoExtended locked the buffer. But
@@ -8091,7 +8279,8 @@ heap_xlog_visible(XLogReaderState *record)
 		 */
 		if (lsn > PageGetLSN(vmpage))
 			visibilitymap_set(reln, blkno, InvalidBuffer, lsn, vmbuffer,
-							  xlrec->cutoff_xid, xlrec->flags);
+							  xlrec->cutoff_xid, xlrec->oldest_xid,
+							  xlrec->flags);
 
 		ReleaseBuffer(vmbuffer);
 		FreeFakeRelcacheEntry(reln);
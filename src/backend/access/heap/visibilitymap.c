@@ -16,6 +16,9 @@
  *		visibilitymap_pin_ok - check whether correct map page is already pinned
  *		visibilitymap_set	 - set a bit in a previously pinned page
  *		visibilitymap_get_status - get status of bits
+ *		visibilitymap_get_freeze_horizon - get freeze horizon of a map page
+ *		visibilitymap_begin_freeze_horizon - start recomputing it
+ *		visibilitymap_raise_freeze_horizon - advance it after a full scan
  *		visibilitymap_count  - count number of bits set in visibility map
  *		visibilitymap_truncate	- truncate the visibility map
  *
@@ -52,6 +55,26 @@
  * VACUUM will normally skip pages for which the visibility map bit is set;
  * such pages can't contain any dead tuples and therefore don't need vacuuming.
  *
+ * Each map page also carries a freeze horizon for the range of heap pages it
+ * covers, kept in the pd_prune_xid field of its page header (which is
+ * otherwise unused on map pages).  None of the pages in the range that are
+ * all-visible but not all-frozen contains an unfrozen XID older than the
+ * horizon, nor an unfrozen MultiXactId.  FrozenTransactionId means that no
+ * such page has anything left to freeze, while InvalidTransactionId means
+ * that nothing is known.  Setting the all-visible bit for a page that is not
+ * also all-frozen lowers the horizon to cover that page, as part of the same
+ * WAL-logged change.  Locking a tuple on an all-visible page clears only the
+ * page's all-frozen bit, and the locker's XID (or MultiXactId) isn't known
+ * here, so that resets the horizon to InvalidTransactionId; again this is
+ * redone from the same WAL record.  VACUUM raises the horizon once it has
+ * examined all the pages in the range.  So that it doesn't overwrite a reset
+ * made by a concurrent locker meanwhile, it first replaces the horizon with
+ * VISIBILITYMAP_HORIZON_PENDING, which counts as unknown, and only stores the
+ * new horizon if that marker is still in place at the end.  An aggressive
+ * VACUUM can then skip the all-visible pages of any range whose horizon isn't
+ * older than its freeze cutoff, rather than reading every page that isn't
+ * all-frozen.
+ *
  * LOCKING
  *
  * In heapam.c, whenever a page is modified so that not all tuples on the
@@ -86,6 +109,7 @@
 #include "postgres.h"
 
 #include "access/heapam_xlog.h"
+#include "access/transam.h"
 #include "access/visibilitymap.h"
 #include "access/xlog.h"
 #include "miscadmin.h"
@@ -163,7 +187,13 @@ static void vm_extend(Relation rel, BlockNumber nvmblocks);
  *
  * You must pass a buffer containing the correct map page to this function.
  * Call visibilitymap_pin first to pin the right one. This function doesn't do
- * any I/O.  Returns true if any bits have been cleared and false otherwise.
+ * any I/O.  Returns true if any bits have been cleared or the freeze horizon
+ * has been reset, and false otherwise.
+ *
+ * Clearing just VISIBILITYMAP_ALL_FROZEN means that the heap page, while still
+ * all-visible, gained an XID or MultiXactId that will need freezing, so the
+ * freeze horizon is reset to unknown.  That is done even if the all-frozen bit
+ * was already clear.
  */
 bool
 visibilitymap_clear(Relation rel, BlockNumber heapBlk, Buffer buf, uint8 flags)
@@ -195,6 +225,19 @@ visibilitymap_clear(Relation rel, BlockNumber heapBlk, Buffer buf, uint8 flags)
 		cleared = true;
 	}
 
+	if ((flags & VISIBILITYMAP_ALL_FROZEN) != 0 &&
+		(map[mapByte] >> mapOffset & VISIBILITYMAP_ALL_VISIBLE) != 0)
+	{
+		PageHeader	phdr = (PageHeader) BufferGetPage(buf);
+
+		if (phdr->pd_prune_xid != InvalidTransactionId)
+		{
+			phdr->pd_prune_xid = InvalidTransactionId;
+			MarkBufferDirty(buf);
+			cleared = true;
+		}
+	}
+
 	LockBuffer(buf, BUFFER_LOCK_UNLOCK);
 
 	return cleared;
@@ -258,7 +301,9 @@ visibilitymap_pin_ok(BlockNumber heapBlk, Buffer buf)
  * marked all-visible; it is needed for Hot Standby, and can be
  * InvalidTransactionId if the page contains no tuples.  It can also be set
  * to InvalidTransactionId when a page that is already all-visible is being
- * marked all-frozen.
+ * marked all-frozen.  oldest_xid is the oldest unfrozen XID on the page, as
+ * computed by heap_tuple_oldest_unfrozen_xid; if the page is left all-visible
+ * but not all-frozen, the map page's freeze horizon is lowered to it.
  *
  * Caller is expected to set the heap page's PD_ALL_VISIBLE bit before calling
  * this function. Except in recovery, caller should also pass the heap
@@ -272,7 +317,7 @@ visibilitymap_pin_ok(BlockNumber heapBlk, Buffer buf)
 void
 visibilitymap_set(Relation rel, BlockNumber heapBlk, Buffer heapBuf,
 				  XLogRecPtr recptr, Buffer vmBuf, TransactionId cutoff_xid,
-				  uint8 flags)
+				  TransactionId oldest_xid, uint8 flags)
 {
 	BlockNumber mapBlock = HEAPBLK_TO_MAPBLOCK(heapBlk);
 	uint32		mapByte = HEAPBLK_TO_MAPBYTE(heapBlk);
@@ -305,6 +350,13 @@ visibilitymap_set(Relation rel, BlockNumber heapBlk, Buffer heapBuf,
 		START_CRIT_SECTION();
 
 		map[mapByte] |= (flags << mapOffset);
+		if ((map[mapByte] >> mapOffset & VISIBILITYMAP_ALL_FROZEN) == 0)
+		{
+			PageHeader	phdr = (PageHeader) page;
+
+			phdr->pd_prune_xid = visibilitymap_horizon_min(phdr->pd_prune_xid,
+														   oldest_xid);
+		}
 		MarkBufferDirty(vmBuf);
 
 		if (RelationNeedsWAL(rel))
@@ -313,7 +365,7 @@ visibilitymap_set(Relation rel, BlockNumber heapBlk, Buffer heapBuf,
 			{
 				Assert(!InRecovery);
 				recptr = log_heap_visible(rel->rd_node, heapBuf, vmBuf,
-										  cutoff_xid, flags);
+										  cutoff_xid, oldest_xid, flags);
 
 				/*
 				 * If data checksums are enabled (or wal_log_hints=on), we
@@ -397,6 +449,153 @@ visibilitymap_get_status(Relation rel, BlockNumber heapBlk, Buffer *buf)
 	return result;
 }
 
+/*
+ *	visibilitymap_get_freeze_horizon - get the freeze horizon of a map page
+ *
+ * Returns the freeze horizon of the map page covering heapBlk, or
+ * InvalidTransactionId if there is no such page.  *buf is handled the same
+ * way as by visibilitymap_get_status, and the same caveats about concurrent
+ * changes apply.
+ */
+TransactionId
+visibilitymap_get_freeze_horizon(Relation rel, BlockNumber heapBlk,
+								 Buffer *buf)
+{
+	BlockNumber mapBlock = HEAPBLK_TO_MAPBLOCK(heapBlk);
+
+	/* Reuse the old pinned buffer if possible */
+	if (BufferIsValid(*buf))
+	{
+		if (BufferGetBlockNumber(*buf) != mapBlock)
+		{
+			ReleaseBuffer(*buf);
+			*buf = InvalidBuffer;
+		}
+	}
+
+	if (!BufferIsValid(*buf))
+	{
+		*buf = vm_readbuf(rel, mapBlock, false);
+		if (!BufferIsValid(*buf))
+			return InvalidTransactionId;
+	}
+
+	/* An aligned four-byte read is atomic */
+	return ((PageHeader) BufferGetPage(*buf))->pd_prune_xid;
+}
+
+/*
+ *	visibilitymap_begin_freeze_horizon - start recomputing the freeze horizon
+ *
+ * Replace the freeze horizon of the map page covering heapBlk with
+ * VISIBILITYMAP_HORIZON_PENDING, and return the old one, for a VACUUM that is
+ * about to examine the range and then call visibilitymap_raise_freeze_horizon.
+ * vmBuf must be pinned by visibilitymap_pin.  Like raising the horizon, this
+ * isn't WAL-logged; it only makes the horizon unknown for the time being.
+ */
+TransactionId
+visibilitymap_begin_freeze_horizon(Relation rel, BlockNumber heapBlk,
+								   Buffer vmBuf)
+{
+	BlockNumber mapBlock = HEAPBLK_TO_MAPBLOCK(heapBlk);
+	PageHeader	phdr;
+	TransactionId horizon;
+
+	Assert(!InRecovery);
+
+	/* Check that we have the right VM page pinned */
+	if (!BufferIsValid(vmBuf) || BufferGetBlockNumber(vmBuf) != mapBlock)
+		elog(ERROR, "wrong VM buffer passed to visibilitymap_begin_freeze_horizon");
+
+	phdr = (PageHeader) BufferGetPage(vmBuf);
+
+	LockBuffer(vmBuf, BUFFER_LOCK_EXCLUSIVE);
+	horizon = phdr->pd_prune_xid;
+	if (horizon != VISIBILITYMAP_HORIZON_PENDING)
+	{
+		phdr->pd_prune_xid = VISIBILITYMAP_HORIZON_PENDING;
+		MarkBufferDirtyHint(vmBuf, false);
+	}
+	LockBuffer(vmBuf, BUFFER_LOCK_UNLOCK);
+
+	/* A marker left behind by an interrupted VACUUM means unknown */
+	if (horizon == VISIBILITYMAP_HORIZON_PENDING)
+		horizon = InvalidTransactionId;
+
+	return horizon;
+}
+
+/*
+ *	visibilitymap_raise_freeze_horizon - advance the freeze horizon
+ *
+ * Set the freeze horizon of the map page covering heapBlk to horizon, which
+ * the caller has computed by examining every page in the range that is
+ * all-visible but not all-frozen, after freezing what it could.  vmBuf must
+ * be pinned by visibilitymap_pin.  The caller must have started with
+ * visibilitymap_begin_freeze_horizon.  If the marker it left has been
+ * replaced since, a locker has reset the horizon, perhaps on a page the
+ * caller had already examined, and the reset stands.
+ *
+ * Raising the horizon isn't WAL-logged: it only lets future VACUUMs do less
+ * work, so losing it in a crash is harmless.  But we must not let the map
+ * page reach disk before the WAL records for the freezing that the new value
+ * depends on, so flush WAL first.
+ */
+void
+visibilitymap_raise_freeze_horizon(Relation rel, BlockNumber heapBlk,
+								   Buffer vmBuf, TransactionId horizon)
+{
+	BlockNumber mapBlock = HEAPBLK_TO_MAPBLOCK(heapBlk);
+	PageHeader	phdr;
+
+	Assert(!InRecovery);
+
+	/* Check that we have the right VM page pinned */
+	if (!BufferIsValid(vmBuf) || BufferGetBlockNumber(vmBuf) != mapBlock)
+		elog(ERROR, "wrong VM buffer passed to visibilitymap_raise_freeze_horizon");
+
+	if (RelationNeedsWAL(rel))
+		XLogFlush(GetXLogInsertRecPtr());
+
+	phdr = (PageHeader) BufferGetPage(vmBuf);
+
+	LockBuffer(vmBuf, BUFFER_LOCK_EXCLUSIVE);
+	if (phdr->pd_prune_xid == VISIBILITYMAP_HORIZON_PENDING)
+	{
+		phdr->pd_prune_xid = horizon;
+		MarkBufferDirtyHint(vmBuf, false);
+	}
+	LockBuffer(vmBuf, BUFFER_LOCK_UNLOCK);
+}
+
+/*
+ * Combine two freeze horizons into one that is valid for the pages covered
+ * by either of them.
+ */
+TransactionId
+visibilitymap_horizon_min(TransactionId a, TransactionId b)
+{
+	if (!TransactionIdIsValid(a) || !TransactionIdIsValid(b))
+		return InvalidTransactionId;
+	if (a == FrozenTransactionId)
+		return b;
+	if (b == FrozenTransactionId)
+		return a;
+	return TransactionIdPrecedes(a, b) ? a : b;
+}
+
+/*
+ * Initialize a new visibility map page.  There is nothing to freeze on a
+ * page whose bits are all clear, so the freeze horizon starts out as
+ * FrozenTransactionId.
+ */
+void
+visibilitymap_page_init(Page page)
+{
+	PageInit(page, BLCKSZ, 0);
+	((PageHeader) page)->pd_prune_xid = FrozenTransactionId;
+}
+
 /*
  *	visibilitymap_count  - count number of bits set in visibility map
  *
@@ -614,7 +813,7 @@ vm_readbuf(Relation rel, BlockNumber blkno, bool extend)
 	buf = ReadBufferExtended(rel, VISIBILITYMAP_FORKNUM, blkno,
 							 RBM_ZERO_ON_ERROR, NULL);
 	if (PageIsNew(BufferGetPage(buf)))
-		PageInit(BufferGetPage(buf), BLCKSZ, 0);
+		visibilitymap_page_init(BufferGetPage(buf));
 	return buf;
 }
 
@@ -629,7 +828,7 @@ vm_extend(Relation rel, BlockNumber vm_nblocks)
 	Page		pg;
 
 	pg = (Page) palloc(BLCKSZ);
-	PageInit(pg, BLCKSZ, 0);
+	visibilitymap_page_init(pg);
 
 	/*
 	 * We use the relation extension lock to lock out other backends trying to
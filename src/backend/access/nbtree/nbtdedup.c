@@ -0,0 +1,362 @@
+/*-------------------------------------------------------------------------
+ *
+ * nbtdedup.c
+ *	  Merge runs of duplicate leaf items into posting list tuples.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/nbtree/nbtdedup.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/nbtree.h"
+#include "access/nbtxlog.h"
+#include "access/xloginsert.h"
+#include "miscadmin.h"
+#include "utils/rel.h"
+
+
+static bool _bt_keys_equal(IndexTuple a, IndexTuple b);
+static int	_bt_tid_cmp(const void *a, const void *b);
+
+
+/*
+ *	_bt_dedup_one_page() -- Merge duplicates on a leaf page.
+ *
+ *		Called by _bt_findinsertloc() when the page it settled on is too full
+ *		for the new item, just before the page would be split.  Each run of
+ *		adjacent items with identical keys is replaced by a single posting
+ *		list tuple, which frees the space taken by all but one copy of the
+ *		key and all but one line pointer.  Returns true if the page was
+ *		changed, in which case the caller must not trust any offsets it
+ *		remembered on the page.
+ *
+ *		Items are only merged if their keys are byte-for-byte identical.
+ *		That is stricter than what the operator class considers equal, but
+ *		it never merges items that the opclass would order differently, and
+ *		it means that an index-only scan returns exactly the datums that
+ *		were inserted.  Items marked LP_DEAD are left alone: they will be
+ *		removed by the next _bt_vacuum_one_page() anyway.
+ *
+ *		Unique indexes are not deduplicated.  They only hold duplicates
+ *		while old row versions await VACUUM, and _bt_check_unique() expects
+ *		each item to point to a single heap tuple.
+ *
+ *		The buffer must be pinned and write-locked.
+ */
+bool
+_bt_dedup_one_page(Relation rel, Buffer buf)
+{
+	Page		page = BufferGetPage(buf);
+	BTPageOpaque opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+	BTDedupInterval intervals[MaxIndexTuplesPerPage];
+	int			nintervals = 0;
+	Size		maxpostingsize;
+	OffsetNumber offnum,
+				minoff,
+				maxoff;
+	IndexTuple	base = NULL;
+	OffsetNumber baseoff = InvalidOffsetNumber;
+	int			nitems = 0;
+	int			nhtids = 0;
+	Page		newpage;
+
+	Assert(P_ISLEAF(opaque));
+
+	if (rel->rd_index->indisunique)
+		return false;
+
+	/*
+	 * Keep posting list tuples well below the maximum item size, so that a
+	 * page always has room for a few of them, and so that VACUUM never has
+	 * to rewrite huge tuples to remove a single TID.
+	 */
+	maxpostingsize = Min(BTMaxItemSize(page) / 2, INDEX_SIZE_MASK);
+
+	minoff = P_FIRSTDATAKEY(opaque);
+	maxoff = PageGetMaxOffsetNumber(page);
+	for (offnum = minoff; offnum <= maxoff; offnum = OffsetNumberNext(offnum))
+	{
+		ItemId		itemid = PageGetItemId(page, offnum);
+		IndexTuple	itup = (IndexTuple) PageGetItem(page, itemid);
+		int			n = BTreeTupleGetNHeapTids(itup);
+
+		if (!ItemIdIsDead(itemid) && base != NULL &&
+			nhtids + n <= BT_OFFSET_MASK &&
+			MAXALIGN(BTreeTupleGetKeySize(base) +
+					 (nhtids + n) * sizeof(ItemPointerData)) <= maxpostingsize &&
+			_bt_keys_equal(base, itup))
+		{
+			/* extend the current run */
+			nitems++;
+			nhtids += n;
+			continue;
+		}
+
+		/* close out the current run, if it's worth merging */
+		if (nitems > 1)
+		{
+			intervals[nintervals].baseoff = baseoff;
+			intervals[nintervals].nitems = nitems;
+			nintervals++;
+		}
+
+		/* and start a new one at this item, unless it's dead */
+		if (ItemIdIsDead(itemid))
+		{
+			base = NULL;
+			nitems = 0;
+			nhtids = 0;
+		}
+		else
+		{
+			base = itup;
+			baseoff = offnum;
+			nitems = 1;
+			nhtids = n;
+		}
+	}
+	if (nitems > 1)
+	{
+		intervals[nintervals].baseoff = baseoff;
+		intervals[nintervals].nitems = nitems;
+		nintervals++;
+	}
+
+	if (nintervals == 0)
+		return false;
+
+	/* Build the new page contents before entering the critical section */
+	newpage = _bt_dedup_build_page(page, intervals, nintervals);
+
+	/* No ereport(ERROR) until changes are logged */
+	START_CRIT_SECTION();
+
+	PageRestoreTempPage(newpage, page);
+	MarkBufferDirty(buf);
+
+	/* XLOG stuff */
+	if (RelationNeedsWAL(rel))
+	{
+		XLogRecPtr	recptr;
+		xl_btree_dedup xlrec;
+
+		xlrec.nintervals = nintervals;
+
+		XLogBeginInsert();
+		XLogRegisterBuffer(0, buf, REGBUF_STANDARD);
+		XLogRegisterData((char *) &xlrec, SizeOfBtreeDedup);
+
+		/*
+		 * The intervals array is not in the buffer, but pretend that it is.
+		 * When XLogInsert stores the whole buffer, the array need not be
+		 * stored too.
+		 */
+		XLogRegisterBufData(0, (char *) intervals,
+							nintervals * sizeof(BTDedupInterval));
+
+		recptr = XLogInsert(RM_BTREE_ID, XLOG_BTREE_DEDUP);
+
+		PageSetLSN(page, recptr);
+	}
+
+	END_CRIT_SECTION();
+
+	return true;
+}
+
+/*
+ *	_bt_dedup_build_page() -- Build a deduplicated copy of a leaf page.
+ *
+ *		Returns a palloc'd temporary page, to be installed with
+ *		PageRestoreTempPage(), holding the same items as "page" except that
+ *		each run of items described by "intervals" (which must be in
+ *		increasing offset order) is merged into one posting list tuple.
+ *		This is shared by _bt_dedup_one_page() and WAL replay, so that both
+ *		produce the same page.
+ */
+Page
+_bt_dedup_build_page(Page page, BTDedupInterval *intervals, int nintervals)
+{
+	BTPageOpaque opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+	Page		newpage;
+	OffsetNumber offnum,
+				minoff,
+				maxoff,
+				newoff;
+	int			k = 0;
+
+	newpage = PageGetTempPageCopySpecial(page);
+	PageSetLSN(newpage, PageGetLSN(page));
+
+	minoff = P_FIRSTDATAKEY(opaque);
+	maxoff = PageGetMaxOffsetNumber(page);
+
+	/* Copy the high key, if any */
+	newoff = P_HIKEY;
+	if (!P_RIGHTMOST(opaque))
+	{
+		ItemId		itemid = PageGetItemId(page, P_HIKEY);
+
+		if (PageAddItem(newpage, PageGetItem(page, itemid),
+						ItemIdGetLength(itemid), newoff,
+						false, false) == InvalidOffsetNumber)
+			elog(ERROR, "failed to add high key while deduplicating index page");
+		newoff = OffsetNumberNext(newoff);
+	}
+
+	for (offnum = minoff; offnum <= maxoff; offnum = OffsetNumberNext(offnum))
+	{
+		ItemId		itemid = PageGetItemId(page, offnum);
+		IndexTuple	itup = (IndexTuple) PageGetItem(page, itemid);
+
+		if (k < nintervals && intervals[k].baseoff == offnum)
+		{
+			ItemPointerData htids[MaxTIDsPerBTreePage];
+			int			nhtids = 0;
+			IndexTuple	posting;
+			int			i;
+
+			Assert(offnum + intervals[k].nitems - 1 <= maxoff);
+
+			/* Gather up the heap TIDs of all the items in the run */
+			for (i = 0; i < intervals[k].nitems; i++)
+			{
+				IndexTuple	dup;
+
+				dup = (IndexTuple) PageGetItem(page,
+											   PageGetItemId(page, offnum + i));
+				if (BTreeTupleIsPosting(dup))
+				{
+					memcpy(htids + nhtids, BTreeTupleGetPosting(dup),
+						   BTreeTupleGetNPosting(dup) * sizeof(ItemPointerData));
+					nhtids += BTreeTupleGetNPosting(dup);
+				}
+				else
+					htids[nhtids++] = dup->t_tid;
+			}
+
+			posting = _bt_form_posting(itup, htids, nhtids);
+			if (PageAddItem(newpage, (Item) posting,
+							MAXALIGN(IndexTupleSize(posting)), newoff,
+							false, false) == InvalidOffsetNumber)
+				elog(ERROR, "failed to add posting list tuple while deduplicating index page");
+			pfree(posting);
+
+			offnum += intervals[k].nitems - 1;
+			k++;
+		}
+		else
+		{
+			if (PageAddItem(newpage, (Item) itup, ItemIdGetLength(itemid),
+							newoff, false, false) == InvalidOffsetNumber)
+				elog(ERROR, "failed to add item while deduplicating index page");
+			/* preserve the LP_DEAD hint */
+			if (ItemIdIsDead(itemid))
+				ItemIdMarkDead(PageGetItemId(newpage, newoff));
+		}
+		newoff = OffsetNumberNext(newoff);
+	}
+
+	if (k != nintervals)
+		elog(ERROR, "deduplication interval at offset %u is beyond end of index page",
+			 intervals[k].baseoff);
+
+	return newpage;
+}
+
+/*
+ *	_bt_form_posting() -- Form a leaf tuple with the key of "base" that
+ *		points to the given heap TIDs.
+ *
+ *		With more than one TID the result is a posting list tuple, with the
+ *		TIDs in sorted order; with just one it is a plain tuple.  "base" may
+ *		itself be a posting list tuple, whose own TIDs are disregarded.
+ *		The result is palloc'd.
+ */
+IndexTuple
+_bt_form_posting(IndexTuple base, ItemPointer htids, int nhtids)
+{
+	Size		keysize = BTreeTupleGetKeySize(base);
+	Size		newsize;
+	IndexTuple	itup;
+
+	Assert(keysize == MAXALIGN(keysize));
+	Assert(nhtids > 0 && nhtids <= BT_OFFSET_MASK);
+
+	if (nhtids > 1)
+		newsize = MAXALIGN(keysize + nhtids * sizeof(ItemPointerData));
+	else
+		newsize = keysize;
+	Assert(newsize <= INDEX_SIZE_MASK);
+
+	itup = (IndexTuple) palloc0(newsize);
+	memcpy(itup, base, keysize);
+	itup->t_info &= ~(INDEX_SIZE_MASK | INDEX_ALT_TID_MASK);
+	itup->t_info |= newsize;
+
+	if (nhtids > 1)
+	{
+		ItemPointer posting = (ItemPointer) ((char *) itup + keysize);
+
+		memcpy(posting, htids, nhtids * sizeof(ItemPointerData));
+		qsort(posting, nhtids, sizeof(ItemPointerData), _bt_tid_cmp);
+		BTreeTupleSetPosting(itup, nhtids, keysize);
+	}
+	else
+		itup->t_tid = htids[0];
+
+	return itup;
+}
+
+/*
+ *	_bt_strip_posting() -- Return a palloc'd copy of a leaf tuple without
+ *		its posting list, if any.
+ *
+ *		High keys and downlinks are copied from leaf items, but must never be
+ *		posting list tuples: their t_tid has other uses (see nbtpage.c).  The
+ *		copy's t_tid is set to the lowest heap TID, so that it looks just like
+ *		the plain tuple that item would have been without deduplication.
+ */
+IndexTuple
+_bt_strip_posting(IndexTuple itup)
+{
+	if (!BTreeTupleIsPosting(itup))
+		return CopyIndexTuple(itup);
+
+	return _bt_form_posting(itup, BTreeTupleGetPosting(itup), 1);
+}
+
+/*
+ * Do two leaf tuples have byte-for-byte identical keys?
+ */
+static bool
+_bt_keys_equal(IndexTuple a, IndexTuple b)
+{
+	Size		keysize = BTreeTupleGetKeySize(a);
+
+	if (BTreeTupleGetKeySize(b) != keysize)
+		return false;
+	if ((a->t_info & (INDEX_NULL_MASK | INDEX_VAR_MASK)) !=
+		(b->t_info & (INDEX_NULL_MASK | INDEX_VAR_MASK)))
+		return false;
+
+	return memcmp((char *) a + sizeof(IndexTupleData),
+				  (char *) b + sizeof(IndexTupleData),
+				  keysize - sizeof(IndexTupleData)) == 0;
+}
+
+/*
+ * qsort comparator for heap TIDs
+ */
+static int
+_bt_tid_cmp(const void *a, const void *b)
+{
+	return ItemPointerCompare((ItemPointer) a, (ItemPointer) b);
+}
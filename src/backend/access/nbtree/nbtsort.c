@@ -55,6 +55,17 @@
  * This code isn't concerned about the FSM at all. The caller is responsible
  * for initializing that.
  *
+ * If the planner asked for parallel workers (see plan_create_index_workers),
+ * the build is done in parallel.  The leader and each worker claim ranges of
+ * heap blocks from a shared counter until the whole heap has been scanned,
+ * spooling index tuples into a tuplesort of their own, each with an even
+ * share of maintenance_work_mem.  Once a worker has sorted its tuples, it
+ * streams them in order to the leader through a shm_mq.  The leader merges
+ * its own sorted output with the workers' streams and loads the result into
+ * the index exactly as in a serial build.  Each participant's tuplesort only
+ * enforces uniqueness among its own tuples, so for a unique index the leader
+ * checks for duplicates across participants as it merges.
+ *
  * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
  *
@@ -67,28 +78,125 @@
 #include "postgres.h"
 
 #include "access/nbtree.h"
+#include "access/parallel.h"
+#include "access/xact.h"
 #include "access/xlog.h"
 #include "access/xloginsert.h"
+#include "catalog/index.h"
+#include "lib/binaryheap.h"
 #include "miscadmin.h"
 #include "storage/smgr.h"
+#include "storage/spin.h"
 #include "tcop/tcopprot.h"
 #include "utils/rel.h"
 #include "utils/sortsupport.h"
 #include "utils/tuplesort.h"
 
 
+/* Magic numbers for parallel state sharing */
+#define PARALLEL_KEY_BTREE_SHARED		UINT64CONST(0xB000000000000001)
+#define PARALLEL_KEY_TUPLE_QUEUES		UINT64CONST(0xB000000000000002)
+
+/*
+ * Size of the queue each worker sends its sorted index tuples through, and
+ * the maximum number of heap blocks a participant claims at a time.
+ */
+#define PARALLEL_BTREE_QUEUE_SIZE		65536
+#define PARALLEL_BTREE_MAX_CHUNK_BLOCKS	256
+
 /*
  * Status record for spooling/sorting phase.  (Note we may have two of
  * these due to the special requirements for uniqueness-checking with
  * dead tuples.)
  */
-struct BTSpool
+typedef struct BTSpool
 {
 	Tuplesortstate *sortstate;	/* state data for tuplesort.c */
 	Relation	heap;
 	Relation	index;
 	bool		isunique;
-};
+} BTSpool;
+
+/* Working state for btbuild and its callback */
+typedef struct BTBuildState
+{
+	bool		isUnique;
+	bool		haveDead;
+	Relation	heapRel;
+	BTSpool    *spool;
+
+	/*
+	 * spool2 is needed only when the index is a unique index. Dead tuples are
+	 * put into spool2 instead of spool in order to avoid uniqueness check.
+	 */
+	BTSpool    *spool2;
+	double		indtuples;
+} BTBuildState;
+
+/*
+ * Status for a parallel index build, shared by the leader and its workers in
+ * dynamic shared memory.
+ */
+typedef struct BTShared
+{
+	/*
+	 * These fields are not modified during the build.  They exist so that
+	 * workers can open the relations and set up their sorts.
+	 */
+	Oid			heaprelid;
+	Oid			indexrelid;
+	bool		isunique;
+	int			sortmem;		/* kB of memory for each participant's sort */
+	BlockNumber nblocks;		/* # of heap blocks to scan */
+	BlockNumber chunkblocks;	/* # of blocks to claim at a time */
+
+	/* mutex protects all the fields below */
+	slock_t		mutex;
+	BlockNumber nextblock;		/* next heap block not yet claimed */
+	double		reltuples;		/* # of heap tuples scanned by workers */
+	double		indtuples;		/* # of index tuples produced by workers */
+	bool		brokenhotchain; /* did any worker see a broken HOT chain? */
+} BTShared;
+
+/*
+ * Header sent ahead of each index tuple a worker passes to the leader.  It's
+ * padded to MAXALIGN so that the tuple itself stays aligned in the buffer
+ * the leader receives it in.
+ */
+typedef union BTTupleHeader
+{
+	bool		isdead;			/* tuple is for a dead heap tuple? */
+	char		pad[MAXIMUM_ALIGNOF];
+} BTTupleHeader;
+
+/*
+ * One input to a merge of sorted index tuples: either a local tuplesort, or
+ * the queue through which a worker sends its sorted tuples.
+ */
+typedef struct BTMergeInput
+{
+	Tuplesortstate *sortstate;	/* local sort, or NULL */
+	bool		sortdead;		/* sortstate holds dead tuples? */
+	shm_mq_handle *mqh;			/* worker's queue, if sortstate is NULL */
+	IndexTuple	itup;			/* current tuple, or NULL if exhausted */
+	bool		itupdead;		/* itup is for a dead heap tuple? */
+} BTMergeInput;
+
+/*
+ * State for merging several sorted streams of index tuples into one.
+ */
+typedef struct BTMergeState
+{
+	Relation	heap;
+	Relation	index;
+	bool		checkunique;	/* check for duplicates across inputs? */
+	int			keysz;
+	SortSupport sortKeys;
+	int			ninputs;
+	BTMergeInput *inputs;
+	binaryheap *heap_inputs;	/* inputs that have a current tuple */
+	int			lastinput;		/* input last tuple came from, or -1 */
+} BTMergeState;
 
 /*
  * Status record for a btree page being built.  We have one of these
@@ -128,6 +236,21 @@ typedef struct BTWriteState
 } BTWriteState;
 
 
+static BTSpool *_bt_spoolinit(Relation heap, Relation index,
+			  bool isunique, bool isdead, int sortmem);
+static void _bt_spooldestroy(BTSpool *btspool);
+static void _bt_spool(BTSpool *btspool, ItemPointer self,
+		  Datum *values, bool *isnull);
+static void btbuildCallback(Relation index,
+				HeapTuple htup,
+				Datum *values,
+				bool *isnull,
+				bool tupleIsAlive,
+				void *state);
+static void _bt_leafbuild(BTSpool *btspool, BTSpool *btspool2);
+static void _bt_initwstate(BTWriteState *wstate, Relation heap,
+			   Relation index);
+static SortSupport _bt_prepare_sortkeys(Relation index);
 static Page _bt_blnewpage(uint32 level);
 static BTPageState *_bt_pagestate(BTWriteState *wstate, uint32 level);
 static void _bt_slideleft(Page page);
@@ -137,7 +260,25 @@ static void _bt_buildadd(BTWriteState *wstate, BTPageState *state,
 			 IndexTuple itup);
 static void _bt_uppershutdown(BTWriteState *wstate, BTPageState *state);
 static void _bt_load(BTWriteState *wstate,
-		 BTSpool *btspool, BTSpool *btspool2);
+		 BTSpool *btspool, BTSpool *btspool2, BTMergeState *mstate);
+static double _bt_parallel_build(Relation heap, Relation index,
+				   IndexInfo *indexInfo, BTBuildState *buildstate);
+static double _bt_parallel_scan_and_sort(BTShared *btshared,
+						   BTBuildState *buildstate, Relation index,
+						   IndexInfo *indexInfo);
+static void _bt_parallel_send(BTMergeState *mstate, shm_mq_handle *mqh);
+static void _bt_merge_init(BTMergeState *mstate, Relation heap,
+			   Relation index, bool checkunique, int maxinputs);
+static void _bt_merge_add_sort(BTMergeState *mstate, BTSpool *btspool,
+				   bool isdead);
+static void _bt_merge_add_queue(BTMergeState *mstate, shm_mq_handle *mqh);
+static void _bt_merge_begin(BTMergeState *mstate);
+static IndexTuple _bt_merge_next(BTMergeState *mstate, bool *isdead);
+static void _bt_merge_end(BTMergeState *mstate);
+static bool _bt_merge_fetch(BTMergeInput *input);
+static int	_bt_merge_compare(Datum a, Datum b, void *arg);
+static int32 _bt_compare_keys(BTMergeState *mstate, IndexTuple itup1,
+				 IndexTuple itup2, bool *hasnull);
 
 
 /*
@@ -145,11 +286,111 @@ static void _bt_load(BTWriteState *wstate,
  */
 
 
+/*
+ *	btbuild() -- build a new btree index.
+ */
+IndexBuildResult *
+btbuild(Relation heap, Relation index, IndexInfo *indexInfo)
+{
+	IndexBuildResult *result;
+	double		reltuples;
+	BTBuildState buildstate;
+
+	buildstate.isUnique = indexInfo->ii_Unique;
+	buildstate.haveDead = false;
+	buildstate.heapRel = heap;
+	buildstate.spool = NULL;
+	buildstate.spool2 = NULL;
+	buildstate.indtuples = 0;
+
+#ifdef BTREE_BUILD_STATS
+	if (log_btree_build_stats)
+		ResetUsage();
+#endif   /* BTREE_BUILD_STATS */
+
+	/*
+	 * We expect to be called exactly once for any index relation. If that's
+	 * not the case, big trouble's what we have.
+	 */
+	if (RelationGetNumberOfBlocks(index) != 0)
+		elog(ERROR, "index \"%s\" already contains data",
+			 RelationGetRelationName(index));
+
+	if (indexInfo->ii_ParallelWorkers > 0)
+	{
+		/* scan, sort and load the index with the help of workers */
+		reltuples = _bt_parallel_build(heap, index, indexInfo, &buildstate);
+	}
+	else
+	{
+		buildstate.spool = _bt_spoolinit(heap, index, indexInfo->ii_Unique,
+										 false, maintenance_work_mem);
+
+		/*
+		 * If building a unique index, put dead tuples in a second spool to
+		 * keep them out of the uniqueness check.
+		 */
+		if (indexInfo->ii_Unique)
+			buildstate.spool2 = _bt_spoolinit(heap, index, false, true,
+											  maintenance_work_mem);
+
+		/* do the heap scan */
+		reltuples = IndexBuildHeapScan(heap, index, indexInfo, true,
+									   btbuildCallback, (void *) &buildstate);
+
+		/* okay, all heap tuples are indexed */
+		if (buildstate.spool2 && !buildstate.haveDead)
+		{
+			/* spool2 turns out to be unnecessary */
+			_bt_spooldestroy(buildstate.spool2);
+			buildstate.spool2 = NULL;
+		}
+
+		/*
+		 * Finish the build by (1) completing the sort of the spool file, (2)
+		 * inserting the sorted tuples into btree pages and (3) building the
+		 * upper levels.
+		 */
+		_bt_leafbuild(buildstate.spool, buildstate.spool2);
+		_bt_spooldestroy(buildstate.spool);
+		if (buildstate.spool2)
+			_bt_spooldestroy(buildstate.spool2);
+	}
+
+#ifdef BTREE_BUILD_STATS
+	if (log_btree_build_stats)
+	{
+		ShowUsage("BTREE BUILD STATS");
+		ResetUsage();
+	}
+#endif   /* BTREE_BUILD_STATS */
+
+	/*
+	 * Return statistics
+	 */
+	result = (IndexBuildResult *) palloc(sizeof(IndexBuildResult));
+
+	result->heap_tuples = reltuples;
+	result->index_tuples = buildstate.indtuples;
+
+	return result;
+}
+
 /*
  * create and initialize a spool structure
+ *
+ * sortmem is the amount of memory, in kB, to use for the sort.  For a
+ * serial build that is maintenance_work_mem rather than work_mem, to speed
+ * index creation; this should be OK since a single backend can't run
+ * multiple index creations in parallel.  For a parallel build, each
+ * participant gets a share of maintenance_work_mem.  Note that creation of a
+ * unique index actually requires two BTSpool objects.  We expect that the
+ * second one (for dead tuples) won't get very full, so we give it no more
+ * than work_mem.
  */
-BTSpool *
-_bt_spoolinit(Relation heap, Relation index, bool isunique, bool isdead)
+static BTSpool *
+_bt_spoolinit(Relation heap, Relation index, bool isunique, bool isdead,
+			  int sortmem)
 {
 	BTSpool    *btspool = (BTSpool *) palloc0(sizeof(BTSpool));
 	int			btKbytes;
@@ -158,15 +399,7 @@ _bt_spoolinit(Relation heap, Relation index, bool isunique, bool isdead)
 	btspool->index = index;
 	btspool->isunique = isunique;
 
-	/*
-	 * We size the sort area as maintenance_work_mem rather than work_mem to
-	 * speed index creation.  This should be OK since a single backend can't
-	 * run multiple index creations in parallel.  Note that creation of a
-	 * unique index actually requires two BTSpool objects.  We expect that the
-	 * second one (for dead tuples) won't get very full, so we give it only
-	 * work_mem.
-	 */
-	btKbytes = isdead ? work_mem : maintenance_work_mem;
+	btKbytes = isdead ? Min(work_mem, sortmem) : sortmem;
 	btspool->sortstate = tuplesort_begin_index_btree(heap, index, isunique,
 													 btKbytes, false);
 
@@ -176,7 +409,7 @@ _bt_spoolinit(Relation heap, Relation index, bool isunique, bool isdead)
 /*
  * clean up a spool structure and its substructures.
  */
-void
+static void
 _bt_spooldestroy(BTSpool *btspool)
 {
 	tuplesort_end(btspool->sortstate);
@@ -186,18 +419,47 @@ _bt_spooldestroy(BTSpool *btspool)
 /*
  * spool an index entry into the sort file.
  */
-void
+static void
 _bt_spool(BTSpool *btspool, ItemPointer self, Datum *values, bool *isnull)
 {
 	tuplesort_putindextuplevalues(btspool->sortstate, btspool->index,
 								  self, values, isnull);
 }
 
+/*
+ * Per-tuple callback from IndexBuildHeapScan
+ */
+static void
+btbuildCallback(Relation index,
+				HeapTuple htup,
+				Datum *values,
+				bool *isnull,
+				bool tupleIsAlive,
+				void *state)
+{
+	BTBuildState *buildstate = (BTBuildState *) state;
+
+	/*
+	 * insert the index tuple into the appropriate spool file for subsequent
+	 * processing
+	 */
+	if (tupleIsAlive || buildstate->spool2 == NULL)
+		_bt_spool(buildstate->spool, &htup->t_self, values, isnull);
+	else
+	{
+		/* dead tuples are put into spool2 */
+		buildstate->haveDead = true;
+		_bt_spool(buildstate->spool2, &htup->t_self, values, isnull);
+	}
+
+	buildstate->indtuples += 1;
+}
+
 /*
  * given a spool loaded by successive calls to _bt_spool,
  * create an entire btree.
  */
-void
+static void
 _bt_leafbuild(BTSpool *btspool, BTSpool *btspool2)
 {
 	BTWriteState wstate;
@@ -214,28 +476,77 @@ _bt_leafbuild(BTSpool *btspool, BTSpool *btspool2)
 	if (btspool2)
 		tuplesort_performsort(btspool2->sortstate);
 
-	wstate.heap = btspool->heap;
-	wstate.index = btspool->index;
+	_bt_initwstate(&wstate, btspool->heap, btspool->index);
+	_bt_load(&wstate, btspool, btspool2, NULL);
+}
+
+
+/*
+ * Internal routines.
+ */
+
+
+/*
+ * set up the state for writing out a new index
+ */
+static void
+_bt_initwstate(BTWriteState *wstate, Relation heap, Relation index)
+{
+	wstate->heap = heap;
+	wstate->index = index;
 
 	/*
 	 * We need to log index creation in WAL iff WAL archiving/streaming is
 	 * enabled UNLESS the index isn't WAL-logged anyway.
 	 */
-	wstate.btws_use_wal = XLogIsNeeded() && RelationNeedsWAL(wstate.index);
+	wstate->btws_use_wal = XLogIsNeeded() && RelationNeedsWAL(wstate->index);
 
 	/* reserve the metapage */
-	wstate.btws_pages_alloced = BTREE_METAPAGE + 1;
-	wstate.btws_pages_written = 0;
-	wstate.btws_zeropage = NULL;	/* until needed */
-
-	_bt_load(&wstate, btspool, btspool2);
+	wstate->btws_pages_alloced = BTREE_METAPAGE + 1;
+	wstate->btws_pages_written = 0;
+	wstate->btws_zeropage = NULL;	/* until needed */
 }
 
-
 /*
- * Internal routines.
+ * prepare SortSupport data for comparing the index's key columns
  */
+static SortSupport
+_bt_prepare_sortkeys(Relation index)
+{
+	int			keysz = RelationGetNumberOfAttributes(index);
+	ScanKey		indexScanKey;
+	SortSupport sortKeys;
+	int			i;
+
+	indexScanKey = _bt_mkscankey_nodata(index);
+	sortKeys = (SortSupport) palloc0(keysz * sizeof(SortSupportData));
+
+	for (i = 0; i < keysz; i++)
+	{
+		SortSupport sortKey = sortKeys + i;
+		ScanKey		scanKey = indexScanKey + i;
+		int16		strategy;
 
+		sortKey->ssup_cxt = CurrentMemoryContext;
+		sortKey->ssup_collation = scanKey->sk_collation;
+		sortKey->ssup_nulls_first =
+			(scanKey->sk_flags & SK_BT_NULLS_FIRST) != 0;
+		sortKey->ssup_attno = scanKey->sk_attno;
+		/* Abbreviation is not supported here */
+		sortKey->abbreviate = false;
+
+		AssertState(sortKey->ssup_attno != 0);
+
+		strategy = (scanKey->sk_flags & SK_BT_DESC) != 0 ?
+			BTGreaterStrategyNumber : BTLessStrategyNumber;
+
+		PrepareSortSupportFromIndexRel(index, strategy, sortKey);
+	}
+
+	_bt_freeskey(indexScanKey);
+
+	return sortKeys;
+}
 
 /*
  * allocate workspace for a new, clean btree page, not linked to any siblings.
@@ -537,6 +848,32 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup)
 		ItemIdSetUnused(ii);	/* redundant */
 		((PageHeader) opage)->pd_lower -= sizeof(ItemIdData);
 
+		/*
+		 * On the leaf level, replace the high key with a copy that keeps only
+		 * the attributes needed to separate it from the item before it, as
+		 * _bt_split() does.  The truncated tuple is never larger, so it fits
+		 * in the space freed by the one it replaces.  It also becomes the new
+		 * page's downlink, below.
+		 */
+		if (state->btps_level == 0)
+		{
+			IndexTuple	lastleft;
+			IndexTuple	truncated;
+
+			ii = PageGetItemId(opage, OffsetNumberPrev(last_off));
+			lastleft = (IndexTuple) PageGetItem(opage, ii);
+
+			truncated = _bt_truncate(wstate->index, lastleft, oitup);
+			PageIndexTupleDelete(opage, P_HIKEY);
+			_bt_sortaddtup(opage, MAXALIGN(IndexTupleSize(truncated)),
+						   truncated, P_HIKEY);
+			pfree(truncated);
+
+			/* oitup should continue to point to the page's high key */
+			hii = PageGetItemId(opage, P_HIKEY);
+			oitup = (IndexTuple) PageGetItem(opage, hii);
+		}
+
 		/*
 		 * Link the old page into its parent, using its minimum key. If we
 		 * don't have a parent, we have to create one; this adds a new btree
@@ -546,7 +883,7 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup)
 			state->btps_next = _bt_pagestate(wstate, state->btps_level + 1);
 
 		Assert(state->btps_minkey != NULL);
-		ItemPointerSet(&(state->btps_minkey->t_tid), oblkno, P_HIKEY);
+		BTreeInnerTupleSetDownLink(state->btps_minkey, oblkno);
 		_bt_buildadd(wstate, state->btps_next, state->btps_minkey);
 		pfree(state->btps_minkey);
 
@@ -643,7 +980,7 @@ _bt_uppershutdown(BTWriteState *wstate, BTPageState *state)
 		else
 		{
 			Assert(s->btps_minkey != NULL);
-			ItemPointerSet(&(s->btps_minkey->t_tid), blkno, P_HIKEY);
+			BTreeInnerTupleSetDownLink(s->btps_minkey, blkno);
 			_bt_buildadd(wstate, s->btps_next, s->btps_minkey);
 			pfree(s->btps_minkey);
 			s->btps_minkey = NULL;
@@ -672,9 +1009,13 @@ _bt_uppershutdown(BTWriteState *wstate, BTPageState *state)
 /*
  * Read tuples in correct sort order from tuplesort, and load them into
  * btree leaves.
+ *
+ * In a parallel build, mstate supplies the tuples instead, merged from the
+ * sorted output of all participants, and the spools are not used.
  */
 static void
-_bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
+_bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2,
+		 BTMergeState *mstate)
 {
 	BTPageState *state = NULL;
 	bool		merge = (btspool2 != NULL);
@@ -684,10 +1025,62 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 	TupleDesc	tupdes = RelationGetDescr(wstate->index);
 	int			i,
 				keysz = RelationGetNumberOfAttributes(wstate->index);
-	ScanKey		indexScanKey = NULL;
 	SortSupport sortKeys;
 
-	if (merge)
+	if (mstate != NULL)
+	{
+		IndexTuple	lastlive = NULL;
+		bool		isdead;
+
+		while ((itup = _bt_merge_next(mstate, &isdead)) != NULL)
+		{
+			/*
+			 * Each participant's sort only checked uniqueness among its own
+			 * tuples, so compare each live tuple with the previous one.
+			 * Dead tuples don't take part, just as in a serial build.
+			 */
+			if (mstate->checkunique && !isdead)
+			{
+				if (lastlive != NULL)
+				{
+					bool		hasnull;
+
+					if (_bt_compare_keys(mstate, lastlive, itup, &hasnull) == 0 &&
+						!hasnull)
+					{
+						Datum		values[INDEX_MAX_KEYS];
+						bool		isnull[INDEX_MAX_KEYS];
+						char	   *key_desc;
+
+						index_deform_tuple(itup, tupdes, values, isnull);
+						key_desc = BuildIndexValueDescription(wstate->index,
+															  values, isnull);
+
+						ereport(ERROR,
+								(errcode(ERRCODE_UNIQUE_VIOLATION),
+								 errmsg("could not create unique index \"%s\"",
+										RelationGetRelationName(wstate->index)),
+								 key_desc ? errdetail("Key %s is duplicated.", key_desc) :
+								 errdetail("Duplicate keys exist."),
+								 errtableconstraint(wstate->heap,
+								   RelationGetRelationName(wstate->index))));
+					}
+					pfree(lastlive);
+				}
+				lastlive = CopyIndexTuple(itup);
+			}
+
+			/* When we see first tuple, create first index page */
+			if (state == NULL)
+				state = _bt_pagestate(wstate, 0);
+
+			_bt_buildadd(wstate, state, itup);
+		}
+
+		if (lastlive != NULL)
+			pfree(lastlive);
+	}
+	else if (merge)
 	{
 		/*
 		 * Another BTSpool for dead tuples exists. Now we have to merge
@@ -697,34 +1090,9 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 		/* the preparation of merge */
 		itup = tuplesort_getindextuple(btspool->sortstate, true);
 		itup2 = tuplesort_getindextuple(btspool2->sortstate, true);
-		indexScanKey = _bt_mkscankey_nodata(wstate->index);
 
 		/* Prepare SortSupport data for each column */
-		sortKeys = (SortSupport) palloc0(keysz * sizeof(SortSupportData));
-
-		for (i = 0; i < keysz; i++)
-		{
-			SortSupport sortKey = sortKeys + i;
-			ScanKey		scanKey = indexScanKey + i;
-			int16		strategy;
-
-			sortKey->ssup_cxt = CurrentMemoryContext;
-			sortKey->ssup_collation = scanKey->sk_collation;
-			sortKey->ssup_nulls_first =
-				(scanKey->sk_flags & SK_BT_NULLS_FIRST) != 0;
-			sortKey->ssup_attno = scanKey->sk_attno;
-			/* Abbreviation is not supported here */
-			sortKey->abbreviate = false;
-
-			AssertState(sortKey->ssup_attno != 0);
-
-			strategy = (scanKey->sk_flags & SK_BT_DESC) != 0 ?
-				BTGreaterStrategyNumber : BTLessStrategyNumber;
-
-			PrepareSortSupportFromIndexRel(wstate->index, strategy, sortKey);
-		}
-
-		_bt_freeskey(indexScanKey);
+		sortKeys = _bt_prepare_sortkeys(wstate->index);
 
 		for (;;)
 		{
@@ -819,3 +1187,479 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 		smgrimmedsync(wstate->index->rd_smgr, MAIN_FORKNUM);
 	}
 }
+
+/*
+ * Build the index with the help of parallel worker processes, the leader
+ * taking part in the heap scan as well.  Returns the number of heap tuples
+ * scanned; the number of index tuples is accumulated in buildstate.
+ */
+static double
+_bt_parallel_build(Relation heap, Relation index, IndexInfo *indexInfo,
+				   BTBuildState *buildstate)
+{
+	ParallelContext *pcxt;
+	BTShared   *btshared;
+	char	   *mqspace;
+	shm_mq_handle **mqhs;
+	BTMergeState mstate;
+	BTWriteState wstate;
+	double		reltuples;
+	int			i;
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext(_bt_parallel_build_main,
+								 indexInfo->ii_ParallelWorkers);
+
+	/* Estimate space for our shared state and the tuple queues */
+	shm_toc_estimate_chunk(&pcxt->estimator, sizeof(BTShared));
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(PARALLEL_BTREE_QUEUE_SIZE, pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 2);
+
+	InitializeParallelDSM(pcxt);
+
+	/*
+	 * Store the shared build state.  Memory is divided evenly between the
+	 * participants we asked for, including the leader.
+	 */
+	btshared = (BTShared *) shm_toc_allocate(pcxt->toc, sizeof(BTShared));
+	btshared->heaprelid = RelationGetRelid(heap);
+	btshared->indexrelid = RelationGetRelid(index);
+	btshared->isunique = indexInfo->ii_Unique;
+	btshared->sortmem = Max(maintenance_work_mem /
+							(indexInfo->ii_ParallelWorkers + 1), 64);
+	btshared->nblocks = RelationGetNumberOfBlocks(heap);
+
+	/*
+	 * Claim blocks in chunks small enough that even a modest table is spread
+	 * over all the participants.
+	 */
+	btshared->chunkblocks = btshared->nblocks /
+		((indexInfo->ii_ParallelWorkers + 1) * 4);
+	btshared->chunkblocks = Max(Min(btshared->chunkblocks,
+									PARALLEL_BTREE_MAX_CHUNK_BLOCKS), 1);
+	SpinLockInit(&btshared->mutex);
+	btshared->nextblock = 0;
+	btshared->reltuples = 0.0;
+	btshared->indtuples = 0.0;
+	btshared->brokenhotchain = false;
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BTREE_SHARED, btshared);
+
+	/* Set up a queue for each worker to send its tuples to us through */
+	mqspace = shm_toc_allocate(pcxt->toc,
+							   mul_size(PARALLEL_BTREE_QUEUE_SIZE,
+										pcxt->nworkers));
+	mqhs = (shm_mq_handle **) palloc(pcxt->nworkers * sizeof(shm_mq_handle *));
+	for (i = 0; i < pcxt->nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(mqspace + ((Size) i) * PARALLEL_BTREE_QUEUE_SIZE,
+						   (Size) PARALLEL_BTREE_QUEUE_SIZE);
+		shm_mq_set_receiver(mq, MyProc);
+		mqhs[i] = shm_mq_attach(mq, pcxt->seg, NULL);
+	}
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_TUPLE_QUEUES, mqspace);
+
+	LaunchParallelWorkers(pcxt);
+
+	/*
+	 * Do our share of the heap scan.  Any blocks that workers which failed to
+	 * launch would have scanned are simply claimed by the rest of us.
+	 */
+	reltuples = _bt_parallel_scan_and_sort(btshared, buildstate, index,
+										   indexInfo);
+
+	/* Merge our own sorted tuples with what the workers send */
+	_bt_merge_init(&mstate, heap, index, indexInfo->ii_Unique,
+				   pcxt->nworkers_launched + 2);
+	_bt_merge_add_sort(&mstate, buildstate->spool, false);
+	if (buildstate->spool2)
+		_bt_merge_add_sort(&mstate, buildstate->spool2, true);
+	for (i = 0; i < pcxt->nworkers_launched; i++)
+	{
+		shm_mq_set_handle(mqhs[i], pcxt->worker[i].bgwhandle);
+		_bt_merge_add_queue(&mstate, mqhs[i]);
+	}
+	_bt_merge_begin(&mstate);
+
+	_bt_initwstate(&wstate, heap, index);
+	_bt_load(&wstate, NULL, NULL, &mstate);
+
+	_bt_merge_end(&mstate);
+	_bt_spooldestroy(buildstate->spool);
+	if (buildstate->spool2)
+		_bt_spooldestroy(buildstate->spool2);
+
+	/*
+	 * Wait for the workers to exit.  This also reports any error a worker
+	 * hit, in which case the tuples it sent us may have been incomplete.
+	 */
+	WaitForParallelWorkersToFinish(pcxt);
+
+	reltuples += btshared->reltuples;
+	buildstate->indtuples += btshared->indtuples;
+	if (btshared->brokenhotchain)
+		indexInfo->ii_BrokenHotChain = true;
+
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+
+	return reltuples;
+}
+
+/*
+ * Perform a parallel build participant's share of the heap scan: claim
+ * ranges of heap blocks until there are none left, spooling index tuples
+ * for them, then sort the spools.  Returns the number of heap tuples scanned.
+ */
+static double
+_bt_parallel_scan_and_sort(BTShared *btshared, BTBuildState *buildstate,
+						   Relation index, IndexInfo *indexInfo)
+{
+	Relation	heap = buildstate->heapRel;
+	double		reltuples = 0;
+
+	buildstate->spool = _bt_spoolinit(heap, index, btshared->isunique, false,
+									  btshared->sortmem);
+	if (btshared->isunique)
+		buildstate->spool2 = _bt_spoolinit(heap, index, false, true,
+										   btshared->sortmem);
+
+	for (;;)
+	{
+		BlockNumber startblock;
+		BlockNumber nblocks;
+
+		SpinLockAcquire(&btshared->mutex);
+		startblock = btshared->nextblock;
+		nblocks = Min(btshared->chunkblocks, btshared->nblocks - startblock);
+		btshared->nextblock += nblocks;
+		SpinLockRelease(&btshared->mutex);
+
+		if (nblocks == 0)
+			break;
+
+		reltuples += IndexBuildHeapRangeScan(heap, index, indexInfo,
+											 false, false,
+											 startblock, nblocks,
+											 btbuildCallback,
+											 (void *) buildstate);
+	}
+
+	if (buildstate->spool2 && !buildstate->haveDead)
+	{
+		/* spool2 turns out to be unnecessary */
+		_bt_spooldestroy(buildstate->spool2);
+		buildstate->spool2 = NULL;
+	}
+
+	tuplesort_performsort(buildstate->spool->sortstate);
+	if (buildstate->spool2)
+		tuplesort_performsort(buildstate->spool2->sortstate);
+
+	return reltuples;
+}
+
+/*
+ * Send merged, sorted index tuples to the leader through our queue.
+ */
+static void
+_bt_parallel_send(BTMergeState *mstate, shm_mq_handle *mqh)
+{
+	IndexTuple	itup;
+	bool		isdead;
+
+	while ((itup = _bt_merge_next(mstate, &isdead)) != NULL)
+	{
+		BTTupleHeader hdr;
+		shm_mq_iovec iov[2];
+		shm_mq_result res;
+
+		MemSet(&hdr, 0, sizeof(hdr));
+		hdr.isdead = isdead;
+
+		iov[0].data = (char *) &hdr;
+		iov[0].len = sizeof(hdr);
+		iov[1].data = (char *) itup;
+		iov[1].len = IndexTupleSize(itup);
+
+		res = shm_mq_sendv(mqh, iov, 2, false);
+
+		/* If the leader went away, it has an error of its own to report */
+		if (res != SHM_MQ_SUCCESS)
+			break;
+	}
+}
+
+/*
+ * Main entry point for a parallel btree build worker.
+ */
+void
+_bt_parallel_build_main(dsm_segment *seg, shm_toc *toc)
+{
+	BTShared   *btshared;
+	BTBuildState buildstate;
+	BTMergeState mstate;
+	Relation	heapRel;
+	Relation	indexRel;
+	IndexInfo  *indexInfo;
+	char	   *mqspace;
+	shm_mq	   *mq;
+	shm_mq_handle *mqh;
+	double		reltuples;
+
+	btshared = shm_toc_lookup(toc, PARALLEL_KEY_BTREE_SHARED);
+
+	/* Attach to our queue as its sender */
+	mqspace = shm_toc_lookup(toc, PARALLEL_KEY_TUPLE_QUEUES);
+	mq = (shm_mq *) (mqspace +
+					 ((Size) ParallelWorkerNumber) * PARALLEL_BTREE_QUEUE_SIZE);
+	shm_mq_set_sender(mq, MyProc);
+	mqh = shm_mq_attach(mq, seg, NULL);
+
+	/*
+	 * Open the relations.  The leader already holds strong enough locks on
+	 * both, and since we're in its lock group these don't conflict with them.
+	 */
+	heapRel = heap_open(btshared->heaprelid, ShareLock);
+	indexRel = index_open(btshared->indexrelid, RowExclusiveLock);
+	indexInfo = BuildIndexInfo(indexRel);
+
+	buildstate.isUnique = btshared->isunique;
+	buildstate.haveDead = false;
+	buildstate.heapRel = heapRel;
+	buildstate.spool = NULL;
+	buildstate.spool2 = NULL;
+	buildstate.indtuples = 0;
+
+	reltuples = _bt_parallel_scan_and_sort(btshared, &buildstate, indexRel,
+										   indexInfo);
+
+	/* Report our totals to the leader */
+	SpinLockAcquire(&btshared->mutex);
+	btshared->reltuples += reltuples;
+	btshared->indtuples += buildstate.indtuples;
+	if (indexInfo->ii_BrokenHotChain)
+		btshared->brokenhotchain = true;
+	SpinLockRelease(&btshared->mutex);
+
+	/* Send everything to the leader, merging in any dead tuples */
+	_bt_merge_init(&mstate, heapRel, indexRel, false, 2);
+	_bt_merge_add_sort(&mstate, buildstate.spool, false);
+	if (buildstate.spool2)
+		_bt_merge_add_sort(&mstate, buildstate.spool2, true);
+	_bt_merge_begin(&mstate);
+	_bt_parallel_send(&mstate, mqh);
+	_bt_merge_end(&mstate);
+
+	/* Detaching tells the leader there are no more tuples to come */
+	shm_mq_detach(mq);
+
+	_bt_spooldestroy(buildstate.spool);
+	if (buildstate.spool2)
+		_bt_spooldestroy(buildstate.spool2);
+
+	index_close(indexRel, RowExclusiveLock);
+	heap_close(heapRel, ShareLock);
+}
+
+/*
+ * Set up to merge up to maxinputs sorted streams of index tuples.
+ */
+static void
+_bt_merge_init(BTMergeState *mstate, Relation heap, Relation index,
+			   bool checkunique, int maxinputs)
+{
+	mstate->heap = heap;
+	mstate->index = index;
+	mstate->checkunique = checkunique;
+	mstate->keysz = RelationGetNumberOfAttributes(index);
+	mstate->sortKeys = _bt_prepare_sortkeys(index);
+	mstate->ninputs = 0;
+	mstate->inputs = (BTMergeInput *) palloc0(maxinputs * sizeof(BTMergeInput));
+	mstate->heap_inputs = binaryheap_allocate(maxinputs, _bt_merge_compare,
+											  mstate);
+	mstate->lastinput = -1;
+}
+
+/*
+ * Add a sorted local spool as a merge input.
+ */
+static void
+_bt_merge_add_sort(BTMergeState *mstate, BTSpool *btspool, bool isdead)
+{
+	BTMergeInput *input = &mstate->inputs[mstate->ninputs++];
+
+	input->sortstate = btspool->sortstate;
+	input->sortdead = isdead;
+}
+
+/*
+ * Add a worker's tuple queue as a merge input.
+ */
+static void
+_bt_merge_add_queue(BTMergeState *mstate, shm_mq_handle *mqh)
+{
+	BTMergeInput *input = &mstate->inputs[mstate->ninputs++];
+
+	input->mqh = mqh;
+}
+
+/*
+ * Read the first tuple from each input, ready to return them in order.
+ */
+static void
+_bt_merge_begin(BTMergeState *mstate)
+{
+	int			i;
+
+	for (i = 0; i < mstate->ninputs; i++)
+	{
+		if (_bt_merge_fetch(&mstate->inputs[i]))
+			binaryheap_add_unordered(mstate->heap_inputs, Int32GetDatum(i));
+	}
+	binaryheap_build(mstate->heap_inputs);
+}
+
+/*
+ * Return the next index tuple in sort order, or NULL when all inputs are
+ * exhausted.  *isdead is set to whether the tuple is for a dead heap tuple.
+ * The tuple is valid only until the next call.
+ */
+static IndexTuple
+_bt_merge_next(BTMergeState *mstate, bool *isdead)
+{
+	BTMergeInput *input;
+	int			i;
+
+	/*
+	 * Advance the input we returned a tuple from last time; we couldn't do
+	 * that before, as it would have released the tuple.
+	 */
+	if (mstate->lastinput >= 0)
+	{
+		if (_bt_merge_fetch(&mstate->inputs[mstate->lastinput]))
+			binaryheap_replace_first(mstate->heap_inputs,
+									 Int32GetDatum(mstate->lastinput));
+		else
+			(void) binaryheap_remove_first(mstate->heap_inputs);
+		mstate->lastinput = -1;
+	}
+
+	if (binaryheap_empty(mstate->heap_inputs))
+		return NULL;
+
+	i = DatumGetInt32(binaryheap_first(mstate->heap_inputs));
+	input = &mstate->inputs[i];
+	mstate->lastinput = i;
+
+	*isdead = input->itupdead;
+	return input->itup;
+}
+
+/*
+ * Release merge state.  The inputs themselves are cleaned up by the caller.
+ */
+static void
+_bt_merge_end(BTMergeState *mstate)
+{
+	binaryheap_free(mstate->heap_inputs);
+	pfree(mstate->inputs);
+	pfree(mstate->sortKeys);
+}
+
+/*
+ * Read the next tuple from a merge input.  Returns false if there are none.
+ */
+static bool
+_bt_merge_fetch(BTMergeInput *input)
+{
+	if (input->sortstate != NULL)
+	{
+		input->itup = tuplesort_getindextuple(input->sortstate, true);
+		input->itupdead = input->sortdead;
+	}
+	else
+	{
+		shm_mq_result res;
+		Size		nbytes;
+		void	   *data;
+
+		res = shm_mq_receive(input->mqh, &nbytes, &data, false);
+		if (res == SHM_MQ_SUCCESS)
+		{
+			Assert(nbytes > sizeof(BTTupleHeader));
+			input->itupdead = ((BTTupleHeader *) data)->isdead;
+			input->itup = (IndexTuple) ((char *) data + sizeof(BTTupleHeader));
+		}
+		else
+		{
+			/*
+			 * The worker has detached, so it has sent all its tuples.  If it
+			 * failed instead, we'll find out when we wait for it to finish.
+			 */
+			Assert(res == SHM_MQ_DETACHED);
+			input->itup = NULL;
+		}
+	}
+
+	return input->itup != NULL;
+}
+
+/*
+ * binaryheap comparator for merge inputs: order them by their current
+ * tuples, breaking ties by heap TID just as tuplesort.c does.
+ */
+static int
+_bt_merge_compare(Datum a, Datum b, void *arg)
+{
+	BTMergeState *mstate = (BTMergeState *) arg;
+	IndexTuple	itup1 = mstate->inputs[DatumGetInt32(a)].itup;
+	IndexTuple	itup2 = mstate->inputs[DatumGetInt32(b)].itup;
+	bool		hasnull;
+	int32		compare;
+
+	compare = _bt_compare_keys(mstate, itup1, itup2, &hasnull);
+	if (compare == 0)
+		compare = ItemPointerCompare(&itup1->t_tid, &itup2->t_tid);
+
+	/* binaryheap keeps the greatest element first, so invert the result */
+	return -compare;
+}
+
+/*
+ * Compare the key columns of two index tuples.  *hasnull is set if the keys
+ * are equal and include a NULL, which means they don't count as duplicates.
+ */
+static int32
+_bt_compare_keys(BTMergeState *mstate, IndexTuple itup1, IndexTuple itup2,
+				 bool *hasnull)
+{
+	TupleDesc	tupdes = RelationGetDescr(mstate->index);
+	int			i;
+
+	*hasnull = false;
+	for (i = 1; i <= mstate->keysz; i++)
+	{
+		SortSupport entry = mstate->sortKeys + i - 1;
+		Datum		attrDatum1,
+					attrDatum2;
+		bool		isNull1,
+					isNull2;
+		int32		compare;
+
+		attrDatum1 = index_getattr(itup1, i, tupdes, &isNull1);
+		attrDatum2 = index_getattr(itup2, i, tupdes, &isNull2);
+
+		compare = ApplySortComparator(attrDatum1, isNull1,
+									  attrDatum2, isNull2,
+									  entry);
+		if (compare != 0)
+			return compare;
+		if (isNull1)
+			*hasnull = true;
+	}
+
+	return 0;
+}
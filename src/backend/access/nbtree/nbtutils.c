@@ -49,6 +49,8 @@ static void _bt_mark_scankey_required(ScanKey skey);
 static bool _bt_check_rowcompare(ScanKey skey,
 					 IndexTuple tuple, TupleDesc tupdesc,
 					 ScanDirection dir, bool *continuescan);
+static int	_bt_keep_natts(Relation rel, IndexTuple lastleft,
+			   IndexTuple firstright);
 
 
 /*
@@ -56,7 +58,10 @@ static bool _bt_check_rowcompare(ScanKey skey,
  *		Build an insertion scan key that contains comparison data from itup
  *		as well as comparator routines appropriate to the key datatypes.
  *
- *		The result is intended for use with _bt_compare().
+ *		The result is intended for use with _bt_compare().  If itup is a
+ *		truncated pivot tuple, the entries for the attributes it lacks are
+ *		set up as NULLs; callers should only pass _bt_compare() as many keys
+ *		as the tuple has attributes.
  */
 ScanKey
 _bt_mkscankey(Relation rel, IndexTuple itup)
@@ -64,11 +69,13 @@ _bt_mkscankey(Relation rel, IndexTuple itup)
 	ScanKey		skey;
 	TupleDesc	itupdesc;
 	int			natts;
+	int			tupnatts;
 	int16	   *indoption;
 	int			i;
 
 	itupdesc = RelationGetDescr(rel);
 	natts = RelationGetNumberOfAttributes(rel);
+	tupnatts = BTreeTupleGetNAtts(itup, rel);
 	indoption = rel->rd_indoption;
 
 	skey = (ScanKey) palloc(natts * sizeof(ScanKeyData));
@@ -85,7 +92,13 @@ _bt_mkscankey(Relation rel, IndexTuple itup)
 		 * comparison can be needed.
 		 */
 		procinfo = index_getprocinfo(rel, i + 1, BTORDER_PROC);
-		arg = index_getattr(itup, i + 1, itupdesc, &null);
+		if (i < tupnatts)
+			arg = index_getattr(itup, i + 1, itupdesc, &null);
+		else
+		{
+			arg = (Datum) 0;
+			null = true;
+		}
 		flags = (null ? SK_ISNULL : 0) | (indoption[i] << SK_BT_INDOPTION_SHIFT);
 		ScanKeyEntryInitializeWithInfo(&skey[i],
 									   flags,
@@ -1710,7 +1723,8 @@ _bt_check_rowcompare(ScanKey skey, IndexTuple tuple, TupleDesc tupdesc,
  * LP_DEAD status (which is only a hint).
  *
  * We match items by heap TID before assuming they are the right ones to
- * delete.  We cope with cases where items have moved right due to insertions.
+ * delete; a posting list tuple is only marked if all of its heap TIDs were
+ * killed.  We cope with cases where items have moved right due to insertions.
  * If an item has moved off the current page due to a split, we'll fail to
  * find it and do nothing (this is not an error case --- we assume the item
  * will eventually get marked in a future indexscan).
@@ -1800,8 +1814,42 @@ _bt_killitems(IndexScanDesc scan)
 		{
 			ItemId		iid = PageGetItemId(page, offnum);
 			IndexTuple	ituple = (IndexTuple) PageGetItem(page, iid);
+			bool		killtuple = false;
+
+			if (BTreeTupleIsPosting(ituple))
+			{
+				int			nposting = BTreeTupleGetNPosting(ituple);
+				int			j;
+
+				/*
+				 * A posting list tuple can only be marked dead if all of its
+				 * heap TIDs were killed.  _bt_readpage() saved them in
+				 * adjacent items, and in either scan direction they are
+				 * returned, and so killed, in the order of the posting list;
+				 * so the next killed items must match the whole list.
+				 */
+				for (j = 0; j < nposting; j++)
+				{
+					if (!ItemPointerEquals(BTreeTupleGetPostingN(ituple, j),
+										   &kitem->heapTid))
+						break;	/* out of posting list loop */
+					if (j < nposting - 1)
+					{
+						if (i + 1 >= numKilled)
+							break;
+						i++;
+						kitem = &so->currPos.items[so->killedItems[i]];
+					}
+				}
+				if (j == nposting)
+					killtuple = true;
+				else if (j > 0)
+					break;		/* matched it, but can't kill it */
+			}
+			else if (ItemPointerEquals(&ituple->t_tid, &kitem->heapTid))
+				killtuple = true;
 
-			if (ItemPointerEquals(&ituple->t_tid, &kitem->heapTid))
+			if (killtuple)
 			{
 				/* found the item */
 				ItemIdMarkDead(iid);
@@ -2069,3 +2117,85 @@ btproperty(Oid index_oid, int attno,
 			return false;		/* punt to generic code */
 	}
 }
+
+/*
+ *	_bt_truncate() -- Build the high key for the left half of a leaf split.
+ *
+ *		lastleft is the last item that will be on the left page and firstright
+ *		the first one on the right page.  The result is a palloc'd copy of
+ *		firstright that keeps only the leading attributes needed to tell the
+ *		two apart, so that lastleft < result <= firstright when the missing
+ *		attributes are taken as minus infinity (see _bt_compare()).  If they
+ *		are equal in every attribute, nothing can be truncated and the result
+ *		is a plain copy of firstright.  Either way, the result has no posting
+ *		list, and its t_tid block number is that of firstright's heap TID.
+ */
+IndexTuple
+_bt_truncate(Relation rel, IndexTuple lastleft, IndexTuple firstright)
+{
+	int			natts = RelationGetNumberOfAttributes(rel);
+	int			keepnatts;
+	IndexTuple	pivot;
+	ItemPointerData htid;
+
+	Assert(!BTreeTupleIsTruncated(lastleft));
+	Assert(!BTreeTupleIsTruncated(firstright));
+
+	keepnatts = _bt_keep_natts(rel, lastleft, firstright);
+	if (keepnatts >= natts)
+		return _bt_strip_posting(firstright);
+
+	htid = *BTreeTupleGetHeapTID(firstright);
+	pivot = index_truncate_tuple(RelationGetDescr(rel), firstright, keepnatts);
+	pivot->t_tid = htid;
+	BTreeTupleSetNAtts(pivot, keepnatts);
+
+	return pivot;
+}
+
+/*
+ * Return the number of leading attributes that a pivot tuple separating
+ * lastleft and firstright must keep: one more than the number of leading
+ * attributes on which they are equal, or all of them if they are equal
+ * throughout.
+ *
+ * Equality is decided by the operator class's comparison support function,
+ * not by comparing the datums' bytes.  Two values that the opclass considers
+ * equal but that are stored differently (numeric 1.0 and 1.00, say) must not
+ * be taken as a point where the tuples can be told apart.
+ */
+static int
+_bt_keep_natts(Relation rel, IndexTuple lastleft, IndexTuple firstright)
+{
+	TupleDesc	itupdesc = RelationGetDescr(rel);
+	int			natts = RelationGetNumberOfAttributes(rel);
+	int			keepnatts;
+
+	for (keepnatts = 1; keepnatts < natts; keepnatts++)
+	{
+		Datum		datum1,
+					datum2;
+		bool		isNull1,
+					isNull2;
+
+		datum1 = index_getattr(lastleft, keepnatts, itupdesc, &isNull1);
+		datum2 = index_getattr(firstright, keepnatts, itupdesc, &isNull2);
+
+		if (isNull1 != isNull2)
+			break;
+
+		if (!isNull1)
+		{
+			FmgrInfo   *procinfo;
+
+			procinfo = index_getprocinfo(rel, keepnatts, BTORDER_PROC);
+			if (DatumGetInt32(FunctionCall2Coll(procinfo,
+												rel->rd_indcollation[keepnatts - 1],
+												datum1,
+												datum2)) != 0)
+				break;
+		}
+	}
+
+	return keepnatts;
+}
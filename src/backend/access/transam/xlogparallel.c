@@ -0,0 +1,780 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogparallel.c
+ *		Parallel WAL redo on standbys.
+ *
+ * With recovery_parallel_workers > 0, once a standby (or a server doing
+ * archive recovery) has reached a consistent state, the startup process
+ * hands some of the WAL records it reads to background workers to replay,
+ * instead of replaying them itself.  Only the simplest and by far the most
+ * common kinds of records are handed off: heap inserts, deletes, in-page
+ * updates and locks, and btree leaf inserts, each of which modifies just one
+ * block.  The block determines which worker gets the record, so records for
+ * the same block are replayed in WAL order.
+ *
+ * Every other record is replayed by the startup process itself.  Most of
+ * them act as a barrier: the startup process first waits for the workers to
+ * apply everything they've been given.  That covers records touching several
+ * blocks, anything that can conflict with hot standby queries, and storage
+ * and checkpoint records.
+ *
+ * Commit and abort records are too frequent to drain the workers for each of
+ * them, and they don't touch any data blocks, so they only wait for the
+ * records of their own transaction (and its subtransactions).  To that end
+ * the startup process remembers, per transaction ID, how many records each
+ * worker had been given when the transaction's last record was dispatched.
+ * A commit record is thus never replayed until all of the transaction's
+ * changes have been, so hot standby queries can't see a transaction as
+ * committed before its effects are in place.  Commits and aborts that drop
+ * relations, and those of prepared transactions, are still full barriers.
+ *
+ * The workers get records through one shm_mq each, and report how many
+ * they've applied through counters in the same dynamic shared memory
+ * segment.  If a worker dies, the startup process exits too, just as if it
+ * had failed to replay the record itself.
+ *
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/backend/access/transam/xlogparallel.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/hash.h"
+#include "access/heapam_xlog.h"
+#include "access/nbtxlog.h"
+#include "access/transam.h"
+#include "access/xact.h"
+#include "access/xlog.h"
+#include "access/xlog_internal.h"
+#include "access/xlogparallel.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/startup.h"
+#include "storage/bufmgr.h"
+#include "storage/dsm.h"
+#include "storage/dsm_impl.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/proc.h"
+#include "storage/shm_mq.h"
+#include "storage/shm_toc.h"
+#include "tcop/tcopprot.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+#include "utils/resowner.h"
+
+
+/* Magic number for parallel redo TOC. */
+#define PARALLEL_REDO_MAGIC				0x52454430
+
+/* Keys in the TOC; the queues use PARALLEL_REDO_KEY_QUEUE + worker number */
+#define PARALLEL_REDO_KEY_SHARED		0
+#define PARALLEL_REDO_KEY_QUEUE			1
+
+/* Size of each worker's queue */
+#define PARALLEL_REDO_QUEUE_SIZE		(1024 * 1024)
+
+/* Shared state: number of records each worker has applied */
+typedef struct ParallelRedoShared
+{
+	int			nworkers;
+	pg_atomic_uint32 startup_waiting;	/* set latch after each record? */
+	pg_atomic_uint32 applied[FLEXIBLE_ARRAY_MEMBER];
+} ParallelRedoShared;
+
+/* What we send ahead of each record */
+typedef struct ParallelRedoRecordHeader
+{
+	XLogRecPtr	ReadRecPtr;
+	XLogRecPtr	EndRecPtr;
+} ParallelRedoRecordHeader;
+
+/* Startup process's view of the workers */
+typedef struct ParallelRedoState
+{
+	dsm_segment *seg;
+	ParallelRedoShared *shared;
+	int			nworkers;
+	BackgroundWorkerHandle **handles;
+	shm_mq_handle **queues;
+	uint32	   *dispatched;		/* number of records sent to each worker */
+	HTAB	   *xacts;			/* ParallelRedoXact entries, by xid */
+
+	/* statistics, reported at the end of redo */
+	long		nrecords;		/* records replayed by the workers */
+	long		nbarriers;		/* waits for all workers */
+	long		nxactends;		/* waits for one transaction's records */
+} ParallelRedoState;
+
+/* Records dispatched for a transaction */
+typedef struct ParallelRedoXact
+{
+	TransactionId xid;			/* hash key */
+	uint32		dispatched[FLEXIBLE_ARRAY_MEMBER];	/* per worker, as of
+													 * its last record */
+} ParallelRedoXact;
+
+/* Identity of the block a dispatched record modifies */
+typedef struct ParallelRedoBlock
+{
+	RelFileNode rnode;
+	ForkNumber	forknum;
+	BlockNumber blkno;
+} ParallelRedoBlock;
+
+/* GUC variable */
+int			recovery_parallel_workers = 0;
+
+bool		InParallelRedoWorker = false;
+
+static ParallelRedoState *redo = NULL;
+static bool redo_failed = false;
+
+static bool ParallelRedoStart(void);
+static bool ParallelRedoWaitForStartup(ParallelRedoState *state);
+static void ParallelRedoCheckWorkers(void);
+static bool ParallelRedoIsSafe(XLogReaderState *record);
+static bool ParallelRedoXactEnd(XLogReaderState *record);
+static void ParallelRedoWait(const uint32 *dispatched);
+static void ParallelRedoSend(int worker, XLogReaderState *record);
+static void parallel_redo_error_callback(void *arg);
+
+
+/*
+ * Hand the record the startup process is about to replay to a worker, if
+ * it's a kind that can be replayed in parallel.  Returns false if the caller
+ * must replay it itself; in that case, all records dispatched earlier have
+ * been applied by the time we return.
+ *
+ * Only to be called once a consistent state has been reached.
+ */
+bool
+ParallelRedoDispatch(XLogReaderState *record)
+{
+	ParallelRedoBlock block;
+	uint32		hash;
+
+	if (redo == NULL)
+	{
+		if (recovery_parallel_workers <= 0 || redo_failed)
+			return false;
+		if (!ParallelRedoStart())
+		{
+			redo_failed = true;
+			return false;
+		}
+	}
+
+	if (!ParallelRedoIsSafe(record))
+	{
+		if (!ParallelRedoXactEnd(record))
+			ParallelRedoDrain();
+		return false;
+	}
+
+	if (!XLogRecGetBlockTag(record, 0, &block.rnode, &block.forknum,
+							&block.blkno))
+		elog(ERROR, "failed to locate backup block with ID 0");
+
+	hash = DatumGetUInt32(hash_any((const unsigned char *) &block,
+								   sizeof(block)));
+	ParallelRedoSend(hash % redo->nworkers, record);
+
+	/* Remember where the transaction's changes are */
+	if (TransactionIdIsValid(XLogRecGetXid(record)))
+	{
+		TransactionId xid = XLogRecGetXid(record);
+		ParallelRedoXact *xact;
+
+		xact = hash_search(redo->xacts, &xid, HASH_ENTER, NULL);
+		memcpy(xact->dispatched, redo->dispatched,
+			   sizeof(uint32) * redo->nworkers);
+	}
+
+	return true;
+}
+
+/*
+ * If the record is a commit or abort record that only needs the records of
+ * its own transaction to have been applied, wait for those and return true.
+ * Returns false if the caller has to wait for all the workers instead.
+ */
+static bool
+ParallelRedoXactEnd(XLogReaderState *record)
+{
+	uint8		info = XLogRecGetInfo(record) & XLOG_XACT_OPMASK;
+	TransactionId xid = XLogRecGetXid(record);
+	TransactionId *subxacts;
+	int			nsubxacts;
+	uint32	   *wait_for;
+	bool		found = false;
+	int			i;
+	int			j;
+
+	if (XLogRecGetRmid(record) != RM_XACT_ID)
+		return false;
+
+	if (info == XLOG_XACT_COMMIT)
+	{
+		xl_xact_parsed_commit parsed;
+
+		ParseCommitRecord(XLogRecGetInfo(record),
+						  (xl_xact_commit *) XLogRecGetData(record), &parsed);
+		if (parsed.nrels > 0)
+			return false;
+		subxacts = parsed.subxacts;
+		nsubxacts = parsed.nsubxacts;
+	}
+	else if (info == XLOG_XACT_ABORT)
+	{
+		xl_xact_parsed_abort parsed;
+
+		ParseAbortRecord(XLogRecGetInfo(record),
+						 (xl_xact_abort *) XLogRecGetData(record), &parsed);
+		if (parsed.nrels > 0)
+			return false;
+		subxacts = parsed.subxacts;
+		nsubxacts = parsed.nsubxacts;
+	}
+	else
+		return false;
+
+	/* Work out how far each worker must have got, and forget the xids */
+	wait_for = palloc0(sizeof(uint32) * redo->nworkers);
+	for (i = -1; i < nsubxacts; i++)
+	{
+		TransactionId cur = (i < 0) ? xid : subxacts[i];
+		ParallelRedoXact *xact;
+
+		xact = hash_search(redo->xacts, &cur, HASH_FIND, NULL);
+		if (xact == NULL)
+			continue;
+
+		for (j = 0; j < redo->nworkers; j++)
+		{
+			if (!found || (int32) (xact->dispatched[j] - wait_for[j]) > 0)
+				wait_for[j] = xact->dispatched[j];
+		}
+		found = true;
+
+		hash_search(redo->xacts, &cur, HASH_REMOVE, NULL);
+	}
+
+	if (found)
+		ParallelRedoWait(wait_for);
+	pfree(wait_for);
+
+	redo->nxactends++;
+
+	return true;
+}
+
+/*
+ * Wait until the workers have applied every record dispatched to them.
+ */
+void
+ParallelRedoDrain(void)
+{
+	HASH_SEQ_STATUS status;
+	ParallelRedoXact *xact;
+
+	if (redo == NULL)
+		return;
+
+	ParallelRedoWait(redo->dispatched);
+	redo->nbarriers++;
+
+	/*
+	 * Nothing is pending now.  Forget any transactions whose commit or abort
+	 * we haven't seen, such as those that were in progress when the primary
+	 * crashed.
+	 */
+	hash_seq_init(&status, redo->xacts);
+	while ((xact = hash_seq_search(&status)) != NULL)
+		hash_search(redo->xacts, &xact->xid, HASH_REMOVE, NULL);
+}
+
+/*
+ * Wait until each worker has applied the given number of records.
+ */
+static void
+ParallelRedoWait(const uint32 *dispatched)
+{
+	/*
+	 * The workers only set our latch after each record while we're waiting;
+	 * otherwise they do so when they run out of work.
+	 */
+	pg_atomic_write_u32(&redo->shared->startup_waiting, 1);
+	pg_memory_barrier();
+
+	for (;;)
+	{
+		bool		done = true;
+		int			i;
+
+		for (i = 0; i < redo->nworkers; i++)
+		{
+			uint32		applied;
+
+			applied = pg_atomic_read_u32(&redo->shared->applied[i]);
+			if ((int32) (applied - dispatched[i]) < 0)
+			{
+				done = false;
+				break;
+			}
+		}
+		if (done)
+			break;
+
+		ParallelRedoCheckWorkers();
+
+		WaitLatch(MyLatch, WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+				  1000L, WAIT_EVENT_PARALLEL_REDO_DRAIN);
+		ResetLatch(MyLatch);
+
+		HandleStartupProcInterrupts();
+	}
+
+	pg_atomic_write_u32(&redo->shared->startup_waiting, 0);
+
+	/* make sure we see everything the workers did */
+	pg_memory_barrier();
+}
+
+/*
+ * Wait for the workers to finish, and let them go.  Called at the end of
+ * redo.
+ */
+void
+ParallelRedoShutdown(void)
+{
+	if (redo == NULL)
+		return;
+
+	ParallelRedoDrain();
+
+	ereport(LOG,
+			(errmsg("parallel redo finished: %ld records replayed by workers, %ld full barriers, %ld transaction ends",
+					redo->nrecords, redo->nbarriers, redo->nxactends)));
+
+	/* Detaching from the queues tells the workers to exit */
+	dsm_detach(redo->seg);
+
+	hash_destroy(redo->xacts);
+	pfree(redo->handles);
+	pfree(redo->queues);
+	pfree(redo->dispatched);
+	pfree(redo);
+	redo = NULL;
+}
+
+/*
+ * Set up the shared memory segment and start the workers.  Returns false,
+ * after logging the reason, if that's not possible; we then just carry on
+ * replaying everything in the startup process.
+ */
+static bool
+ParallelRedoStart(void)
+{
+	int			nworkers = recovery_parallel_workers;
+	ParallelRedoState *state;
+	shm_toc_estimator e;
+	Size		shared_size;
+	Size		segsize;
+	shm_toc    *toc;
+	BackgroundWorker worker;
+	MemoryContext oldcontext;
+	HASHCTL		ctl;
+	int			i;
+
+	if (dynamic_shared_memory_type == DSM_IMPL_NONE)
+	{
+		ereport(LOG,
+				(errmsg("parallel redo disabled because dynamic_shared_memory_type is \"none\"")));
+		return false;
+	}
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+	state = palloc0(sizeof(ParallelRedoState));
+	state->nworkers = 0;
+	state->handles = palloc0(sizeof(BackgroundWorkerHandle *) * nworkers);
+	state->queues = palloc0(sizeof(shm_mq_handle *) * nworkers);
+	state->dispatched = palloc0(sizeof(uint32) * nworkers);
+
+	shared_size = add_size(offsetof(ParallelRedoShared, applied),
+						   mul_size(sizeof(pg_atomic_uint32), nworkers));
+
+	shm_toc_initialize_estimator(&e);
+	shm_toc_estimate_chunk(&e, shared_size);
+	for (i = 0; i < nworkers; i++)
+		shm_toc_estimate_chunk(&e, PARALLEL_REDO_QUEUE_SIZE);
+	shm_toc_estimate_keys(&e, 1 + nworkers);
+	segsize = shm_toc_estimate(&e);
+
+	state->seg = dsm_create(segsize, DSM_CREATE_NULL_IF_MAXSEGMENTS);
+	if (state->seg == NULL)
+	{
+		ereport(LOG,
+				(errmsg("parallel redo disabled because no dynamic shared memory segment could be created")));
+		MemoryContextSwitchTo(oldcontext);
+		pfree(state->handles);
+		pfree(state->queues);
+		pfree(state->dispatched);
+		pfree(state);
+		return false;
+	}
+	toc = shm_toc_create(PARALLEL_REDO_MAGIC, dsm_segment_address(state->seg),
+						 segsize);
+
+	state->shared = shm_toc_allocate(toc, shared_size);
+	state->shared->nworkers = nworkers;
+	pg_atomic_init_u32(&state->shared->startup_waiting, 0);
+	for (i = 0; i < nworkers; i++)
+		pg_atomic_init_u32(&state->shared->applied[i], 0);
+	shm_toc_insert(toc, PARALLEL_REDO_KEY_SHARED, state->shared);
+
+	memset(&worker, 0, sizeof(worker));
+	worker.bgw_flags = BGWORKER_SHMEM_ACCESS;
+	worker.bgw_start_time = BgWorkerStart_PostmasterStart;
+	worker.bgw_restart_time = BGW_NEVER_RESTART;
+	sprintf(worker.bgw_library_name, "postgres");
+	sprintf(worker.bgw_function_name, "ParallelRedoWorkerMain");
+	worker.bgw_main_arg = UInt32GetDatum(dsm_segment_handle(state->seg));
+	/* we're not a backend, so the postmaster can't notify us */
+	worker.bgw_notify_pid = 0;
+
+	for (i = 0; i < nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(shm_toc_allocate(toc, PARALLEL_REDO_QUEUE_SIZE),
+						   PARALLEL_REDO_QUEUE_SIZE);
+		shm_toc_insert(toc, PARALLEL_REDO_KEY_QUEUE + i, mq);
+		shm_mq_set_sender(mq, MyProc);
+
+		snprintf(worker.bgw_name, BGW_MAXLEN, "parallel redo worker %d", i);
+		memcpy(worker.bgw_extra, &i, sizeof(int));
+		if (!RegisterDynamicBackgroundWorker(&worker, &state->handles[i]))
+			break;
+		state->queues[i] = shm_mq_attach(mq, state->seg, state->handles[i]);
+		state->nworkers++;
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	if (state->nworkers < nworkers || !ParallelRedoWaitForStartup(state))
+	{
+		ereport(LOG,
+				(errmsg("parallel redo disabled because not enough background workers could be started"),
+				 errhint("You might need to increase max_worker_processes.")));
+		for (i = 0; i < state->nworkers; i++)
+			TerminateBackgroundWorker(state->handles[i]);
+		dsm_detach(state->seg);
+		pfree(state->handles);
+		pfree(state->queues);
+		pfree(state->dispatched);
+		pfree(state);
+		return false;
+	}
+
+	ereport(LOG,
+			(errmsg("parallel redo started with %d workers", nworkers)));
+
+	memset(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(TransactionId);
+	ctl.entrysize = add_size(offsetof(ParallelRedoXact, dispatched),
+							 mul_size(sizeof(uint32), nworkers));
+	state->xacts = hash_create("Parallel redo transactions", 256, &ctl,
+							   HASH_ELEM | HASH_BLOBS);
+
+	redo = state;
+	return true;
+}
+
+/*
+ * Wait for all the workers to have started.  Returns false if any of them
+ * couldn't be.
+ */
+static bool
+ParallelRedoWaitForStartup(ParallelRedoState *state)
+{
+	for (;;)
+	{
+		bool		all_started = true;
+		int			i;
+
+		for (i = 0; i < state->nworkers; i++)
+		{
+			pid_t		pid;
+
+			switch (GetBackgroundWorkerPid(state->handles[i], &pid))
+			{
+				case BGWH_STARTED:
+					break;
+				case BGWH_NOT_YET_STARTED:
+					all_started = false;
+					break;
+				case BGWH_STOPPED:
+				case BGWH_POSTMASTER_DIED:
+					return false;
+			}
+		}
+		if (all_started)
+			return true;
+
+		WaitLatch(MyLatch, WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+				  10L, WAIT_EVENT_BGWORKER_STARTUP);
+		ResetLatch(MyLatch);
+
+		HandleStartupProcInterrupts();
+	}
+}
+
+/*
+ * Exit if any worker has gone away.  It will have logged why.
+ */
+static void
+ParallelRedoCheckWorkers(void)
+{
+	int			i;
+
+	for (i = 0; i < redo->nworkers; i++)
+	{
+		pid_t		pid;
+		BgwHandleStatus status;
+
+		status = GetBackgroundWorkerPid(redo->handles[i], &pid);
+		if (status == BGWH_STOPPED || status == BGWH_POSTMASTER_DIED)
+			ereport(FATAL,
+					(errmsg("parallel redo worker %d exited unexpectedly", i)));
+	}
+}
+
+/*
+ * Can this record be replayed by a worker?  It must modify exactly one
+ * block, and nothing but that block (and the visibility map and free space
+ * map pages covering it, which are locked as usual), and it must not need
+ * to resolve conflicts with hot standby queries.
+ */
+static bool
+ParallelRedoIsSafe(XLogReaderState *record)
+{
+	uint8		info = XLogRecGetInfo(record) & ~XLR_INFO_MASK;
+
+	if (record->max_block_id != 0 ||
+		(XLogRecGetInfo(record) & (XLR_SPECIAL_REL_UPDATE |
+								   XLR_CHECK_CONSISTENCY)) != 0)
+		return false;
+
+	switch (XLogRecGetRmid(record))
+	{
+		case RM_HEAP_ID:
+			switch (info & XLOG_HEAP_OPMASK)
+			{
+				case XLOG_HEAP_INSERT:
+				case XLOG_HEAP_DELETE:
+				case XLOG_HEAP_HOT_UPDATE:
+				case XLOG_HEAP_CONFIRM:
+				case XLOG_HEAP_LOCK:
+				case XLOG_HEAP_INPLACE:
+					return true;
+			}
+			break;
+
+		case RM_HEAP2_ID:
+			switch (info & XLOG_HEAP_OPMASK)
+			{
+				case XLOG_HEAP2_MULTI_INSERT:
+				case XLOG_HEAP2_LOCK_UPDATED:
+					return true;
+			}
+			break;
+
+		case RM_BTREE_ID:
+			if (info == XLOG_BTREE_INSERT_LEAF || info == XLOG_BTREE_DEDUP)
+				return true;
+			break;
+	}
+
+	return false;
+}
+
+/*
+ * Send a record to a worker, waiting for room in its queue if need be.
+ */
+static void
+ParallelRedoSend(int worker, XLogReaderState *record)
+{
+	ParallelRedoRecordHeader hdr;
+	shm_mq_iovec iov[2];
+
+	hdr.ReadRecPtr = record->ReadRecPtr;
+	hdr.EndRecPtr = record->EndRecPtr;
+
+	iov[0].data = (const char *) &hdr;
+	iov[0].len = sizeof(hdr);
+	iov[1].data = (const char *) record->decoded_record;
+	iov[1].len = XLogRecGetTotalLen(record);
+
+	for (;;)
+	{
+		shm_mq_result res;
+
+		res = shm_mq_sendv(redo->queues[worker], iov, 2, true);
+		if (res == SHM_MQ_SUCCESS)
+			break;
+		if (res == SHM_MQ_DETACHED)
+			ereport(FATAL,
+					(errmsg("parallel redo worker %d exited unexpectedly",
+							worker)));
+
+		/* The worker sets our latch as it makes room */
+		WaitLatch(MyLatch, WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+				  1000L, WAIT_EVENT_PARALLEL_REDO_DISPATCH);
+		ResetLatch(MyLatch);
+
+		HandleStartupProcInterrupts();
+	}
+
+	redo->dispatched[worker]++;
+	redo->nrecords++;
+}
+
+/*
+ * Error context callback for errors while replaying a record in a worker.
+ */
+static void
+parallel_redo_error_callback(void *arg)
+{
+	XLogReaderState *record = (XLogReaderState *) arg;
+
+	errcontext("WAL redo at %X/%X for %s",
+			   (uint32) (record->ReadRecPtr >> 32),
+			   (uint32) record->ReadRecPtr,
+			   RmgrTable[XLogRecGetRmid(record)].rm_name);
+}
+
+/*
+ * Main entry point for parallel redo workers.
+ */
+void
+ParallelRedoWorkerMain(Datum main_arg)
+{
+	int			workerno;
+	dsm_segment *seg;
+	shm_toc    *toc;
+	ParallelRedoShared *shared;
+	shm_mq	   *mq;
+	shm_mq_handle *mqh;
+	PGPROC	   *startup;
+	XLogReaderState *reader;
+	MemoryContext redo_context;
+
+	/* Establish signal handlers. */
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	memcpy(&workerno, MyBgworkerEntry->bgw_extra, sizeof(int));
+
+	CurrentResourceOwner = ResourceOwnerCreate(NULL, "parallel redo worker");
+	redo_context = AllocSetContextCreate(TopMemoryContext,
+										 "Parallel redo",
+										 ALLOCSET_DEFAULT_SIZES);
+
+	seg = dsm_attach(DatumGetUInt32(main_arg));
+	if (seg == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not map dynamic shared memory segment")));
+	toc = shm_toc_attach(PARALLEL_REDO_MAGIC, dsm_segment_address(seg));
+	if (toc == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+		   errmsg("invalid magic number in dynamic shared memory segment")));
+
+	shared = shm_toc_lookup(toc, PARALLEL_REDO_KEY_SHARED);
+	Assert(workerno >= 0 && workerno < shared->nworkers);
+	mq = shm_toc_lookup(toc, PARALLEL_REDO_KEY_QUEUE + workerno);
+	shm_mq_set_receiver(mq, MyProc);
+	mqh = shm_mq_attach(mq, seg, NULL);
+	startup = shm_mq_get_sender(mq);
+
+	/* Release buffer pins if we exit abnormally */
+	InitBufferPoolBackend();
+
+	/* Behave like the startup process while replaying */
+	InRecovery = true;
+	reachedConsistency = true;
+	InParallelRedoWorker = true;
+
+	reader = XLogReaderAllocate(NULL, NULL);
+	if (!reader)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+				 errdetail("Failed while allocating an XLog reading processor.")));
+
+	for (;;)
+	{
+		ParallelRedoRecordHeader hdr;
+		XLogRecord *record;
+		ErrorContextCallback errcallback;
+		MemoryContext oldcontext;
+		shm_mq_result res;
+		Size		nbytes;
+		void	   *data;
+		char	   *errormsg;
+
+		CHECK_FOR_INTERRUPTS();
+
+		res = shm_mq_receive(mqh, &nbytes, &data, true);
+		if (res == SHM_MQ_WOULD_BLOCK)
+		{
+			/* Out of work; the startup process may be waiting for that */
+			SetLatch(&startup->procLatch);
+			res = shm_mq_receive(mqh, &nbytes, &data, false);
+		}
+		if (res != SHM_MQ_SUCCESS)
+			break;				/* end of recovery */
+
+		if (nbytes < sizeof(hdr) + SizeOfXLogRecord)
+			elog(ERROR, "invalid parallel redo message of %zu bytes", nbytes);
+		memcpy(&hdr, data, sizeof(hdr));
+		record = (XLogRecord *) ((char *) data + sizeof(hdr));
+
+		reader->ReadRecPtr = hdr.ReadRecPtr;
+		reader->EndRecPtr = hdr.EndRecPtr;
+		if (!DecodeXLogRecord(reader, record, &errormsg))
+			elog(ERROR, "could not decode WAL record at %X/%X: %s",
+				 (uint32) (hdr.ReadRecPtr >> 32), (uint32) hdr.ReadRecPtr,
+				 errormsg);
+
+		errcallback.callback = parallel_redo_error_callback;
+		errcallback.arg = (void *) reader;
+		errcallback.previous = error_context_stack;
+		error_context_stack = &errcallback;
+
+		oldcontext = MemoryContextSwitchTo(redo_context);
+		RmgrTable[record->xl_rmid].rm_redo(reader);
+		MemoryContextSwitchTo(oldcontext);
+		MemoryContextReset(redo_context);
+
+		error_context_stack = errcallback.previous;
+
+		/* this is also a barrier, making our changes visible first */
+		pg_atomic_fetch_add_u32(&shared->applied[workerno], 1);
+		if (pg_atomic_read_u32(&shared->startup_waiting) != 0)
+			SetLatch(&startup->procLatch);
+	}
+
+	XLogReaderFree(reader);
+	dsm_detach(seg);
+	proc_exit(0);
+}
@@ -0,0 +1,391 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogprefetch.c
+ *		Prefetching support for recovery.
+ *
+ * During WAL replay, each record that modifies a block not in shared
+ * buffers has to wait for the block to be read in, one at a time.  To hide
+ * that latency, the startup process runs a second xlogreader some distance
+ * ahead of the record being replayed, decodes the records it finds there,
+ * and initiates asynchronous reads (via smgrprefetch) of the blocks they
+ * reference.  By the time replay reaches those records, the blocks should
+ * be in the kernel's page cache.
+ *
+ * Blocks that redo will not read are skipped: those with a full page image,
+ * and those that the record re-initializes.  So are blocks referenced very
+ * recently, since they are almost certainly still in shared buffers or
+ * already on their way in.
+ *
+ * The look-ahead reader reads WAL directly from the segment files in
+ * pg_wal on the current replay timeline.  It never waits for WAL to arrive:
+ * if the data it wants isn't there yet, or can't be decoded, it simply
+ * stops and tries again once replay has made some progress.  Prefetching is
+ * purely advisory, so none of this affects the correctness of replay.
+ *
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/backend/access/transam/xlogprefetch.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "access/xlog.h"
+#include "access/xlog_internal.h"
+#include "access/xlogprefetch.h"
+#include "access/xlogrecord.h"
+#include "replication/walreceiver.h"
+#include "storage/bufmgr.h"
+#include "storage/fd.h"
+#include "storage/smgr.h"
+
+
+/*
+ * Number of recently prefetched block references we remember, to avoid
+ * issuing the same prefetch over and over for a hot block.
+ */
+#define XLOGPREFETCHER_RECENT_BLOCKS	64
+
+typedef struct XLogPrefetcherBlock
+{
+	RelFileNode rnode;
+	ForkNumber	forknum;
+	BlockNumber blkno;
+} XLogPrefetcherBlock;
+
+struct XLogPrefetcher
+{
+	/* Reader used to decode ahead of replay */
+	XLogReaderState *reader;
+
+	/* Timeline we're reading, and the currently open segment file */
+	TimeLineID	tli;
+	int			readFile;
+	XLogSegNo	readSegNo;
+
+	/*
+	 * Where to (re)start decoding, if valid; otherwise we carry on from the
+	 * reader's current position.
+	 */
+	XLogRecPtr	restartRecPtr;
+
+	/* Start and end of the last record we decoded */
+	XLogRecPtr	lastRecPtr;
+	XLogRecPtr	lastEndRecPtr;
+
+	/* After a failure, don't try again until replay has passed this point */
+	XLogRecPtr	retryRecPtr;
+
+	/* Ring of recently prefetched blocks */
+	XLogPrefetcherBlock recent[XLOGPREFETCHER_RECENT_BLOCKS];
+	int			nextRecent;
+
+	/* Statistics, reported at the end */
+	uint64		prefetched;		/* prefetches issued */
+	uint64		hits;			/* blocks found in shared buffers */
+	uint64		skipped;		/* blocks redo won't read, or seen recently */
+};
+
+/* GUC variable */
+int			recovery_prefetch_distance = (256 * 1024) / XLOG_BLCKSZ;
+
+static int XLogPrefetcherPageRead(XLogReaderState *reader,
+					   XLogRecPtr targetPagePtr, int reqLen,
+					   XLogRecPtr targetRecPtr, char *readBuf,
+					   TimeLineID *pageTLI);
+static XLogReaderState *XLogPrefetcherAllocateReader(XLogPrefetcher *prefetcher);
+static void XLogPrefetcherCloseFile(XLogPrefetcher *prefetcher);
+static void XLogPrefetcherScanRecord(XLogPrefetcher *prefetcher);
+static bool XLogPrefetcherSeenRecently(XLogPrefetcher *prefetcher,
+						   RelFileNode rnode, ForkNumber forknum,
+						   BlockNumber blkno);
+
+
+/*
+ * Set up the look-ahead reader.
+ */
+static XLogReaderState *
+XLogPrefetcherAllocateReader(XLogPrefetcher *prefetcher)
+{
+	XLogReaderState *reader;
+
+	reader = XLogReaderAllocate(&XLogPrefetcherPageRead, prefetcher);
+	if (!reader)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+				 errdetail("Failed while allocating an XLog reading processor.")));
+
+	return reader;
+}
+
+/*
+ * Create a prefetcher, for use by the startup process.
+ */
+XLogPrefetcher *
+XLogPrefetcherAllocate(void)
+{
+	XLogPrefetcher *prefetcher;
+
+	prefetcher = palloc0(sizeof(XLogPrefetcher));
+	prefetcher->reader = XLogPrefetcherAllocateReader(prefetcher);
+	prefetcher->readFile = -1;
+	prefetcher->restartRecPtr = InvalidXLogRecPtr;
+	prefetcher->lastRecPtr = InvalidXLogRecPtr;
+	prefetcher->lastEndRecPtr = InvalidXLogRecPtr;
+	prefetcher->retryRecPtr = InvalidXLogRecPtr;
+
+	return prefetcher;
+}
+
+/*
+ * Release a prefetcher, reporting what it did.
+ */
+void
+XLogPrefetcherFree(XLogPrefetcher *prefetcher)
+{
+	ereport(DEBUG1,
+			(errmsg("recovery prefetched " UINT64_FORMAT " blocks, found " UINT64_FORMAT " in shared buffers, skipped " UINT64_FORMAT,
+					prefetcher->prefetched, prefetcher->hits,
+					prefetcher->skipped)));
+
+	XLogPrefetcherCloseFile(prefetcher);
+	XLogReaderFree(prefetcher->reader);
+	pfree(prefetcher);
+}
+
+/*
+ * Issue prefetches for the blocks referenced by WAL records following the
+ * one that is about to be replayed by "replay", up to
+ * recovery_prefetch_distance ahead of it.  "tli" is the timeline replay is
+ * on.
+ *
+ * Called by the startup process before replaying each record.
+ */
+void
+XLogPrefetcherReadAhead(XLogPrefetcher *prefetcher, XLogReaderState *replay,
+						TimeLineID tli)
+{
+#ifdef USE_PREFETCH
+	XLogRecPtr	limit;
+
+	if (recovery_prefetch_distance <= 0)
+		return;
+
+	limit = replay->EndRecPtr + (XLogRecPtr) recovery_prefetch_distance * XLOG_BLCKSZ;
+
+	/*
+	 * If replay has switched timelines, start over on the new one.  The
+	 * reader may have a page of the old timeline cached, so get a new one.
+	 */
+	if (tli != prefetcher->tli)
+	{
+		XLogPrefetcherCloseFile(prefetcher);
+		if (prefetcher->tli != 0)
+		{
+			XLogReaderFree(prefetcher->reader);
+			prefetcher->reader = XLogPrefetcherAllocateReader(prefetcher);
+		}
+		prefetcher->tli = tli;
+		prefetcher->lastRecPtr = InvalidXLogRecPtr;
+		prefetcher->lastEndRecPtr = InvalidXLogRecPtr;
+		prefetcher->retryRecPtr = InvalidXLogRecPtr;
+	}
+
+	/* After a failure, wait until replay has made some progress */
+	if (!XLogRecPtrIsInvalid(prefetcher->retryRecPtr))
+	{
+		if (replay->EndRecPtr < prefetcher->retryRecPtr)
+			return;
+		prefetcher->retryRecPtr = InvalidXLogRecPtr;
+	}
+
+	/*
+	 * If we haven't started yet, or replay has caught up with us, (re)start
+	 * at the record being replayed, which is known to be a valid record
+	 * boundary.
+	 */
+	if (prefetcher->lastEndRecPtr <= replay->EndRecPtr)
+		prefetcher->restartRecPtr = replay->ReadRecPtr;
+
+	while (prefetcher->lastEndRecPtr < limit)
+	{
+		XLogRecord *record;
+		char	   *errormsg;
+
+		record = XLogReadRecord(prefetcher->reader, prefetcher->restartRecPtr,
+								&errormsg);
+		if (record == NULL)
+		{
+			/*
+			 * Not there yet, or garbage; either way, give up for now.  Next
+			 * time, start again from the last record we managed to decode, or
+			 * from wherever replay has got to if that's further.
+			 */
+			if (XLogRecPtrIsInvalid(prefetcher->lastRecPtr) ||
+				prefetcher->lastRecPtr < replay->ReadRecPtr)
+				prefetcher->restartRecPtr = replay->ReadRecPtr;
+			else
+				prefetcher->restartRecPtr = prefetcher->lastRecPtr;
+			prefetcher->lastEndRecPtr = prefetcher->restartRecPtr;
+			prefetcher->retryRecPtr = replay->EndRecPtr + XLOG_BLCKSZ;
+			return;
+		}
+		prefetcher->restartRecPtr = InvalidXLogRecPtr;
+
+		/*
+		 * Don't bother with records that replay has already reached, nor with
+		 * ones we've processed before a restart.
+		 */
+		if (prefetcher->reader->ReadRecPtr > replay->ReadRecPtr &&
+			prefetcher->reader->ReadRecPtr > prefetcher->lastRecPtr)
+			XLogPrefetcherScanRecord(prefetcher);
+
+		prefetcher->lastRecPtr = prefetcher->reader->ReadRecPtr;
+		prefetcher->lastEndRecPtr = prefetcher->reader->EndRecPtr;
+	}
+#endif   /* USE_PREFETCH */
+}
+
+/*
+ * Prefetch the blocks referenced by the record the reader just decoded.
+ */
+static void
+XLogPrefetcherScanRecord(XLogPrefetcher *prefetcher)
+{
+	XLogReaderState *reader = prefetcher->reader;
+	int			block_id;
+
+	for (block_id = 0; block_id <= reader->max_block_id; block_id++)
+	{
+		RelFileNode rnode;
+		ForkNumber	forknum;
+		BlockNumber blkno;
+		SMgrRelation smgr;
+
+		if (!XLogRecGetBlockTag(reader, block_id, &rnode, &forknum, &blkno))
+			continue;
+
+		/* Redo won't read blocks it restores from an image or initializes */
+		if (XLogRecHasBlockImage(reader, block_id) ||
+			(reader->blocks[block_id].flags & BKPBLOCK_WILL_INIT) != 0)
+		{
+			prefetcher->skipped++;
+			continue;
+		}
+
+		if (XLogPrefetcherSeenRecently(prefetcher, rnode, forknum, blkno))
+		{
+			prefetcher->skipped++;
+			continue;
+		}
+
+		smgr = smgropen(rnode, InvalidBackendId);
+		if (PrefetchSharedBuffer(smgr, forknum, blkno))
+			prefetcher->prefetched++;
+		else
+			prefetcher->hits++;
+	}
+}
+
+/*
+ * Check whether a block is among the ones we prefetched most recently, and
+ * remember it if not.
+ */
+static bool
+XLogPrefetcherSeenRecently(XLogPrefetcher *prefetcher, RelFileNode rnode,
+						   ForkNumber forknum, BlockNumber blkno)
+{
+	XLogPrefetcherBlock *entry;
+	int			i;
+
+	for (i = 0; i < XLOGPREFETCHER_RECENT_BLOCKS; i++)
+	{
+		entry = &prefetcher->recent[i];
+		if (entry->blkno == blkno && entry->forknum == forknum &&
+			RelFileNodeEquals(entry->rnode, rnode))
+			return true;
+	}
+
+	entry = &prefetcher->recent[prefetcher->nextRecent];
+	entry->rnode = rnode;
+	entry->forknum = forknum;
+	entry->blkno = blkno;
+	prefetcher->nextRecent = (prefetcher->nextRecent + 1) %
+		XLOGPREFETCHER_RECENT_BLOCKS;
+
+	return false;
+}
+
+static void
+XLogPrefetcherCloseFile(XLogPrefetcher *prefetcher)
+{
+	if (prefetcher->readFile >= 0)
+	{
+		close(prefetcher->readFile);
+		prefetcher->readFile = -1;
+	}
+}
+
+/*
+ * Page read callback for the look-ahead reader.
+ *
+ * Reads from the segment files in pg_wal, without waiting for anything.
+ * While streaming, we must not read past what the WAL receiver has flushed,
+ * since the rest of the segment may still contain old data.  Returns -1 if
+ * the page isn't available.
+ */
+static int
+XLogPrefetcherPageRead(XLogReaderState *reader, XLogRecPtr targetPagePtr,
+					   int reqLen, XLogRecPtr targetRecPtr, char *readBuf,
+					   TimeLineID *pageTLI)
+{
+	XLogPrefetcher *prefetcher = (XLogPrefetcher *) reader->private_data;
+	XLogSegNo	segno;
+	uint32		offset;
+	int			readLen = XLOG_BLCKSZ;
+
+	if (WalRcvStreaming())
+	{
+		XLogRecPtr	receivedUpto = GetWalRcvWriteRecPtr(NULL, NULL);
+
+		if (targetPagePtr + reqLen > receivedUpto)
+			return -1;
+		if (targetPagePtr + XLOG_BLCKSZ > receivedUpto)
+			readLen = receivedUpto - targetPagePtr;
+	}
+
+	XLByteToSeg(targetPagePtr, segno);
+	if (prefetcher->readFile >= 0 && segno != prefetcher->readSegNo)
+		XLogPrefetcherCloseFile(prefetcher);
+
+	if (prefetcher->readFile < 0)
+	{
+		char		path[MAXPGPATH];
+		char		fname[MAXFNAMELEN];
+
+		XLogFileName(fname, prefetcher->tli, segno);
+		snprintf(path, MAXPGPATH, XLOGDIR "/%s", fname);
+
+		prefetcher->readFile = BasicOpenFile(path, O_RDONLY | PG_BINARY, 0);
+		if (prefetcher->readFile < 0)
+			return -1;
+		prefetcher->readSegNo = segno;
+	}
+
+	offset = targetPagePtr % XLogSegSize;
+	if (lseek(prefetcher->readFile, (off_t) offset, SEEK_SET) < 0 ||
+		read(prefetcher->readFile, readBuf, readLen) != readLen)
+	{
+		XLogPrefetcherCloseFile(prefetcher);
+		return -1;
+	}
+
+	*pageTLI = prefetcher->tli;
+	return readLen;
+}
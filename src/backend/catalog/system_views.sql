@@ -883,6 +883,9 @@ CREATE VIEW pg_stat_bgwriter AS
         pg_stat_get_bgwriter_requested_checkpoints() AS checkpoints_req,
         pg_stat_get_checkpoint_write_time() AS checkpoint_write_time,
         pg_stat_get_checkpoint_sync_time() AS checkpoint_sync_time,
+        pg_stat_get_checkpoint_early_sync_time() AS checkpoint_early_sync_time,
+        pg_stat_get_checkpoint_early_syncs() AS checkpoint_early_syncs,
+        pg_stat_get_checkpoint_syncs() AS checkpoint_syncs,
         pg_stat_get_bgwriter_buf_written_checkpoints() AS buffers_checkpoint,
         pg_stat_get_bgwriter_buf_written_clean() AS buffers_clean,
         pg_stat_get_bgwriter_maxwritten_clean() AS maxwritten_clean,
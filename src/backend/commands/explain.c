@@ -21,6 +21,7 @@
 #include "commands/prepare.h"
 #include "executor/hashjoin.h"
 #include "foreign/fdwapi.h"
+#include "jit/jit.h"
 #include "nodes/extensible.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
@@ -102,6 +103,7 @@ static void show_tablesample(TableSampleClause *tsc, PlanState *planstate,
 				 List *ancestors, ExplainState *es);
 static void show_sort_info(SortState *sortstate, ExplainState *es);
 static void show_hash_info(HashState *hashstate, ExplainState *es);
+static void show_hashagg_info(AggState *aggstate, ExplainState *es);
 static void show_tidbitmap_info(BitmapHeapScanState *planstate,
 					ExplainState *es);
 static void show_instrumentation_count(const char *qlabel, int which,
@@ -565,6 +567,9 @@ ExplainOnePlan(PlannedStmt *plannedstmt, IntoClause *into, ExplainState *es,
 	if (es->analyze)
 		ExplainPrintTriggers(es, queryDesc);
 
+	/* Print info about JIT compilation, if any was done */
+	ExplainPrintJIT(es, queryDesc);
+
 	/*
 	 * Close down the query and free resources.  Include time for this in the
 	 * total execution time (although it should be pretty minimal).
@@ -676,6 +681,40 @@ ExplainPrintTriggers(ExplainState *es, QueryDesc *queryDesc)
 	ExplainCloseGroup("Triggers", "Triggers", false, es);
 }
 
+/*
+ * ExplainPrintJIT -
+ *	  Append information about JIT compilation of the query to es->str,
+ *	  if any was performed.
+ */
+void
+ExplainPrintJIT(ExplainState *es, QueryDesc *queryDesc)
+{
+	JitContext *jc = queryDesc->estate->es_jit;
+
+	if (jc == NULL)
+		return;
+
+	ExplainOpenGroup("JIT", "JIT", true, es);
+
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+	{
+		appendStringInfoString(es->str, "JIT:\n");
+		appendStringInfo(es->str, "  Functions: %zu\n",
+						 jc->created_functions);
+		appendStringInfo(es->str, "  Generation Time: %.3f ms\n",
+						 1000.0 * INSTR_TIME_GET_DOUBLE(jc->generation_counter));
+	}
+	else
+	{
+		ExplainPropertyLong("Functions", (long) jc->created_functions, es);
+		ExplainPropertyFloat("Generation Time",
+							 1000.0 * INSTR_TIME_GET_DOUBLE(jc->generation_counter),
+							 3, es);
+	}
+
+	ExplainCloseGroup("JIT", "JIT", true, es);
+}
+
 /*
  * ExplainQueryText -
  *	  add a "Query Text" node that contains the actual text of the query
@@ -1564,6 +1603,8 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
+			if (es->analyze)
+				show_hashagg_info(castNode(AggState, planstate), es);
 			break;
 		case T_Group:
 			show_group_keys(castNode(GroupState, planstate), ancestors, es);
@@ -2334,6 +2375,30 @@ show_hash_info(HashState *hashstate, ExplainState *es)
 	}
 }
 
+/*
+ * Show information on hash aggregate batches, if the node spilled to disk
+ */
+static void
+show_hashagg_info(AggState *aggstate, ExplainState *es)
+{
+	if (aggstate->hash_batches_used == 0)
+		return;
+
+	if (es->format != EXPLAIN_FORMAT_TEXT)
+	{
+		ExplainPropertyLong("HashAgg Batches", aggstate->hash_batches_used,
+							es);
+		ExplainPropertyLong("Disk Usage", aggstate->hash_disk_used, es);
+	}
+	else
+	{
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		appendStringInfo(es->str, "Batches: %d  Disk Usage: %ldkB\n",
+						 aggstate->hash_batches_used,
+						 aggstate->hash_disk_used);
+	}
+}
+
 /*
  * If it's EXPLAIN ANALYZE, show exact/lossy pages for a BitmapHeapScan node
  */
@@ -60,6 +60,14 @@ int			vacuum_freeze_table_age;
 int			vacuum_multixact_freeze_min_age;
 int			vacuum_multixact_freeze_table_age;
 
+/*
+ * Cost-based delay state shared by the participants of a parallel index
+ * vacuum or cleanup pass.  These are NULL when we're not part of one.
+ */
+pg_atomic_uint32 *VacuumSharedCostBalance = NULL;
+pg_atomic_uint32 *VacuumActiveNWorkers = NULL;
+int			VacuumCostBalanceLocal = 0;
+
 
 /* A few variables that don't seem worth passing around as parameters */
 static MemoryContext vac_context = NULL;
@@ -74,6 +82,7 @@ static void vac_truncate_clog(TransactionId frozenXID,
 				  MultiXactId lastSaneMinMulti);
 static bool vacuum_rel(Oid relid, RangeVar *relation, int options,
 		   VacuumParams *params);
+static int	compute_parallel_delay(void);
 
 /*
  * Primary entry point for manual VACUUM and ANALYZE commands
@@ -288,6 +297,8 @@ vacuum(int options, RangeVar *relation, Oid relid, VacuumParams *params,
 		in_vacuum = true;
 		VacuumCostActive = (VacuumCostDelay > 0);
 		VacuumCostBalance = 0;
+		VacuumSharedCostBalance = NULL;
+		VacuumActiveNWorkers = NULL;
 		VacuumPageHit = 0;
 		VacuumPageMiss = 0;
 		VacuumPageDirty = 0;
@@ -333,6 +344,9 @@ vacuum(int options, RangeVar *relation, Oid relid, VacuumParams *params,
 	{
 		in_vacuum = false;
 		VacuumCostActive = false;
+		/* the shared balance went away with the parallel context, if any */
+		VacuumSharedCostBalance = NULL;
+		VacuumActiveNWorkers = NULL;
 		PG_RE_THROW();
 	}
 	PG_END_TRY();
@@ -1559,16 +1573,26 @@ vac_close_indexes(int nindexes, Relation *Irel, LOCKMODE lockmode)
 void
 vacuum_delay_point(void)
 {
+	int			msec = 0;
+
 	/* Always check for interrupts */
 	CHECK_FOR_INTERRUPTS();
 
-	/* Nap if appropriate */
-	if (VacuumCostActive && !InterruptPending &&
-		VacuumCostBalance >= VacuumCostLimit)
-	{
-		int			msec;
+	if (!VacuumCostActive || InterruptPending)
+		return;
 
+	/*
+	 * In a parallel index pass the balance is shared by all the participants,
+	 * otherwise it's our own.
+	 */
+	if (VacuumSharedCostBalance != NULL)
+		msec = compute_parallel_delay();
+	else if (VacuumCostBalance >= VacuumCostLimit)
 		msec = VacuumCostDelay * VacuumCostBalance / VacuumCostLimit;
+
+	/* Nap if appropriate */
+	if (msec > 0)
+	{
 		if (msec > VacuumCostDelay * 4)
 			msec = VacuumCostDelay * 4;
 
@@ -1583,3 +1607,38 @@ vacuum_delay_point(void)
 		CHECK_FOR_INTERRUPTS();
 	}
 }
+
+/*
+ * compute_parallel_delay --- how long to nap in a parallel index pass
+ *
+ * Our cost balance is added to the one shared by all the participants.  Once
+ * that reaches the limit, each participant that has done more than its fair
+ * share of the work since it last napped naps for a time in proportion to
+ * that work, and takes it off the shared balance.  Together, the
+ * participants then stay within the cost limit, as a serial vacuum would.
+ */
+static int
+compute_parallel_delay(void)
+{
+	int			msec = 0;
+	uint32		shared_balance;
+	int			nworkers;
+
+	nworkers = Max(pg_atomic_read_u32(VacuumActiveNWorkers), 1);
+
+	shared_balance = pg_atomic_add_fetch_u32(VacuumSharedCostBalance,
+											 VacuumCostBalance);
+	VacuumCostBalanceLocal += VacuumCostBalance;
+	VacuumCostBalance = 0;
+
+	if (shared_balance >= VacuumCostLimit &&
+		VacuumCostBalanceLocal > VacuumCostLimit / (2 * nworkers))
+	{
+		msec = VacuumCostDelay * VacuumCostBalanceLocal / VacuumCostLimit;
+		pg_atomic_sub_fetch_u32(VacuumSharedCostBalance,
+								VacuumCostBalanceLocal);
+		VacuumCostBalanceLocal = 0;
+	}
+
+	return msec;
+}
@@ -4,24 +4,37 @@
  *	  Concurrent ("lazy") vacuuming.
  *
  *
- * The major space usage for LAZY VACUUM is storage for the array of dead
- * tuple TIDs, with the next biggest need being storage for per-disk-page
- * free space info.  We want to ensure we can vacuum even the very largest
- * relations with finite memory space usage.  To do that, we set upper bounds
- * on the number of tuples and pages we will keep track of at once.
+ * The major space usage for LAZY VACUUM is storage for the dead tuple TIDs,
+ * with the next biggest need being storage for per-disk-page free space info.
+ * We want to ensure we can vacuum even the very largest relations with finite
+ * memory space usage.  To do that, we set upper bounds on the number of
+ * tuples and pages we will keep track of at once.
  *
  * We are willing to use at most maintenance_work_mem (or perhaps
  * autovacuum_work_mem) memory space to keep track of dead tuples.  We
- * initially allocate an array of TIDs of that size, with an upper limit that
- * depends on table size (this limit ensures we don't allocate a huge area
- * uselessly for vacuuming small tables).  If the array threatens to overflow,
- * we suspend the heap scan phase and perform a pass of index cleanup and page
- * compaction, then resume the heap scan with an empty TID array.
+ * initially allocate a dead tuple store of that size, with an upper limit
+ * that depends on table size (this limit ensures we don't allocate a huge
+ * area uselessly for vacuuming small tables).  If the store threatens to
+ * overflow, we suspend the heap scan phase and perform a pass of index
+ * cleanup and page compaction, then resume the heap scan with an empty store.
+ *
+ * The store keeps one entry per heap page with dead tuples, holding the
+ * page's dead item offsets either as a sorted list or as a bitmap, whichever
+ * is smaller.  Pages with many dead tuples thus cost only a few bits per
+ * tuple, which makes it far less likely that a large table needs more than
+ * one pass over its indexes.  See LVDeadTuples below for the details.
  *
  * If we're processing a table with no indexes, we can just vacuum each page
  * as we go; there's no need to save up multiple tuples to minimize the number
  * of index scans performed.  So we don't use maintenance_work_mem memory for
- * the TID array, just enough to hold as many heap tuples as fit on one page.
+ * the store, just enough to hold the dead tuples of one page.
+ *
+ * A table with several indexes can have its indexes vacuumed and cleaned up
+ * by parallel workers.  The dead tuple store is then allocated in a dynamic
+ * shared memory segment of its own from the start, which the workers attach
+ * to for each index vacuum pass, and each participant, the leader included,
+ * claims indexes one at a time until all are done.  The heap scan itself is
+ * always done by the leader alone, outside of parallel mode.
  *
  *
  * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
@@ -37,13 +50,16 @@
 
 #include <math.h>
 
+#include "access/amapi.h"
 #include "access/genam.h"
 #include "access/heapam.h"
 #include "access/heapam_xlog.h"
 #include "access/htup_details.h"
 #include "access/multixact.h"
+#include "access/parallel.h"
 #include "access/transam.h"
 #include "access/visibilitymap.h"
+#include "access/xact.h"
 #include "access/xlog.h"
 #include "catalog/catalog.h"
 #include "catalog/storage.h"
@@ -51,12 +67,17 @@
 #include "commands/progress.h"
 #include "commands/vacuum.h"
 #include "miscadmin.h"
+#include "optimizer/paths.h"
 #include "pgstat.h"
 #include "portability/instr_time.h"
 #include "postmaster/autovacuum.h"
 #include "storage/bufmgr.h"
+#include "storage/dsm.h"
+#include "storage/dsm_impl.h"
 #include "storage/freespace.h"
 #include "storage/lmgr.h"
+#include "storage/proc.h"
+#include "storage/spin.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/pg_rusage.h"
@@ -85,13 +106,6 @@
 #define VACUUM_TRUNCATE_LOCK_WAIT_INTERVAL		50		/* ms */
 #define VACUUM_TRUNCATE_LOCK_TIMEOUT			5000	/* ms */
 
-/*
- * Guesstimation of number of dead tuples per page.  This is used to
- * provide an upper limit to memory allocated when vacuuming small
- * tables.
- */
-#define LAZY_ALLOC_TUPLES		MaxHeapTuplesPerPage
-
 /*
  * Before we consider skipping a page that's marked as clean in
  * visibility map, we must've seen at least this many clean pages.
@@ -104,6 +118,134 @@
  */
 #define PREFETCH_SIZE			((BlockNumber) 32)
 
+/*
+ * Heap pages that lazy_scan_heap has read ahead of the page it is working
+ * on, with one I/O per range of consecutive pages.  They stay pinned until
+ * the scan gets to them, or skips past them.
+ */
+typedef struct LVReadAhead
+{
+	BlockNumber next_block;		/* block held in buffers[next], if any */
+	int			next;			/* next entry of buffers to hand out */
+	int			nbuffers;		/* number of entries read into buffers */
+	Buffer		buffers[MAX_IO_COMBINE_BLOCKS];
+} LVReadAhead;
+
+/*
+ * Storage for the TIDs of dead tuples.
+ *
+ * The store is a single chunk of memory.  LVDeadBlock entries, one per heap
+ * page with dead tuples and in block number order, grow upward from the
+ * start of the chunk, while the encoded item offsets of each page grow
+ * downward from the end.  A directory at the very end maps each range of
+ * heap blocks (256 of them, or more for huge tables) to its first
+ * LVDeadBlock entry, so a lookup only needs to binary search the entries for
+ * that range, which is a handful of steps.  All
+ * positions are stored as byte offsets from the start of the chunk, never as
+ * pointers.
+ *
+ * A page with a single dead tuple stores its offset directly in the "data"
+ * field, flagged with LAZY_DEAD_INLINE.  Otherwise "data" points to a uint16
+ * header word.  If the LAZY_DEAD_BITMAP bit of the header is set, the rest
+ * of it is the length of a bitmap of dead offsets that follows; if not, the
+ * header is the number of dead offsets that follow as a sorted uint16 array.
+ * Encoded offsets always take an even number of bytes, so the header words
+ * stay aligned.
+ */
+typedef struct LVDeadBlock
+{
+	BlockNumber blkno;			/* heap block with dead tuples */
+	uint32		data;			/* encoded offsets, see above */
+} LVDeadBlock;
+
+typedef struct LVDeadTuples
+{
+	Size		size;			/* total size of the chunk */
+	int64		num_tuples;		/* # of dead tuples stored */
+	int			num_blocks;		/* # of entries in blocks[] */
+	uint32		data_start;		/* lowest byte used by encoded offsets */
+	uint32		directory;		/* start of the directory */
+	int			ndirectory;		/* # of directory entries */
+	int			directory_shift;	/* log2 of # of heap blocks per entry */
+	bool		directory_valid;	/* has the directory been built? */
+	LVDeadBlock blocks[FLEXIBLE_ARRAY_MEMBER];
+} LVDeadTuples;
+
+#define LAZY_DEAD_INLINE		0x80000000
+#define LAZY_DEAD_BITMAP		0x8000
+
+/* log2 of the least number of heap blocks covered by a directory entry */
+#define LAZY_DIRECTORY_MIN_SHIFT	8
+
+/* Size of a bitmap of offsets up to "maxoff", rounded up to an even size */
+#define LAZY_DEAD_BITMAP_SIZE(maxoff) \
+	(((maxoff) / BITS_PER_BYTE + 2) & ~1)
+
+/*
+ * The most space the dead tuples of one heap page can take.  The store is
+ * considered full once less than this is free.
+ */
+#define LAZY_MAX_BLOCK_SPACE \
+	(sizeof(LVDeadBlock) + sizeof(uint16) + \
+	 LAZY_DEAD_BITMAP_SIZE(MaxHeapTuplesPerPage))
+
+#define LAZY_DEAD_FREE_SPACE(dead) \
+	((Size) (dead)->data_start - \
+	 (offsetof(LVDeadTuples, blocks) + \
+	  (dead)->num_blocks * sizeof(LVDeadBlock)))
+
+#define LAZY_DEAD_TUPLES_FULL(dead) \
+	(LAZY_DEAD_FREE_SPACE(dead) < LAZY_MAX_BLOCK_SPACE)
+
+/* Magic number for parallel state sharing */
+#define PARALLEL_KEY_VACUUM_SHARED		UINT64CONST(0xC000000000000001)
+
+/*
+ * Statistics of one index, as passed between the participants of parallel
+ * index passes.  Until an index has been processed once, "updated" is false
+ * and its access method gets NULL statistics, as in a serial vacuum.
+ */
+typedef struct LVSharedIndStats
+{
+	Oid			indexoid;
+	bool		updated;		/* does stats hold anything? */
+	IndexBulkDeleteResult stats;
+} LVSharedIndStats;
+
+/*
+ * State shared by the participants of a parallel index vacuum or cleanup
+ * pass.
+ */
+typedef struct LVShared
+{
+	Oid			relid;			/* heap relation being vacuumed */
+	int			elevel;
+	bool		for_cleanup;	/* amvacuumcleanup rather than ambulkdelete? */
+	bool		estimated_count;	/* is num_heap_tuples an estimate? */
+	double		num_heap_tuples;
+	dsm_handle	dead_tuples_handle; /* segment holding the dead tuples */
+	int			maintenance_work_mem_worker;	/* for each worker, in kB */
+	int			nindexes;
+
+	/* mutex protects nextindex */
+	slock_t		mutex;
+	int			nextindex;		/* next index to be claimed */
+
+	/*
+	 * Cost-based delay.  The leader's settings are passed on explicitly,
+	 * because autovacuum adjusts them without going through the GUCs.  The
+	 * participants share one cost balance, so that together they do no more
+	 * I/O than a serial vacuum would.
+	 */
+	bool		cost_active;
+	int			cost_delay;
+	int			cost_limit;
+	pg_atomic_uint32 cost_balance;
+	pg_atomic_uint32 active_nworkers;	/* # of participants at work */
+
+	LVSharedIndStats indstats[FLEXIBLE_ARRAY_MEMBER];
+} LVShared;
+
 typedef struct LVRelStats
 {
 	/* hasindex = true means two-pass strategy; false means one-pass */
@@ -114,6 +256,8 @@ typedef struct LVRelStats
 	BlockNumber scanned_pages;	/* number of pages we examined */
 	BlockNumber pinskipped_pages;		/* # of pages we skipped due to a pin */
 	BlockNumber frozenskipped_pages;	/* # of frozen pages we skipped */
+	BlockNumber horizonskipped_pages;	/* # of all-visible pages we skipped
+										 * thanks to the freeze horizon */
 	BlockNumber tupcount_pages; /* pages whose tuples we counted */
 	double		scanned_tuples; /* counts only tuples on tupcount_pages */
 	double		old_rel_tuples; /* previous value of pg_class.reltuples */
@@ -122,17 +266,24 @@ typedef struct LVRelStats
 	BlockNumber pages_removed;
 	double		tuples_deleted;
 	BlockNumber nonempty_pages; /* actually, last nonempty page + 1 */
-	/* List of TIDs of tuples we intend to delete */
-	/* NB: this list is ordered by TID address */
-	int			num_dead_tuples;	/* current # of entries */
-	int			max_dead_tuples;	/* # slots allocated in array */
-	ItemPointer dead_tuples;	/* array of ItemPointerData */
+	/* TIDs of tuples we intend to delete */
+	LVDeadTuples *dead_tuples;
+	dsm_segment *dead_tuples_seg;	/* segment holding them, if shared */
+	int			parallel_workers;	/* # of workers for index passes */
+	int			parallel_work_mem;	/* maintenance_work_mem of each worker */
 	int			num_index_scans;
 	TransactionId latestRemovedXid;
 	bool		lock_waiter_detected;
+	/* Freeze horizon of the visibility map range being scanned */
+	BlockNumber range_start;	/* first heap block of the range */
+	TransactionId range_old_horizon;	/* horizon as of entering the range */
+	TransactionId range_horizon;	/* new horizon, as computed so far */
 } LVRelStats;
 
 
+/* GUC parameter: log the number of workers planned for index passes */
+bool		trace_parallel_vacuum = false;
+
 /* A few variables that don't seem worth passing around as parameters */
 static int	elevel = -1;
 
@@ -148,26 +299,54 @@ static void lazy_scan_heap(Relation onerel, int options,
 			   LVRelStats *vacrelstats, Relation *Irel, int nindexes,
 			   bool aggressive);
 static void lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats);
+static Buffer lazy_read_heap_page(Relation onerel, LVReadAhead *readahead,
+					BlockNumber blkno, BlockNumber endblk);
+static void lazy_release_readahead(LVReadAhead *readahead);
 static bool lazy_check_needs_freeze(Buffer buf, bool *hastup);
+static void lazy_vacuum_all_indexes(Relation onerel, Relation *Irel,
+						int nindexes, IndexBulkDeleteResult **indstats,
+						LVRelStats *vacrelstats);
+static void lazy_cleanup_all_indexes(Relation onerel, Relation *Irel,
+						 int nindexes, IndexBulkDeleteResult **indstats,
+						 LVRelStats *vacrelstats);
 static void lazy_vacuum_index(Relation indrel,
 				  IndexBulkDeleteResult **stats,
-				  LVRelStats *vacrelstats);
+				  LVDeadTuples *dead, double reltuples);
 static void lazy_cleanup_index(Relation indrel,
-				   IndexBulkDeleteResult *stats,
-				   LVRelStats *vacrelstats);
+				   IndexBulkDeleteResult **stats,
+				   double reltuples, bool estimated_count);
+static int lazy_compute_parallel_workers(Relation onerel, Relation *Irel,
+							  int nindexes, int vac_work_mem);
+static void lazy_parallel_vacuum_indexes(Relation onerel, Relation *Irel,
+							 int nindexes, IndexBulkDeleteResult **indstats,
+							 LVRelStats *vacrelstats, bool for_cleanup);
+static void lazy_parallel_process_indexes(Relation *Irel, LVShared *lvshared,
+							  LVDeadTuples *dead);
 static int lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
-				 int tupindex, LVRelStats *vacrelstats, Buffer *vmbuffer);
+				 int blockindex, LVRelStats *vacrelstats, Buffer *vmbuffer);
 static bool should_attempt_truncation(LVRelStats *vacrelstats);
 static void lazy_truncate_heap(Relation onerel, LVRelStats *vacrelstats);
 static BlockNumber count_nondeletable_pages(Relation onerel,
 						 LVRelStats *vacrelstats);
-static void lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks);
-static void lazy_record_dead_tuple(LVRelStats *vacrelstats,
-					   ItemPointer itemptr);
+static void lazy_space_alloc(Relation onerel, LVRelStats *vacrelstats,
+				 BlockNumber relblocks, Relation *Irel, int nindexes);
+static void lazy_space_free(LVRelStats *vacrelstats);
+static void lazy_reset_dead_tuples(LVDeadTuples *dead);
+static void lazy_record_dead_tuples(LVRelStats *vacrelstats, BlockNumber blkno,
+						OffsetNumber *offsets, int noffsets);
+static int lazy_get_dead_offsets(LVDeadTuples *dead, int blockindex,
+					  OffsetNumber *offsets);
+static void lazy_build_dead_directory(LVDeadTuples *dead);
 static bool lazy_tid_reaped(ItemPointer itemptr, void *state);
-static int	vac_cmp_itemptr(const void *left, const void *right);
 static bool heap_page_is_all_visible(Relation rel, Buffer buf,
 					 TransactionId *visibility_cutoff_xid, bool *all_frozen);
+static bool lazy_block_is_skippable(Relation onerel, LVRelStats *vacrelstats,
+						BlockNumber blkno, bool aggressive, Buffer *vmbuffer);
+static TransactionId lazy_page_oldest_unfrozen_xid(Page page);
+static void lazy_begin_horizon_range(Relation onerel, LVRelStats *vacrelstats,
+						 BlockNumber blkno, Buffer *vmbuffer);
+static void lazy_end_horizon_range(Relation onerel, LVRelStats *vacrelstats,
+					   Buffer *vmbuffer);
 
 
 /*
@@ -268,8 +447,8 @@ lazy_vacuum_rel(Relation onerel, int options, VacuumParams *params,
 	 * NB: We need to check this before truncating the relation, because that
 	 * will change ->rel_pages.
 	 */
-	if ((vacrelstats->scanned_pages + vacrelstats->frozenskipped_pages)
-		< vacrelstats->rel_pages)
+	if ((vacrelstats->scanned_pages + vacrelstats->frozenskipped_pages +
+		 vacrelstats->horizonskipped_pages) < vacrelstats->rel_pages)
 	{
 		Assert(!aggressive);
 		scanned_all_unfrozen = false;
@@ -379,11 +558,12 @@ lazy_vacuum_rel(Relation onerel, int options, VacuumParams *params,
 							 get_namespace_name(RelationGetNamespace(onerel)),
 							 RelationGetRelationName(onerel),
 							 vacrelstats->num_index_scans);
-			appendStringInfo(&buf, _("pages: %u removed, %u remain, %u skipped due to pins, %u skipped frozen\n"),
+			appendStringInfo(&buf, _("pages: %u removed, %u remain, %u skipped due to pins, %u skipped frozen, %u skipped not yet due for freezing\n"),
 							 vacrelstats->pages_removed,
 							 vacrelstats->rel_pages,
 							 vacrelstats->pinskipped_pages,
-							 vacrelstats->frozenskipped_pages);
+							 vacrelstats->frozenskipped_pages,
+							 vacrelstats->horizonskipped_pages);
 			appendStringInfo(&buf,
 							 _("tuples: %.0f removed, %.0f remain, %.0f are dead but not yet removable, oldest xmin: %u\n"),
 							 vacrelstats->tuples_deleted,
@@ -475,6 +655,7 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 	Buffer		vmbuffer = InvalidBuffer;
 	BlockNumber next_unskippable_block;
 	bool		skipping_blocks;
+	LVReadAhead readahead;
 	xl_heap_freeze_tuple *frozen;
 	StringInfoData buf;
 	const int	initprog_index[] = {
@@ -505,13 +686,15 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 	vacrelstats->nonempty_pages = 0;
 	vacrelstats->latestRemovedXid = InvalidTransactionId;
 
-	lazy_space_alloc(vacrelstats, nblocks);
+	lazy_space_alloc(onerel, vacrelstats, nblocks, Irel, nindexes);
 	frozen = palloc(sizeof(xl_heap_freeze_tuple) * MaxHeapTuplesPerPage);
+	readahead.next = readahead.nbuffers = 0;
 
 	/* Report that we're scanning the heap, advertising total # of blocks */
 	initprog_val[0] = PROGRESS_VACUUM_PHASE_SCAN_HEAP;
 	initprog_val[1] = nblocks;
-	initprog_val[2] = vacrelstats->max_dead_tuples;
+	initprog_val[2] = LAZY_DEAD_FREE_SPACE(vacrelstats->dead_tuples) /
+		sizeof(LVDeadBlock);
 	pgstat_progress_update_multi_param(3, initprog_index, initprog_val);
 
 	/*
@@ -527,7 +710,10 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 	 * When aggressive is set, we can't skip pages just because they are
 	 * all-visible, but we can still skip pages that are all-frozen, since
 	 * such pages do not need freezing and do not affect the value that we can
-	 * safely set for relfrozenxid or relminmxid.
+	 * safely set for relfrozenxid or relminmxid.  The same goes for
+	 * all-visible pages whose visibility map page has a freeze horizon that
+	 * isn't older than FreezeLimit: nothing on them would be frozen, and
+	 * none of their XIDs precede the relfrozenxid we're going to set.
 	 *
 	 * Before entering the main loop, establish the invariant that
 	 * next_unskippable_block is the next block number >= blkno that's not we
@@ -563,25 +749,17 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 	{
 		while (next_unskippable_block < nblocks)
 		{
-			uint8		vmstatus;
-
-			vmstatus = visibilitymap_get_status(onerel, next_unskippable_block,
-												&vmbuffer);
-			if (aggressive)
-			{
-				if ((vmstatus & VISIBILITYMAP_ALL_FROZEN) == 0)
-					break;
-			}
-			else
-			{
-				if ((vmstatus & VISIBILITYMAP_ALL_VISIBLE) == 0)
-					break;
-			}
+			if (!lazy_block_is_skippable(onerel, vacrelstats,
+										 next_unskippable_block,
+										 aggressive, &vmbuffer))
+				break;
 			vacuum_delay_point();
 			next_unskippable_block++;
 		}
 	}
 
+	lazy_begin_horizon_range(onerel, vacrelstats, 0, &vmbuffer);
+
 	if (next_unskippable_block >= SKIP_PAGES_THRESHOLD)
 		skipping_blocks = true;
 	else
@@ -595,7 +773,8 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 					maxoff;
 		bool		tupgone,
 					hastup;
-		int			prev_dead_count;
+		OffsetNumber deadoffsets[MaxHeapTuplesPerPage];
+		int			ndeadoffsets;
 		int			nfrozen;
 		Size		freespace;
 		bool		all_visible_according_to_vm = false;
@@ -603,6 +782,10 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 		bool		all_frozen = true;	/* provided all_visible is also true */
 		bool		has_dead_tuples;
 		TransactionId visibility_cutoff_xid = InvalidTransactionId;
+		TransactionId freeze_cutoff;
+		TransactionId oldest_xid = InvalidTransactionId;
+		int			npruned;
+		uint8		vmstatus;
 
 		/* see note above about forcing scanning of last page */
 #define FORCE_CHECK_PAGE() \
@@ -610,6 +793,14 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 
 		pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED, blkno);
 
+		/* Moving on to the next visibility map page's range? */
+		if (blkno == vacrelstats->range_start +
+			VISIBILITYMAP_HEAPBLOCKS_PER_PAGE)
+		{
+			lazy_end_horizon_range(onerel, vacrelstats, &vmbuffer);
+			lazy_begin_horizon_range(onerel, vacrelstats, blkno, &vmbuffer);
+		}
+
 		if (blkno == next_unskippable_block)
 		{
 			/* Time to advance next_unskippable_block */
@@ -618,21 +809,10 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 			{
 				while (next_unskippable_block < nblocks)
 				{
-					uint8		vmskipflags;
-
-					vmskipflags = visibilitymap_get_status(onerel,
-													  next_unskippable_block,
-														   &vmbuffer);
-					if (aggressive)
-					{
-						if ((vmskipflags & VISIBILITYMAP_ALL_FROZEN) == 0)
-							break;
-					}
-					else
-					{
-						if ((vmskipflags & VISIBILITYMAP_ALL_VISIBLE) == 0)
-							break;
-					}
+					if (!lazy_block_is_skippable(onerel, vacrelstats,
+												 next_unskippable_block,
+												 aggressive, &vmbuffer))
+						break;
 					vacuum_delay_point();
 					next_unskippable_block++;
 				}
@@ -669,16 +849,28 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 			{
 				/*
 				 * Tricky, tricky.  If this is in aggressive vacuum, the page
-				 * must have been all-frozen at the time we checked whether it
-				 * was skippable, but it might not be any more.  We must be
-				 * careful to count it as a skipped all-frozen page in that
-				 * case, or else we'll think we can't update relfrozenxid and
-				 * relminmxid.  If it's not an aggressive vacuum, we don't
-				 * know whether it was all-frozen, so we have to recheck; but
-				 * in this case an approximate answer is OK.
+				 * must have been all-frozen, or all-visible and covered by a
+				 * recent enough freeze horizon, at the time we checked
+				 * whether it was skippable, but it might not be any more.  We
+				 * must be careful to count it as a skipped page of one kind
+				 * or the other in that case, or else we'll think we can't
+				 * update relfrozenxid and relminmxid.  If it's not an
+				 * aggressive vacuum, we don't know whether it was all-frozen,
+				 * so we have to recheck; but in this case an approximate
+				 * answer is OK.
 				 */
-				if (aggressive || VM_ALL_FROZEN(onerel, blkno, &vmbuffer))
+				if (VM_ALL_FROZEN(onerel, blkno, &vmbuffer))
 					vacrelstats->frozenskipped_pages++;
+				else
+				{
+					if (aggressive)
+						vacrelstats->horizonskipped_pages++;
+
+					/* We know only what the old horizon says about it */
+					vacrelstats->range_horizon =
+						visibilitymap_horizon_min(vacrelstats->range_horizon,
+											  vacrelstats->range_old_horizon);
+				}
 				continue;
 			}
 			all_visible_according_to_vm = true;
@@ -690,8 +882,8 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 		 * If we are close to overrunning the available space for dead-tuple
 		 * TIDs, pause and do a cycle of vacuuming before we tackle this page.
 		 */
-		if ((vacrelstats->max_dead_tuples - vacrelstats->num_dead_tuples) < MaxHeapTuplesPerPage &&
-			vacrelstats->num_dead_tuples > 0)
+		if (LAZY_DEAD_TUPLES_FULL(vacrelstats->dead_tuples) &&
+			vacrelstats->dead_tuples->num_blocks > 0)
 		{
 			const int	hvp_index[] = {
 				PROGRESS_VACUUM_PHASE,
@@ -710,6 +902,7 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 				ReleaseBuffer(vmbuffer);
 				vmbuffer = InvalidBuffer;
 			}
+			lazy_release_readahead(&readahead);
 
 			/* Log cleanup info before we touch indexes */
 			vacuum_log_cleanup_info(onerel, vacrelstats);
@@ -719,10 +912,8 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 										 PROGRESS_VACUUM_PHASE_VACUUM_INDEX);
 
 			/* Remove index entries */
-			for (i = 0; i < nindexes; i++)
-				lazy_vacuum_index(Irel[i],
-								  &indstats[i],
-								  vacrelstats);
+			lazy_vacuum_all_indexes(onerel, Irel, nindexes, indstats,
+									vacrelstats);
 
 			/*
 			 * Report that we are now vacuuming the heap.  We also increase
@@ -742,7 +933,7 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 			 * not to reset latestRemovedXid since we want that value to be
 			 * valid.
 			 */
-			vacrelstats->num_dead_tuples = 0;
+			lazy_reset_dead_tuples(vacrelstats->dead_tuples);
 			vacrelstats->num_index_scans++;
 
 			/* Report that we are once again scanning the heap */
@@ -761,8 +952,17 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 		 */
 		visibilitymap_pin(onerel, blkno, &vmbuffer);
 
-		buf = ReadBufferExtended(onerel, MAIN_FORKNUM, blkno,
-								 RBM_NORMAL, vac_strategy);
+		/*
+		 * Read the page, along with the following ones we know we're going
+		 * to scan too.  skipping_blocks doesn't change until we reach
+		 * next_unskippable_block, so if it's set, every block between here
+		 * and there will be skipped and we read just this one.  Otherwise
+		 * every block up to and including next_unskippable_block will be
+		 * scanned, but we can't tell yet what happens beyond it.
+		 */
+		buf = lazy_read_heap_page(onerel, &readahead, blkno,
+								  skipping_blocks ? blkno + 1 :
+								  Min(next_unskippable_block + 1, nblocks));
 
 		/* We need buffer cleanup lock so that we can prune HOT chains. */
 		if (!ConditionalLockBufferForCleanup(buf))
@@ -777,6 +977,9 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 			{
 				ReleaseBuffer(buf);
 				vacrelstats->pinskipped_pages++;
+				vacrelstats->range_horizon =
+					visibilitymap_horizon_min(vacrelstats->range_horizon,
+											  vacrelstats->range_old_horizon);
 				continue;
 			}
 
@@ -802,6 +1005,9 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 				UnlockReleaseBuffer(buf);
 				vacrelstats->scanned_pages++;
 				vacrelstats->pinskipped_pages++;
+				vacrelstats->range_horizon =
+					visibilitymap_horizon_min(vacrelstats->range_horizon,
+											  vacrelstats->range_old_horizon);
 				if (hastup)
 					vacrelstats->nonempty_pages = blkno + 1;
 				continue;
@@ -814,6 +1020,9 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 				 */
 				UnlockReleaseBuffer(buf);
 				vacrelstats->pinskipped_pages++;
+				vacrelstats->range_horizon =
+					visibilitymap_horizon_min(vacrelstats->range_horizon,
+											  vacrelstats->range_old_horizon);
 				if (hastup)
 					vacrelstats->nonempty_pages = blkno + 1;
 				continue;
@@ -900,6 +1109,7 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 				PageSetAllVisible(page);
 				visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
 								  vmbuffer, InvalidTransactionId,
+								  FrozenTransactionId,
 					   VISIBILITYMAP_ALL_VISIBLE | VISIBILITYMAP_ALL_FROZEN);
 				END_CRIT_SECTION();
 			}
@@ -914,8 +1124,9 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 		 *
 		 * We count tuples removed by the pruning step as removed by VACUUM.
 		 */
-		tups_vacuumed += heap_page_prune(onerel, buf, OldestXmin, false,
-										 &vacrelstats->latestRemovedXid);
+		npruned = heap_page_prune(onerel, buf, OldestXmin, false,
+								  &vacrelstats->latestRemovedXid);
+		tups_vacuumed += npruned;
 
 		/*
 		 * Now scan the page to collect vacuumable items and check for tuples
@@ -925,7 +1136,7 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 		has_dead_tuples = false;
 		nfrozen = 0;
 		hastup = false;
-		prev_dead_count = vacrelstats->num_dead_tuples;
+		ndeadoffsets = 0;
 		maxoff = PageGetMaxOffsetNumber(page);
 
 		/*
@@ -964,7 +1175,7 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 			 */
 			if (ItemIdIsDead(itemid))
 			{
-				lazy_record_dead_tuple(vacrelstats, &(tuple.t_self));
+				deadoffsets[ndeadoffsets++] = offnum;
 				all_visible = false;
 				continue;
 			}
@@ -1069,7 +1280,7 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 
 			if (tupgone)
 			{
-				lazy_record_dead_tuple(vacrelstats, &(tuple.t_self));
+				deadoffsets[ndeadoffsets++] = offnum;
 				HeapTupleHeaderAdvanceLatestRemovedXid(tuple.t_data,
 											 &vacrelstats->latestRemovedXid);
 				tups_vacuumed += 1;
@@ -1096,6 +1307,72 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 			}
 		}						/* scan along page */
 
+		if (ndeadoffsets > 0)
+			lazy_record_dead_tuples(vacrelstats, blkno,
+									deadoffsets, ndeadoffsets);
+
+		/*
+		 * If the page is all-visible but not all-frozen, and we're going to
+		 * dirty it anyway -- because pruning changed it, because some of its
+		 * tuples need freezing, or because we're about to mark it
+		 * all-visible -- then freeze everything on it that we can, not just
+		 * what precedes FreezeLimit.  That costs little more than what we're
+		 * already doing, and lets the page be marked all-frozen instead of
+		 * being rewritten by some later anti-wraparound vacuum.  Every tuple
+		 * on an all-visible page has a committed xmin older than OldestXmin,
+		 * and any xmax is either a locker or an aborted updater, so
+		 * OldestXmin is a safe cutoff.
+		 *
+		 * Standby queries only conflict with the freezing if they might still
+		 * see one of the xmins we freeze as running, so the WAL record's
+		 * cutoff is just past the newest of those, not OldestXmin.
+		 */
+		freeze_cutoff = FreezeLimit;
+		if (all_visible && !all_frozen &&
+			(npruned > 0 || nfrozen > 0 || !PageIsAllVisible(page)))
+		{
+			TransactionId newest_frozen_xmin = InvalidTransactionId;
+
+			nfrozen = 0;
+			all_frozen = true;
+			for (offnum = FirstOffsetNumber;
+				 offnum <= maxoff;
+				 offnum = OffsetNumberNext(offnum))
+			{
+				ItemId		itemid;
+				HeapTupleHeader htup;
+				TransactionId xmin;
+				bool		tuple_totally_frozen;
+
+				itemid = PageGetItemId(page, offnum);
+				if (!ItemIdIsNormal(itemid))
+					continue;
+
+				htup = (HeapTupleHeader) PageGetItem(page, itemid);
+				xmin = HeapTupleHeaderGetXmin(htup);
+				if (heap_prepare_freeze_tuple(htup, OldestXmin, MultiXactCutoff,
+											  &frozen[nfrozen],
+											  &tuple_totally_frozen))
+				{
+					frozen[nfrozen++].offset = offnum;
+
+					/* Track newest xmin frozen on page. */
+					if (TransactionIdIsNormal(xmin) &&
+						TransactionIdFollows(xmin, newest_frozen_xmin))
+						newest_frozen_xmin = xmin;
+				}
+
+				if (!tuple_totally_frozen)
+					all_frozen = false;
+			}
+
+			if (TransactionIdIsValid(newest_frozen_xmin))
+			{
+				freeze_cutoff = newest_frozen_xmin;
+				TransactionIdAdvance(freeze_cutoff);
+			}
+		}
+
 		/*
 		 * If we froze any tuples, mark the buffer dirty, and write a WAL
 		 * record recording the changes.  We must log the changes to be
@@ -1124,7 +1401,7 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 			{
 				XLogRecPtr	recptr;
 
-				recptr = log_heap_freeze(onerel, buf, FreezeLimit,
+				recptr = log_heap_freeze(onerel, buf, freeze_cutoff,
 										 frozen, nfrozen);
 				PageSetLSN(page, recptr);
 			}
@@ -1137,7 +1414,7 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 		 * instead of doing a second scan.
 		 */
 		if (nindexes == 0 &&
-			vacrelstats->num_dead_tuples > 0)
+			vacrelstats->dead_tuples->num_blocks > 0)
 		{
 			/* Remove tuples from heap */
 			lazy_vacuum_page(onerel, blkno, buf, 0, vacrelstats, &vmbuffer);
@@ -1148,7 +1425,8 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 			 * not to reset latestRemovedXid since we want that value to be
 			 * valid.
 			 */
-			vacrelstats->num_dead_tuples = 0;
+			lazy_reset_dead_tuples(vacrelstats->dead_tuples);
+			ndeadoffsets = 0;
 			vacuumed_pages++;
 		}
 
@@ -1160,7 +1438,12 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 			uint8		flags = VISIBILITYMAP_ALL_VISIBLE;
 
 			if (all_frozen)
+			{
 				flags |= VISIBILITYMAP_ALL_FROZEN;
+				oldest_xid = FrozenTransactionId;
+			}
+			else
+				oldest_xid = lazy_page_oldest_unfrozen_xid(page);
 
 			/*
 			 * It should never be the case that the visibility map page is set
@@ -1178,7 +1461,8 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 			PageSetAllVisible(page);
 			MarkBufferDirty(buf);
 			visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
-							  vmbuffer, visibility_cutoff_xid, flags);
+							  vmbuffer, visibility_cutoff_xid, oldest_xid,
+							  flags);
 		}
 
 		/*
@@ -1235,7 +1519,23 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 			 */
 			visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
 							  vmbuffer, InvalidTransactionId,
-							  VISIBILITYMAP_ALL_FROZEN);
+							  FrozenTransactionId, VISIBILITYMAP_ALL_FROZEN);
+		}
+
+		/*
+		 * If the page is now all-visible but not all-frozen according to the
+		 * visibility map, the new freeze horizon must cover what's left to
+		 * freeze on it.
+		 */
+		vmstatus = visibilitymap_get_status(onerel, blkno, &vmbuffer);
+		if ((vmstatus & VISIBILITYMAP_ALL_VISIBLE) != 0 &&
+			(vmstatus & VISIBILITYMAP_ALL_FROZEN) == 0)
+		{
+			if (!TransactionIdIsValid(oldest_xid))
+				oldest_xid = lazy_page_oldest_unfrozen_xid(page);
+			vacrelstats->range_horizon =
+				visibilitymap_horizon_min(vacrelstats->range_horizon,
+										  oldest_xid);
 		}
 
 		UnlockReleaseBuffer(buf);
@@ -1251,13 +1551,16 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 		 * page, so remember its free space as-is.  (This path will always be
 		 * taken if there are no indexes.)
 		 */
-		if (vacrelstats->num_dead_tuples == prev_dead_count)
+		if (ndeadoffsets == 0)
 			RecordPageWithFreeSpace(onerel, blkno, freespace);
 	}
 
+	lazy_end_horizon_range(onerel, vacrelstats, &vmbuffer);
+
 	/* report that everything is scanned and vacuumed */
 	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED, blkno);
 
+	lazy_release_readahead(&readahead);
 	pfree(frozen);
 
 	/* save stats for use later */
@@ -1282,7 +1585,7 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 
 	/* If any tuples need to be deleted, perform final vacuum cycle */
 	/* XXX put a threshold on min number of tuples here? */
-	if (vacrelstats->num_dead_tuples > 0)
+	if (vacrelstats->dead_tuples->num_blocks > 0)
 	{
 		const int	hvp_index[] = {
 			PROGRESS_VACUUM_PHASE,
@@ -1298,10 +1601,8 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 									 PROGRESS_VACUUM_PHASE_VACUUM_INDEX);
 
 		/* Remove index entries */
-		for (i = 0; i < nindexes; i++)
-			lazy_vacuum_index(Irel[i],
-							  &indstats[i],
-							  vacrelstats);
+		lazy_vacuum_all_indexes(onerel, Irel, nindexes, indstats,
+								vacrelstats);
 
 		/* Report that we are now vacuuming the heap */
 		hvp_val[0] = PROGRESS_VACUUM_PHASE_VACUUM_HEAP;
@@ -1320,9 +1621,34 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 	pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
 								 PROGRESS_VACUUM_PHASE_INDEX_CLEANUP);
 
-	/* Do post-vacuum cleanup and statistics update for each index */
+	/* Do post-vacuum cleanup for each index */
+	lazy_cleanup_all_indexes(onerel, Irel, nindexes, indstats, vacrelstats);
+
+	lazy_space_free(vacrelstats);
+
+	/*
+	 * Now update statistics in pg_class, but only if the index says the count
+	 * is accurate.  This is done here rather than in lazy_cleanup_index,
+	 * because it can't be done in parallel mode.
+	 */
 	for (i = 0; i < nindexes; i++)
-		lazy_cleanup_index(Irel[i], indstats[i], vacrelstats);
+	{
+		IndexBulkDeleteResult *stats = indstats[i];
+
+		if (!stats)
+			continue;
+
+		if (!stats->estimated_count)
+			vac_update_relstats(Irel[i],
+								stats->num_pages,
+								stats->num_index_tuples,
+								0,
+								false,
+								InvalidTransactionId,
+								InvalidMultiXactId,
+								false);
+		pfree(stats);
+	}
 
 	/* If no indexes, make log report that lazy_vacuum_heap would've made */
 	if (vacuumed_pages)
@@ -1345,10 +1671,14 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 									"Skipped %u pages due to buffer pins, ",
 									vacrelstats->pinskipped_pages),
 					 vacrelstats->pinskipped_pages);
-	appendStringInfo(&buf, ngettext("%u frozen page.\n",
-									"%u frozen pages.\n",
+	appendStringInfo(&buf, ngettext("%u frozen page, ",
+									"%u frozen pages, ",
 									vacrelstats->frozenskipped_pages),
 					 vacrelstats->frozenskipped_pages);
+	appendStringInfo(&buf, ngettext("%u page not yet due for freezing.\n",
+									"%u pages not yet due for freezing.\n",
+									vacrelstats->horizonskipped_pages),
+					 vacrelstats->horizonskipped_pages);
 	appendStringInfo(&buf, ngettext("%u page is entirely empty.\n",
 									"%u pages are entirely empty.\n",
 									empty_pages),
@@ -1366,6 +1696,60 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 }
 
 
+/*
+ *	lazy_read_heap_page() -- read a heap page for lazy_scan_heap
+ *
+ * If the page hasn't been read ahead already, read it together with the
+ * following pages up to endblk, using ReadBufferRange.  At most
+ * MAX_IO_COMBINE_BLOCKS pages are read at once, and no more than the buffer
+ * access strategy allows us to keep pinned.  Pages read ahead that the scan has
+ * skipped meanwhile are released.  Returns the pinned buffer for blkno.
+ */
+static Buffer
+lazy_read_heap_page(Relation onerel, LVReadAhead *readahead,
+					BlockNumber blkno, BlockNumber endblk)
+{
+	int			nblocks;
+
+	/* Release pages the scan has skipped over */
+	while (readahead->next < readahead->nbuffers &&
+		   readahead->next_block < blkno)
+	{
+		ReleaseBuffer(readahead->buffers[readahead->next++]);
+		readahead->next_block++;
+	}
+
+	if (readahead->next < readahead->nbuffers)
+	{
+		Assert(readahead->next_block == blkno);
+		readahead->next_block++;
+		return readahead->buffers[readahead->next++];
+	}
+
+	Assert(endblk > blkno);
+	nblocks = Min(endblk - blkno, MAX_IO_COMBINE_BLOCKS);
+	nblocks = Min(nblocks, GetAccessStrategyPinLimit(vac_strategy));
+	ReadBufferRange(onerel, MAIN_FORKNUM, blkno, nblocks, vac_strategy,
+					readahead->buffers);
+	readahead->nbuffers = nblocks;
+	readahead->next = 1;
+	readahead->next_block = blkno + 1;
+
+	return readahead->buffers[0];
+}
+
+/*
+ *	lazy_release_readahead() -- release pages lazy_scan_heap read ahead
+ */
+static void
+lazy_release_readahead(LVReadAhead *readahead)
+{
+	while (readahead->next < readahead->nbuffers)
+		ReleaseBuffer(readahead->buffers[readahead->next++]);
+	readahead->next = readahead->nbuffers = 0;
+}
+
+
 /*
  *	lazy_vacuum_heap() -- second pass over the heap
  *
@@ -1380,16 +1764,18 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 static void
 lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 {
-	int			tupindex;
+	LVDeadTuples *dead = vacrelstats->dead_tuples;
+	int			blockindex;
+	double		ntuples;
 	int			npages;
 	PGRUsage	ru0;
 	Buffer		vmbuffer = InvalidBuffer;
 
 	pg_rusage_init(&ru0);
+	ntuples = 0;
 	npages = 0;
 
-	tupindex = 0;
-	while (tupindex < vacrelstats->num_dead_tuples)
+	for (blockindex = 0; blockindex < dead->num_blocks; blockindex++)
 	{
 		BlockNumber tblk;
 		Buffer		buf;
@@ -1398,16 +1784,15 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 
 		vacuum_delay_point();
 
-		tblk = ItemPointerGetBlockNumber(&vacrelstats->dead_tuples[tupindex]);
+		tblk = dead->blocks[blockindex].blkno;
 		buf = ReadBufferExtended(onerel, MAIN_FORKNUM, tblk, RBM_NORMAL,
 								 vac_strategy);
 		if (!ConditionalLockBufferForCleanup(buf))
 		{
 			ReleaseBuffer(buf);
-			++tupindex;
 			continue;
 		}
-		tupindex = lazy_vacuum_page(onerel, tblk, buf, tupindex, vacrelstats,
+		ntuples += lazy_vacuum_page(onerel, tblk, buf, blockindex, vacrelstats,
 									&vmbuffer);
 
 		/* Now that we've compacted the page, record its available space */
@@ -1426,9 +1811,9 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 	}
 
 	ereport(elevel,
-			(errmsg("\"%s\": removed %d row versions in %d pages",
+			(errmsg("\"%s\": removed %.0f row versions in %d pages",
 					RelationGetRelationName(onerel),
-					tupindex, npages),
+					ntuples, npages),
 			 errdetail("%s.",
 					   pg_rusage_show(&ru0))));
 }
@@ -1439,37 +1824,35 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
  *
  * Caller must hold pin and buffer cleanup lock on the buffer.
  *
- * tupindex is the index in vacrelstats->dead_tuples of the first dead
- * tuple for this page.  We assume the rest follow sequentially.
- * The return value is the first tupindex after the tuples of this page.
+ * blockindex is the index of the page's entry in vacrelstats->dead_tuples.
+ * The return value is the number of dead tuples removed from the page.
  */
 static int
 lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
-				 int tupindex, LVRelStats *vacrelstats, Buffer *vmbuffer)
+				 int blockindex, LVRelStats *vacrelstats, Buffer *vmbuffer)
 {
 	Page		page = BufferGetPage(buffer);
 	OffsetNumber unused[MaxOffsetNumber];
-	int			uncnt = 0;
+	int			uncnt;
+	int			i;
 	TransactionId visibility_cutoff_xid;
 	bool		all_frozen;
 
+	Assert(vacrelstats->dead_tuples->blocks[blockindex].blkno == blkno);
+
 	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED, blkno);
 
+	uncnt = lazy_get_dead_offsets(vacrelstats->dead_tuples, blockindex,
+								  unused);
+
 	START_CRIT_SECTION();
 
-	for (; tupindex < vacrelstats->num_dead_tuples; tupindex++)
+	for (i = 0; i < uncnt; i++)
 	{
-		BlockNumber tblk;
-		OffsetNumber toff;
 		ItemId		itemid;
 
-		tblk = ItemPointerGetBlockNumber(&vacrelstats->dead_tuples[tupindex]);
-		if (tblk != blkno)
-			break;				/* past end of tuples for this block */
-		toff = ItemPointerGetOffsetNumber(&vacrelstats->dead_tuples[tupindex]);
-		itemid = PageGetItemId(page, toff);
+		itemid = PageGetItemId(page, unused[i]);
 		ItemIdSetUnused(itemid);
-		unused[uncnt++] = toff;
 	}
 
 	PageRepairFragmentation(page);
@@ -1518,6 +1901,7 @@ lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
 	{
 		uint8		vm_status = visibilitymap_get_status(onerel, blkno, vmbuffer);
 		uint8		flags = 0;
+		TransactionId oldest_xid = FrozenTransactionId;
 
 		/* Set the VM all-frozen bit to flag, if needed */
 		if ((vm_status & VISIBILITYMAP_ALL_VISIBLE) == 0)
@@ -1525,13 +1909,27 @@ lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
 		if ((vm_status & VISIBILITYMAP_ALL_FROZEN) == 0 && all_frozen)
 			flags |= VISIBILITYMAP_ALL_FROZEN;
 
+		/*
+		 * If the page stays unfrozen, and it's in the range whose freeze
+		 * horizon lazy_scan_heap is computing, account for it there too.
+		 */
+		if (!all_frozen && (vm_status & VISIBILITYMAP_ALL_FROZEN) == 0)
+		{
+			oldest_xid = lazy_page_oldest_unfrozen_xid(page);
+			if (blkno >= vacrelstats->range_start)
+				vacrelstats->range_horizon =
+					visibilitymap_horizon_min(vacrelstats->range_horizon,
+											  oldest_xid);
+		}
+
 		Assert(BufferIsValid(*vmbuffer));
 		if (flags != 0)
 			visibilitymap_set(onerel, blkno, buffer, InvalidXLogRecPtr,
-							  *vmbuffer, visibility_cutoff_xid, flags);
+							  *vmbuffer, visibility_cutoff_xid, oldest_xid,
+							  flags);
 	}
 
-	return tupindex;
+	return uncnt;
 }
 
 /*
@@ -1587,16 +1985,70 @@ lazy_check_needs_freeze(Buffer buf, bool *hastup)
 }
 
 
+/*
+ *	lazy_vacuum_all_indexes() -- vacuum all indexes of the relation.
+ *
+ *		Uses parallel workers if lazy_scan_heap decided to.
+ */
+static void
+lazy_vacuum_all_indexes(Relation onerel, Relation *Irel, int nindexes,
+						IndexBulkDeleteResult **indstats,
+						LVRelStats *vacrelstats)
+{
+	int			i;
+
+	/* lazy_tid_reaped needs the directory, and workers can't build it */
+	if (!vacrelstats->dead_tuples->directory_valid)
+		lazy_build_dead_directory(vacrelstats->dead_tuples);
+
+	if (vacrelstats->parallel_workers > 0)
+	{
+		lazy_parallel_vacuum_indexes(onerel, Irel, nindexes, indstats,
+									 vacrelstats, false);
+		return;
+	}
+
+	for (i = 0; i < nindexes; i++)
+		lazy_vacuum_index(Irel[i], &indstats[i], vacrelstats->dead_tuples,
+						  vacrelstats->old_rel_tuples);
+}
+
+/*
+ *	lazy_cleanup_all_indexes() -- do post-vacuum cleanup for all indexes.
+ *
+ *		Uses parallel workers if lazy_scan_heap decided to.
+ */
+static void
+lazy_cleanup_all_indexes(Relation onerel, Relation *Irel, int nindexes,
+						 IndexBulkDeleteResult **indstats,
+						 LVRelStats *vacrelstats)
+{
+	int			i;
+
+	if (vacrelstats->parallel_workers > 0)
+	{
+		lazy_parallel_vacuum_indexes(onerel, Irel, nindexes, indstats,
+									 vacrelstats, true);
+		return;
+	}
+
+	for (i = 0; i < nindexes; i++)
+		lazy_cleanup_index(Irel[i], &indstats[i],
+						   vacrelstats->new_rel_tuples,
+						   vacrelstats->tupcount_pages < vacrelstats->rel_pages);
+}
+
 /*
  *	lazy_vacuum_index() -- vacuum one index relation.
  *
  *		Delete all the index entries pointing to tuples listed in
- *		vacrelstats->dead_tuples, and update running statistics.
+ *		dead, and update running statistics.  reltuples is the number
+ *		of heap tuples, as of the previous vacuum.
  */
 static void
 lazy_vacuum_index(Relation indrel,
 				  IndexBulkDeleteResult **stats,
-				  LVRelStats *vacrelstats)
+				  LVDeadTuples *dead, double reltuples)
 {
 	IndexVacuumInfo ivinfo;
 	PGRUsage	ru0;
@@ -1607,27 +2059,30 @@ lazy_vacuum_index(Relation indrel,
 	ivinfo.analyze_only = false;
 	ivinfo.estimated_count = true;
 	ivinfo.message_level = elevel;
-	ivinfo.num_heap_tuples = vacrelstats->old_rel_tuples;
+	ivinfo.num_heap_tuples = reltuples;
 	ivinfo.strategy = vac_strategy;
 
 	/* Do bulk deletion */
 	*stats = index_bulk_delete(&ivinfo, *stats,
-							   lazy_tid_reaped, (void *) vacrelstats);
+							   lazy_tid_reaped, (void *) dead);
 
 	ereport(elevel,
-			(errmsg("scanned index \"%s\" to remove %d row versions",
+			(errmsg("scanned index \"%s\" to remove %.0f row versions",
 					RelationGetRelationName(indrel),
-					vacrelstats->num_dead_tuples),
+					(double) dead->num_tuples),
 			 errdetail("%s.", pg_rusage_show(&ru0))));
 }
 
 /*
  *	lazy_cleanup_index() -- do post-vacuum cleanup for one index relation.
+ *
+ *		The resulting statistics are returned in *stats; it's up to the
+ *		caller to store them in pg_class.
  */
 static void
 lazy_cleanup_index(Relation indrel,
-				   IndexBulkDeleteResult *stats,
-				   LVRelStats *vacrelstats)
+				   IndexBulkDeleteResult **stats,
+				   double reltuples, bool estimated_count)
 {
 	IndexVacuumInfo ivinfo;
 	PGRUsage	ru0;
@@ -1636,43 +2091,320 @@ lazy_cleanup_index(Relation indrel,
 
 	ivinfo.index = indrel;
 	ivinfo.analyze_only = false;
-	ivinfo.estimated_count = (vacrelstats->tupcount_pages < vacrelstats->rel_pages);
+	ivinfo.estimated_count = estimated_count;
 	ivinfo.message_level = elevel;
-	ivinfo.num_heap_tuples = vacrelstats->new_rel_tuples;
+	ivinfo.num_heap_tuples = reltuples;
 	ivinfo.strategy = vac_strategy;
 
-	stats = index_vacuum_cleanup(&ivinfo, stats);
+	*stats = index_vacuum_cleanup(&ivinfo, *stats);
 
-	if (!stats)
+	if (!*stats)
 		return;
 
-	/*
-	 * Now update statistics in pg_class, but only if the index says the count
-	 * is accurate.
-	 */
-	if (!stats->estimated_count)
-		vac_update_relstats(indrel,
-							stats->num_pages,
-							stats->num_index_tuples,
-							0,
-							false,
-							InvalidTransactionId,
-							InvalidMultiXactId,
-							false);
-
 	ereport(elevel,
 			(errmsg("index \"%s\" now contains %.0f row versions in %u pages",
 					RelationGetRelationName(indrel),
-					stats->num_index_tuples,
-					stats->num_pages),
+					(*stats)->num_index_tuples,
+					(*stats)->num_pages),
 			 errdetail("%.0f index row versions were removed.\n"
 			 "%u index pages have been deleted, %u are currently reusable.\n"
 					   "%s.",
-					   stats->tuples_removed,
-					   stats->pages_deleted, stats->pages_free,
+					   (*stats)->tuples_removed,
+					   (*stats)->pages_deleted, (*stats)->pages_free,
 					   pg_rusage_show(&ru0))));
+}
 
-	pfree(stats);
+/*
+ * lazy_compute_parallel_workers - how many workers to use for index passes
+ *
+ * Only indexes of at least min_parallel_index_scan_size are worth handing
+ * to a worker, and the leader takes one of them itself.  Temporary tables
+ * can't be accessed by workers at all.
+ *
+ * Some access methods, like GIN, use up to maintenance_work_mem of their own
+ * while vacuuming an index.  The workers share vac_work_mem for those (see
+ * lazy_space_alloc), so we don't plan more workers than can each get the
+ * smallest allowed maintenance_work_mem.
+ */
+static int
+lazy_compute_parallel_workers(Relation onerel, Relation *Irel, int nindexes,
+							  int vac_work_mem)
+{
+	int			nworkers;
+	int			nlarge = 0;
+	bool		use_work_mem = false;
+	int			i;
+
+	nworkers = IsAutoVacuumWorkerProcess() ?
+		autovacuum_max_parallel_workers : max_parallel_maintenance_workers;
+
+	if (nworkers == 0 || nindexes < 2 || RelationUsesLocalBuffers(onerel) ||
+		dynamic_shared_memory_type == DSM_IMPL_NONE)
+		return 0;
+
+	for (i = 0; i < nindexes; i++)
+	{
+		if (RelationGetNumberOfBlocks(Irel[i]) >=
+			(BlockNumber) min_parallel_index_scan_size)
+			nlarge++;
+		if (Irel[i]->rd_amroutine->amusemaintenanceworkmem)
+			use_work_mem = true;
+	}
+
+	if (use_work_mem)
+		nworkers = Min(nworkers, Max(vac_work_mem / 1024, 1));
+
+	return Max(Min(nworkers, nlarge - 1), 0);
+}
+
+/*
+ * lazy_parallel_vacuum_indexes - vacuum or clean up all indexes in parallel
+ *
+ * The workers of an index vacuum pass attach to the dead tuple store's own
+ * segment, and the statistics of each index are handed over to whichever
+ * participant processes it.
+ */
+static void
+lazy_parallel_vacuum_indexes(Relation onerel, Relation *Irel, int nindexes,
+							 IndexBulkDeleteResult **indstats,
+							 LVRelStats *vacrelstats, bool for_cleanup)
+{
+	ParallelContext *pcxt;
+	LVShared   *lvshared;
+	Size		sharedsize;
+	int			i;
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext(lazy_parallel_vacuum_main,
+								 vacrelstats->parallel_workers);
+
+	/* Estimate space for our shared state */
+	sharedsize = add_size(offsetof(LVShared, indstats),
+						  mul_size(sizeof(LVSharedIndStats), nindexes));
+	shm_toc_estimate_chunk(&pcxt->estimator, sharedsize);
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	InitializeParallelDSM(pcxt);
+
+	lvshared = (LVShared *) shm_toc_allocate(pcxt->toc, sharedsize);
+	lvshared->relid = RelationGetRelid(onerel);
+	lvshared->elevel = elevel;
+	lvshared->for_cleanup = for_cleanup;
+	if (for_cleanup)
+	{
+		lvshared->estimated_count =
+			(vacrelstats->tupcount_pages < vacrelstats->rel_pages);
+		lvshared->num_heap_tuples = vacrelstats->new_rel_tuples;
+	}
+	else
+	{
+		lvshared->estimated_count = true;
+		lvshared->num_heap_tuples = vacrelstats->old_rel_tuples;
+	}
+	lvshared->dead_tuples_handle =
+		dsm_segment_handle(vacrelstats->dead_tuples_seg);
+	lvshared->maintenance_work_mem_worker = vacrelstats->parallel_work_mem;
+	lvshared->nindexes = nindexes;
+	SpinLockInit(&lvshared->mutex);
+	lvshared->nextindex = 0;
+	lvshared->cost_active = VacuumCostActive;
+	lvshared->cost_delay = VacuumCostDelay;
+	lvshared->cost_limit = VacuumCostLimit;
+	pg_atomic_init_u32(&lvshared->cost_balance, VacuumCostBalance);
+	pg_atomic_init_u32(&lvshared->active_nworkers, 0);
+	for (i = 0; i < nindexes; i++)
+	{
+		LVSharedIndStats *slot = &lvshared->indstats[i];
+
+		slot->indexoid = RelationGetRelid(Irel[i]);
+		slot->updated = (indstats[i] != NULL);
+		if (slot->updated)
+			memcpy(&slot->stats, indstats[i], sizeof(IndexBulkDeleteResult));
+	}
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_VACUUM_SHARED, lvshared);
+
+	/* Our cost balance so far has become the shared one */
+	if (VacuumCostActive)
+	{
+		VacuumSharedCostBalance = &lvshared->cost_balance;
+		VacuumActiveNWorkers = &lvshared->active_nworkers;
+		VacuumCostBalance = 0;
+		VacuumCostBalanceLocal = 0;
+	}
+
+	if (trace_parallel_vacuum)
+		elog(LOG, "parallel index %s of \"%s\" planned with %d workers",
+			 for_cleanup ? "cleanup" : "vacuuming",
+			 RelationGetRelationName(onerel), pcxt->nworkers);
+
+	LaunchParallelWorkers(pcxt);
+
+	if (for_cleanup)
+		ereport(elevel,
+				(errmsg("launched %d parallel vacuum workers for index cleanup (planned: %d)",
+						pcxt->nworkers_launched, pcxt->nworkers)));
+	else
+		ereport(elevel,
+				(errmsg("launched %d parallel vacuum workers for index vacuuming (planned: %d)",
+						pcxt->nworkers_launched, pcxt->nworkers)));
+
+	/*
+	 * Do our share of the indexes.  Any indexes that workers which failed to
+	 * launch would have processed are simply claimed by the rest of us.
+	 */
+	lazy_parallel_process_indexes(Irel, lvshared, vacrelstats->dead_tuples);
+
+	/* Wait for the workers to finish, reporting any error they hit */
+	WaitForParallelWorkersToFinish(pcxt);
+
+	/* Carry over what's left of the shared cost balance */
+	if (VacuumSharedCostBalance != NULL)
+	{
+		VacuumCostBalance = pg_atomic_read_u32(VacuumSharedCostBalance);
+		VacuumSharedCostBalance = NULL;
+		VacuumActiveNWorkers = NULL;
+	}
+
+	/* Take back the statistics before the shared memory goes away */
+	for (i = 0; i < nindexes; i++)
+	{
+		LVSharedIndStats *slot = &lvshared->indstats[i];
+
+		if (slot->updated)
+		{
+			if (indstats[i] == NULL)
+				indstats[i] = (IndexBulkDeleteResult *)
+					palloc(sizeof(IndexBulkDeleteResult));
+			memcpy(indstats[i], &slot->stats, sizeof(IndexBulkDeleteResult));
+		}
+		else if (indstats[i] != NULL)
+		{
+			pfree(indstats[i]);
+			indstats[i] = NULL;
+		}
+	}
+
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+}
+
+/*
+ * Perform a parallel index pass participant's share of the work: claim
+ * indexes until there are none left, and vacuum or clean up each of them.
+ */
+static void
+lazy_parallel_process_indexes(Relation *Irel, LVShared *lvshared,
+							  LVDeadTuples *dead)
+{
+	if (VacuumActiveNWorkers != NULL)
+		pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
+
+	for (;;)
+	{
+		LVSharedIndStats *slot;
+		IndexBulkDeleteResult *stats;
+		int			idx;
+
+		SpinLockAcquire(&lvshared->mutex);
+		idx = lvshared->nextindex++;
+		SpinLockRelease(&lvshared->mutex);
+
+		if (idx >= lvshared->nindexes)
+			break;
+
+		slot = &lvshared->indstats[idx];
+		stats = slot->updated ? &slot->stats : NULL;
+
+		if (lvshared->for_cleanup)
+			lazy_cleanup_index(Irel[idx], &stats, lvshared->num_heap_tuples,
+							   lvshared->estimated_count);
+		else
+			lazy_vacuum_index(Irel[idx], &stats, dead,
+							  lvshared->num_heap_tuples);
+
+		/* The access method may have returned statistics of its own */
+		if (stats != NULL && stats != &slot->stats)
+		{
+			memcpy(&slot->stats, stats, sizeof(IndexBulkDeleteResult));
+			pfree(stats);
+		}
+		slot->updated = (stats != NULL);
+	}
+
+	if (VacuumActiveNWorkers != NULL)
+		pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
+}
+
+/*
+ * Main entry point for a parallel vacuum worker.
+ */
+void
+lazy_parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
+{
+	LVShared   *lvshared;
+	dsm_segment *dead_seg = NULL;
+	LVDeadTuples *dead = NULL;
+	Relation	onerel;
+	Relation   *Irel;
+	int			i;
+
+	lvshared = shm_toc_lookup(toc, PARALLEL_KEY_VACUUM_SHARED);
+	if (!lvshared->for_cleanup)
+	{
+		dead_seg = dsm_attach(lvshared->dead_tuples_handle);
+		if (dead_seg == NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					 errmsg("could not map dynamic shared memory segment")));
+		dead = (LVDeadTuples *) dsm_segment_address(dead_seg);
+	}
+
+	/*
+	 * Like the leader, let concurrent VACUUMs ignore us when determining
+	 * their OldestXmin.  See vacuum_rel().  The flag is cleared when our
+	 * transaction ends.
+	 */
+	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
+	MyPgXact->vacuumFlags |= PROC_IN_VACUUM;
+	LWLockRelease(ProcArrayLock);
+
+	/*
+	 * Open the relations.  The leader already holds the same locks, and
+	 * since we're in its lock group these don't conflict with them.  The
+	 * indexes are opened by OID so that we process the same ones.
+	 */
+	onerel = heap_open(lvshared->relid, ShareUpdateExclusiveLock);
+	Irel = (Relation *) palloc(lvshared->nindexes * sizeof(Relation));
+	for (i = 0; i < lvshared->nindexes; i++)
+		Irel[i] = index_open(lvshared->indstats[i].indexoid, RowExclusiveLock);
+
+	elevel = lvshared->elevel;
+	vac_strategy = GetAccessStrategy(BAS_VACUUM);
+	maintenance_work_mem = lvshared->maintenance_work_mem_worker;
+
+	/* Throttle ourselves along with the leader, using its settings */
+	VacuumCostActive = lvshared->cost_active;
+	VacuumCostDelay = lvshared->cost_delay;
+	VacuumCostLimit = lvshared->cost_limit;
+	VacuumCostBalance = 0;
+	VacuumCostBalanceLocal = 0;
+	VacuumPageHit = 0;
+	VacuumPageMiss = 0;
+	VacuumPageDirty = 0;
+	if (VacuumCostActive)
+	{
+		VacuumSharedCostBalance = &lvshared->cost_balance;
+		VacuumActiveNWorkers = &lvshared->active_nworkers;
+	}
+
+	lazy_parallel_process_indexes(Irel, lvshared, dead);
+
+	for (i = 0; i < lvshared->nindexes; i++)
+		index_close(Irel[i], RowExclusiveLock);
+	heap_close(onerel, ShareUpdateExclusiveLock);
+	FreeAccessStrategy(vac_strategy);
+	if (dead_seg != NULL)
+		dsm_detach(dead_seg);
 }
 
 /*
@@ -1980,111 +2712,327 @@ count_nondeletable_pages(Relation onerel, LVRelStats *vacrelstats)
 /*
  * lazy_space_alloc - space allocation decisions for lazy vacuum
  *
- * See the comments at the head of this file for rationale.
+ * Also decides how many parallel workers to use for the index passes.  See
+ * the comments at the head of this file for rationale.
  */
 static void
-lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks)
+lazy_space_alloc(Relation onerel, LVRelStats *vacrelstats,
+				 BlockNumber relblocks, Relation *Irel, int nindexes)
 {
-	long		maxtuples;
+	LVDeadTuples *dead;
+	Size		space;
+	int			ndirectory = 0;
+	int			shift = LAZY_DIRECTORY_MIN_SHIFT;
 	int			vac_work_mem = IsAutoVacuumWorkerProcess() &&
 	autovacuum_work_mem != -1 ?
 	autovacuum_work_mem : maintenance_work_mem;
 
 	if (vacrelstats->hasindex)
 	{
-		maxtuples = (vac_work_mem * 1024L) / sizeof(ItemPointerData);
-		maxtuples = Min(maxtuples, INT_MAX);
-		maxtuples = Min(maxtuples, MaxAllocSize / sizeof(ItemPointerData));
+		Size		minspace;
+
+		space = (Size) vac_work_mem * 1024;
+		/* positions must fit in LVDeadBlock.data, next to LAZY_DEAD_INLINE */
+		space = Min(space, (Size) PG_INT32_MAX);
+		space = Min(space, MaxAllocHugeSize);
+
+		/* keep the directory to a small fraction of the space */
+		while (((relblocks >> shift) + 1) * sizeof(uint32) > space / 16)
+			shift++;
+		ndirectory = (relblocks >> shift) + 1;
+		minspace = offsetof(LVDeadTuples, blocks) + ndirectory * sizeof(uint32);
 
 		/* curious coding here to ensure the multiplication can't overflow */
-		if ((BlockNumber) (maxtuples / LAZY_ALLOC_TUPLES) > relblocks)
-			maxtuples = relblocks * LAZY_ALLOC_TUPLES;
+		if ((space - minspace) / LAZY_MAX_BLOCK_SPACE > relblocks)
+			space = minspace + relblocks * LAZY_MAX_BLOCK_SPACE;
 
 		/* stay sane if small maintenance_work_mem */
-		maxtuples = Max(maxtuples, MaxHeapTuplesPerPage);
+		space = Max(space, minspace + LAZY_MAX_BLOCK_SPACE);
 	}
 	else
 	{
-		maxtuples = MaxHeapTuplesPerPage;
+		space = offsetof(LVDeadTuples, blocks) + LAZY_MAX_BLOCK_SPACE;
 	}
+	space = TYPEALIGN_DOWN(sizeof(uint32), space);
 
-	vacrelstats->num_dead_tuples = 0;
-	vacrelstats->max_dead_tuples = (int) maxtuples;
-	vacrelstats->dead_tuples = (ItemPointer)
-		palloc(maxtuples * sizeof(ItemPointerData));
+	vacrelstats->parallel_workers =
+		lazy_compute_parallel_workers(onerel, Irel, nindexes, vac_work_mem);
+	vacrelstats->dead_tuples_seg = NULL;
+	if (vacrelstats->parallel_workers > 0)
+	{
+		int			nmwm = 0;
+		int			i;
+
+		/*
+		 * The workers will read the dead tuples where the leader stores them.
+		 * If no segment can be had, vacuum the indexes without workers.
+		 */
+		vacrelstats->dead_tuples_seg =
+			dsm_create(space, DSM_CREATE_NULL_IF_MAXSEGMENTS);
+		if (vacrelstats->dead_tuples_seg == NULL)
+			vacrelstats->parallel_workers = 0;
+
+		/*
+		 * The workers together get vac_work_mem for the indexes that use
+		 * maintenance_work_mem while vacuuming, on top of what the leader
+		 * uses.
+		 */
+		for (i = 0; i < nindexes; i++)
+		{
+			if (Irel[i]->rd_amroutine->amusemaintenanceworkmem)
+				nmwm++;
+		}
+		vacrelstats->parallel_work_mem = vac_work_mem;
+		if (nmwm > 0 && vacrelstats->parallel_workers > 0)
+			vacrelstats->parallel_work_mem /=
+				Min(vacrelstats->parallel_workers, nmwm);
+	}
+
+	if (vacrelstats->dead_tuples_seg != NULL)
+		dead = (LVDeadTuples *)
+			dsm_segment_address(vacrelstats->dead_tuples_seg);
+	else
+		dead = (LVDeadTuples *)
+			MemoryContextAllocHuge(CurrentMemoryContext, space);
+	dead->size = space;
+	dead->directory = space - ndirectory * sizeof(uint32);
+	dead->ndirectory = ndirectory;
+	dead->directory_shift = shift;
+	lazy_reset_dead_tuples(dead);
+
+	vacrelstats->dead_tuples = dead;
+}
+
+/*
+ * lazy_reset_dead_tuples - forget all dead tuples
+ */
+static void
+lazy_reset_dead_tuples(LVDeadTuples *dead)
+{
+	dead->num_tuples = 0;
+	dead->num_blocks = 0;
+	dead->data_start = dead->directory;
+	dead->directory_valid = false;
+}
+
+/*
+ * lazy_space_free - release the dead tuple store
+ */
+static void
+lazy_space_free(LVRelStats *vacrelstats)
+{
+	if (vacrelstats->dead_tuples_seg != NULL)
+		dsm_detach(vacrelstats->dead_tuples_seg);
+	else
+		pfree(vacrelstats->dead_tuples);
+	vacrelstats->dead_tuples = NULL;
+	vacrelstats->dead_tuples_seg = NULL;
 }
 
 /*
- * lazy_record_dead_tuple - remember one deletable tuple
+ * lazy_record_dead_tuples - remember the deletable tuples of one page
+ *
+ * offsets must be in ascending order, and pages must be recorded in
+ * ascending block number order.
  */
 static void
-lazy_record_dead_tuple(LVRelStats *vacrelstats,
-					   ItemPointer itemptr)
+lazy_record_dead_tuples(LVRelStats *vacrelstats, BlockNumber blkno,
+						OffsetNumber *offsets, int noffsets)
 {
+	LVDeadTuples *dead = vacrelstats->dead_tuples;
+	LVDeadBlock *entry;
+	int			i;
+
+	Assert(noffsets > 0);
+	Assert(dead->num_blocks == 0 ||
+		   dead->blocks[dead->num_blocks - 1].blkno < blkno);
+
 	/*
-	 * The array shouldn't overflow under normal behavior, but perhaps it
+	 * The store shouldn't overflow under normal behavior, but perhaps it
 	 * could if we are given a really small maintenance_work_mem. In that
-	 * case, just forget the last few tuples (we'll get 'em next time).
+	 * case, just forget this page's tuples (we'll get 'em next time).
 	 */
-	if (vacrelstats->num_dead_tuples < vacrelstats->max_dead_tuples)
+	if (LAZY_DEAD_TUPLES_FULL(dead))
+		return;
+
+	entry = &dead->blocks[dead->num_blocks];
+	entry->blkno = blkno;
+
+	if (noffsets == 1)
+		entry->data = LAZY_DEAD_INLINE | offsets[0];
+	else
 	{
-		vacrelstats->dead_tuples[vacrelstats->num_dead_tuples] = *itemptr;
-		vacrelstats->num_dead_tuples++;
-		pgstat_progress_update_param(PROGRESS_VACUUM_NUM_DEAD_TUPLES,
-									 vacrelstats->num_dead_tuples);
+		Size		bitmapsize = LAZY_DEAD_BITMAP_SIZE(offsets[noffsets - 1]);
+		uint16	   *header;
+
+		if (noffsets * sizeof(uint16) <= bitmapsize)
+		{
+			dead->data_start -= (noffsets + 1) * sizeof(uint16);
+			header = (uint16 *) ((char *) dead + dead->data_start);
+			header[0] = noffsets;
+			for (i = 0; i < noffsets; i++)
+				header[i + 1] = offsets[i];
+		}
+		else
+		{
+			uint8	   *bitmap;
+
+			dead->data_start -= sizeof(uint16) + bitmapsize;
+			header = (uint16 *) ((char *) dead + dead->data_start);
+			header[0] = LAZY_DEAD_BITMAP | bitmapsize;
+			bitmap = (uint8 *) (header + 1);
+			memset(bitmap, 0, bitmapsize);
+			for (i = 0; i < noffsets; i++)
+				bitmap[offsets[i] / BITS_PER_BYTE] |=
+					1 << (offsets[i] % BITS_PER_BYTE);
+		}
+		entry->data = dead->data_start;
 	}
+
+	dead->num_blocks++;
+	dead->num_tuples += noffsets;
+	dead->directory_valid = false;
+	pgstat_progress_update_param(PROGRESS_VACUUM_NUM_DEAD_TUPLES,
+								 dead->num_tuples);
 }
 
 /*
- *	lazy_tid_reaped() -- is a particular tid deletable?
- *
- *		This has the right signature to be an IndexBulkDeleteCallback.
+ * lazy_get_dead_offsets - get the dead item offsets of one page
  *
- *		Assumes dead_tuples array is in sorted order.
+ * Stores the offsets of the page in blocks[blockindex] into offsets[], in
+ * ascending order, and returns how many there are.
  */
-static bool
-lazy_tid_reaped(ItemPointer itemptr, void *state)
+static int
+lazy_get_dead_offsets(LVDeadTuples *dead, int blockindex,
+					  OffsetNumber *offsets)
 {
-	LVRelStats *vacrelstats = (LVRelStats *) state;
-	ItemPointer res;
+	uint32		data = dead->blocks[blockindex].data;
+	uint16	   *header;
+	int			n = 0;
+	int			i;
+
+	if (data & LAZY_DEAD_INLINE)
+	{
+		offsets[0] = (OffsetNumber) (data & ~LAZY_DEAD_INLINE);
+		return 1;
+	}
+
+	header = (uint16 *) ((char *) dead + data);
+	if (header[0] & LAZY_DEAD_BITMAP)
+	{
+		uint8	   *bitmap = (uint8 *) (header + 1);
+		int			nbytes = header[0] & ~LAZY_DEAD_BITMAP;
 
-	res = (ItemPointer) bsearch((void *) itemptr,
-								(void *) vacrelstats->dead_tuples,
-								vacrelstats->num_dead_tuples,
-								sizeof(ItemPointerData),
-								vac_cmp_itemptr);
+		for (i = 0; i < nbytes * BITS_PER_BYTE; i++)
+		{
+			if (bitmap[i / BITS_PER_BYTE] & (1 << (i % BITS_PER_BYTE)))
+				offsets[n++] = (OffsetNumber) i;
+		}
+	}
+	else
+	{
+		n = header[0];
+		for (i = 0; i < n; i++)
+			offsets[i] = header[i + 1];
+	}
 
-	return (res != NULL);
+	return n;
 }
 
 /*
- * Comparator routines for use with qsort() and bsearch().
+ * lazy_build_dead_directory - build the directory used by lazy_tid_reaped
  */
-static int
-vac_cmp_itemptr(const void *left, const void *right)
+static void
+lazy_build_dead_directory(LVDeadTuples *dead)
 {
-	BlockNumber lblk,
-				rblk;
-	OffsetNumber loff,
-				roff;
+	uint32	   *directory = (uint32 *) ((char *) dead + dead->directory);
+	int			blockindex = 0;
+	int			i;
 
-	lblk = ItemPointerGetBlockNumber((ItemPointer) left);
-	rblk = ItemPointerGetBlockNumber((ItemPointer) right);
+	for (i = 0; i < dead->ndirectory; i++)
+	{
+		BlockNumber first = (BlockNumber) i << dead->directory_shift;
 
-	if (lblk < rblk)
-		return -1;
-	if (lblk > rblk)
-		return 1;
+		while (blockindex < dead->num_blocks &&
+			   dead->blocks[blockindex].blkno < first)
+			blockindex++;
+		directory[i] = blockindex;
+	}
 
-	loff = ItemPointerGetOffsetNumber((ItemPointer) left);
-	roff = ItemPointerGetOffsetNumber((ItemPointer) right);
+	dead->directory_valid = true;
+}
 
-	if (loff < roff)
-		return -1;
-	if (loff > roff)
-		return 1;
+/*
+ *	lazy_tid_reaped() -- is a particular tid deletable?
+ *
+ *		This has the right signature to be an IndexBulkDeleteCallback.
+ *
+ *		Assumes the directory of the dead tuple store has been built.
+ */
+static bool
+lazy_tid_reaped(ItemPointer itemptr, void *state)
+{
+	LVDeadTuples *dead = (LVDeadTuples *) state;
+	BlockNumber blkno = ItemPointerGetBlockNumber(itemptr);
+	OffsetNumber offnum = ItemPointerGetOffsetNumber(itemptr);
+	uint32	   *directory;
+	BlockNumber range;
+	uint32		data;
+	uint16	   *header;
+	int			lo,
+				hi;
+
+	Assert(dead->directory_valid);
+
+	range = blkno >> dead->directory_shift;
+	if (range >= dead->ndirectory)
+		return false;
+
+	/* binary search the entries of the page's range of blocks */
+	directory = (uint32 *) ((char *) dead + dead->directory);
+	lo = directory[range];
+	hi = (range + 1 < dead->ndirectory) ?
+		directory[range + 1] : dead->num_blocks;
+	while (lo < hi)
+	{
+		int			mid = lo + (hi - lo) / 2;
+
+		if (dead->blocks[mid].blkno < blkno)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo >= dead->num_blocks || dead->blocks[lo].blkno != blkno)
+		return false;
+
+	data = dead->blocks[lo].data;
+	if (data & LAZY_DEAD_INLINE)
+		return (OffsetNumber) (data & ~LAZY_DEAD_INLINE) == offnum;
+
+	header = (uint16 *) ((char *) dead + data);
+	if (header[0] & LAZY_DEAD_BITMAP)
+	{
+		uint8	   *bitmap = (uint8 *) (header + 1);
+		int			nbytes = header[0] & ~LAZY_DEAD_BITMAP;
 
-	return 0;
+		if (offnum / BITS_PER_BYTE >= nbytes)
+			return false;
+		return (bitmap[offnum / BITS_PER_BYTE] &
+				(1 << (offnum % BITS_PER_BYTE))) != 0;
+	}
+	else
+	{
+		int			n = header[0];
+		int			i;
+
+		/* lists are short, see lazy_record_dead_tuples */
+		for (i = 1; i <= n && header[i] <= offnum; i++)
+		{
+			if (header[i] == offnum)
+				return true;
+		}
+		return false;
+	}
 }
 
 /*
@@ -2198,3 +3146,111 @@ heap_page_is_all_visible(Relation rel, Buffer buf,
 
 	return all_visible;
 }
+
+/*
+ * Can VACUUM skip blkno, going by the visibility map?  In a regular vacuum,
+ * all-visible pages can be skipped.  An aggressive vacuum can skip pages that
+ * are all-frozen, and also all-visible pages whose map page's freeze horizon
+ * shows that nothing on them would be frozen with the current FreezeLimit.
+ * In the range whose horizon we're recomputing, the map page holds our
+ * pending marker, unless a locker has reset it since; the horizon we found
+ * there when we started applies.
+ */
+static bool
+lazy_block_is_skippable(Relation onerel, LVRelStats *vacrelstats,
+						BlockNumber blkno, bool aggressive, Buffer *vmbuffer)
+{
+	uint8		vmstatus;
+	TransactionId horizon;
+
+	vmstatus = visibilitymap_get_status(onerel, blkno, vmbuffer);
+	if (!aggressive)
+		return (vmstatus & VISIBILITYMAP_ALL_VISIBLE) != 0;
+
+	if ((vmstatus & VISIBILITYMAP_ALL_FROZEN) != 0)
+		return true;
+	if ((vmstatus & VISIBILITYMAP_ALL_VISIBLE) == 0)
+		return false;
+
+	horizon = visibilitymap_get_freeze_horizon(onerel, blkno, vmbuffer);
+	if (horizon == VISIBILITYMAP_HORIZON_PENDING &&
+		blkno >= vacrelstats->range_start &&
+		blkno < vacrelstats->range_start + VISIBILITYMAP_HEAPBLOCKS_PER_PAGE)
+		horizon = vacrelstats->range_old_horizon;
+	if (horizon == FrozenTransactionId)
+		return true;
+	return TransactionIdIsNormal(horizon) &&
+		!TransactionIdPrecedes(horizon, FreezeLimit);
+}
+
+/*
+ * Return the oldest XID on the page that remains to be frozen, in the form
+ * expected by visibilitymap_set; see heap_tuple_oldest_unfrozen_xid.
+ */
+static TransactionId
+lazy_page_oldest_unfrozen_xid(Page page)
+{
+	TransactionId oldest = FrozenTransactionId;
+	OffsetNumber offnum,
+				maxoff;
+
+	maxoff = PageGetMaxOffsetNumber(page);
+	for (offnum = FirstOffsetNumber;
+		 offnum <= maxoff && TransactionIdIsValid(oldest);
+		 offnum = OffsetNumberNext(offnum))
+	{
+		ItemId		itemid = PageGetItemId(page, offnum);
+		HeapTupleHeader htup;
+
+		if (!ItemIdIsNormal(itemid))
+			continue;
+
+		htup = (HeapTupleHeader) PageGetItem(page, itemid);
+		oldest = visibilitymap_horizon_min(oldest,
+										heap_tuple_oldest_unfrozen_xid(htup));
+	}
+
+	return oldest;
+}
+
+/*
+ * Start computing a new freeze horizon for the visibility map page covering
+ * blkno, which must be the first heap block it covers.  The map page gets a
+ * marker in place of its horizon until we're done with the range, so that we
+ * can tell whether a locker has reset the horizon meanwhile.
+ */
+static void
+lazy_begin_horizon_range(Relation onerel, LVRelStats *vacrelstats,
+						 BlockNumber blkno, Buffer *vmbuffer)
+{
+	vacrelstats->range_start = blkno;
+	vacrelstats->range_old_horizon =
+		visibilitymap_get_freeze_horizon(onerel, blkno, vmbuffer);
+	if (BufferIsValid(*vmbuffer))
+		vacrelstats->range_old_horizon =
+			visibilitymap_begin_freeze_horizon(onerel, blkno, *vmbuffer);
+	vacrelstats->range_horizon = FrozenTransactionId;
+}
+
+/*
+ * Store the freeze horizon computed for the current range.  Every all-visible
+ * page in the range has by now either been examined, and its oldest unfrozen
+ * XID folded into range_horizon, or been skipped, in which case the old
+ * horizon has been folded in.  A tuple locked on a page after we examined or
+ * skipped it isn't covered, but the locker will also have replaced our
+ * marker, and then visibilitymap_raise_freeze_horizon leaves the horizon
+ * alone.
+ */
+static void
+lazy_end_horizon_range(Relation onerel, LVRelStats *vacrelstats,
+					   Buffer *vmbuffer)
+{
+	/* Pin the map page; there's nothing to do if it doesn't exist */
+	(void) visibilitymap_get_freeze_horizon(onerel, vacrelstats->range_start,
+											vmbuffer);
+	if (!BufferIsValid(*vmbuffer))
+		return;
+
+	visibilitymap_raise_freeze_horizon(onerel, vacrelstats->range_start,
+									   *vmbuffer, vacrelstats->range_horizon);
+}
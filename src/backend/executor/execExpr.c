@@ -36,12 +36,14 @@
 #include "executor/execExpr.h"
 #include "executor/nodeSubplan.h"
 #include "funcapi.h"
+#include "jit/jit.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
 #include "optimizer/planner.h"
 #include "pgstat.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
 #include "utils/typcache.h"
@@ -122,6 +124,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 	/* Initialize ExprState with empty step list */
 	state = makeNode(ExprState);
 	state->expr = node;
+	state->parent = parent;
 
 	/* Insert EEOP_*_FETCHSOME steps as needed */
 	ExecInitExprSlots(state, (Node *) node);
@@ -172,6 +175,7 @@ ExecInitQual(List *qual, PlanState *parent)
 
 	state = makeNode(ExprState);
 	state->expr = (Expr *) qual;
+	state->parent = parent;
 	/* mark expression as to be used with ExecQual() */
 	state->flags = EEO_FLAG_IS_QUAL;
 
@@ -314,6 +318,7 @@ ExecBuildProjectionInfo(List *targetList,
 	projInfo->pi_state.tag.type = T_ExprState;
 	state = &projInfo->pi_state;
 	state->expr = (Expr *) targetList;
+	state->parent = parent;
 	state->resultslot = slot;
 
 	/* Insert EEOP_*_FETCHSOME steps as needed */
@@ -559,14 +564,17 @@ ExecCheck(ExprState *state, ExprContext *econtext)
  * Prepare a compiled expression for execution.  This has to be called for
  * every ExprState before it can be executed.
  *
- * NB: While this currently only calls ExecReadyInterpretedExpr(),
- * this will likely get extended to further expression evaluation methods.
- * Therefore this should be used instead of directly calling
+ * If the query is to be JIT compiled, the JIT provider gets the first chance
+ * to prepare the expression; otherwise, or if it declines, the expression is
+ * interpreted.  Therefore this should be used instead of directly calling
  * ExecReadyInterpretedExpr().
  */
 static void
 ExecReadyExpr(ExprState *state)
 {
+	if (jit_compile_expr(state))
+		return;
+
 	ExecReadyInterpretedExpr(state);
 }
 
@@ -867,6 +875,7 @@ ExecInitExprRec(Expr *node, PlanState *parent, ExprState *state,
 				FmgrInfo   *finfo;
 				FunctionCallInfo fcinfo;
 				AclResult	aclresult;
+				Oid			hashfuncid = InvalidOid;
 
 				Assert(list_length(opexpr->args) == 2);
 				scalararg = (Expr *) linitial(opexpr->args);
@@ -889,6 +898,30 @@ ExecInitExprRec(Expr *node, PlanState *parent, ExprState *state,
 				InitFunctionCallInfoData(*fcinfo, finfo, 2,
 										 opexpr->inputcollid, NULL, NULL);
 
+				/*
+				 * If the array is a constant with enough elements, and the
+				 * operator is a hashable equality operator, we can probe a
+				 * hash table of the elements rather than comparing against
+				 * each of them in turn.  We only do this for the ANY case,
+				 * and only when both inputs are hashed with the same
+				 * function, i.e. for same-type comparisons.
+				 */
+				if (opexpr->useOr && finfo->fn_strict &&
+					IsA(arrayarg, Const) && !((Const *) arrayarg)->constisnull)
+				{
+					ArrayType  *arr;
+					Oid			lefthashfunc;
+					Oid			righthashfunc;
+
+					arr = DatumGetArrayTypeP(((Const *) arrayarg)->constvalue);
+					if (ArrayGetNItems(ARR_NDIM(arr), ARR_DIMS(arr)) >=
+						MIN_ARRAY_SIZE_FOR_HASHED_SAOP &&
+						get_op_hash_functions(opexpr->opno,
+											  &lefthashfunc, &righthashfunc) &&
+						lefthashfunc == righthashfunc)
+						hashfuncid = lefthashfunc;
+				}
+
 				/* Evaluate scalar directly into left function argument */
 				ExecInitExprRec(scalararg, parent, state,
 								&fcinfo->arg[0], &fcinfo->argnull[0]);
@@ -902,12 +935,34 @@ ExecInitExprRec(Expr *node, PlanState *parent, ExprState *state,
 				ExecInitExprRec(arrayarg, parent, state, resv, resnull);
 
 				/* And perform the operation */
-				scratch.opcode = EEOP_SCALARARRAYOP;
-				scratch.d.scalararrayop.element_type = InvalidOid;
-				scratch.d.scalararrayop.useOr = opexpr->useOr;
-				scratch.d.scalararrayop.finfo = finfo;
-				scratch.d.scalararrayop.fcinfo_data = fcinfo;
-				scratch.d.scalararrayop.fn_addr = finfo->fn_addr;
+				if (OidIsValid(hashfuncid))
+				{
+					FmgrInfo   *hash_finfo;
+					FunctionCallInfo hash_fcinfo;
+
+					hash_finfo = palloc0(sizeof(FmgrInfo));
+					hash_fcinfo = palloc0(sizeof(FunctionCallInfoData));
+					fmgr_info(hashfuncid, hash_finfo);
+					fmgr_info_set_expr((Node *) node, hash_finfo);
+					InitFunctionCallInfoData(*hash_fcinfo, hash_finfo, 1,
+											 opexpr->inputcollid, NULL, NULL);
+
+					scratch.opcode = EEOP_HASHED_SCALARARRAYOP;
+					scratch.d.hashedscalararrayop.has_nulls = false;
+					scratch.d.hashedscalararrayop.elements_tab = NULL;
+					scratch.d.hashedscalararrayop.finfo = finfo;
+					scratch.d.hashedscalararrayop.fcinfo_data = fcinfo;
+					scratch.d.hashedscalararrayop.hash_fcinfo_data = hash_fcinfo;
+				}
+				else
+				{
+					scratch.opcode = EEOP_SCALARARRAYOP;
+					scratch.d.scalararrayop.element_type = InvalidOid;
+					scratch.d.scalararrayop.useOr = opexpr->useOr;
+					scratch.d.scalararrayop.finfo = finfo;
+					scratch.d.scalararrayop.fcinfo_data = fcinfo;
+					scratch.d.scalararrayop.fn_addr = finfo->fn_addr;
+				}
 				ExprEvalPushStep(state, &scratch);
 				break;
 			}
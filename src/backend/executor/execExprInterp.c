@@ -75,6 +75,43 @@
 #include "utils/xml.h"
 
 
+/*
+ * Hash table of the elements of a constant array, used to evaluate
+ * "scalar = ANY(array)" by lookup rather than linear search.  See
+ * ExecEvalHashedScalarArrayOp.
+ */
+typedef struct ScalarArrayOpExprHashEntry
+{
+	Datum		key;
+	uint32		status;			/* hash status */
+	uint32		hash;			/* hash value (cached) */
+} ScalarArrayOpExprHashEntry;
+
+struct saophash_hash;
+static uint32 saop_element_hash(struct saophash_hash *tb, Datum key);
+static bool saop_hash_element_match(struct saophash_hash *tb, Datum key1,
+						Datum key2);
+
+#define SH_PREFIX saophash
+#define SH_ELEMENT_TYPE ScalarArrayOpExprHashEntry
+#define SH_KEY_TYPE Datum
+#define SH_KEY key
+#define SH_HASH_KEY(tb, key) saop_element_hash(tb, key)
+#define SH_EQUAL(tb, a, b) saop_hash_element_match(tb, a, b)
+#define SH_SCOPE static inline
+#define SH_STORE_HASH
+#define SH_GET_HASH(tb, a) a->hash
+#define SH_DECLARE
+#define SH_DEFINE
+#include "lib/simplehash.h"
+
+typedef struct ScalarArrayOpExprHashTable
+{
+	saophash_hash *hashtab;		/* underlying hash table */
+	struct ExprEvalStep *op;
+} ScalarArrayOpExprHashTable;
+
+
 /*
  * Use computed-goto-based opcode dispatch when computed gotos are available.
  * But use a separate symbol so that it's easy to adjust locally in this file
@@ -355,6 +392,7 @@ ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull)
 		&&CASE_EEOP_DOMAIN_CHECK,
 		&&CASE_EEOP_CONVERT_ROWTYPE,
 		&&CASE_EEOP_SCALARARRAYOP,
+		&&CASE_EEOP_HASHED_SCALARARRAYOP,
 		&&CASE_EEOP_XMLEXPR,
 		&&CASE_EEOP_AGGREF,
 		&&CASE_EEOP_GROUPING_FUNC,
@@ -1414,6 +1452,14 @@ ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull)
 			EEO_NEXT();
 		}
 
+		EEO_CASE(EEOP_HASHED_SCALARARRAYOP)
+		{
+			/* too complex for an inline implementation */
+			ExecEvalHashedScalarArrayOp(state, op, econtext);
+
+			EEO_NEXT();
+		}
+
 		EEO_CASE(EEOP_DOMAIN_NOTNULL)
 		{
 			/* too complex for an inline implementation */
@@ -2992,6 +3038,181 @@ ExecEvalScalarArrayOp(ExprState *state, ExprEvalStep *op)
 	*op->resnull = resultnull;
 }
 
+/*
+ * Hash function for the elements of a hashed "scalar = ANY(array)" test.
+ */
+static uint32
+saop_element_hash(struct saophash_hash *tb, Datum key)
+{
+	ScalarArrayOpExprHashTable *elements_tab = (ScalarArrayOpExprHashTable *) tb->private_data;
+	FunctionCallInfo fcinfo = elements_tab->op->d.hashedscalararrayop.hash_fcinfo_data;
+	Datum		hash;
+
+	fcinfo->arg[0] = key;
+	fcinfo->argnull[0] = false;
+	fcinfo->isnull = false;
+
+	hash = FunctionCallInvoke(fcinfo);
+
+	return DatumGetUInt32(hash);
+}
+
+/*
+ * Matching function for the elements of a hashed "scalar = ANY(array)" test.
+ */
+static bool
+saop_hash_element_match(struct saophash_hash *tb, Datum key1, Datum key2)
+{
+	ScalarArrayOpExprHashTable *elements_tab = (ScalarArrayOpExprHashTable *) tb->private_data;
+	FunctionCallInfo fcinfo = elements_tab->op->d.hashedscalararrayop.fcinfo_data;
+	Datum		result;
+
+	fcinfo->arg[0] = key1;
+	fcinfo->argnull[0] = false;
+	fcinfo->arg[1] = key2;
+	fcinfo->argnull[1] = false;
+	fcinfo->isnull = false;
+
+	result = FunctionCallInvoke(fcinfo);
+
+	return DatumGetBool(result);
+}
+
+/*
+ * Evaluate "scalar op ANY (const array)" by probing a hash table built from
+ * the array's elements.
+ *
+ * This is used in place of ExecEvalScalarArrayOp when the array is a
+ * constant with at least MIN_ARRAY_SIZE_FOR_HASHED_SAOP elements and the
+ * operator is a strict, hashable equality operator; see ExecInitExprRec.
+ * The hash table is built on first execution and kept for the rest of the
+ * query, so each subsequent row costs a single hash probe instead of a
+ * comparison against every array element.
+ *
+ * As in ExecEvalScalarArrayOp, the array is in our result area and the
+ * scalar arg is already evaluated into fcinfo->arg[0]/argnull[0].
+ */
+void
+ExecEvalHashedScalarArrayOp(ExprState *state, ExprEvalStep *op,
+							ExprContext *econtext)
+{
+	ScalarArrayOpExprHashTable *elements_tab = op->d.hashedscalararrayop.elements_tab;
+	FunctionCallInfo fcinfo = op->d.hashedscalararrayop.fcinfo_data;
+	Datum		scalar = fcinfo->arg[0];
+	bool		scalar_isnull = fcinfo->argnull[0];
+	bool		hashfound;
+
+	/* We don't setup a hashed scalar array op if the array const is null. */
+	Assert(!*op->resnull);
+
+	/*
+	 * If the scalar is NULL, the result is NULL, since the operator is
+	 * strict.  Nor is there any need to build the hash table in that case.
+	 */
+	if (scalar_isnull)
+	{
+		*op->resnull = true;
+		return;
+	}
+
+	/* Build the hash table on first evaluation */
+	if (elements_tab == NULL)
+	{
+		MemoryContext oldcontext;
+		ArrayType  *arr;
+		int16		typlen;
+		bool		typbyval;
+		char		typalign;
+		int			nitems;
+		bool		has_nulls = false;
+		char	   *s;
+		bits8	   *bitmap;
+		int			bitmask;
+		int			i;
+
+		/*
+		 * The table, and the detoasted array whose elements it points into,
+		 * must live for the rest of the query.
+		 */
+		oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_query_memory);
+
+		arr = DatumGetArrayTypeP(*op->resvalue);
+		nitems = ArrayGetNItems(ARR_NDIM(arr), ARR_DIMS(arr));
+
+		get_typlenbyvalalign(ARR_ELEMTYPE(arr), &typlen, &typbyval, &typalign);
+
+		elements_tab = (ScalarArrayOpExprHashTable *)
+			palloc(sizeof(ScalarArrayOpExprHashTable));
+		op->d.hashedscalararrayop.elements_tab = elements_tab;
+		elements_tab->op = op;
+
+		/*
+		 * Create the hash table sizing it according to the number of
+		 * elements in the array.  This does assume that the array has no
+		 * duplicates.  If the array happens to contain many duplicate values
+		 * then it'll just mean that we sized the table a bit on the large
+		 * side.
+		 */
+		elements_tab->hashtab = saophash_create(CurrentMemoryContext, nitems,
+												elements_tab);
+
+		s = (char *) ARR_DATA_PTR(arr);
+		bitmap = ARR_NULLBITMAP(arr);
+		bitmask = 1;
+		for (i = 0; i < nitems; i++)
+		{
+			/* Get array element, checking for NULL. */
+			if (bitmap && (*bitmap & bitmask) == 0)
+				has_nulls = true;
+			else
+			{
+				Datum		element;
+
+				element = fetch_att(s, typbyval, typlen);
+				s = att_addlength_pointer(s, typlen, s);
+				s = (char *) att_align_nominal(s, typalign);
+
+				saophash_insert(elements_tab->hashtab, element, &hashfound);
+			}
+
+			/* Advance bitmap pointer if any. */
+			if (bitmap)
+			{
+				bitmask <<= 1;
+				if (bitmask == 0x100)
+				{
+					bitmap++;
+					bitmask = 1;
+				}
+			}
+		}
+
+		/* Remember if we had any nulls, for use when no match is found */
+		op->d.hashedscalararrayop.has_nulls = has_nulls;
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	/* Check the hash to see if we have a match. */
+	hashfound = NULL != saophash_lookup(elements_tab->hashtab, scalar);
+
+	/*
+	 * If there's no match and the array contains NULLs, the result is NULL,
+	 * as it would be when comparing against each element: the strict
+	 * operator yields NULL for the NULL elements.
+	 */
+	if (!hashfound && op->d.hashedscalararrayop.has_nulls)
+	{
+		*op->resvalue = (Datum) 0;
+		*op->resnull = true;
+	}
+	else
+	{
+		*op->resvalue = BoolGetDatum(hashfound);
+		*op->resnull = false;
+	}
+}
+
 /*
  * Evaluate a NOT NULL domain constraint.
  */
@@ -28,6 +28,7 @@
 #include "executor/nodeBitmapHeapscan.h"
 #include "executor/nodeCustom.h"
 #include "executor/nodeForeignscan.h"
+#include "executor/nodeHash.h"
 #include "executor/nodeSeqscan.h"
 #include "executor/nodeIndexscan.h"
 #include "executor/nodeIndexonlyscan.h"
@@ -158,6 +159,7 @@ ExecSerializePlan(Plan *plan, EState *estate)
 	pstmt->transientPlan = false;
 	pstmt->dependsOnRole = false;
 	pstmt->parallelModeNeeded = false;
+	pstmt->jitFlags = estate->es_jit_flags;
 	pstmt->planTree = plan;
 	pstmt->rtable = estate->es_range_table;
 	pstmt->resultRelations = NIL;
@@ -223,6 +225,9 @@ ExecParallelEstimate(PlanState *planstate, ExecParallelEstimateContext *e)
 				ExecBitmapHeapEstimate((BitmapHeapScanState *) planstate,
 									   e->pcxt);
 				break;
+			case T_HashState:
+				ExecHashEstimate((HashState *) planstate, e->pcxt);
+				break;
 			default:
 				break;
 		}
@@ -287,6 +292,9 @@ ExecParallelInitializeDSM(PlanState *planstate,
 				ExecBitmapHeapInitializeDSM((BitmapHeapScanState *) planstate,
 											d->pcxt);
 				break;
+			case T_HashState:
+				ExecHashInitializeDSM((HashState *) planstate, d->pcxt);
+				break;
 
 			default:
 				break;
@@ -348,6 +356,35 @@ ExecParallelSetupTupleQueues(ParallelContext *pcxt, bool reinitialize)
 	return responseq;
 }
 
+/*
+ * Give parallel-aware plan nodes a chance to reset any shared state they
+ * keep in the DSM before the workers are relaunched for a rescan.  This must
+ * happen while no workers are running, before any of them can see the state
+ * left behind by the previous scan.
+ */
+static bool
+ExecParallelReInitializeDSM(PlanState *planstate, ParallelContext *pcxt)
+{
+	if (planstate == NULL)
+		return false;
+
+	if (planstate->plan->parallel_aware)
+	{
+		switch (nodeTag(planstate))
+		{
+			case T_HashState:
+				ExecHashReInitializeDSM((HashState *) planstate, pcxt);
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	return planstate_tree_walker(planstate, ExecParallelReInitializeDSM,
+								 pcxt);
+}
+
 /*
  * Re-initialize the parallel executor info such that it can be reused by
  * workers.
@@ -358,6 +395,7 @@ ExecParallelReinitialize(ParallelExecutorInfo *pei)
 	ReinitializeParallelDSM(pei->pcxt);
 	pei->tqueue = ExecParallelSetupTupleQueues(pei->pcxt, true);
 	pei->finished = false;
+	ExecParallelReInitializeDSM(pei->planstate, pei->pcxt);
 }
 
 /*
@@ -790,6 +828,9 @@ ExecParallelInitializeWorker(PlanState *planstate, shm_toc *toc)
 				ExecBitmapHeapInitializeWorker(
 									 (BitmapHeapScanState *) planstate, toc);
 				break;
+			case T_HashState:
+				ExecHashInitializeWorker((HashState *) planstate, toc);
+				break;
 			default:
 				break;
 		}
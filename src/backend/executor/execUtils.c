@@ -44,16 +44,20 @@
 #include "access/relscan.h"
 #include "access/transam.h"
 #include "executor/executor.h"
+#include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/predtest.h"
 #include "parser/parsetree.h"
 #include "storage/lmgr.h"
 #include "utils/builtins.h"
+#include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/typcache.h"
 
 
 static void ShutdownExprContext(ExprContext *econtext, bool isCommit);
+static Node *replace_params_mutator(Node *node, PlanState *planstate);
 
 
 /* ----------------------------------------------------------------
@@ -148,6 +152,9 @@ CreateExecutorState(void)
 	estate->es_epqScanDone = NULL;
 	estate->es_sourceText = NULL;
 
+	estate->es_jit_flags = 0;
+	estate->es_jit = NULL;
+
 	/*
 	 * Return the executor state structure
 	 */
@@ -985,3 +992,80 @@ ExecCleanTargetListLength(List *targetlist)
 	}
 	return len;
 }
+
+/*
+ * ExecPruneAppendSubplans
+ *
+ * Decide which subplans of an Append or MergeAppend node over a partitioned
+ * table must be run, given the current values of the Params in the node's
+ * part_prune_quals.  For each subplan that has such clauses, the Params are
+ * replaced by their values, and we try to prove that the resulting clauses
+ * contradict the partition's constraint, the same way constraint exclusion
+ * does at plan time.  valid_subplans[i] is set to false if that succeeds,
+ * else to true.
+ *
+ * planstate must have an ExprContext, which is used to evaluate the Params
+ * and as scratch memory for the proofs.
+ */
+void
+ExecPruneAppendSubplans(PlanState *planstate, List *prune_quals,
+						List *constraints, bool *valid_subplans)
+{
+	ExprContext *econtext = planstate->ps_ExprContext;
+	MemoryContext oldcontext;
+	ListCell   *lc1;
+	ListCell   *lc2;
+	int			i;
+
+	ResetExprContext(econtext);
+	oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	i = 0;
+	forboth(lc1, prune_quals, lc2, constraints)
+	{
+		List	   *quals = (List *) lfirst(lc1);
+		List	   *constraint = (List *) lfirst(lc2);
+
+		valid_subplans[i] = true;
+		if (quals != NIL)
+		{
+			quals = (List *) replace_params_mutator((Node *) quals,
+													planstate);
+			if (predicate_refuted_by(constraint, quals))
+				valid_subplans[i] = false;
+		}
+		i++;
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+	ResetExprContext(econtext);
+}
+
+/*
+ * Replace each Param in the expression by a Const holding its current value.
+ */
+static Node *
+replace_params_mutator(Node *node, PlanState *planstate)
+{
+	if (node == NULL)
+		return NULL;
+	if (IsA(node, Param))
+	{
+		Param	   *param = (Param *) node;
+		ExprState  *exprstate;
+		Datum		value;
+		bool		isnull;
+		int16		typlen;
+		bool		typbyval;
+
+		exprstate = ExecInitExpr((Expr *) param, planstate);
+		value = ExecEvalExpr(exprstate, planstate->ps_ExprContext, &isnull);
+		get_typlenbyval(param->paramtype, &typlen, &typbyval);
+
+		return (Node *) makeConst(param->paramtype, param->paramtypmod,
+								  param->paramcollid, (int) typlen,
+								  value, isnull, typbyval);
+	}
+	return expression_tree_mutator(node, replace_params_mutator,
+								   (void *) planstate);
+}
@@ -194,6 +194,20 @@
  *	  transition values.  hashcontext is the single context created to support
  *	  all hash tables.
  *
+ *	  Spilling hashed aggregation to disk:
+ *
+ *	  When there is a single hashed grouping set and no sorted ones (plain
+ *	  AGG_HASHED), the hash table is not allowed to grow much beyond work_mem.
+ *	  Once it does, we stop creating new groups: input tuples that belong to
+ *	  groups already in the table are still aggregated normally, but all other
+ *	  tuples are written out to one of several partitions, chosen by bits of
+ *	  the grouping columns' hash value, held in a logical tape set.  After the
+ *	  groups in memory have been emitted, the hash table is reset and each
+ *	  partition is read back in turn as a new batch of input, spilling again
+ *	  (using further bits of the hash value) if it still doesn't fit.  Since
+ *	  it's raw input tuples that are spilled, this works for any aggregate,
+ *	  whether or not its transition state can be serialized.
+ *
  *
  * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -206,6 +220,9 @@
 
 #include "postgres.h"
 
+#include <math.h>
+
+#include "access/hash.h"
 #include "access/htup_details.h"
 #include "catalog/objectaccess.h"
 #include "catalog/pg_aggregate.h"
@@ -213,6 +230,7 @@
 #include "catalog/pg_type.h"
 #include "executor/executor.h"
 #include "executor/nodeAgg.h"
+#include "executor/nodeSeqscan.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
@@ -222,6 +240,8 @@
 #include "parser/parse_coerce.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
+#include "utils/dynahash.h"
+#include "utils/logtape.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/syscache.h"
@@ -517,6 +537,45 @@ typedef struct AggStatePerHashData
 	Agg		   *aggnode;		/* original Agg node, for numGroups etc. */
 } AggStatePerHashData;
 
+/*
+ * HashAggSpill - one set of partitions of spilled input tuples
+ *
+ * Each time a hash table fills up, tuples that don't belong to groups already
+ * in it are distributed among npartitions tapes of a new logical tape set.
+ * Once the input has been consumed, each non-empty partition becomes a
+ * HashAggBatch to be processed later; the tape set is closed when the last of
+ * them has been read back.
+ */
+typedef struct HashAggSpill
+{
+	LogicalTapeSet *tapeset;	/* one tape per partition */
+	int			npartitions;	/* number of partitions */
+	int			shift;			/* right shift to extract partition number */
+	uint32		mask;			/* mask to apply after shifting */
+	double	   *ntuples;		/* # tuples written to each partition */
+	int			nunread;		/* # partitions not yet read back */
+} HashAggSpill;
+
+/*
+ * HashAggBatch - a spilled partition that is yet to be aggregated
+ */
+typedef struct HashAggBatch
+{
+	HashAggSpill *spill;		/* partition set this belongs to */
+	int			partition;		/* tape number within spill->tapeset */
+	int			used_bits;		/* hash bits used to select this partition */
+	double		ntuples;		/* # tuples in the partition */
+} HashAggBatch;
+
+/*
+ * Number of partitions to spill to, and how often to check memory usage.
+ * The memory check walks the hash table's memory contexts, so we only do it
+ * every HASHAGG_CHECK_INTERVAL new groups.
+ */
+#define HASHAGG_MIN_PARTITIONS_LOG2 2
+#define HASHAGG_MAX_PARTITIONS_LOG2 8
+#define HASHAGG_CHECK_INTERVAL 64
+
 
 static void select_current_set(AggState *aggstate, int setno, bool is_hash);
 static void initialize_phase(AggState *aggstate, int newphase);
@@ -559,8 +618,15 @@ static bool find_unaggregated_cols_walker(Node *node, Bitmapset **colnos);
 static void build_hash_table(AggState *aggstate);
 static TupleHashEntryData *lookup_hash_entry(AggState *aggstate);
 static AggStatePerGroup *lookup_hash_entries(AggState *aggstate);
+static void hashagg_check_limits(AggState *aggstate);
+static void hashagg_spill_init(AggState *aggstate);
+static void hashagg_spill_tuple(AggState *aggstate, TupleTableSlot *inputslot);
+static void hashagg_spill_finish(AggState *aggstate);
+static void hashagg_batch_read(HashAggBatch *batch, TupleTableSlot *slot);
+static void hashagg_reset_spill_state(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_direct(AggState *aggstate);
 static void agg_fill_hash_table(AggState *aggstate);
+static bool agg_refill_hash_table(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table(AggState *aggstate);
 static Datum GetAggInitVal(Datum textInitVal, Oid transtype);
 static void build_pertrans_for_aggref(AggStatePerTrans pertrans,
@@ -679,6 +745,22 @@ fetch_input_tuple(AggState *aggstate)
 			return NULL;
 		slot = aggstate->sort_slot;
 	}
+	else if (aggstate->input_scan)
+	{
+		/*
+		 * Take the next qualifying tuple of the current page, reading the
+		 * next page from the scan once this one is used up.
+		 */
+		if (aggstate->input_next >= aggstate->input_ntuples)
+		{
+			aggstate->input_ntuples = ExecSeqScanBatch(aggstate->input_scan);
+			aggstate->input_next = 0;
+			if (aggstate->input_ntuples == 0)
+				return NULL;
+		}
+		slot = ExecSeqScanBatchSlot(aggstate->input_scan,
+									aggstate->input_next++);
+	}
 	else
 		slot = ExecProcNode(outerPlanState(aggstate));
 
@@ -1845,6 +1927,9 @@ find_unaggregated_cols_walker(Node *node, Bitmapset **colnos)
  * The hash tables always live in the hashcontext's per-tuple memory context
  * (there is only one of these for all tables together, since they are all
  * reset at the same time).
+ *
+ * If the table may spill, don't size it for more groups than can fit in
+ * memory, nor for more than there are in the current batch of input.
  */
 static void
 build_hash_table(AggState *aggstate)
@@ -1860,14 +1945,25 @@ build_hash_table(AggState *aggstate)
 	for (i = 0; i < aggstate->num_hashes; ++i)
 	{
 		AggStatePerHash perhash = &aggstate->perhash[i];
+		long		nbuckets = perhash->aggnode->numGroups;
 
 		Assert(perhash->aggnode->numGroups > 0);
 
+		if (aggstate->hash_spill_enabled)
+		{
+			long		max_groups;
+
+			max_groups = aggstate->hash_mem_limit /
+				hash_agg_entry_size(aggstate->numtrans);
+			nbuckets = Min(nbuckets, (long) aggstate->hash_input_groups);
+			nbuckets = Max(Min(nbuckets, max_groups), 1);
+		}
+
 		perhash->hashtable = BuildTupleHashTable(perhash->numCols,
 												 perhash->hashGrpColIdxHash,
 												 perhash->eqfunctions,
 												 perhash->hashfunctions,
-												 perhash->aggnode->numGroups,
+												 nbuckets,
 												 additionalsize,
 								aggstate->hashcontext->ecxt_per_tuple_memory,
 												 tmpmem,
@@ -2016,6 +2112,9 @@ hash_agg_entry_size(int numAggs)
  * set (which the caller must have selected - note that initialize_aggregate
  * depends on this).
  *
+ * While we're spilling, no new entries are created; NULL is returned instead
+ * if the tuple doesn't belong to a group that's already in the table.
+ *
  * When called, CurrentMemoryContext should be the per-query context.
  */
 static TupleHashEntryData *
@@ -2025,7 +2124,7 @@ lookup_hash_entry(AggState *aggstate)
 	AggStatePerHash perhash = &aggstate->perhash[aggstate->current_set];
 	TupleTableSlot *hashslot = perhash->hashslot;
 	TupleHashEntryData *entry;
-	bool		isnew;
+	bool		isnew = false;
 	int			i;
 
 	/* transfer just the needed columns into hashslot */
@@ -2042,7 +2141,8 @@ lookup_hash_entry(AggState *aggstate)
 	ExecStoreVirtualTuple(hashslot);
 
 	/* find or create the hashtable entry using the filtered tuple */
-	entry = LookupTupleHashEntry(perhash->hashtable, hashslot, &isnew);
+	entry = LookupTupleHashEntry(perhash->hashtable, hashslot,
+								 aggstate->hash_spill_mode ? NULL : &isnew);
 
 	if (isnew)
 	{
@@ -2052,6 +2152,10 @@ lookup_hash_entry(AggState *aggstate)
 		/* initialize aggregates for new tuple group */
 		initialize_aggregates(aggstate, (AggStatePerGroup) entry->additional,
 							  -1);
+
+		aggstate->hash_ngroups_current++;
+		if (aggstate->hash_spill_enabled)
+			hashagg_check_limits(aggstate);
 	}
 
 	return entry;
@@ -2060,6 +2164,8 @@ lookup_hash_entry(AggState *aggstate)
 /*
  * Look up hash entries for the current tuple in all hashed grouping sets,
  * returning an array of pergroup pointers suitable for advance_aggregates.
+ * Returns NULL if we're spilling and the tuple's group isn't in the table;
+ * that can only happen when there is a single hashed grouping set.
  *
  * Be aware that lookup_hash_entry can reset the tmpcontext.
  */
@@ -2072,13 +2178,236 @@ lookup_hash_entries(AggState *aggstate)
 
 	for (setno = 0; setno < numHashes; setno++)
 	{
+		TupleHashEntryData *entry;
+
 		select_current_set(aggstate, setno, true);
-		pergroup[setno] = lookup_hash_entry(aggstate)->additional;
+		entry = lookup_hash_entry(aggstate);
+		if (entry == NULL)
+		{
+			Assert(numHashes == 1);
+			return NULL;
+		}
+		pergroup[setno] = entry->additional;
 	}
 
 	return pergroup;
 }
 
+/*
+ * Check whether the hash table has outgrown its memory limit, and if so,
+ * start spilling tuples of new groups to disk.
+ */
+static void
+hashagg_check_limits(AggState *aggstate)
+{
+	Size		mem;
+
+	if (aggstate->hash_spill_mode ||
+		++aggstate->hash_ngroups_check < HASHAGG_CHECK_INTERVAL)
+		return;
+	aggstate->hash_ngroups_check = 0;
+
+	mem = MemoryContextMemAllocated(aggstate->hashcontext->ecxt_per_tuple_memory,
+									true);
+	if (mem > aggstate->hash_mem_limit)
+		hashagg_spill_init(aggstate);
+}
+
+/*
+ * Start spilling tuples of new groups into a new set of partitions.
+ *
+ * The number of partitions is chosen so that each of them can be expected to
+ * fit in memory, judging by how many groups fit this time round and how many
+ * groups there are estimated to be in all.  If we've run out of hash bits to
+ * partition by, we just carry on without spilling; that can only happen if a
+ * huge number of tuples have the same hash value, in which case splitting
+ * them up further wouldn't help anyway.
+ */
+static void
+hashagg_spill_init(AggState *aggstate)
+{
+	HashAggSpill *spill;
+	double		npartitions;
+	int			nbits;
+
+	npartitions = ceil((aggstate->hash_input_groups -
+						aggstate->hash_ngroups_current) /
+					   Max(aggstate->hash_ngroups_current, 1));
+	nbits = my_log2((long) Min(npartitions, 1 << HASHAGG_MAX_PARTITIONS_LOG2));
+	nbits = Max(nbits, HASHAGG_MIN_PARTITIONS_LOG2);
+
+	if (aggstate->hash_used_bits + nbits > 32)
+	{
+		aggstate->hash_spill_enabled = false;
+		return;
+	}
+
+	spill = (HashAggSpill *) palloc(sizeof(HashAggSpill));
+	spill->npartitions = 1 << nbits;
+	spill->shift = 32 - aggstate->hash_used_bits - nbits;
+	spill->mask = spill->npartitions - 1;
+	spill->tapeset = LogicalTapeSetCreate(spill->npartitions);
+	spill->ntuples = (double *) palloc0(sizeof(double) * spill->npartitions);
+	spill->nunread = 0;
+
+	aggstate->hash_spill = spill;
+	aggstate->hash_spill_mode = true;
+	aggstate->hash_ever_spilled = true;
+}
+
+/*
+ * Write the current input tuple, which belongs to a group that's not in the
+ * hash table, to its partition.  lookup_hash_entry must have loaded the
+ * grouping columns into the hash slot.
+ */
+static void
+hashagg_spill_tuple(AggState *aggstate, TupleTableSlot *inputslot)
+{
+	AggStatePerHash perhash = &aggstate->perhash[0];
+	TupleTableSlot *hashslot = perhash->hashslot;
+	HashAggSpill *spill = aggstate->hash_spill;
+	MinimalTuple tuple;
+	uint32		hashkey = 0;
+	int			partition;
+	int			i;
+
+	Assert(spill != NULL);
+
+	/*
+	 * Hash the grouping columns much as execGrouping.c does, but mix the
+	 * result so that the bits we partition by are independent of the ones
+	 * the hash table uses to choose buckets.
+	 */
+	for (i = 0; i < perhash->numCols; i++)
+	{
+		/* rotate hashkey left 1 bit at each step */
+		hashkey = (hashkey << 1) | ((hashkey & 0x80000000) ? 1 : 0);
+
+		if (!hashslot->tts_isnull[i])	/* treat nulls as having hash key 0 */
+		{
+			uint32		hkey;
+
+			hkey = DatumGetUInt32(FunctionCall1(&perhash->hashfunctions[i],
+												hashslot->tts_values[i]));
+			hashkey ^= hkey;
+		}
+	}
+	hashkey = DatumGetUInt32(hash_uint32(hashkey));
+
+	partition = (hashkey >> spill->shift) & spill->mask;
+
+	tuple = ExecFetchSlotMinimalTuple(inputslot);
+	LogicalTapeWrite(spill->tapeset, partition, (void *) tuple, tuple->t_len);
+	spill->ntuples[partition] += 1;
+}
+
+/*
+ * Finish writing the current set of partitions, if any, and queue up the
+ * non-empty ones to be processed as batches later.
+ */
+static void
+hashagg_spill_finish(AggState *aggstate)
+{
+	HashAggSpill *spill = aggstate->hash_spill;
+	int			used_bits;
+	int			i;
+
+	if (spill == NULL)
+		return;
+
+	used_bits = 32 - spill->shift;
+	for (i = 0; i < spill->npartitions; i++)
+	{
+		HashAggBatch *batch;
+
+		if (spill->ntuples[i] == 0)
+			continue;
+
+		batch = (HashAggBatch *) palloc(sizeof(HashAggBatch));
+		batch->spill = spill;
+		batch->partition = i;
+		batch->used_bits = used_bits;
+		batch->ntuples = spill->ntuples[i];
+		aggstate->hash_batches = lappend(aggstate->hash_batches, batch);
+		spill->nunread++;
+	}
+
+	aggstate->hash_disk_used += LogicalTapeSetBlocks(spill->tapeset) *
+		(BLCKSZ / 1024);
+
+	if (spill->nunread == 0)
+	{
+		LogicalTapeSetClose(spill->tapeset);
+		pfree(spill->ntuples);
+		pfree(spill);
+	}
+
+	aggstate->hash_spill = NULL;
+}
+
+/*
+ * Read the next spilled tuple of a batch into the given slot.
+ */
+static void
+hashagg_batch_read(HashAggBatch *batch, TupleTableSlot *slot)
+{
+	LogicalTapeSet *tapeset = batch->spill->tapeset;
+	MinimalTuple tuple;
+	uint32		t_len;
+	size_t		nread;
+
+	nread = LogicalTapeRead(tapeset, batch->partition, &t_len, sizeof(t_len));
+	if (nread != sizeof(t_len))
+		elog(ERROR, "unexpected end of data");
+
+	tuple = (MinimalTuple) palloc(t_len);
+	tuple->t_len = t_len;
+	nread = LogicalTapeRead(tapeset, batch->partition,
+							(char *) tuple + sizeof(t_len),
+							t_len - sizeof(t_len));
+	if (nread != t_len - sizeof(t_len))
+		elog(ERROR, "unexpected end of data");
+
+	ExecStoreMinimalTuple(tuple, slot, true);
+}
+
+/*
+ * Throw away any spilled data, as when rescanning.
+ */
+static void
+hashagg_reset_spill_state(AggState *aggstate)
+{
+	ListCell   *lc;
+
+	/* Queue up any partitions being written, so they get closed below */
+	hashagg_spill_finish(aggstate);
+
+	foreach(lc, aggstate->hash_batches)
+	{
+		HashAggBatch *batch = (HashAggBatch *) lfirst(lc);
+		HashAggSpill *spill = batch->spill;
+
+		if (--spill->nunread == 0)
+		{
+			LogicalTapeSetClose(spill->tapeset);
+			pfree(spill->ntuples);
+			pfree(spill);
+		}
+		pfree(batch);
+	}
+	list_free(aggstate->hash_batches);
+	aggstate->hash_batches = NIL;
+
+	aggstate->hash_spill_mode = false;
+	aggstate->hash_ever_spilled = false;
+	aggstate->hash_spill_enabled =
+		(aggstate->aggstrategy == AGG_HASHED && aggstate->num_hashes == 1);
+	aggstate->hash_ngroups_check = 0;
+	aggstate->hash_ngroups_current = 0;
+	aggstate->hash_input_groups = aggstate->perhash[0].aggnode->numGroups;
+	aggstate->hash_used_bits = 0;
+}
+
 /*
  * ExecAgg -
  *
@@ -2503,8 +2832,10 @@ agg_fill_hash_table(AggState *aggstate)
 		/* Find or build hashtable entries */
 		pergroups = lookup_hash_entries(aggstate);
 
-		/* Advance the aggregates */
-		if (DO_AGGSPLIT_COMBINE(aggstate->aggsplit))
+		/* Advance the aggregates, or save the tuple for a later batch */
+		if (pergroups == NULL)
+			hashagg_spill_tuple(aggstate, outerslot);
+		else if (DO_AGGSPLIT_COMBINE(aggstate->aggsplit))
 			combine_aggregates(aggstate, pergroups[0]);
 		else
 			advance_aggregates(aggstate, NULL, pergroups);
@@ -2516,6 +2847,9 @@ agg_fill_hash_table(AggState *aggstate)
 		ResetExprContext(aggstate->tmpcontext);
 	}
 
+	/* Queue up any spilled partitions for later */
+	hashagg_spill_finish(aggstate);
+
 	aggstate->table_filled = true;
 	/* Initialize to walk the first hash table */
 	select_current_set(aggstate, 0, true);
@@ -2523,6 +2857,87 @@ agg_fill_hash_table(AggState *aggstate)
 						   &aggstate->perhash[0].hashiter);
 }
 
+/*
+ * ExecAgg for hashed case: after the groups in the hash table have all been
+ * returned, rebuild it from the next batch of spilled tuples.  Returns false
+ * if there are no more batches.
+ */
+static bool
+agg_refill_hash_table(AggState *aggstate)
+{
+	ExprContext *tmpcontext = aggstate->tmpcontext;
+	TupleTableSlot *slot = aggstate->hash_spill_slot;
+	HashAggBatch *batch;
+	HashAggSpill *spill;
+	double		ntuples;
+
+	if (aggstate->hash_batches == NIL)
+		return false;
+
+	batch = (HashAggBatch *) linitial(aggstate->hash_batches);
+	aggstate->hash_batches = list_delete_first(aggstate->hash_batches);
+	spill = batch->spill;
+
+	/*
+	 * Release the groups we've already returned and start again with an
+	 * empty hash table.  (We use rescan rather than just reset because
+	 * transfns may have registered callbacks that need to be run now.)
+	 */
+	ReScanExprContext(aggstate->hashcontext);
+	aggstate->hash_spill_mode = false;
+	aggstate->hash_spill_enabled = true;
+	aggstate->hash_ngroups_check = 0;
+	aggstate->hash_ngroups_current = 0;
+	aggstate->hash_input_groups = batch->ntuples;
+	aggstate->hash_used_bits = batch->used_bits;
+	aggstate->hash_batches_used++;
+	build_hash_table(aggstate);
+
+	LogicalTapeRewindForRead(spill->tapeset, batch->partition, BLCKSZ);
+
+	for (ntuples = 0; ntuples < batch->ntuples; ntuples++)
+	{
+		AggStatePerGroup *pergroups;
+
+		CHECK_FOR_INTERRUPTS();
+
+		hashagg_batch_read(batch, slot);
+
+		/* from here on, just as in agg_fill_hash_table */
+		tmpcontext->ecxt_outertuple = slot;
+
+		pergroups = lookup_hash_entries(aggstate);
+
+		if (pergroups == NULL)
+			hashagg_spill_tuple(aggstate, slot);
+		else if (DO_AGGSPLIT_COMBINE(aggstate->aggsplit))
+			combine_aggregates(aggstate, pergroups[0]);
+		else
+			advance_aggregates(aggstate, NULL, pergroups);
+
+		ResetExprContext(aggstate->tmpcontext);
+	}
+	ExecClearTuple(slot);
+
+	hashagg_spill_finish(aggstate);
+
+	/* We're done with this batch; release its tape set if it's the last */
+	if (--spill->nunread == 0)
+	{
+		LogicalTapeSetClose(spill->tapeset);
+		pfree(spill->ntuples);
+		pfree(spill);
+	}
+	pfree(batch);
+
+	/* Initialize to walk the new hash table */
+	select_current_set(aggstate, 0, true);
+	ResetTupleHashIterator(aggstate->perhash[0].hashtable,
+						   &aggstate->perhash[0].hashiter);
+
+	return true;
+}
+
 /*
  * ExecAgg for hashed case: retrieving groups from hash table
  */
@@ -2583,6 +2998,12 @@ agg_retrieve_hash_table(AggState *aggstate)
 
 				continue;
 			}
+			else if (agg_refill_hash_table(aggstate))
+			{
+				/* Start returning the groups of the next spilled batch */
+				perhash = &aggstate->perhash[aggstate->current_set];
+				continue;
+			}
 			else
 			{
 				/* No more hashtables, so done */
@@ -2809,6 +3230,17 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 	outerPlan = outerPlan(node);
 	outerPlanState(aggstate) = ExecInitNode(outerPlan, estate, eflags);
 
+	/*
+	 * If the input is a sequential scan that returns its tuples unchanged,
+	 * read it a page at a time: the scan then evaluates its qual over the
+	 * whole page in one loop, and we feed the qualifying tuples to the
+	 * transition functions without a round trip through ExecProcNode for
+	 * each.
+	 */
+	if (IsA(outerPlanState(aggstate), SeqScanState) &&
+		ExecSeqScanCanBatch((SeqScanState *) outerPlanState(aggstate)))
+		aggstate->input_scan = (SeqScanState *) outerPlanState(aggstate);
+
 	/*
 	 * initialize source tuple type.
 	 */
@@ -2998,6 +3430,17 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 		/* this is an array of pointers, not structures */
 		aggstate->hash_pergroup = palloc0(sizeof(AggStatePerGroup) * numHashes);
 
+		/*
+		 * Plain hashed aggregation may spill to disk if the hash table grows
+		 * beyond work_mem.  Spilled input tuples are read back into a slot
+		 * of their own.
+		 */
+		aggstate->hash_mem_limit = work_mem * 1024L;
+		aggstate->hash_spill_slot = ExecInitExtraTupleSlot(estate);
+		ExecSetSlotDescriptor(aggstate->hash_spill_slot,
+							  ExecGetResultType(outerPlanState(aggstate)));
+		hashagg_reset_spill_state(aggstate);
+
 		find_hash_columns(aggstate);
 		build_hash_table(aggstate);
 		aggstate->table_filled = false;
@@ -3856,6 +4299,10 @@ ExecEndAgg(AggState *node)
 		}
 	}
 
+	/* Release any temporary files used to spill hashed input */
+	if (node->hashcontext)
+		hashagg_reset_spill_state(node);
+
 	/* And ensure any agg shutdown callbacks have been called */
 	for (setno = 0; setno < numGroupingSets; setno++)
 		ReScanExprContext(node->aggcontexts[setno]);
@@ -3887,6 +4334,8 @@ ExecReScanAgg(AggState *node)
 	int			setno;
 
 	node->agg_done = false;
+	node->input_ntuples = 0;
+	node->input_next = 0;
 
 	if (node->aggstrategy == AGG_HASHED)
 	{
@@ -3903,9 +4352,11 @@ ExecReScanAgg(AggState *node)
 		 * If we do have the hash table, and the subplan does not have any
 		 * parameter changes, and none of our own parameter changes affect
 		 * input expressions of the aggregated functions, then we can just
-		 * rescan the existing hash table; no need to build it again.
+		 * rescan the existing hash table; no need to build it again.  That
+		 * doesn't work if any input was spilled, since then the table holds
+		 * only the groups of the last batch.
 		 */
-		if (outerPlan->chgParam == NULL &&
+		if (outerPlan->chgParam == NULL && !node->hash_ever_spilled &&
 			!bms_overlap(node->ss.ps.chgParam, aggnode->aggParams))
 		{
 			ResetTupleHashIterator(node->perhash[0].hashtable,
@@ -3962,6 +4413,7 @@ ExecReScanAgg(AggState *node)
 	 */
 	if (node->aggstrategy == AGG_HASHED || node->aggstrategy == AGG_MIXED)
 	{
+		hashagg_reset_spill_state(node);
 		ReScanExprContext(node->hashcontext);
 		/* Rebuild an empty hash table */
 		build_hash_table(node);
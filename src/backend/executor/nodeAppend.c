@@ -61,6 +61,8 @@
 #include "executor/nodeAppend.h"
 
 static bool exec_append_initialize_next(AppendState *appendstate);
+static void exec_append_prune(AppendState *appendstate);
+static void exec_append_skip_pruned(AppendState *appendstate, bool forward);
 
 
 /* ----------------------------------------------------------------
@@ -105,6 +107,53 @@ exec_append_initialize_next(AppendState *appendstate)
 	}
 }
 
+/* ----------------------------------------------------------------
+ *		exec_append_prune
+ *
+ *		Recompute which subplans can be skipped given the current
+ *		values of the Params they depend on, and move to the first
+ *		subplan that can't.
+ * ----------------------------------------------------------------
+ */
+static void
+exec_append_prune(AppendState *appendstate)
+{
+	Append	   *node = (Append *) appendstate->ps.plan;
+
+	ExecPruneAppendSubplans(&appendstate->ps,
+							node->part_prune_quals,
+							node->part_constraints,
+							appendstate->as_valid_subplans);
+	appendstate->as_prune_pending = false;
+
+	appendstate->as_whichplan = 0;
+	exec_append_skip_pruned(appendstate, true);
+}
+
+/* ----------------------------------------------------------------
+ *		exec_append_skip_pruned
+ *
+ *		Advance as_whichplan past subplans pruned at runtime, in
+ *		the given direction.  It may end up outside the valid range.
+ * ----------------------------------------------------------------
+ */
+static void
+exec_append_skip_pruned(AppendState *appendstate, bool forward)
+{
+	if (appendstate->as_valid_subplans == NULL)
+		return;
+
+	while (appendstate->as_whichplan >= 0 &&
+		   appendstate->as_whichplan < appendstate->as_nplans &&
+		   !appendstate->as_valid_subplans[appendstate->as_whichplan])
+	{
+		if (forward)
+			appendstate->as_whichplan++;
+		else
+			appendstate->as_whichplan--;
+	}
+}
+
 /* ----------------------------------------------------------------
  *		ExecInitAppend
  *
@@ -152,9 +201,17 @@ ExecInitAppend(Append *node, EState *estate, int eflags)
 	/*
 	 * Miscellaneous initialization
 	 *
-	 * Append plans don't have expression contexts because they never call
-	 * ExecQual or ExecProject.
+	 * Append plans don't need expression contexts because they never call
+	 * ExecQual or ExecProject, except to evaluate Params for runtime
+	 * partition pruning.  That is done on the first call to ExecAppend, as
+	 * initplans the Params might depend on aren't set up yet.
 	 */
+	if (node->part_prune_quals != NIL)
+	{
+		ExecAssignExprContext(estate, &appendstate->ps);
+		appendstate->as_valid_subplans = (bool *) palloc(nplans * sizeof(bool));
+		appendstate->as_prune_pending = true;
+	}
 
 	/*
 	 * append nodes still have Result slots, which hold pointers to tuples, so
@@ -199,11 +256,34 @@ ExecInitAppend(Append *node, EState *estate, int eflags)
 TupleTableSlot *
 ExecAppend(AppendState *node)
 {
+	if (node->as_prune_pending)
+	{
+		exec_append_prune(node);
+		if (!exec_append_initialize_next(node))
+			return ExecClearTuple(node->ps.ps_ResultTupleSlot);
+	}
+
 	for (;;)
 	{
 		PlanState  *subnode;
 		TupleTableSlot *result;
 
+		/*
+		 * If we've been left on a pruned subplan, advance to the nearest
+		 * unpruned one in the current scan direction.  We can land here
+		 * after a scan in the other direction ran off the end, leaving us
+		 * clamped to a pruned subplan at that end; that doesn't mean there
+		 * is nothing to return now that the direction has changed.
+		 */
+		if (node->as_valid_subplans != NULL &&
+			!node->as_valid_subplans[node->as_whichplan])
+		{
+			exec_append_skip_pruned(node,
+							ScanDirectionIsForward(node->ps.state->es_direction));
+			if (!exec_append_initialize_next(node))
+				return ExecClearTuple(node->ps.ps_ResultTupleSlot);
+		}
+
 		/*
 		 * figure out which subplan we are currently processing
 		 */
@@ -230,9 +310,15 @@ ExecAppend(AppendState *node)
 		 * ExecInitAppend.
 		 */
 		if (ScanDirectionIsForward(node->ps.state->es_direction))
+		{
 			node->as_whichplan++;
+			exec_append_skip_pruned(node, true);
+		}
 		else
+		{
 			node->as_whichplan--;
+			exec_append_skip_pruned(node, false);
+		}
 		if (!exec_append_initialize_next(node))
 			return ExecClearTuple(node->ps.ps_ResultTupleSlot);
 
@@ -291,6 +377,15 @@ ExecReScanAppend(AppendState *node)
 		if (subnode->chgParam == NULL)
 			ExecReScan(subnode);
 	}
+
+	/*
+	 * If the Params used for pruning may have changed, the set of subplans
+	 * to scan has to be recomputed by the next ExecAppend.
+	 */
+	if (node->as_valid_subplans != NULL && node->ps.chgParam != NULL)
+		node->as_prune_pending = true;
+
 	node->as_whichplan = 0;
+	exec_append_skip_pruned(node, true);
 	exec_append_initialize_next(node);
 }
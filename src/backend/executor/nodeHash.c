@@ -32,12 +32,15 @@
 #include "executor/nodeHash.h"
 #include "executor/nodeHashjoin.h"
 #include "miscadmin.h"
+#include "pgstat.h"
 #include "utils/dynahash.h"
 #include "utils/memutils.h"
 #include "utils/lsyscache.h"
 #include "utils/syscache.h"
 
 
+static void MultiExecPrivateHash(HashState *node);
+static void MultiExecParallelHash(HashState *node);
 static void ExecHashIncreaseNumBatches(HashJoinTable hashtable);
 static void ExecHashIncreaseNumBuckets(HashJoinTable hashtable);
 static void ExecHashBuildSkewHash(HashJoinTable hashtable, Hash *node,
@@ -50,6 +53,39 @@ static void ExecHashRemoveNextSkewBucket(HashJoinTable hashtable);
 
 static void *dense_alloc(HashJoinTable hashtable, Size size);
 
+static void ExecParallelHashTableInsert(HashJoinTable hashtable,
+							TupleTableSlot *slot,
+							uint32 hashvalue);
+static void *ExecParallelHashTupleAlloc(HashJoinTable hashtable, Size size,
+						   dsa_pointer *shared, bool may_grow);
+static void ExecParallelHashRetireChunk(HashJoinTable hashtable);
+static inline void ExecParallelHashPushTuple(dsa_pointer_atomic *head,
+						  HashJoinTuple tuple,
+						  dsa_pointer tuple_shared);
+static int	ExecParallelHashChooseNumBuckets(double ntuples);
+static Size ExecParallelHashBucketBytes(ParallelHashJoinState *pstate,
+							ParallelHashJoinBatch *batch);
+static void ExecParallelHashIncreaseNumBatches(HashJoinTable hashtable);
+static void ExecParallelHashSetUpGrowth(HashJoinTable hashtable);
+static void ExecParallelHashSetUpBatches(HashJoinTable hashtable, int nbatch);
+static void ExecParallelHashRepartitionFirst(HashJoinTable hashtable);
+static void ExecParallelHashRepartitionRest(HashJoinTable hashtable);
+static MinimalTuple ExecParallelHashReadTuple(BufFile *file,
+						  uint32 *hashvalue);
+static void ExecParallelHashFileName(char *name, bool inner, int nbatch,
+						 int batchno, int participant);
+static void ExecParallelHashAdoptShape(HashJoinTable hashtable);
+static void ExecParallelHashAllocBuckets(HashJoinTable hashtable,
+							 ParallelHashJoinBatch *batch, int nbuckets);
+static void ExecParallelHashSizeFirstBatch(HashJoinTable hashtable);
+static void ExecParallelHashInsertChunks(HashJoinTable hashtable);
+static void ExecParallelHashFreeChunks(dsa_area *area, dsa_pointer chunk_shared);
+static void ExecParallelHashFreeBatch(dsa_area *area,
+						  ParallelHashJoinBatch *batch);
+static void ExecParallelHashResetState(ParallelHashJoinState *pstate);
+static bool ExecParallelScanHashBucket(HashJoinState *hjstate,
+						   ExprContext *econtext);
+
 /* ----------------------------------------------------------------
  *		ExecHash
  *
@@ -72,6 +108,39 @@ ExecHash(HashState *node)
  */
 Node *
 MultiExecHash(HashState *node)
+{
+	/* must provide our own instrumentation support */
+	if (node->ps.instrument)
+		InstrStartNode(node->ps.instrument);
+
+	if (node->hashtable->parallel_state != NULL)
+		MultiExecParallelHash(node);
+	else
+		MultiExecPrivateHash(node);
+
+	/* must provide our own instrumentation support */
+	if (node->ps.instrument)
+		InstrStopNode(node->ps.instrument, node->hashtable->partialTuples);
+
+	/*
+	 * We do not return the hash table directly because it's not a subtype of
+	 * Node, and so would violate the MultiExecProcNode API.  Instead, our
+	 * parent Hashjoin node is expected to know how to fish it out of our node
+	 * state.  Ugly but not really worth cleaning up, since Hashjoin knows
+	 * quite a bit more about Hash besides that.
+	 */
+	return NULL;
+}
+
+/* ----------------------------------------------------------------
+ *		MultiExecPrivateHash
+ *
+ *		build a backend-private hash table, as done for a Hash node
+ *		that is not parallel-aware.
+ * ----------------------------------------------------------------
+ */
+static void
+MultiExecPrivateHash(HashState *node)
 {
 	PlanState  *outerNode;
 	List	   *hashkeys;
@@ -80,10 +149,6 @@ MultiExecHash(HashState *node)
 	ExprContext *econtext;
 	uint32		hashvalue;
 
-	/* must provide our own instrumentation support */
-	if (node->ps.instrument)
-		InstrStartNode(node->ps.instrument);
-
 	/*
 	 * get state info from node
 	 */
@@ -138,18 +203,110 @@ MultiExecHash(HashState *node)
 	if (hashtable->spaceUsed > hashtable->spacePeak)
 		hashtable->spacePeak = hashtable->spaceUsed;
 
-	/* must provide our own instrumentation support */
-	if (node->ps.instrument)
-		InstrStopNode(node->ps.instrument, hashtable->totalTuples);
+	hashtable->partialTuples = hashtable->totalTuples;
+}
+
+/* ----------------------------------------------------------------
+ *		MultiExecParallelHash
+ *
+ *		build a hash table shared with other processes, as done for a
+ *		parallel-aware Hash node.  See ParallelHashJoinState in hashjoin.h
+ *		for an outline of the protocol.
+ * ----------------------------------------------------------------
+ */
+static void
+MultiExecParallelHash(HashState *node)
+{
+	HashJoinTable hashtable = node->hashtable;
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	Barrier    *build_barrier = &pstate->build_barrier;
+	PlanState  *outerNode;
+	ExprContext *econtext;
+	TupleTableSlot *slot;
+	uint32		hashvalue;
 
 	/*
-	 * We do not return the hash table directly because it's not a subtype of
-	 * Node, and so would violate the MultiExecProcNode API.  Instead, our
-	 * parent Hashjoin node is expected to know how to fish it out of our node
-	 * state.  Ugly but not really worth cleaning up, since Hashjoin knows
-	 * quite a bit more about Hash besides that.
+	 * We attached to the build in ExecHashTableCreate, and the phase can't
+	 * have moved on without us since then.  If we arrived too late to read
+	 * any inner tuples, we still help with whatever is left to do.
 	 */
-	return NULL;
+	switch (BarrierPhase(build_barrier))
+	{
+		case PHJ_BUILD_HASHING_INNER:
+
+			/*
+			 * Read our share of the inner relation.  If the number of
+			 * batches is being increased right now, help with that first.
+			 */
+			if (PHJ_GROW_BATCHES_PHASE(BarrierAttach(&pstate->grow_batches_barrier)) !=
+				PHJ_GROW_BATCHES_ELECTING)
+				ExecParallelHashIncreaseNumBatches(hashtable);
+			ExecParallelHashAdoptShape(hashtable);
+
+			outerNode = outerPlanState(node);
+			econtext = node->ps.ps_ExprContext;
+			for (;;)
+			{
+				slot = ExecProcNode(outerNode);
+				if (TupIsNull(slot))
+					break;
+				econtext->ecxt_innertuple = slot;
+				if (ExecHashGetHashValue(hashtable, econtext, node->hashkeys,
+										 false, hashtable->keepNulls,
+										 &hashvalue))
+				{
+					ExecParallelHashTableInsert(hashtable, slot, hashvalue);
+					hashtable->partialTuples += 1;
+				}
+			}
+
+			/*
+			 * Make our last chunk and our batch files available to everyone
+			 * before we stop taking part in any increase of nbatch.
+			 */
+			ExecParallelHashRetireChunk(hashtable);
+			ExecParallelHashCloseBatchFiles(hashtable, true);
+			BarrierDetach(&pstate->grow_batches_barrier);
+
+			SpinLockAcquire(&pstate->mutex);
+			pstate->total_tuples += hashtable->partialTuples;
+			SpinLockRelease(&pstate->mutex);
+
+			if (BarrierArriveAndWait(build_barrier, WAIT_EVENT_HASH_BUILD))
+				ExecParallelHashSizeFirstBatch(hashtable);
+			/* FALL THRU */
+
+		case PHJ_BUILD_SIZING:
+			/* Wait for the buckets of batch 0 to be allocated. */
+			BarrierArriveAndWait(build_barrier, WAIT_EVENT_HASH_BUILD);
+			/* FALL THRU */
+
+		case PHJ_BUILD_INSERTING:
+			ExecParallelHashAdoptShape(hashtable);
+			ExecParallelHashInsertChunks(hashtable);
+			BarrierArriveAndWait(build_barrier, WAIT_EVENT_HASH_BUILD);
+			break;
+
+		default:
+			break;
+	}
+
+	/*
+	 * The shape of the table is now final.  Our caller partitions the outer
+	 * relation if there is more than one batch, and then chooses batches to
+	 * work on.
+	 */
+	ExecParallelHashAdoptShape(hashtable);
+	hashtable->curbatch = -1;
+	hashtable->batch_done = (bool *)
+		MemoryContextAllocZero(hashtable->hashCxt,
+							   hashtable->nbatch * sizeof(bool));
+
+	SpinLockAcquire(&pstate->mutex);
+	hashtable->totalTuples = pstate->total_tuples;
+	hashtable->spaceUsed = hashtable->batches[0].size;
+	SpinLockRelease(&pstate->mutex);
+	hashtable->spacePeak = Max(hashtable->spacePeak, hashtable->spaceUsed);
 }
 
 /* ----------------------------------------------------------------
@@ -174,6 +331,7 @@ ExecInitHash(Hash *node, EState *estate, int eflags)
 	hashstate->ps.state = estate;
 	hashstate->hashtable = NULL;
 	hashstate->hashkeys = NIL;	/* will be set by parent HashJoin */
+	hashstate->parallel_state = NULL;
 
 	/*
 	 * Miscellaneous initialization
@@ -239,10 +397,13 @@ ExecEndHash(HashState *node)
  * ----------------------------------------------------------------
  */
 HashJoinTable
-ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
+ExecHashTableCreate(HashState *state, List *hashOperators, bool keepNulls)
 {
+	Hash	   *node = (Hash *) state->ps.plan;
+	ParallelHashJoinState *pstate;
 	HashJoinTable hashtable;
 	Plan	   *outerNode;
+	double		rows;
 	int			nbuckets;
 	int			nbatch;
 	int			num_skew_mcvs;
@@ -256,12 +417,27 @@ ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
 	 * Get information about the size of the relation to be hashed (it's the
 	 * "outer" subtree of this node, but the inner relation of the hashjoin).
 	 * Compute the appropriate size of the hash table.
+	 *
+	 * A shared hash table is sized for the rows of all participants, and may
+	 * use the memory of all of them, but never uses skew optimization.  The
+	 * size computed here is only the starting point: the number of batches
+	 * may grow while the table is built, and if it stays at one, the number
+	 * of buckets is chosen once all tuples have been loaded.
 	 */
 	outerNode = outerPlan(node);
+	pstate = state->parallel_state;
 
-	ExecChooseHashTableSize(outerNode->plan_rows, outerNode->plan_width,
-							OidIsValid(node->skewTable),
-							&nbuckets, &nbatch, &num_skew_mcvs);
+	if (pstate != NULL)
+	{
+		rows = node->rows_total > 0 ? node->rows_total : outerNode->plan_rows;
+		ExecChooseHashTableSize(rows, outerNode->plan_width, false,
+								pstate->nparticipants - 1,
+								&nbuckets, &nbatch, &num_skew_mcvs);
+	}
+	else
+		ExecChooseHashTableSize(outerNode->plan_rows, outerNode->plan_width,
+								OidIsValid(node->skewTable), 0,
+								&nbuckets, &nbatch, &num_skew_mcvs);
 
 	/* nbuckets must be a power of 2 */
 	log2_nbuckets = my_log2(nbuckets);
@@ -279,7 +455,7 @@ ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
 	hashtable->nbuckets_optimal = nbuckets;
 	hashtable->log2_nbuckets = log2_nbuckets;
 	hashtable->log2_nbuckets_optimal = log2_nbuckets;
-	hashtable->buckets = NULL;
+	hashtable->buckets.unshared = NULL;
 	hashtable->keepNulls = keepNulls;
 	hashtable->skewEnabled = false;
 	hashtable->skewBucket = NULL;
@@ -302,6 +478,16 @@ ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
 	hashtable->spaceAllowedSkew =
 		hashtable->spaceAllowed * SKEW_WORK_MEM_PERCENT / 100;
 	hashtable->chunks = NULL;
+	hashtable->partialTuples = 0;
+	hashtable->parallel_state = pstate;
+	hashtable->batches = NULL;
+	hashtable->batch_done = NULL;
+	hashtable->area = state->ps.state->es_query_dsa;
+	hashtable->participant = ParallelWorkerNumber + 1;
+	hashtable->current_chunk = NULL;
+	hashtable->current_chunk_shared = InvalidDsaPointer;
+	hashtable->read_file = NULL;
+	hashtable->read_participant = -1;
 
 #ifdef HJDEBUG
 	printf("Hashjoin %p: initial nbatch = %d, nbuckets = %d\n",
@@ -346,6 +532,40 @@ ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
 												"HashBatchContext",
 												ALLOCSET_DEFAULT_SIZES);
 
+	if (pstate != NULL)
+	{
+		Barrier    *build_barrier = &pstate->build_barrier;
+
+		/*
+		 * Attach to the build of the shared hash table.  If it hasn't begun
+		 * yet, one participant sets up the initial batches while the others
+		 * wait; see ParallelHashJoinState in hashjoin.h.  Our batch file
+		 * arrays are allocated once we adopt the shared number of batches.
+		 */
+		switch (BarrierAttach(build_barrier))
+		{
+			case PHJ_BUILD_ELECTING:
+				if (BarrierArriveAndWait(build_barrier, WAIT_EVENT_HASH_BUILD))
+				{
+					pstate->nbuckets = nbuckets;
+					ExecParallelHashSetUpBatches(hashtable, nbatch);
+				}
+				/* FALL THRU */
+
+			case PHJ_BUILD_ALLOCATING:
+				BarrierArriveAndWait(build_barrier, WAIT_EVENT_HASH_BUILD);
+				break;
+
+			default:
+				break;
+		}
+
+		hashtable->nbatch = 0;
+		ExecParallelHashAdoptShape(hashtable);
+
+		return hashtable;
+	}
+
 	/* Allocate data that will live for the life of the hashjoin */
 
 	oldcxt = MemoryContextSwitchTo(hashtable->hashCxt);
@@ -364,13 +584,15 @@ ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
 		PrepareTempTablespaces();
 	}
 
+	MemoryContextSwitchTo(oldcxt);
+
 	/*
 	 * Prepare context for the first-scan space allocations; allocate the
 	 * hashbucket array therein, and set each bucket "empty".
 	 */
-	MemoryContextSwitchTo(hashtable->batchCxt);
+	oldcxt = MemoryContextSwitchTo(hashtable->batchCxt);
 
-	hashtable->buckets = (HashJoinTuple *)
+	hashtable->buckets.unshared = (HashJoinTuple *)
 		palloc0(nbuckets * sizeof(HashJoinTuple));
 
 	/*
@@ -398,6 +620,7 @@ ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
 
 void
 ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
+						int parallel_workers,
 						int *numbuckets,
 						int *numbatches,
 						int *num_skew_mcvs)
@@ -405,6 +628,7 @@ ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 	int			tupsize;
 	double		inner_rel_bytes;
 	long		bucket_bytes;
+	long		space_allowed;
 	long		hash_table_bytes;
 	long		skew_table_bytes;
 	long		max_pointers;
@@ -428,9 +652,17 @@ ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 	inner_rel_bytes = ntuples * tupsize;
 
 	/*
-	 * Target in-memory hashtable size is work_mem kilobytes.
+	 * Target in-memory hashtable size is work_mem kilobytes.  A table shared
+	 * by a parallel-aware Hash node is built by the leader and the workers
+	 * together, so it is allowed one work_mem for each of them.
 	 */
-	hash_table_bytes = work_mem * 1024L;
+	space_allowed = work_mem * 1024L;
+	if (parallel_workers > 0)
+	{
+		Assert(!useskew);
+		space_allowed *= parallel_workers + 1;
+	}
+	hash_table_bytes = space_allowed;
 
 	/*
 	 * If skew optimization is possible, estimate the number of skew buckets
@@ -477,7 +709,7 @@ ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 	 * Note that both nbuckets and nbatch must be powers of 2 to make
 	 * ExecHashGetBucketAndBatch fast.
 	 */
-	max_pointers = (work_mem * 1024L) / sizeof(HashJoinTuple);
+	max_pointers = space_allowed / sizeof(HashJoinTuple);
 	max_pointers = Min(max_pointers, MaxAllocSize / sizeof(HashJoinTuple));
 	/* If max_pointers isn't a power of 2, must round it down to one */
 	mppow2 = 1L << my_log2(max_pointers);
@@ -560,17 +792,41 @@ ExecHashTableDestroy(HashJoinTable hashtable)
 {
 	int			i;
 
-	/*
-	 * Make sure all the temp files are closed.  We skip batch 0, since it
-	 * can't have any temp files (and the arrays might not even exist if
-	 * nbatch is only 1).
-	 */
-	for (i = 1; i < hashtable->nbatch; i++)
+	if (hashtable->parallel_state != NULL)
+	{
+		/*
+		 * Close any shared batch files we still have open.  The files
+		 * themselves, like the shared memory of the table, belong to the
+		 * parallel query and are released along with it, or when it is
+		 * reinitialized for a rescan.
+		 */
+		if (hashtable->innerBatchFile != NULL)
+		{
+			for (i = 0; i < hashtable->nbatch; i++)
+			{
+				if (hashtable->innerBatchFile[i])
+					BufFileClose(hashtable->innerBatchFile[i]);
+				if (hashtable->outerBatchFile[i])
+					BufFileClose(hashtable->outerBatchFile[i]);
+			}
+		}
+		if (hashtable->read_file != NULL)
+			BufFileClose(hashtable->read_file);
+	}
+	else
 	{
-		if (hashtable->innerBatchFile[i])
-			BufFileClose(hashtable->innerBatchFile[i]);
-		if (hashtable->outerBatchFile[i])
-			BufFileClose(hashtable->outerBatchFile[i]);
+		/*
+		 * Make sure all the temp files are closed.  We skip batch 0, since
+		 * it can't have any temp files (and the arrays might not even exist
+		 * if nbatch is only 1).
+		 */
+		for (i = 1; i < hashtable->nbatch; i++)
+		{
+			if (hashtable->innerBatchFile[i])
+				BufFileClose(hashtable->innerBatchFile[i]);
+			if (hashtable->outerBatchFile[i])
+				BufFileClose(hashtable->outerBatchFile[i]);
+		}
 	}
 
 	/* Release working memory (batchCxt is a child, so it goes away too) */
@@ -656,7 +912,7 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 		hashtable->nbuckets = hashtable->nbuckets_optimal;
 		hashtable->log2_nbuckets = hashtable->log2_nbuckets_optimal;
 
-		hashtable->buckets = repalloc(hashtable->buckets,
+		hashtable->buckets.unshared = repalloc(hashtable->buckets.unshared,
 								sizeof(HashJoinTuple) * hashtable->nbuckets);
 	}
 
@@ -665,14 +921,15 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 	 * buckets now and not have to keep track which tuples in the buckets have
 	 * already been processed. We will free the old chunks as we go.
 	 */
-	memset(hashtable->buckets, 0, sizeof(HashJoinTuple) * hashtable->nbuckets);
+	memset(hashtable->buckets.unshared, 0,
+		   sizeof(HashJoinTuple) * hashtable->nbuckets);
 	oldchunks = hashtable->chunks;
 	hashtable->chunks = NULL;
 
 	/* so, let's scan through the old chunks, and all tuples in each chunk */
 	while (oldchunks != NULL)
 	{
-		HashMemoryChunk nextchunk = oldchunks->next;
+		HashMemoryChunk nextchunk = oldchunks->next.unshared;
 
 		/* position within the buffer (up to oldchunks->used) */
 		size_t		idx = 0;
@@ -699,8 +956,8 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 				memcpy(copyTuple, hashTuple, hashTupleSize);
 
 				/* and add it back to the appropriate bucket */
-				copyTuple->next = hashtable->buckets[bucketno];
-				hashtable->buckets[bucketno] = copyTuple;
+				copyTuple->next.unshared = hashtable->buckets.unshared[bucketno];
+				hashtable->buckets.unshared[bucketno] = copyTuple;
 			}
 			else
 			{
@@ -781,14 +1038,15 @@ ExecHashIncreaseNumBuckets(HashJoinTable hashtable)
 	 * ExecHashIncreaseNumBatches, but without all the copying into new
 	 * chunks)
 	 */
-	hashtable->buckets =
-		(HashJoinTuple *) repalloc(hashtable->buckets,
+	hashtable->buckets.unshared =
+		(HashJoinTuple *) repalloc(hashtable->buckets.unshared,
 								hashtable->nbuckets * sizeof(HashJoinTuple));
 
-	memset(hashtable->buckets, 0, hashtable->nbuckets * sizeof(HashJoinTuple));
+	memset(hashtable->buckets.unshared, 0,
+		   hashtable->nbuckets * sizeof(HashJoinTuple));
 
 	/* scan through all tuples in all chunks to rebuild the hash table */
-	for (chunk = hashtable->chunks; chunk != NULL; chunk = chunk->next)
+	for (chunk = hashtable->chunks; chunk != NULL; chunk = chunk->next.unshared)
 	{
 		/* process all tuples stored in this chunk */
 		size_t		idx = 0;
@@ -803,8 +1061,8 @@ ExecHashIncreaseNumBuckets(HashJoinTable hashtable)
 									  &bucketno, &batchno);
 
 			/* add the tuple to the proper bucket */
-			hashTuple->next = hashtable->buckets[bucketno];
-			hashtable->buckets[bucketno] = hashTuple;
+			hashTuple->next.unshared = hashtable->buckets.unshared[bucketno];
+			hashtable->buckets.unshared[bucketno] = hashTuple;
 
 			/* advance index past the tuple */
 			idx += MAXALIGN(HJTUPLE_OVERHEAD +
@@ -865,8 +1123,8 @@ ExecHashTableInsert(HashJoinTable hashtable,
 		HeapTupleHeaderClearMatch(HJTUPLE_MINTUPLE(hashTuple));
 
 		/* Push it onto the front of the bucket's list */
-		hashTuple->next = hashtable->buckets[bucketno];
-		hashtable->buckets[bucketno] = hashTuple;
+		hashTuple->next.unshared = hashtable->buckets.unshared[bucketno];
+		hashtable->buckets.unshared[bucketno] = hashTuple;
 
 		/*
 		 * Increase the (optimal) number of buckets if we just exceeded the
@@ -1064,6 +1322,9 @@ ExecScanHashBucket(HashJoinState *hjstate,
 	HashJoinTuple hashTuple = hjstate->hj_CurTuple;
 	uint32		hashvalue = hjstate->hj_CurHashValue;
 
+	if (hashtable->parallel_state != NULL)
+		return ExecParallelScanHashBucket(hjstate, econtext);
+
 	/*
 	 * hj_CurTuple is the address of the tuple last returned from the current
 	 * bucket, or NULL if it's time to start scanning a new bucket.
@@ -1072,11 +1333,11 @@ ExecScanHashBucket(HashJoinState *hjstate,
 	 * otherwise scan the standard hashtable bucket.
 	 */
 	if (hashTuple != NULL)
-		hashTuple = hashTuple->next;
+		hashTuple = hashTuple->next.unshared;
 	else if (hjstate->hj_CurSkewBucketNo != INVALID_SKEW_BUCKET_NO)
 		hashTuple = hashtable->skewBucket[hjstate->hj_CurSkewBucketNo]->tuples;
 	else
-		hashTuple = hashtable->buckets[hjstate->hj_CurBucketNo];
+		hashTuple = hashtable->buckets.unshared[hjstate->hj_CurBucketNo];
 
 	while (hashTuple != NULL)
 	{
@@ -1100,7 +1361,7 @@ ExecScanHashBucket(HashJoinState *hjstate,
 			}
 		}
 
-		hashTuple = hashTuple->next;
+		hashTuple = hashTuple->next.unshared;
 	}
 
 	/*
@@ -1151,10 +1412,10 @@ ExecScanHashTableForUnmatched(HashJoinState *hjstate, ExprContext *econtext)
 		 * bucket.
 		 */
 		if (hashTuple != NULL)
-			hashTuple = hashTuple->next;
+			hashTuple = hashTuple->next.unshared;
 		else if (hjstate->hj_CurBucketNo < hashtable->nbuckets)
 		{
-			hashTuple = hashtable->buckets[hjstate->hj_CurBucketNo];
+			hashTuple = hashtable->buckets.unshared[hjstate->hj_CurBucketNo];
 			hjstate->hj_CurBucketNo++;
 		}
 		else if (hjstate->hj_CurSkewBucketNo < hashtable->nSkewBuckets)
@@ -1190,7 +1451,7 @@ ExecScanHashTableForUnmatched(HashJoinState *hjstate, ExprContext *econtext)
 				return true;
 			}
 
-			hashTuple = hashTuple->next;
+			hashTuple = hashTuple->next.unshared;
 		}
 	}
 
@@ -1219,7 +1480,7 @@ ExecHashTableReset(HashJoinTable hashtable)
 	oldcxt = MemoryContextSwitchTo(hashtable->batchCxt);
 
 	/* Reallocate and reinitialize the hash bucket headers. */
-	hashtable->buckets = (HashJoinTuple *)
+	hashtable->buckets.unshared = (HashJoinTuple *)
 		palloc0(nbuckets * sizeof(HashJoinTuple));
 
 	hashtable->spaceUsed = 0;
@@ -1243,7 +1504,8 @@ ExecHashTableResetMatchFlags(HashJoinTable hashtable)
 	/* Reset all flags in the main table ... */
 	for (i = 0; i < hashtable->nbuckets; i++)
 	{
-		for (tuple = hashtable->buckets[i]; tuple != NULL; tuple = tuple->next)
+		for (tuple = hashtable->buckets.unshared[i]; tuple != NULL;
+			 tuple = tuple->next.unshared)
 			HeapTupleHeaderClearMatch(HJTUPLE_MINTUPLE(tuple));
 	}
 
@@ -1253,7 +1515,8 @@ ExecHashTableResetMatchFlags(HashJoinTable hashtable)
 		int			j = hashtable->skewBucketNums[i];
 		HashSkewBucket *skewBucket = hashtable->skewBucket[j];
 
-		for (tuple = skewBucket->tuples; tuple != NULL; tuple = tuple->next)
+		for (tuple = skewBucket->tuples; tuple != NULL;
+			 tuple = tuple->next.unshared)
 			HeapTupleHeaderClearMatch(HJTUPLE_MINTUPLE(tuple));
 	}
 }
@@ -1505,7 +1768,7 @@ ExecHashSkewTableInsert(HashJoinTable hashtable,
 	HeapTupleHeaderClearMatch(HJTUPLE_MINTUPLE(hashTuple));
 
 	/* Push it onto the front of the skew bucket's list */
-	hashTuple->next = hashtable->skewBucket[bucketNumber]->tuples;
+	hashTuple->next.unshared = hashtable->skewBucket[bucketNumber]->tuples;
 	hashtable->skewBucket[bucketNumber]->tuples = hashTuple;
 
 	/* Account for space used, and back off if we've used too much */
@@ -1554,7 +1817,7 @@ ExecHashRemoveNextSkewBucket(HashJoinTable hashtable)
 	hashTuple = bucket->tuples;
 	while (hashTuple != NULL)
 	{
-		HashJoinTuple nextHashTuple = hashTuple->next;
+		HashJoinTuple nextHashTuple = hashTuple->next.unshared;
 		MinimalTuple tuple;
 		Size		tupleSize;
 
@@ -1580,8 +1843,8 @@ ExecHashRemoveNextSkewBucket(HashJoinTable hashtable)
 			memcpy(copyTuple, hashTuple, tupleSize);
 			pfree(hashTuple);
 
-			copyTuple->next = hashtable->buckets[bucketno];
-			hashtable->buckets[bucketno] = copyTuple;
+			copyTuple->next.unshared = hashtable->buckets.unshared[bucketno];
+			hashtable->buckets.unshared[bucketno] = copyTuple;
 
 			/* We have reduced skew space, but overall space doesn't change */
 			hashtable->spaceUsedSkew -= tupleSize;
@@ -1668,12 +1931,12 @@ dense_alloc(HashJoinTable hashtable, Size size)
 		 */
 		if (hashtable->chunks != NULL)
 		{
-			newChunk->next = hashtable->chunks->next;
-			hashtable->chunks->next = newChunk;
+			newChunk->next.unshared = hashtable->chunks->next.unshared;
+			hashtable->chunks->next.unshared = newChunk;
 		}
 		else
 		{
-			newChunk->next = hashtable->chunks;
+			newChunk->next.unshared = hashtable->chunks;
 			hashtable->chunks = newChunk;
 		}
 
@@ -1698,7 +1961,7 @@ dense_alloc(HashJoinTable hashtable, Size size)
 		newChunk->used = size;
 		newChunk->ntuples = 1;
 
-		newChunk->next = hashtable->chunks;
+		newChunk->next.unshared = hashtable->chunks;
 		hashtable->chunks = newChunk;
 
 		return newChunk->data;
@@ -1712,3 +1975,1143 @@ dense_alloc(HashJoinTable hashtable, Size size)
 	/* return pointer to the start of the tuple memory */
 	return ptr;
 }
+
+/*
+ * Insert a tuple into a shared hash table while it is being built.  Tuples
+ * of batch 0 are copied into chunks of shared memory, and linked into their
+ * buckets once all participants have finished and the number of buckets is
+ * known.  Tuples of later batches are written to our own batch file.
+ */
+static void
+ExecParallelHashTableInsert(HashJoinTable hashtable,
+							TupleTableSlot *slot,
+							uint32 hashvalue)
+{
+	MinimalTuple tuple = ExecFetchSlotMinimalTuple(slot);
+	dsa_pointer shared;
+	int			bucketno;
+	int			batchno;
+
+retry:
+	ExecHashGetBucketAndBatch(hashtable, hashvalue, &bucketno, &batchno);
+
+	if (batchno == 0)
+	{
+		HashJoinTuple hashTuple;
+
+		/* Try to load it into memory. */
+		Assert(BarrierPhase(&hashtable->parallel_state->build_barrier) ==
+			   PHJ_BUILD_HASHING_INNER);
+		hashTuple = ExecParallelHashTupleAlloc(hashtable,
+											   HJTUPLE_OVERHEAD + tuple->t_len,
+											   &shared, true);
+		if (hashTuple == NULL)
+		{
+			/* The number of batches has grown; the tuple may have moved. */
+			goto retry;
+		}
+
+		hashTuple->hashvalue = hashvalue;
+		memcpy(HJTUPLE_MINTUPLE(hashTuple), tuple, tuple->t_len);
+
+		/*
+		 * We always reset the tuple-matched flag on insertion.
+		 * Parallel-aware hash joins don't support right or full joins, so it
+		 * will never be examined, but keep it consistent with the private
+		 * case.
+		 */
+		HeapTupleHeaderClearMatch(HJTUPLE_MINTUPLE(hashTuple));
+	}
+	else
+	{
+		/* Not in memory; write it to our file for its batch. */
+		ExecParallelHashSaveTuple(hashtable, true, batchno, tuple, hashvalue);
+	}
+}
+
+/*
+ * ExecParallelHashTableInsertCurrentBatch
+ *		insert a tuple into the current batch of a shared hash table, while
+ *		loading a batch other than batch 0.  The buckets have already been
+ *		allocated, so the tuple is linked into its bucket right away.
+ */
+void
+ExecParallelHashTableInsertCurrentBatch(HashJoinTable hashtable,
+										TupleTableSlot *slot,
+										uint32 hashvalue)
+{
+	MinimalTuple tuple = ExecFetchSlotMinimalTuple(slot);
+	HashJoinTuple hashTuple;
+	dsa_pointer shared;
+	int			bucketno;
+	int			batchno;
+
+	ExecHashGetBucketAndBatch(hashtable, hashvalue, &bucketno, &batchno);
+	Assert(batchno == hashtable->curbatch);
+
+	hashTuple = ExecParallelHashTupleAlloc(hashtable,
+										   HJTUPLE_OVERHEAD + tuple->t_len,
+										   &shared, false);
+	hashTuple->hashvalue = hashvalue;
+	memcpy(HJTUPLE_MINTUPLE(hashTuple), tuple, tuple->t_len);
+	HeapTupleHeaderClearMatch(HJTUPLE_MINTUPLE(hashTuple));
+	ExecParallelHashPushTuple(&hashtable->buckets.shared[bucketno],
+							  hashTuple, shared);
+}
+
+/*
+ * Allocate space for a tuple in the current batch of a shared hash table, in
+ * the same dense chunked format that dense_alloc uses for private hash
+ * tables.  The dsa_pointer of the space is returned in *shared.
+ *
+ * Each participant fills its own current chunk, so no locking is required
+ * except when a new chunk has to be pushed onto the batch's list of chunks.
+ * Tuples larger than HASH_CHUNK_THRESHOLD get a chunk of their own.
+ *
+ * If may_grow is true, a new chunk that would take the batch beyond
+ * space_allowed instead makes us help to increase the number of batches,
+ * and NULL is returned; the caller must then work out which batch the tuple
+ * belongs to now.  Only batch 0 can grow, and only while it is being built.
+ */
+static void *
+ExecParallelHashTupleAlloc(HashJoinTable hashtable, Size size,
+						   dsa_pointer *shared, bool may_grow)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	ParallelHashJoinBatch *batch = &hashtable->batches[hashtable->curbatch];
+	HashMemoryChunk chunk = hashtable->current_chunk;
+	dsa_pointer chunk_shared;
+	Size		chunk_size;
+	char	   *result;
+
+	/* just in case the size is not already aligned properly */
+	size = MAXALIGN(size);
+
+	/* Is there enough space left in our current chunk? */
+	if (chunk != NULL && size <= HASH_CHUNK_THRESHOLD &&
+		chunk->maxlen - chunk->used >= size)
+	{
+		result = chunk->data + chunk->used;
+		*shared = hashtable->current_chunk_shared + HASH_CHUNK_HEADER_SIZE +
+			chunk->used;
+		chunk->used += size;
+		chunk->ntuples += 1;
+		return result;
+	}
+
+	/* No; we need a new chunk.  Oversized tuples get a chunk of their own. */
+	if (size > HASH_CHUNK_THRESHOLD)
+		chunk_size = size;
+	else
+	{
+		chunk_size = HASH_CHUNK_SIZE;
+		ExecParallelHashRetireChunk(hashtable);
+	}
+
+	SpinLockAcquire(&pstate->mutex);
+	if (may_grow)
+	{
+		/*
+		 * Check whether the batch, with its buckets, would still fit.  We
+		 * always allow it one chunk, since no number of batches can make a
+		 * batch smaller than a single tuple.
+		 */
+		if (pstate->growth == PHJ_GROWTH_OK && batch->size > 0 &&
+			batch->size + HASH_CHUNK_HEADER_SIZE + chunk_size +
+			ExecParallelHashBucketBytes(pstate, batch) > pstate->space_allowed)
+		{
+			if (pstate->nbatch > Min(INT_MAX / 2,
+									 MaxAllocSize / (sizeof(void *) * 2)))
+				pstate->growth = PHJ_GROWTH_DISABLED;
+			else
+				pstate->growth = PHJ_GROWTH_NEED_MORE_BATCHES;
+		}
+
+		if (pstate->growth == PHJ_GROWTH_NEED_MORE_BATCHES)
+		{
+			SpinLockRelease(&pstate->mutex);
+			ExecParallelHashIncreaseNumBatches(hashtable);
+			return NULL;
+		}
+	}
+	batch->size += HASH_CHUNK_HEADER_SIZE + chunk_size;
+	SpinLockRelease(&pstate->mutex);
+
+	/* Allocate it and make it visible to everyone. */
+	chunk_shared = dsa_allocate(hashtable->area,
+								HASH_CHUNK_HEADER_SIZE + chunk_size);
+	chunk = (HashMemoryChunk) dsa_get_address(hashtable->area, chunk_shared);
+	chunk->maxlen = chunk_size;
+	chunk->used = size;
+	chunk->ntuples = 1;
+
+	SpinLockAcquire(&pstate->mutex);
+	chunk->next.shared = batch->chunks;
+	batch->chunks = chunk_shared;
+	if (size > HASH_CHUNK_THRESHOLD)
+		batch->ntuples += 1;
+	SpinLockRelease(&pstate->mutex);
+
+	/*
+	 * An oversized chunk is full as soon as it is created, so we counted its
+	 * tuple already; keep filling the current one so that we don't waste its
+	 * remaining space.
+	 */
+	if (size <= HASH_CHUNK_THRESHOLD)
+	{
+		hashtable->current_chunk = chunk;
+		hashtable->current_chunk_shared = chunk_shared;
+	}
+
+	*shared = chunk_shared + HASH_CHUNK_HEADER_SIZE;
+	return chunk->data;
+}
+
+/*
+ * Stop filling our current chunk, adding its tuples to the count for the
+ * current batch.
+ */
+static void
+ExecParallelHashRetireChunk(HashJoinTable hashtable)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	HashMemoryChunk chunk = hashtable->current_chunk;
+
+	if (chunk == NULL)
+		return;
+
+	SpinLockAcquire(&pstate->mutex);
+	hashtable->batches[hashtable->curbatch].ntuples += chunk->ntuples;
+	SpinLockRelease(&pstate->mutex);
+
+	hashtable->current_chunk = NULL;
+	hashtable->current_chunk_shared = InvalidDsaPointer;
+}
+
+/*
+ * Push a tuple onto the front of a shared bucket with a compare-and-swap
+ * loop, so that several participants can insert tuples concurrently.
+ */
+static inline void
+ExecParallelHashPushTuple(dsa_pointer_atomic *head,
+						  HashJoinTuple tuple,
+						  dsa_pointer tuple_shared)
+{
+	tuple->next.shared = dsa_pointer_atomic_read(head);
+	while (!dsa_pointer_atomic_compare_exchange(head,
+												&tuple->next.shared,
+												tuple_shared))
+		;
+}
+
+/*
+ * Choose the number of buckets for a shared batch holding ntuples tuples.
+ */
+static int
+ExecParallelHashChooseNumBuckets(double ntuples)
+{
+	double		dbuckets;
+	int			nbuckets;
+
+	dbuckets = ceil(ntuples / NTUP_PER_BUCKET);
+	dbuckets = Min(dbuckets, MaxAllocHugeSize / sizeof(dsa_pointer_atomic));
+	dbuckets = Min(dbuckets, INT_MAX / 2);
+	nbuckets = Max((int) dbuckets, 1024);
+
+	return 1 << my_log2(nbuckets);
+}
+
+/*
+ * Estimate the memory that the buckets of a batch will take, for comparison
+ * with space_allowed.  The caller must hold the mutex.
+ */
+static Size
+ExecParallelHashBucketBytes(ParallelHashJoinState *pstate,
+							ParallelHashJoinBatch *batch)
+{
+	int			nbuckets;
+
+	/* Once there is more than one batch, the number of buckets is fixed. */
+	if (pstate->nbatch > 1)
+		nbuckets = pstate->nbuckets;
+	else
+		nbuckets = ExecParallelHashChooseNumBuckets(batch->ntuples);
+
+	return nbuckets * sizeof(dsa_pointer_atomic);
+}
+
+/*
+ * ExecParallelHashIncreaseNumBatches
+ *		double the number of batches of a shared hash table, together with
+ *		all other participants that are reading inner tuples
+ *
+ * This is entered either by a participant that found that batch 0 no longer
+ * fits, or by one that attached to grow_batches_barrier while a growth was
+ * under way.  See ParallelHashJoinState in hashjoin.h for the phases.
+ */
+static void
+ExecParallelHashIncreaseNumBatches(HashJoinTable hashtable)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	Barrier    *grow_barrier = &pstate->grow_batches_barrier;
+	bool		elected = false;
+
+	switch (PHJ_GROW_BATCHES_PHASE(BarrierPhase(grow_barrier)))
+	{
+		case PHJ_GROW_BATCHES_ELECTING:
+
+			/*
+			 * Make our last chunk and our batch files available to whoever
+			 * repartitions them, then wait for everyone else to do the same.
+			 */
+			ExecParallelHashRetireChunk(hashtable);
+			ExecParallelHashCloseBatchFiles(hashtable, true);
+			if (BarrierArriveAndWait(grow_barrier,
+									 WAIT_EVENT_HASH_GROW_BATCHES))
+				ExecParallelHashSetUpGrowth(hashtable);
+			/* FALL THRU */
+
+		case PHJ_GROW_BATCHES_ALLOCATING:
+			/* Wait for the new batches to be set up. */
+			BarrierArriveAndWait(grow_barrier, WAIT_EVENT_HASH_GROW_BATCHES);
+			/* FALL THRU */
+
+		case PHJ_GROW_BATCHES_REPARTITIONING:
+
+			/*
+			 * Move the tuples of the old batches to the new ones.  The new
+			 * batch files we write stay open, since we'll keep adding to
+			 * them once we go back to reading inner tuples.
+			 */
+			ExecParallelHashAdoptShape(hashtable);
+			ExecParallelHashRepartitionFirst(hashtable);
+			ExecParallelHashRepartitionRest(hashtable);
+			ExecParallelHashRetireChunk(hashtable);
+			elected = BarrierArriveAndWait(grow_barrier,
+										   WAIT_EVENT_HASH_GROW_BATCHES);
+			/* FALL THRU */
+
+		case PHJ_GROW_BATCHES_DECIDING:
+
+			/*
+			 * If repartitioning moved none of the tuples of batch 0, or all
+			 * of them, then their hash values are all the same as far as the
+			 * batch number goes, and doubling the number of batches again
+			 * would be futile.
+			 */
+			if (elected)
+			{
+				SpinLockAcquire(&pstate->mutex);
+				if (pstate->nfreed == 0 || pstate->nfreed == pstate->ninmemory)
+					pstate->growth = PHJ_GROWTH_DISABLED;
+				else
+					pstate->growth = PHJ_GROWTH_OK;
+				SpinLockRelease(&pstate->mutex);
+			}
+			BarrierArriveAndWait(grow_barrier, WAIT_EVENT_HASH_GROW_BATCHES);
+			break;
+	}
+
+	ExecParallelHashAdoptShape(hashtable);
+}
+
+/*
+ * Set up twice as many batches as before, and make the chunks of the old
+ * batch 0 available for repartitioning.  This is done by one participant
+ * while the others wait.
+ */
+static void
+ExecParallelHashSetUpGrowth(HashJoinTable hashtable)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	ParallelHashJoinBatch *old_batch0;
+	dsa_pointer old_batches;
+	int			old_nbatch;
+
+	SpinLockAcquire(&pstate->mutex);
+	old_batches = pstate->batches;
+	old_nbatch = pstate->nbatch;
+	SpinLockRelease(&pstate->mutex);
+
+	old_batch0 = (ParallelHashJoinBatch *)
+		dsa_get_address(hashtable->area, old_batches);
+
+	SpinLockAcquire(&pstate->mutex);
+
+	/*
+	 * The bucket number is taken from the low bits of the hash value and the
+	 * batch number from the bits above them, so the number of buckets can't
+	 * change once there is more than one batch.  Make it big enough for the
+	 * tuples that batch 0 holds now, like ExecHashIncreaseNumBatches does for
+	 * a private table.
+	 */
+	if (old_nbatch == 1)
+		pstate->nbuckets =
+			Max(pstate->nbuckets,
+				ExecParallelHashChooseNumBuckets(old_batch0->ntuples));
+
+	pstate->old_chunks = old_batch0->chunks;
+	pstate->old_nbatch = old_nbatch;
+	pstate->ninmemory = 0;
+	pstate->nfreed = 0;
+	SpinLockRelease(&pstate->mutex);
+
+	pg_atomic_write_u32(&pstate->distributor, 0);
+
+	ExecParallelHashSetUpBatches(hashtable, old_nbatch * 2);
+	dsa_free(hashtable->area, old_batches);
+}
+
+/*
+ * Allocate and initialize the shared state of nbatch batches, replacing any
+ * that exist already.  Batch 0 is loaded while the table is built, so its
+ * barrier is moved straight on to PHJ_BATCH_PROBING.
+ */
+static void
+ExecParallelHashSetUpBatches(HashJoinTable hashtable, int nbatch)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	ParallelHashJoinBatch *batches;
+	dsa_pointer batches_shared;
+	int			i;
+
+	batches_shared = dsa_allocate_extended(hashtable->area,
+										   nbatch * sizeof(ParallelHashJoinBatch),
+										   DSA_ALLOC_HUGE);
+	batches = (ParallelHashJoinBatch *)
+		dsa_get_address(hashtable->area, batches_shared);
+
+	for (i = 0; i < nbatch; ++i)
+	{
+		ParallelHashJoinBatch *batch = &batches[i];
+
+		BarrierInit(&batch->batch_barrier, 0);
+		batch->buckets = InvalidDsaPointer;
+		batch->chunks = InvalidDsaPointer;
+		batch->inserted_chunks = InvalidDsaPointer;
+		batch->size = 0;
+		batch->ntuples = 0;
+		pg_atomic_init_u32(&batch->next_inner_file, 0);
+		pg_atomic_init_u32(&batch->next_outer_file, 0);
+	}
+
+	BarrierAttach(&batches[0].batch_barrier);
+	while (BarrierPhase(&batches[0].batch_barrier) < PHJ_BATCH_PROBING)
+		BarrierArriveAndWait(&batches[0].batch_barrier, 0);
+	BarrierDetach(&batches[0].batch_barrier);
+
+	SpinLockAcquire(&pstate->mutex);
+	pstate->batches = batches_shared;
+	pstate->nbatch = nbatch;
+	SpinLockRelease(&pstate->mutex);
+}
+
+/*
+ * Move the tuples of the old batch 0 to their new batches, taking one chunk
+ * at a time from the shared list of old chunks.
+ */
+static void
+ExecParallelHashRepartitionFirst(HashJoinTable hashtable)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	long		ninmemory = 0;
+	long		nfreed = 0;
+
+	for (;;)
+	{
+		dsa_pointer chunk_shared;
+		HashMemoryChunk chunk;
+		size_t		idx;
+
+		/* Take the next old chunk. */
+		SpinLockAcquire(&pstate->mutex);
+		chunk_shared = pstate->old_chunks;
+		if (DsaPointerIsValid(chunk_shared))
+		{
+			chunk = (HashMemoryChunk) dsa_get_address(hashtable->area,
+													  chunk_shared);
+			pstate->old_chunks = chunk->next.shared;
+		}
+		SpinLockRelease(&pstate->mutex);
+
+		if (!DsaPointerIsValid(chunk_shared))
+			break;
+
+		idx = 0;
+		while (idx < chunk->used)
+		{
+			HashJoinTuple hashTuple = (HashJoinTuple) (chunk->data + idx);
+			MinimalTuple tuple = HJTUPLE_MINTUPLE(hashTuple);
+			int			bucketno;
+			int			batchno;
+
+			CHECK_FOR_INTERRUPTS();
+
+			ExecHashGetBucketAndBatch(hashtable, hashTuple->hashvalue,
+									  &bucketno, &batchno);
+			if (batchno == 0)
+			{
+				HashJoinTuple copyTuple;
+				dsa_pointer shared;
+
+				/* It still belongs in batch 0; copy it to a new chunk. */
+				copyTuple = ExecParallelHashTupleAlloc(hashtable,
+													   HJTUPLE_OVERHEAD + tuple->t_len,
+													   &shared, false);
+				copyTuple->hashvalue = hashTuple->hashvalue;
+				memcpy(HJTUPLE_MINTUPLE(copyTuple), tuple, tuple->t_len);
+			}
+			else
+			{
+				/* It belongs in a later batch now. */
+				ExecParallelHashSaveTuple(hashtable, true, batchno,
+										  tuple, hashTuple->hashvalue);
+				nfreed++;
+			}
+			ninmemory++;
+
+			idx += MAXALIGN(HJTUPLE_OVERHEAD + tuple->t_len);
+		}
+
+		dsa_free(hashtable->area, chunk_shared);
+	}
+
+	SpinLockAcquire(&pstate->mutex);
+	pstate->ninmemory += ninmemory;
+	pstate->nfreed += nfreed;
+	SpinLockRelease(&pstate->mutex);
+}
+
+/*
+ * Move the tuples in the batch files of the old batches other than 0 to the
+ * files of their new batches.  Each participant wrote one file per batch, and
+ * the files are handed out one at a time.
+ */
+static void
+ExecParallelHashRepartitionRest(HashJoinTable hashtable)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	int			nparticipants = pstate->nparticipants;
+	int			old_nbatch;
+	uint32		item;
+
+	SpinLockAcquire(&pstate->mutex);
+	old_nbatch = pstate->old_nbatch;
+	SpinLockRelease(&pstate->mutex);
+
+	while ((item = pg_atomic_fetch_add_u32(&pstate->distributor, 1)) <
+		   (uint32) ((old_nbatch - 1) * nparticipants))
+	{
+		int			old_batchno = 1 + item / nparticipants;
+		int			participant = item % nparticipants;
+		char		name[MAXPGPATH];
+		BufFile    *file;
+		MinimalTuple tuple;
+		uint32		hashvalue;
+
+		ExecParallelHashFileName(name, true, old_nbatch, old_batchno,
+								 participant);
+		file = BufFileOpenShared(&pstate->fileset, name);
+		if (file == NULL)
+			continue;
+
+		while ((tuple = ExecParallelHashReadTuple(file, &hashvalue)) != NULL)
+		{
+			int			bucketno;
+			int			batchno;
+
+			ExecHashGetBucketAndBatch(hashtable, hashvalue,
+									  &bucketno, &batchno);
+			Assert(batchno > 0);
+			ExecParallelHashSaveTuple(hashtable, true, batchno,
+									  tuple, hashvalue);
+			pfree(tuple);
+		}
+
+		BufFileClose(file);
+		BufFileDeleteShared(&pstate->fileset, name);
+	}
+}
+
+/*
+ * Read the next tuple from a shared batch file, in the format written by
+ * ExecHashJoinSaveTuple.  Returns a palloc'd tuple, or NULL at end of file.
+ */
+static MinimalTuple
+ExecParallelHashReadTuple(BufFile *file, uint32 *hashvalue)
+{
+	uint32		header[2];
+	size_t		nread;
+	MinimalTuple tuple;
+
+	CHECK_FOR_INTERRUPTS();
+
+	nread = BufFileRead(file, (void *) header, sizeof(header));
+	if (nread == 0)
+		return NULL;
+	if (nread != sizeof(header))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from hash-join temporary file: %m")));
+	*hashvalue = header[0];
+	tuple = (MinimalTuple) palloc(header[1]);
+	tuple->t_len = header[1];
+	nread = BufFileRead(file,
+						(void *) ((char *) tuple + sizeof(uint32)),
+						header[1] - sizeof(uint32));
+	if (nread != header[1] - sizeof(uint32))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from hash-join temporary file: %m")));
+
+	return tuple;
+}
+
+/*
+ * Build the name of a shared batch file.  Inner batch files are named after
+ * the number of batches they were written for, since they are repartitioned
+ * whenever that number grows; outer batch files are only written once it is
+ * final.
+ */
+static void
+ExecParallelHashFileName(char *name, bool inner, int nbatch, int batchno,
+						 int participant)
+{
+	if (inner)
+		snprintf(name, MAXPGPATH, "i%d.%d.%d", nbatch, batchno, participant);
+	else
+		snprintf(name, MAXPGPATH, "o%d.%d", batchno, participant);
+}
+
+/*
+ * ExecParallelHashSaveTuple
+ *		write a tuple to our own shared inner or outer file for a batch,
+ *		creating the file if need be
+ */
+void
+ExecParallelHashSaveTuple(HashJoinTable hashtable, bool inner, int batchno,
+						  MinimalTuple tuple, uint32 hashvalue)
+{
+	BufFile   **files = inner ? hashtable->innerBatchFile :
+	hashtable->outerBatchFile;
+
+	if (files[batchno] == NULL)
+	{
+		char		name[MAXPGPATH];
+
+		ExecParallelHashFileName(name, inner, hashtable->nbatch, batchno,
+								 hashtable->participant);
+		files[batchno] =
+			BufFileCreateShared(&hashtable->parallel_state->fileset, name);
+	}
+
+	ExecHashJoinSaveTuple(tuple, hashvalue, &files[batchno]);
+}
+
+/*
+ * ExecParallelHashCloseBatchFiles
+ *		close our shared inner or outer batch files, so that other
+ *		participants can read them
+ */
+void
+ExecParallelHashCloseBatchFiles(HashJoinTable hashtable, bool inner)
+{
+	BufFile   **files = inner ? hashtable->innerBatchFile :
+	hashtable->outerBatchFile;
+	int			i;
+
+	for (i = 0; i < hashtable->nbatch; ++i)
+	{
+		if (files[i] != NULL)
+		{
+			BufFileClose(files[i]);
+			files[i] = NULL;
+		}
+	}
+}
+
+/*
+ * ExecParallelHashNextBatchFile
+ *		claim the next shared inner or outer file of the current batch for
+ *		reading, after deleting the one we read last
+ *
+ * Returns NULL once every file of the batch has been claimed.  Each file is
+ * read by exactly one participant, so it can be deleted once read.
+ */
+BufFile *
+ExecParallelHashNextBatchFile(HashJoinTable hashtable, bool inner)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	ParallelHashJoinBatch *batch = &hashtable->batches[hashtable->curbatch];
+	pg_atomic_uint32 *next_file;
+	char		name[MAXPGPATH];
+
+	if (hashtable->read_file != NULL)
+	{
+		BufFileClose(hashtable->read_file);
+		hashtable->read_file = NULL;
+		ExecParallelHashFileName(name, inner, hashtable->nbatch,
+								 hashtable->curbatch,
+								 hashtable->read_participant);
+		BufFileDeleteShared(&pstate->fileset, name);
+	}
+
+	next_file = inner ? &batch->next_inner_file : &batch->next_outer_file;
+	for (;;)
+	{
+		uint32		participant = pg_atomic_fetch_add_u32(next_file, 1);
+
+		if (participant >= (uint32) pstate->nparticipants)
+			return NULL;
+
+		/* Participants that had no tuples for this batch wrote no file. */
+		ExecParallelHashFileName(name, inner, hashtable->nbatch,
+								 hashtable->curbatch, participant);
+		hashtable->read_file = BufFileOpenShared(&pstate->fileset, name);
+		if (hashtable->read_file != NULL)
+		{
+			hashtable->read_participant = participant;
+			return hashtable->read_file;
+		}
+	}
+}
+
+/*
+ * Make our backend-local view of a shared hash table match the current
+ * number of batches and buckets.  Our batch file arrays are replaced if the
+ * number of batches has changed; their files must all be closed by then.
+ */
+static void
+ExecParallelHashAdoptShape(HashJoinTable hashtable)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	dsa_pointer batches_shared;
+	int			nbatch;
+	int			nbuckets;
+
+	SpinLockAcquire(&pstate->mutex);
+	batches_shared = pstate->batches;
+	nbatch = pstate->nbatch;
+	nbuckets = pstate->nbuckets;
+	SpinLockRelease(&pstate->mutex);
+
+	hashtable->batches = (ParallelHashJoinBatch *)
+		dsa_get_address(hashtable->area, batches_shared);
+	hashtable->nbuckets = nbuckets;
+	hashtable->log2_nbuckets = my_log2(nbuckets);
+	hashtable->nbuckets_optimal = nbuckets;
+	hashtable->log2_nbuckets_optimal = hashtable->log2_nbuckets;
+
+	if (nbatch != hashtable->nbatch)
+	{
+		MemoryContext oldcxt = MemoryContextSwitchTo(hashtable->hashCxt);
+
+		if (hashtable->innerBatchFile != NULL)
+		{
+			pfree(hashtable->innerBatchFile);
+			pfree(hashtable->outerBatchFile);
+		}
+		hashtable->innerBatchFile = (BufFile **)
+			palloc0(nbatch * sizeof(BufFile *));
+		hashtable->outerBatchFile = (BufFile **)
+			palloc0(nbatch * sizeof(BufFile *));
+		hashtable->nbatch = nbatch;
+
+		MemoryContextSwitchTo(oldcxt);
+	}
+}
+
+/*
+ * Allocate the buckets of a batch, and set them all to empty.  The caller
+ * must be the only participant working on the batch.
+ */
+static void
+ExecParallelHashAllocBuckets(HashJoinTable hashtable,
+							 ParallelHashJoinBatch *batch, int nbuckets)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	dsa_pointer_atomic *buckets;
+	int			i;
+
+	batch->buckets = dsa_allocate_extended(hashtable->area,
+										   nbuckets * sizeof(dsa_pointer_atomic),
+										   DSA_ALLOC_HUGE);
+	buckets = (dsa_pointer_atomic *)
+		dsa_get_address(hashtable->area, batch->buckets);
+	for (i = 0; i < nbuckets; ++i)
+		dsa_pointer_atomic_init(&buckets[i], InvalidDsaPointer);
+
+	SpinLockAcquire(&pstate->mutex);
+	batch->size += nbuckets * sizeof(dsa_pointer_atomic);
+	SpinLockRelease(&pstate->mutex);
+}
+
+/*
+ * Once all inner tuples have been read, stop any further growth, choose the
+ * number of buckets if there is still only one batch, and allocate the
+ * buckets of batch 0.  This is done by one participant while the others
+ * wait.
+ */
+static void
+ExecParallelHashSizeFirstBatch(HashJoinTable hashtable)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	ParallelHashJoinBatch *batch0;
+	dsa_pointer batches_shared;
+	int			nbuckets;
+
+	SpinLockAcquire(&pstate->mutex);
+	pstate->growth = PHJ_GROWTH_DISABLED;
+	batches_shared = pstate->batches;
+	SpinLockRelease(&pstate->mutex);
+
+	batch0 = (ParallelHashJoinBatch *)
+		dsa_get_address(hashtable->area, batches_shared);
+
+	SpinLockAcquire(&pstate->mutex);
+	if (pstate->nbatch == 1)
+		pstate->nbuckets = ExecParallelHashChooseNumBuckets(batch0->ntuples);
+	nbuckets = pstate->nbuckets;
+	SpinLockRelease(&pstate->mutex);
+
+	ExecParallelHashAllocBuckets(hashtable, batch0, nbuckets);
+
+	/* Let participants start their search for batches at different places. */
+	pg_atomic_write_u32(&pstate->distributor, 0);
+}
+
+/*
+ * Link the tuples of batch 0 into its buckets.  All attached participants
+ * take chunks from the batch's list until it is empty, moving each chunk to
+ * the list of inserted chunks.
+ */
+static void
+ExecParallelHashInsertChunks(HashJoinTable hashtable)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	ParallelHashJoinBatch *batch = &hashtable->batches[0];
+
+	ExecParallelHashTableSetCurrentBatch(hashtable, 0);
+
+	for (;;)
+	{
+		dsa_pointer chunk_shared;
+		HashMemoryChunk chunk;
+		size_t		idx;
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* Take the next chunk, moving it to the list of inserted chunks. */
+		SpinLockAcquire(&pstate->mutex);
+		chunk_shared = batch->chunks;
+		if (DsaPointerIsValid(chunk_shared))
+		{
+			chunk = (HashMemoryChunk) dsa_get_address(hashtable->area,
+													  chunk_shared);
+			batch->chunks = chunk->next.shared;
+			chunk->next.shared = batch->inserted_chunks;
+			batch->inserted_chunks = chunk_shared;
+		}
+		SpinLockRelease(&pstate->mutex);
+
+		if (!DsaPointerIsValid(chunk_shared))
+			break;
+
+		idx = 0;
+		while (idx < chunk->used)
+		{
+			HashJoinTuple hashTuple = (HashJoinTuple) (chunk->data + idx);
+			int			bucketno;
+			int			batchno;
+
+			ExecHashGetBucketAndBatch(hashtable, hashTuple->hashvalue,
+									  &bucketno, &batchno);
+			Assert(batchno == 0);
+			ExecParallelHashPushTuple(&hashtable->buckets.shared[bucketno],
+									  hashTuple,
+									  chunk_shared + HASH_CHUNK_HEADER_SIZE + idx);
+
+			idx += MAXALIGN(HJTUPLE_OVERHEAD +
+							HJTUPLE_MINTUPLE(hashTuple)->t_len);
+		}
+	}
+}
+
+/*
+ * Free a list of chunks of a shared hash table.
+ */
+static void
+ExecParallelHashFreeChunks(dsa_area *area, dsa_pointer chunk_shared)
+{
+	while (DsaPointerIsValid(chunk_shared))
+	{
+		HashMemoryChunk chunk;
+		dsa_pointer next;
+
+		chunk = (HashMemoryChunk) dsa_get_address(area, chunk_shared);
+		next = chunk->next.shared;
+		dsa_free(area, chunk_shared);
+		chunk_shared = next;
+	}
+}
+
+/*
+ * Free the tuples and buckets of a shared batch.
+ */
+static void
+ExecParallelHashFreeBatch(dsa_area *area, ParallelHashJoinBatch *batch)
+{
+	ExecParallelHashFreeChunks(area, batch->chunks);
+	ExecParallelHashFreeChunks(area, batch->inserted_chunks);
+	if (DsaPointerIsValid(batch->buckets))
+		dsa_free(area, batch->buckets);
+	batch->chunks = InvalidDsaPointer;
+	batch->inserted_chunks = InvalidDsaPointer;
+	batch->buckets = InvalidDsaPointer;
+	batch->size = 0;
+}
+
+/*
+ * ExecParallelHashTableAllocBatch
+ *		allocate the buckets of a batch other than 0, before it is loaded.
+ *		Called by the participant elected to do so.
+ */
+void
+ExecParallelHashTableAllocBatch(HashJoinTable hashtable, int batchno)
+{
+	ExecParallelHashAllocBuckets(hashtable, &hashtable->batches[batchno],
+								 hashtable->nbuckets);
+}
+
+/*
+ * ExecParallelHashTableSetCurrentBatch
+ *		make a shared batch the one we load or probe
+ */
+void
+ExecParallelHashTableSetCurrentBatch(HashJoinTable hashtable, int batchno)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	ParallelHashJoinBatch *batch = &hashtable->batches[batchno];
+
+	hashtable->curbatch = batchno;
+	hashtable->buckets.shared = (dsa_pointer_atomic *)
+		dsa_get_address(hashtable->area, batch->buckets);
+	hashtable->current_chunk = NULL;
+	hashtable->current_chunk_shared = InvalidDsaPointer;
+
+	SpinLockAcquire(&pstate->mutex);
+	hashtable->spaceUsed = batch->size;
+	SpinLockRelease(&pstate->mutex);
+	hashtable->spacePeak = Max(hashtable->spacePeak, hashtable->spaceUsed);
+}
+
+/*
+ * ExecParallelHashTableDetachBatch
+ *		stop working on the current batch, once we have probed it with all
+ *		the outer tuples we could get
+ *
+ * We don't wait for the other participants to finish probing; the last one
+ * to detach frees the memory of the batch.
+ */
+void
+ExecParallelHashTableDetachBatch(HashJoinTable hashtable)
+{
+	int			curbatch = hashtable->curbatch;
+	ParallelHashJoinBatch *batch;
+
+	if (curbatch < 0)
+		return;
+
+	batch = &hashtable->batches[curbatch];
+	hashtable->batch_done[curbatch] = true;
+	hashtable->curbatch = -1;
+	hashtable->current_chunk = NULL;
+	hashtable->current_chunk_shared = InvalidDsaPointer;
+
+	if (BarrierArriveAndDetach(&batch->batch_barrier))
+		ExecParallelHashFreeBatch(hashtable->area, batch);
+}
+
+/*
+ * ExecParallelScanHashBucket
+ *		scan a bucket of a shared hash table for matches to the current
+ *		outer tuple; see ExecScanHashBucket.
+ */
+static bool
+ExecParallelScanHashBucket(HashJoinState *hjstate,
+						   ExprContext *econtext)
+{
+	ExprState  *hjclauses = hjstate->hashclauses;
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	HashJoinTuple hashTuple = hjstate->hj_CurTuple;
+	uint32		hashvalue = hjstate->hj_CurHashValue;
+	dsa_pointer next;
+
+	/*
+	 * hj_CurTuple is the backend-local address of the tuple last returned
+	 * from the current bucket, or NULL if it's time to start scanning a new
+	 * bucket.  Shared hash tables never have skew buckets.
+	 */
+	if (hashTuple != NULL)
+		next = hashTuple->next.shared;
+	else
+		next = dsa_pointer_atomic_read(
+							&hashtable->buckets.shared[hjstate->hj_CurBucketNo]);
+
+	while (DsaPointerIsValid(next))
+	{
+		hashTuple = (HashJoinTuple) dsa_get_address(hashtable->area, next);
+
+		if (hashTuple->hashvalue == hashvalue)
+		{
+			TupleTableSlot *inntuple;
+
+			/* insert hashtable's tuple into exec slot so ExecQual sees it */
+			inntuple = ExecStoreMinimalTuple(HJTUPLE_MINTUPLE(hashTuple),
+											 hjstate->hj_HashTupleSlot,
+											 false);	/* do not pfree */
+			econtext->ecxt_innertuple = inntuple;
+
+			/* reset temp memory each time to avoid leaks from qual expr */
+			ResetExprContext(econtext);
+
+			if (ExecQual(hjclauses, econtext))
+			{
+				hjstate->hj_CurTuple = hashTuple;
+				return true;
+			}
+		}
+
+		next = hashTuple->next.shared;
+	}
+
+	/*
+	 * no match
+	 */
+	return false;
+}
+
+/*
+ * Put the control object of a shared hash table back into its initial
+ * state.  Any shared memory and files it used must have been released.
+ */
+static void
+ExecParallelHashResetState(ParallelHashJoinState *pstate)
+{
+	pstate->batches = InvalidDsaPointer;
+	pstate->nbatch = 0;
+	pstate->old_nbatch = 0;
+	pstate->nbuckets = 0;
+	pstate->growth = PHJ_GROWTH_OK;
+	pstate->old_chunks = InvalidDsaPointer;
+	pstate->total_tuples = 0;
+	pstate->ninmemory = 0;
+	pstate->nfreed = 0;
+	pg_atomic_init_u32(&pstate->distributor, 0);
+	BarrierInit(&pstate->build_barrier, 0);
+	BarrierInit(&pstate->grow_batches_barrier, 0);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecHashEstimate
+ *
+ *		estimates the space required to serialize the shared state of
+ *		a parallel-aware Hash node.
+ * ----------------------------------------------------------------
+ */
+void
+ExecHashEstimate(HashState *node, ParallelContext *pcxt)
+{
+	shm_toc_estimate_chunk(&pcxt->estimator, sizeof(ParallelHashJoinState));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecHashInitializeDSM
+ *
+ *		Set up the shared state of a parallel-aware Hash node.
+ * ----------------------------------------------------------------
+ */
+void
+ExecHashInitializeDSM(HashState *node, ParallelContext *pcxt)
+{
+	ParallelHashJoinState *pstate;
+
+	pstate = shm_toc_allocate(pcxt->toc, sizeof(ParallelHashJoinState));
+	SpinLockInit(&pstate->mutex);
+	ExecParallelHashResetState(pstate);
+
+	/*
+	 * Batch files are named after the participant that wrote them, so we
+	 * need to know how many there can be.  Batch 0 may use the work_mem of
+	 * all of them together.
+	 */
+	pstate->nparticipants = pcxt->nworkers + 1;
+	pstate->space_allowed = work_mem * 1024L * pstate->nparticipants;
+
+	shm_toc_insert(pcxt->toc, node->ps.plan->plan_node_id, pstate);
+
+	/*
+	 * Without a per-query DSA area there is nowhere to put the shared table,
+	 * so in that case build a private one, as if we weren't parallel-aware.
+	 * That can only happen if the DSM segment couldn't be created, in which
+	 * case no workers will be launched either.
+	 */
+	if (node->ps.state->es_query_dsa != NULL)
+	{
+		SharedFileSetInit(&pstate->fileset, pcxt->seg);
+		pstate->segment = dsm_segment_handle(pcxt->seg);
+		node->parallel_state = pstate;
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecHashReInitializeDSM
+ *
+ *		Reset the shared state of a parallel-aware Hash node before a
+ *		rescan, releasing the memory and files used by the previous scan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecHashReInitializeDSM(HashState *node, ParallelContext *pcxt)
+{
+	ParallelHashJoinState *pstate = node->parallel_state;
+	dsa_area   *area = node->ps.state->es_query_dsa;
+
+	if (pstate == NULL)
+		return;
+
+	/* Free whatever the last participant to probe each batch didn't. */
+	if (DsaPointerIsValid(pstate->batches))
+	{
+		ParallelHashJoinBatch *batches;
+		int			i;
+
+		batches = (ParallelHashJoinBatch *)
+			dsa_get_address(area, pstate->batches);
+		for (i = 0; i < pstate->nbatch; ++i)
+			ExecParallelHashFreeBatch(area, &batches[i]);
+		dsa_free(area, pstate->batches);
+	}
+	ExecParallelHashFreeChunks(area, pstate->old_chunks);
+
+	SharedFileSetDeleteAll(&pstate->fileset);
+	ExecParallelHashResetState(pstate);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecHashInitializeWorker
+ *
+ *		Find the shared state of a parallel-aware Hash node, and attach
+ *		to its shared batch files.
+ * ----------------------------------------------------------------
+ */
+void
+ExecHashInitializeWorker(HashState *node, shm_toc *toc)
+{
+	ParallelHashJoinState *pstate;
+
+	pstate = shm_toc_lookup(toc, node->ps.plan->plan_node_id);
+	SharedFileSetAttach(&pstate->fileset, dsm_find_mapping(pstate->segment));
+	node->parallel_state = pstate;
+}
@@ -21,6 +21,7 @@
 #include "executor/nodeHash.h"
 #include "executor/nodeHashjoin.h"
 #include "miscadmin.h"
+#include "pgstat.h"
 #include "utils/memutils.h"
 
 
@@ -47,6 +48,11 @@ static TupleTableSlot *ExecHashJoinGetSavedTuple(HashJoinState *hjstate,
 						  uint32 *hashvalue,
 						  TupleTableSlot *tupleSlot);
 static bool ExecHashJoinNewBatch(HashJoinState *hjstate);
+static TupleTableSlot *ExecParallelHashJoinOuterGetTuple(PlanState *outerNode,
+								  HashJoinState *hjstate,
+								  uint32 *hashvalue);
+static void ExecParallelHashJoinPartitionOuter(HashJoinState *hjstate);
+static bool ExecParallelHashJoinNewBatch(HashJoinState *hjstate);
 
 
 /* ----------------------------------------------------------------
@@ -123,8 +129,12 @@ ExecHashJoin(HashJoinState *node)
 				 * The only way to make the check is to try to fetch a tuple
 				 * from the outer plan node.  If we succeed, we have to stash
 				 * it away for later consumption by ExecHashJoinOuterGetTuple.
+				 *
+				 * In a parallel-aware join each process sees only part of the
+				 * outer relation, so finding that part empty doesn't mean
+				 * the shared hash table isn't needed; we never try it there.
 				 */
-				if (HJ_FILL_INNER(node))
+				if (HJ_FILL_INNER(node) || hashNode->parallel_state != NULL)
 				{
 					/* no chance to not build the hash table */
 					node->hj_FirstOuterTupleSlot = NULL;
@@ -148,7 +158,7 @@ ExecHashJoin(HashJoinState *node)
 				/*
 				 * create the hash table
 				 */
-				hashtable = ExecHashTableCreate((Hash *) hashNode->ps.plan,
+				hashtable = ExecHashTableCreate(hashNode,
 												node->hj_HashOperators,
 												HJ_FILL_INNER(node));
 				node->hj_HashTable = hashtable;
@@ -159,6 +169,36 @@ ExecHashJoin(HashJoinState *node)
 				hashNode->hashtable = hashtable;
 				(void) MultiExecProcNode((PlanState *) hashNode);
 
+				/*
+				 * A shared hash table is complete once every participant has
+				 * finished building it.  If it has more than one batch, all
+				 * outer tuples are then written to shared batch files before
+				 * any batch is probed, and each process goes on to work on
+				 * whichever batches it can get.
+				 */
+				if (hashNode->parallel_state != NULL)
+				{
+					Barrier    *build_barrier;
+					bool		empty;
+
+					build_barrier = &hashNode->parallel_state->build_barrier;
+					empty = hashtable->totalTuples == 0 && !HJ_FILL_OUTER(node);
+					if (BarrierPhase(build_barrier) == PHJ_BUILD_HASHING_OUTER)
+					{
+						if (hashtable->nbatch > 1 && !empty)
+							ExecParallelHashJoinPartitionOuter(node);
+						BarrierArriveAndWait(build_barrier,
+											 WAIT_EVENT_HASH_BUILD);
+					}
+					BarrierDetach(build_barrier);
+
+					if (empty)
+						return NULL;
+
+					node->hj_JoinState = HJ_NEED_NEW_BATCH;
+					continue;
+				}
+
 				/*
 				 * If the inner relation is completely empty, and we're not
 				 * doing a left outer join, we can quit without scanning the
@@ -359,7 +399,12 @@ ExecHashJoin(HashJoinState *node)
 				/*
 				 * Try to advance to next batch.  Done if there are no more.
 				 */
-				if (!ExecHashJoinNewBatch(node))
+				if (hashNode->parallel_state != NULL)
+				{
+					if (!ExecParallelHashJoinNewBatch(node))
+						return NULL;	/* end of parallel-aware join */
+				}
+				else if (!ExecHashJoinNewBatch(node))
 					return NULL;	/* end of join */
 				node->hj_JoinState = HJ_NEED_NEW_OUTER;
 				break;
@@ -589,6 +634,10 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 	int			curbatch = hashtable->curbatch;
 	TupleTableSlot *slot;
 
+	if (hashtable->parallel_state != NULL)
+		return ExecParallelHashJoinOuterGetTuple(outerNode, hjstate,
+												 hashvalue);
+
 	if (curbatch == 0)			/* if it is the first pass */
 	{
 		/*
@@ -793,6 +842,193 @@ ExecHashJoinNewBatch(HashJoinState *hjstate)
 	return true;
 }
 
+/*
+ * ExecParallelHashJoinOuterGetTuple
+ *
+ *		get the next outer tuple for a parallel-aware hashjoin: from our
+ *		share of the outer plan if there is only one batch, or else from
+ *		the shared outer batch files of the current batch, which the
+ *		participants probing it claim one at a time.
+ */
+static TupleTableSlot *
+ExecParallelHashJoinOuterGetTuple(PlanState *outerNode,
+								  HashJoinState *hjstate,
+								  uint32 *hashvalue)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	TupleTableSlot *slot;
+
+	if (hashtable->nbatch == 1)
+	{
+		for (;;)
+		{
+			ExprContext *econtext = hjstate->js.ps.ps_ExprContext;
+
+			slot = ExecProcNode(outerNode);
+			if (TupIsNull(slot))
+				return NULL;
+
+			econtext->ecxt_outertuple = slot;
+			if (ExecHashGetHashValue(hashtable, econtext,
+									 hjstate->hj_OuterHashKeys,
+									 true,		/* outer tuple */
+									 HJ_FILL_OUTER(hjstate),
+									 hashvalue))
+				return slot;
+		}
+	}
+
+	for (;;)
+	{
+		if (hashtable->read_file != NULL)
+		{
+			slot = ExecHashJoinGetSavedTuple(hjstate,
+											 hashtable->read_file,
+											 hashvalue,
+											 hjstate->hj_OuterTupleSlot);
+			if (!TupIsNull(slot))
+				return slot;
+		}
+
+		if (ExecParallelHashNextBatchFile(hashtable, false) == NULL)
+			return NULL;		/* end of this batch */
+	}
+}
+
+/*
+ * ExecParallelHashJoinPartitionOuter
+ *		write our share of the outer relation to the shared outer batch
+ *		files, including those of batch 0
+ */
+static void
+ExecParallelHashJoinPartitionOuter(HashJoinState *hjstate)
+{
+	PlanState  *outerState = outerPlanState(hjstate);
+	ExprContext *econtext = hjstate->js.ps.ps_ExprContext;
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	TupleTableSlot *slot;
+	uint32		hashvalue;
+
+	for (;;)
+	{
+		slot = ExecProcNode(outerState);
+		if (TupIsNull(slot))
+			break;
+
+		ResetExprContext(econtext);
+		econtext->ecxt_outertuple = slot;
+		if (ExecHashGetHashValue(hashtable, econtext,
+								 hjstate->hj_OuterHashKeys,
+								 true,	/* outer tuple */
+								 HJ_FILL_OUTER(hjstate),
+								 &hashvalue))
+		{
+			int			bucketno;
+			int			batchno;
+
+			ExecHashGetBucketAndBatch(hashtable, hashvalue,
+									  &bucketno, &batchno);
+			ExecParallelHashSaveTuple(hashtable, false, batchno,
+									  ExecFetchSlotMinimalTuple(slot),
+									  hashvalue);
+		}
+	}
+
+	ExecParallelHashCloseBatchFiles(hashtable, false);
+}
+
+/*
+ * ExecParallelHashJoinNewBatch
+ *		switch to a batch of a shared hash table that still needs probing
+ *
+ * Each participant starts looking at a different batch, and attaches to the
+ * first one that isn't finished.  If it hasn't been loaded yet, we help to
+ * load it.  Returns true if successful, false if there are no more batches.
+ */
+static bool
+ExecParallelHashJoinNewBatch(HashJoinState *hjstate)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	int			nbatch = hashtable->nbatch;
+	int			start;
+	int			i;
+
+	/* We are done with the batch we were probing, if any. */
+	ExecParallelHashTableDetachBatch(hashtable);
+
+	start = pg_atomic_fetch_add_u32(&pstate->distributor, 1) % nbatch;
+	for (i = 0; i < nbatch; ++i)
+	{
+		int			batchno = (start + i) % nbatch;
+		Barrier    *batch_barrier;
+		TupleTableSlot *slot;
+		uint32		hashvalue;
+
+		if (hashtable->batch_done[batchno])
+			continue;
+
+		batch_barrier = &hashtable->batches[batchno].batch_barrier;
+		switch (BarrierAttach(batch_barrier))
+		{
+			case PHJ_BATCH_ELECTING:
+				/* One participant allocates the buckets. */
+				if (BarrierArriveAndWait(batch_barrier,
+										 WAIT_EVENT_HASH_BATCH_LOAD))
+					ExecParallelHashTableAllocBatch(hashtable, batchno);
+				/* FALL THRU */
+
+			case PHJ_BATCH_ALLOCATING:
+				/* Wait for the buckets to be allocated. */
+				BarrierArriveAndWait(batch_barrier,
+									 WAIT_EVENT_HASH_BATCH_LOAD);
+				/* FALL THRU */
+
+			case PHJ_BATCH_LOADING:
+				/* Help to load the inner tuples, then wait for the rest. */
+				ExecParallelHashTableSetCurrentBatch(hashtable, batchno);
+				while (ExecParallelHashNextBatchFile(hashtable, true) != NULL)
+				{
+					while ((slot = ExecHashJoinGetSavedTuple(hjstate,
+													  hashtable->read_file,
+															 &hashvalue,
+											   hjstate->hj_HashTupleSlot)))
+						ExecParallelHashTableInsertCurrentBatch(hashtable,
+																slot,
+																hashvalue);
+				}
+				BarrierArriveAndWait(batch_barrier,
+									 WAIT_EVENT_HASH_BATCH_LOAD);
+				/* FALL THRU */
+
+			case PHJ_BATCH_PROBING:
+
+				/*
+				 * The batch is ready to probe.  We don't wait for anyone
+				 * from here on; see ExecParallelHashTableDetachBatch.
+				 */
+				ExecParallelHashTableSetCurrentBatch(hashtable, batchno);
+				return true;
+
+			case PHJ_BATCH_DONE:
+
+				/*
+				 * Everyone else has already finished probing this batch, and
+				 * its memory has been freed.
+				 */
+				BarrierDetach(batch_barrier);
+				hashtable->batch_done[batchno] = true;
+				break;
+
+			default:
+				elog(ERROR, "unexpected batch phase %d",
+					 BarrierPhase(batch_barrier));
+		}
+	}
+
+	return false;
+}
+
 /*
  * ExecHashJoinSaveTuple
  *		save a tuple to a batch file.
@@ -892,11 +1128,16 @@ ExecReScanHashJoin(HashJoinState *node)
 	 * primarily because batch temp files may have already been released. But
 	 * if it's a single-batch join, and there is no parameter change for the
 	 * inner subnode, then we can just re-use the existing hash table without
-	 * rebuilding it.
+	 * rebuilding it.  The hash table of a parallel-aware join is never
+	 * re-used, since its shared memory and batch files are released when the
+	 * parallel query is reinitialized for the rescan.
 	 */
 	if (node->hj_HashTable != NULL)
 	{
+		HashState  *hashNode = (HashState *) innerPlanState(node);
+
 		if (node->hj_HashTable->nbatch == 1 &&
+			hashNode->parallel_state == NULL &&
 			node->js.ps.righttree->chgParam == NULL)
 		{
 			/*
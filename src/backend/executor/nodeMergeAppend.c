@@ -99,9 +99,17 @@ ExecInitMergeAppend(MergeAppend *node, EState *estate, int eflags)
 	/*
 	 * Miscellaneous initialization
 	 *
-	 * MergeAppend plans don't have expression contexts because they never
-	 * call ExecQual or ExecProject.
+	 * MergeAppend plans don't need expression contexts because they never
+	 * call ExecQual or ExecProject, except to evaluate Params for runtime
+	 * partition pruning.  That is done when the subplans are started, as
+	 * initplans the Params might depend on aren't set up yet.
 	 */
+	if (node->part_prune_quals != NIL)
+	{
+		ExecAssignExprContext(estate, &mergestate->ps);
+		mergestate->ms_valid_subplans = (bool *) palloc(nplans * sizeof(bool));
+		mergestate->ms_prune_pending = true;
+	}
 
 	/*
 	 * MergeAppend nodes do have Result slots, which hold pointers to tuples,
@@ -179,10 +187,25 @@ ExecMergeAppend(MergeAppendState *node)
 	{
 		/*
 		 * First time through: pull the first tuple from each subplan, and set
-		 * up the heap.
+		 * up the heap.  Subplans pruned at runtime are left out.
 		 */
+		if (node->ms_prune_pending)
+		{
+			MergeAppend *plan = (MergeAppend *) node->ps.plan;
+
+			ExecPruneAppendSubplans(&node->ps,
+									plan->part_prune_quals,
+									plan->part_constraints,
+									node->ms_valid_subplans);
+			node->ms_prune_pending = false;
+		}
+
 		for (i = 0; i < node->ms_nplans; i++)
 		{
+			if (node->ms_valid_subplans != NULL &&
+				!node->ms_valid_subplans[i])
+				continue;
+
 			node->ms_slots[i] = ExecProcNode(node->mergeplans[i]);
 			if (!TupIsNull(node->ms_slots[i]))
 				binaryheap_add_unordered(node->ms_heap, Int32GetDatum(i));
@@ -312,6 +335,14 @@ ExecReScanMergeAppend(MergeAppendState *node)
 		if (subnode->chgParam == NULL)
 			ExecReScan(subnode);
 	}
+
+	/*
+	 * If the Params used for pruning may have changed, the set of subplans
+	 * to scan has to be recomputed when they're started again.
+	 */
+	if (node->ms_valid_subplans != NULL && node->ps.chgParam != NULL)
+		node->ms_prune_pending = true;
+
 	binaryheap_reset(node->ms_heap);
 	node->ms_initialized = false;
 }
@@ -19,6 +19,8 @@
  *		ExecInitSeqScan			creates and initializes a seqscan node.
  *		ExecEndSeqScan			releases any storage allocated.
  *		ExecReScanSeqScan		rescans the relation
+ *		ExecSeqScanCanBatch		can the parent take tuples a page at a time?
+ *		ExecSeqScanBatch		retrieve the next page of qualifying tuples
  *
  *		ExecSeqScanEstimate		estimates DSM space needed for parallel scan
  *		ExecSeqScanInitializeDSM initialize DSM for parallel scan
@@ -26,12 +28,16 @@
  */
 #include "postgres.h"
 
+#include "access/htup_details.h"
 #include "access/relscan.h"
 #include "executor/execdebug.h"
 #include "executor/nodeSeqscan.h"
+#include "miscadmin.h"
+#include "utils/memutils.h"
 #include "utils/rel.h"
 
 static void InitScanRelation(SeqScanState *node, EState *estate, int eflags);
+static HeapScanDesc SeqBeginScan(SeqScanState *node);
 static TupleTableSlot *SeqNext(SeqScanState *node);
 
 /* ----------------------------------------------------------------
@@ -57,27 +63,34 @@ SeqNext(SeqScanState *node)
 	/*
 	 * get information from the estate and scan state
 	 */
-	scandesc = node->ss.ss_currentScanDesc;
+	scandesc = SeqBeginScan(node);
 	estate = node->ss.ps.state;
 	direction = estate->es_direction;
 	slot = node->ss.ss_ScanTupleSlot;
 
-	if (scandesc == NULL)
-	{
-		/*
-		 * We reach here if the scan is not parallel, or if we're executing a
-		 * scan that was intended to be parallel serially.
-		 */
-		scandesc = heap_beginscan(node->ss.ss_currentRelation,
-								  estate->es_snapshot,
-								  0, NULL);
-		node->ss.ss_currentScanDesc = scandesc;
-	}
-
 	/*
-	 * get the next tuple from the table
+	 * get the next tuple from the table.  In batch mode, we take all the
+	 * visible tuples of a page from the heap at once, and then hand them out
+	 * from our local array until it's used up.
 	 */
-	tuple = heap_getnext(scandesc, direction);
+	if (node->use_batch && scandesc->rs_pageatatime)
+	{
+		Assert(ScanDirectionIsForward(direction));
+
+		if (node->batch_next >= node->batch_ntuples)
+		{
+			node->batch_ntuples = heap_getnextbatch(scandesc, node->batch,
+													MaxHeapTuplesPerPage);
+			node->batch_next = 0;
+		}
+
+		if (node->batch_next < node->batch_ntuples)
+			tuple = &node->batch[node->batch_next++];
+		else
+			tuple = NULL;
+	}
+	else
+		tuple = heap_getnext(scandesc, direction);
 
 	/*
 	 * save the tuple and the buffer returned to us by the access methods in
@@ -99,6 +112,27 @@ SeqNext(SeqScanState *node)
 	return slot;
 }
 
+/*
+ * SeqBeginScan -- return the heap scan, starting it if necessary
+ */
+static HeapScanDesc
+SeqBeginScan(SeqScanState *node)
+{
+	if (node->ss.ss_currentScanDesc == NULL)
+	{
+		/*
+		 * We reach here if the scan is not parallel, or if we're executing a
+		 * scan that was intended to be parallel serially.
+		 */
+		node->ss.ss_currentScanDesc =
+			heap_beginscan(node->ss.ss_currentRelation,
+						   node->ss.ps.state->es_snapshot,
+						   0, NULL);
+	}
+
+	return node->ss.ss_currentScanDesc;
+}
+
 /*
  * SeqRecheck -- access method routine to recheck a tuple in EvalPlanQual
  */
@@ -129,6 +163,126 @@ ExecSeqScan(SeqScanState *node)
 					(ExecScanRecheckMtd) SeqRecheck);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecSeqScanCanBatch
+ *
+ *		Returns true if the parent node may read this scan with
+ *		ExecSeqScanBatch instead of ExecProcNode.  That requires that the
+ *		scan tuples are returned as they are, without a projection, and
+ *		that nothing depends on going through ExecProcNode for each tuple:
+ *		neither instrumentation, which counts the tuples returned there,
+ *		nor EvalPlanQual, where ExecScan substitutes the test tuple.
+ * ----------------------------------------------------------------
+ */
+bool
+ExecSeqScanCanBatch(SeqScanState *node)
+{
+	return node->use_batch &&
+		node->ss.ps.ps_ProjInfo == NULL &&
+		node->ss.ps.instrument == NULL &&
+		node->ss.ps.state->es_epqTuple == NULL;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecSeqScanBatch(node)
+ *
+ *		Reads the visible tuples of the next heap page, evaluates the
+ *		scan's qual over all of them in one loop, and returns the number
+ *		that pass, which are left in node->batch[0 .. n-1].  Returns 0 at
+ *		the end of the scan.  The tuples point into the scan's current
+ *		buffer and stay valid until the next call; use
+ *		ExecSeqScanBatchSlot to store one into the scan tuple slot.
+ *
+ *		This saves the parent the ExecProcNode and ExecScan round trip for
+ *		every tuple.  The caller must have checked ExecSeqScanCanBatch,
+ *		and must not mix calls of this with ExecProcNode on the same scan.
+ * ----------------------------------------------------------------
+ */
+int
+ExecSeqScanBatch(SeqScanState *node)
+{
+	ExprContext *econtext = node->ss.ps.ps_ExprContext;
+	ExprState  *qual = node->ss.ps.qual;
+	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+	HeapScanDesc scandesc;
+
+	Assert(ExecSeqScanCanBatch(node));
+	Assert(ScanDirectionIsForward(node->ss.ps.state->es_direction));
+
+	/* what ExecProcNode would do for us */
+	CHECK_FOR_INTERRUPTS();
+	if (node->ss.ps.chgParam != NULL)
+		ExecReScan((PlanState *) node);
+
+	scandesc = SeqBeginScan(node);
+
+	for (;;)
+	{
+		int			ntuples;
+		int			nkept;
+		int			i;
+
+		if (scandesc->rs_pageatatime)
+			ntuples = heap_getnextbatch(scandesc, node->batch,
+										MaxHeapTuplesPerPage);
+		else
+		{
+			/* without page-at-a-time mode, a batch is just one tuple */
+			HeapTuple	tuple = heap_getnext(scandesc, ForwardScanDirection);
+
+			if (tuple == NULL)
+				ntuples = 0;
+			else
+			{
+				node->batch[0] = *tuple;
+				ntuples = 1;
+			}
+		}
+
+		if (ntuples == 0)
+		{
+			ExecClearTuple(slot);
+			return 0;
+		}
+
+		if (qual == NULL)
+			return ntuples;
+
+		/* keep the tuples that pass the qual, in their original order */
+		nkept = 0;
+		for (i = 0; i < ntuples; i++)
+		{
+			ResetExprContext(econtext);
+			econtext->ecxt_scantuple =
+				ExecStoreTuple(&node->batch[i], slot, scandesc->rs_cbuf,
+							   false);
+			if (ExecQual(qual, econtext))
+				node->batch[nkept++] = node->batch[i];
+		}
+
+		if (nkept > 0)
+			return nkept;
+
+		CHECK_FOR_INTERRUPTS();
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecSeqScanBatchSlot(node, i)
+ *
+ *		Stores the i'th tuple of the current batch into the scan tuple
+ *		slot, and returns the slot.
+ * ----------------------------------------------------------------
+ */
+TupleTableSlot *
+ExecSeqScanBatchSlot(SeqScanState *node, int i)
+{
+	return ExecStoreTuple(&node->batch[i],
+						  node->ss.ss_ScanTupleSlot,
+						  node->ss.ss_currentScanDesc->rs_cbuf,
+						  false);
+}
+
 /* ----------------------------------------------------------------
  *		InitScanRelation
  *
@@ -208,6 +362,20 @@ ExecInitSeqScan(SeqScan *node, EState *estate, int eflags)
 	ExecAssignResultTypeFromTL(&scanstate->ss.ps);
 	ExecAssignScanProjectionInfo(&scanstate->ss);
 
+	/*
+	 * Fetch a page's worth of tuples at a time, unless we might be asked to
+	 * scan backwards: the heap scan runs ahead of the tuples we've returned
+	 * in batch mode, so it can't simply be reversed.
+	 */
+	if (!(eflags & EXEC_FLAG_BACKWARD))
+	{
+		scanstate->use_batch = true;
+		scanstate->batch = (HeapTuple)
+			palloc(MaxHeapTuplesPerPage * sizeof(HeapTupleData));
+	}
+	scanstate->batch_ntuples = 0;
+	scanstate->batch_next = 0;
+
 	return scanstate;
 }
 
@@ -274,6 +442,9 @@ ExecReScanSeqScan(SeqScanState *node)
 		heap_rescan(scan,		/* scan desc */
 					NULL);		/* new scan keys */
 
+	node->batch_ntuples = 0;
+	node->batch_next = 0;
+
 	ExecScanReScan((ScanState *) node);
 }
 
@@ -0,0 +1,203 @@
+/*-------------------------------------------------------------------------
+ *
+ * jit.c
+ *	  Provider independent JIT infrastructure.
+ *
+ * Code related to loading JIT providers, redirecting calls into JIT providers
+ * and error handling.  No code specific to a specific JIT implementation
+ * should end up here.  No provider is included in the core distribution, so
+ * unless one is installed and named by jit_provider, all of this is inert.
+ *
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/jit/jit.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fmgr.h"
+#include "jit/jit.h"
+#include "miscadmin.h"
+#include "nodes/execnodes.h"
+#include "utils/memutils.h"
+
+
+/* GUCs */
+bool		jit_enabled = false;
+char	   *jit_provider = NULL;
+bool		jit_expressions = true;
+bool		jit_tuple_deforming = true;
+double		jit_above_cost = 100000;
+
+static JitProviderCallbacks provider;
+static bool provider_successfully_loaded = false;
+static bool provider_failed_loading = false;
+
+
+static bool provider_init(void);
+static bool file_exists(const char *name);
+static void jit_context_reset_callback(void *arg);
+
+
+/*
+ * Load the JIT provider named by jit_provider, if not done already.
+ *
+ * Returns true if the provider is available.  If it isn't, JIT compilation
+ * is silently disabled for the rest of the session.
+ */
+static bool
+provider_init(void)
+{
+	char		path[MAXPGPATH];
+	JitProviderInit init;
+
+	/* don't even try to load if not enabled */
+	if (!jit_enabled)
+		return false;
+
+	/*
+	 * Don't retry loading after failing - attempting to load JIT provider
+	 * isn't cheap.
+	 */
+	if (provider_failed_loading)
+		return false;
+	if (provider_successfully_loaded)
+		return true;
+
+	/* no provider configured */
+	if (jit_provider == NULL || jit_provider[0] == '\0')
+	{
+		provider_failed_loading = true;
+		return false;
+	}
+
+	/*
+	 * Check whether the shared library exists.  We do that check before
+	 * actually attempting to load it (via load_external_function()), because
+	 * that'd error out if the library isn't available.
+	 */
+	snprintf(path, MAXPGPATH, "%s/%s%s", pkglib_path, jit_provider, DLSUFFIX);
+	elog(DEBUG1, "probing availability of JIT provider at %s", path);
+	if (!file_exists(path))
+	{
+		elog(DEBUG1,
+			 "provider not available, disabling JIT for current session");
+		provider_failed_loading = true;
+		return false;
+	}
+
+	/*
+	 * If loading functions fails, signal failure.  We do so because
+	 * load_external_function() might error out despite the above check if
+	 * e.g. the library's dependencies aren't installed.  We want to signal
+	 * ERROR in that case, so the user is notified, but we don't want to
+	 * continually retry.
+	 */
+	provider_failed_loading = true;
+
+	/* and initialize */
+	init = (JitProviderInit)
+		load_external_function(path, "_PG_jit_provider_init", true, NULL);
+	init(&provider);
+
+	provider_successfully_loaded = true;
+	provider_failed_loading = false;
+
+	elog(DEBUG1, "successfully loaded JIT provider in current session");
+
+	return true;
+}
+
+/*
+ * Attach a JIT context, created by the provider for the query running in
+ * estate, to that EState.
+ *
+ * The provider's release_context callback is invoked when the query's memory
+ * is released, which happens both at normal executor shutdown and when the
+ * query is aborted by an error.
+ */
+void
+jit_attach_context(EState *estate, JitContext *context)
+{
+	MemoryContextCallback *cb;
+
+	Assert(estate->es_jit == NULL);
+
+	cb = MemoryContextAlloc(estate->es_query_cxt,
+							sizeof(MemoryContextCallback));
+	cb->func = jit_context_reset_callback;
+	cb->arg = context;
+	MemoryContextRegisterResetCallback(estate->es_query_cxt, cb);
+
+	estate->es_jit = context;
+}
+
+/*
+ * Memory context callback releasing a query's JIT context.
+ */
+static void
+jit_context_reset_callback(void *arg)
+{
+	JitContext *context = (JitContext *) arg;
+
+	/* provider must be loaded, as it created the context */
+	Assert(provider_successfully_loaded);
+
+	provider.release_context(context);
+}
+
+/*
+ * Ask provider to JIT compile an expression.
+ *
+ * Returns true if successful, false if not.
+ */
+bool
+jit_compile_expr(struct ExprState *state)
+{
+	/*
+	 * Expressions without an associated PlanState (and thus EState) have no
+	 * JIT context whose lifetime could bound that of the generated code, nor
+	 * any plan cost to decide whether compiling is worthwhile.  Leave those
+	 * to the interpreter.
+	 */
+	if (!state->parent)
+		return false;
+
+	/* if no jitting should be performed at all */
+	if (!(state->parent->state->es_jit_flags & PGJIT_PERFORM))
+		return false;
+
+	/* or if expressions aren't JITed */
+	if (!(state->parent->state->es_jit_flags & PGJIT_EXPR))
+		return false;
+
+	/* this also takes !jit_enabled into account */
+	if (provider_init())
+		return provider.compile_expr(state);
+
+	return false;
+}
+
+static bool
+file_exists(const char *name)
+{
+	struct stat st;
+
+	AssertArg(name != NULL);
+
+	if (stat(name, &st) == 0)
+		return S_ISDIR(st.st_mode) ? false : true;
+	else if (!(errno == ENOENT || errno == ENOTDIR))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not access file \"%s\": %m", name)));
+
+	return false;
+}
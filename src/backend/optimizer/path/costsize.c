@@ -80,6 +80,7 @@
 #include "access/htup_details.h"
 #include "access/tsmapi.h"
 #include "executor/executor.h"
+#include "executor/nodeAgg.h"
 #include "executor/nodeHash.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
@@ -122,10 +123,12 @@ bool		enable_bitmapscan = true;
 bool		enable_tidscan = true;
 bool		enable_sort = true;
 bool		enable_hashagg = true;
+bool		enable_hashagg_disk = true;
 bool		enable_nestloop = true;
 bool		enable_material = true;
 bool		enable_mergejoin = true;
 bool		enable_hashjoin = true;
+bool		enable_parallel_hash = true;
 bool		enable_gathermerge = true;
 
 typedef struct
@@ -162,6 +165,8 @@ static Selectivity get_foreign_key_join_selectivity(PlannerInfo *root,
 static void set_rel_width(PlannerInfo *root, RelOptInfo *rel);
 static double relation_byte_size(double tuples, int width);
 static double page_size(double tuples, int width);
+static Cost hashagg_spill_cost(const AggClauseCosts *aggcosts,
+				   double numGroups, double input_tuples, int input_width);
 static double get_parallel_divisor(Path *path);
 
 
@@ -677,7 +682,8 @@ cost_index(IndexPath *path, PlannerInfo *root, double loop_count,
 		 * order.
 		 */
 		path->path.parallel_workers = compute_parallel_worker(baserel,
-											   rand_heap_pages, index_pages);
+											   rand_heap_pages, index_pages,
+											   max_parallel_workers_per_gather);
 
 		/*
 		 * Fall out if workers can't be assigned for parallel scan, because in
@@ -1868,13 +1874,19 @@ cost_material(Path *path,
  *
  * Note: when aggstrategy == AGG_SORTED, caller must ensure that input costs
  * are for appropriately-sorted input.
+ *
+ * input_width is the average width of the input tuples; for AGG_HASHED it is
+ * used to estimate the I/O needed if the hash table overflows work_mem and
+ * input has to be spilled to disk.  Only an Agg node with a single hashed
+ * grouping set can spill, so callers costing hashed SetOps or grouping sets
+ * pass zero, and no spill cost is charged.
  */
 void
 cost_agg(Path *path, PlannerInfo *root,
 		 AggStrategy aggstrategy, const AggClauseCosts *aggcosts,
 		 int numGroupCols, double numGroups,
 		 Cost input_startup_cost, Cost input_total_cost,
-		 double input_tuples)
+		 double input_tuples, int input_width)
 {
 	double		output_tuples;
 	Cost		startup_cost;
@@ -1948,6 +1960,9 @@ cost_agg(Path *path, PlannerInfo *root,
 		startup_cost += aggcosts->transCost.startup;
 		startup_cost += aggcosts->transCost.per_tuple * input_tuples;
 		startup_cost += (cpu_operator_cost * numGroupCols) * input_tuples;
+		if (input_width > 0)
+			startup_cost += hashagg_spill_cost(aggcosts, numGroups,
+											   input_tuples, input_width);
 		total_cost = startup_cost;
 		total_cost += aggcosts->finalCost * numGroups;
 		total_cost += cpu_tuple_cost * numGroups;
@@ -1959,6 +1974,50 @@ cost_agg(Path *path, PlannerInfo *root,
 	path->total_cost = total_cost;
 }
 
+/*
+ * hashagg_spill_cost
+ *		Estimate the disk I/O cost of a hashed Agg whose hash table does not
+ *		fit in work_mem.
+ *
+ * The executor keeps the groups that fit in memory and writes the input
+ * tuples belonging to any other group out to a set of partitions, which are
+ * then read back and processed one at a time, possibly recursively.  We
+ * charge seq_page_cost for each page written and again for each page read,
+ * for every level of recursion we expect to need.
+ */
+static Cost
+hashagg_spill_cost(const AggClauseCosts *aggcosts, double numGroups,
+				   double input_tuples, int input_width)
+{
+	double		work_mem_bytes = work_mem * 1024.0;
+	double		hashentrysize;
+	double		groups_in_memory;
+	double		spill_fraction;
+	double		depth;
+	double		pages;
+
+	hashentrysize = MAXALIGN(input_width) + MAXALIGN(SizeofMinimalTupleHeader);
+	hashentrysize += hash_agg_entry_size(aggcosts->numAggs);
+	hashentrysize += aggcosts->transitionSpace;
+
+	if (numGroups * hashentrysize <= work_mem_bytes)
+		return 0;
+
+	groups_in_memory = Max(work_mem_bytes / hashentrysize, 1.0);
+	spill_fraction = 1.0 - groups_in_memory / numGroups;
+
+	/*
+	 * Each pass splits the spilled input into up to 256 partitions; assume
+	 * we need enough passes for each partition's groups to fit in memory.
+	 */
+	depth = ceil(log(numGroups / groups_in_memory) / log(256.0));
+	depth = Max(depth, 1.0);
+
+	pages = page_size(input_tuples * spill_fraction, input_width);
+
+	return 2.0 * seq_page_cost * pages * depth;
+}
+
 /*
  * cost_windowagg
  *		Determines and returns the cost of performing a WindowAgg plan node,
@@ -2878,6 +2937,8 @@ cached_scansel(PlannerInfo *root, RestrictInfo *rinfo, PathKey *pathkey)
  * 'inner_path' is the inner input to the join
  * 'sjinfo' is extra info about the join for selectivity estimation
  * 'semifactors' contains valid data if jointype is SEMI or ANTI
+ * 'parallel_hash' indicates that inner_path is partial and that a shared
+ *		hash table will be built from it by all participants together
  */
 void
 initial_cost_hashjoin(PlannerInfo *root, JoinCostWorkspace *workspace,
@@ -2885,12 +2946,14 @@ initial_cost_hashjoin(PlannerInfo *root, JoinCostWorkspace *workspace,
 					  List *hashclauses,
 					  Path *outer_path, Path *inner_path,
 					  SpecialJoinInfo *sjinfo,
-					  SemiAntiJoinFactors *semifactors)
+					  SemiAntiJoinFactors *semifactors,
+					  bool parallel_hash)
 {
 	Cost		startup_cost = 0;
 	Cost		run_cost = 0;
 	double		outer_path_rows = outer_path->rows;
 	double		inner_path_rows = inner_path->rows;
+	double		inner_path_rows_total = inner_path_rows;
 	int			num_hashclauses = list_length(hashclauses);
 	int			numbuckets;
 	int			numbatches;
@@ -2924,10 +2987,16 @@ initial_cost_hashjoin(PlannerInfo *root, JoinCostWorkspace *workspace,
 	 *
 	 * XXX at some point it might be interesting to try to account for skew
 	 * optimization in the cost estimate, but for now, we don't.
+	 *
+	 * A shared hash table holds the rows produced by all participants, and
+	 * may use the memory of all of them, but never uses skew optimization.
 	 */
-	ExecChooseHashTableSize(inner_path_rows,
+	if (parallel_hash)
+		inner_path_rows_total *= get_parallel_divisor(inner_path);
+	ExecChooseHashTableSize(inner_path_rows_total,
 							inner_path->pathtarget->width,
-							true,		/* useskew */
+							!parallel_hash,		/* useskew */
+							parallel_hash ? outer_path->parallel_workers : 0,
 							&numbuckets,
 							&numbatches,
 							&num_skew_mcvs);
@@ -2959,6 +3028,7 @@ initial_cost_hashjoin(PlannerInfo *root, JoinCostWorkspace *workspace,
 	workspace->run_cost = run_cost;
 	workspace->numbuckets = numbuckets;
 	workspace->numbatches = numbatches;
+	workspace->inner_rows_total = inner_path_rows_total;
 }
 
 /*
@@ -2982,7 +3052,7 @@ final_cost_hashjoin(PlannerInfo *root, HashPath *path,
 	Path	   *outer_path = path->jpath.outerjoinpath;
 	Path	   *inner_path = path->jpath.innerjoinpath;
 	double		outer_path_rows = outer_path->rows;
-	double		inner_path_rows = inner_path->rows;
+	double		inner_path_rows = workspace->inner_rows_total;
 	List	   *hashclauses = path->path_hashclauses;
 	Cost		startup_cost = workspace->startup_cost;
 	Cost		run_cost = workspace->run_cost;
@@ -3022,6 +3092,9 @@ final_cost_hashjoin(PlannerInfo *root, HashPath *path,
 	/* mark the path with estimated # of batches */
 	path->num_batches = numbatches;
 
+	/* store the total number of tuples (sum of partial row estimates) */
+	path->inner_rows_total = inner_path_rows;
+
 	/* and compute the number of "virtual" buckets in the whole join */
 	virtualbuckets = (double) numbuckets *(double) numbatches;
 
@@ -151,6 +151,9 @@ static CustomScan *create_customscan_plan(PlannerInfo *root,
 static NestLoop *create_nestloop_plan(PlannerInfo *root, NestPath *best_path);
 static MergeJoin *create_mergejoin_plan(PlannerInfo *root, MergePath *best_path);
 static HashJoin *create_hashjoin_plan(PlannerInfo *root, HashPath *best_path);
+static void make_partition_prune_info(PlannerInfo *root, List *subpaths,
+						  List **prune_quals, List **constraints);
+static bool contain_param_walker(Node *node, void *context);
 static Node *replace_nestloop_params(PlannerInfo *root, Node *expr);
 static Node *replace_nestloop_params_mutator(Node *node, PlannerInfo *root);
 static void process_subquery_nestloop_params(PlannerInfo *root,
@@ -1042,6 +1045,11 @@ create_append_plan(PlannerInfo *root, AppendPath *best_path)
 
 	copy_generic_path_info(&plan->plan, (Path *) best_path);
 
+	if (best_path->partitioned_rels != NIL)
+		make_partition_prune_info(root, best_path->subpaths,
+								  &plan->part_prune_quals,
+								  &plan->part_constraints);
+
 	return (Plan *) plan;
 }
 
@@ -1149,9 +1157,112 @@ create_merge_append_plan(PlannerInfo *root, MergeAppendPath *best_path)
 	node->partitioned_rels = best_path->partitioned_rels;
 	node->mergeplans = subplans;
 
+	if (best_path->partitioned_rels != NIL)
+		make_partition_prune_info(root, best_path->subpaths,
+								  &node->part_prune_quals,
+								  &node->part_constraints);
+
 	return (Plan *) node;
 }
 
+/*
+ * make_partition_prune_info
+ *	  Collect what an Append or MergeAppend over a partitioned table needs to
+ *	  skip subplans at execution time.
+ *
+ * Constraint exclusion can only use restriction clauses that compare the
+ * partition key against constants.  Clauses that compare it against a
+ * Param, such as parameters of a generic plan, nestloop parameters of a
+ * parameterized scan, or outputs of initplans, are useless at plan time,
+ * but the executor can substitute the Params' current values and retry the
+ * refutation proof against the partition's constraint before running each
+ * subplan.  For each subpath we therefore return the list of such clauses,
+ * and the partition's constraint; both are NIL for subpaths that have no
+ * Param-dependent clauses.  If no subpath has any, both output lists are
+ * NIL, so that the executor doesn't bother.
+ *
+ * This must be called after the subplans have been created, so that any
+ * nestloop params the clauses need are already registered.
+ */
+static void
+make_partition_prune_info(PlannerInfo *root, List *subpaths,
+						  List **prune_quals, List **constraints)
+{
+	bool		have_prune_quals = false;
+	ListCell   *lc;
+
+	*prune_quals = NIL;
+	*constraints = NIL;
+
+	foreach(lc, subpaths)
+	{
+		Path	   *subpath = (Path *) lfirst(lc);
+		RelOptInfo *rel = subpath->parent;
+		List	   *rinfos = rel->baserestrictinfo;
+		List	   *quals = NIL;
+		List	   *constraint = NIL;
+		ListCell   *lc2;
+
+		if (subpath->param_info)
+			rinfos = list_concat(list_copy(rinfos),
+								 subpath->param_info->ppi_clauses);
+
+		foreach(lc2, rinfos)
+		{
+			RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc2);
+			Node	   *clause = (Node *) rinfo->clause;
+
+			if (rinfo->pseudoconstant ||
+				contain_volatile_functions(clause) ||
+				contain_subplans(clause))
+				continue;
+
+			/* Vars of the outer side of a nestloop become Params */
+			clause = replace_nestloop_params(root, clause);
+
+			if (!contain_param_walker(clause, NULL) ||
+				!bms_is_subset(pull_varnos(clause),
+							   bms_make_singleton(rel->relid)))
+				continue;
+
+			quals = lappend(quals, clause);
+		}
+
+		if (quals != NIL)
+		{
+			constraint = get_relation_pruning_constraints(root, rel,
+														  planner_rt_fetch(rel->relid, root));
+			if (constraint == NIL)
+				quals = NIL;
+			else
+				have_prune_quals = true;
+		}
+
+		*prune_quals = lappend(*prune_quals, quals);
+		*constraints = lappend(*constraints, constraint);
+	}
+
+	if (!have_prune_quals)
+	{
+		*prune_quals = NIL;
+		*constraints = NIL;
+	}
+}
+
+/*
+ * contain_param_walker
+ *	  Does the expression contain any Param?
+ */
+static bool
+contain_param_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Param))
+		return true;
+	return expression_tree_walker(node, contain_param_walker, context);
+}
+
 /*
  * create_result_plan
  *	  Create a Result plan for 'best_path'.
@@ -4150,6 +4261,15 @@ create_hashjoin_plan(PlannerInfo *root,
 	copy_plan_costsize(&hash_plan->plan, inner_plan);
 	hash_plan->plan.startup_cost = hash_plan->plan.total_cost;
 
+	/*
+	 * In a parallel-aware hash join, it's the Hash node that coordinates
+	 * the build of the shared hash table.  It needs the total number of
+	 * rows expected from all participants to size that table.
+	 */
+	hash_plan->plan.parallel_aware = best_path->jpath.path.parallel_aware;
+	if (hash_plan->plan.parallel_aware)
+		hash_plan->rows_total = best_path->inner_rows_total;
+
 	join_plan = make_hashjoin(tlist,
 							  joinclauses,
 							  otherclauses,
@@ -5409,6 +5529,7 @@ make_hash(Plan *lefttree,
 	node->skewInherit = skewInherit;
 	node->skewColType = skewColType;
 	node->skewColTypmod = skewColTypmod;
+	node->rows_total = 0;
 
 	return node;
 }
@@ -903,6 +903,12 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 				{
 					lfirst_int(l) += rtoffset;
 				}
+				splan->part_prune_quals = (List *)
+					fix_scan_expr(root, (Node *) splan->part_prune_quals,
+								  rtoffset);
+				splan->part_constraints = (List *)
+					fix_scan_expr(root, (Node *) splan->part_constraints,
+								  rtoffset);
 				foreach(l, splan->appendplans)
 				{
 					lfirst(l) = set_plan_refs(root,
@@ -925,6 +931,12 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 				{
 					lfirst_int(l) += rtoffset;
 				}
+				splan->part_prune_quals = (List *)
+					fix_scan_expr(root, (Node *) splan->part_prune_quals,
+								  rtoffset);
+				splan->part_constraints = (List *)
+					fix_scan_expr(root, (Node *) splan->part_constraints,
+								  rtoffset);
 				foreach(l, splan->mergeplans)
 				{
 					lfirst(l) = set_plan_refs(root,
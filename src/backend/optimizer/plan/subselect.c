@@ -2553,6 +2553,10 @@ finalize_plan(PlannerInfo *root, Plan *plan, Bitmapset *valid_params,
 			{
 				ListCell   *l;
 
+				/* Params used for runtime partition pruning */
+				finalize_primnode((Node *) ((Append *) plan)->part_prune_quals,
+								  &context);
+
 				foreach(l, ((Append *) plan)->appendplans)
 				{
 					context.paramids =
@@ -2569,6 +2573,10 @@ finalize_plan(PlannerInfo *root, Plan *plan, Bitmapset *valid_params,
 			{
 				ListCell   *l;
 
+				/* Params used for runtime partition pruning */
+				finalize_primnode((Node *) ((MergeAppend *) plan)->part_prune_quals,
+								  &context);
+
 				foreach(l, ((MergeAppend *) plan)->mergeplans)
 				{
 					context.paramids =
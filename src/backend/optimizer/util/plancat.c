@@ -1428,6 +1428,47 @@ relation_excluded_by_constraints(PlannerInfo *root,
 	return false;
 }
 
+/*
+ * get_relation_pruning_constraints
+ *
+ * Return the constraints of a partition (or other appendrel member) that
+ * can be used to prove at execution time that it need not be scanned, once
+ * the values of Params in its restriction clauses are known.  This is the
+ * same set of constraints relation_excluded_by_constraints() uses, and NIL
+ * is returned if constraint exclusion is disabled for the rel.
+ */
+List *
+get_relation_pruning_constraints(PlannerInfo *root,
+								 RelOptInfo *rel, RangeTblEntry *rte)
+{
+	List	   *constraint_pred;
+	List	   *safe_constraints;
+	ListCell   *lc;
+
+	if (constraint_exclusion == CONSTRAINT_EXCLUSION_OFF)
+		return NIL;
+	if (rel->reloptkind != RELOPT_OTHER_MEMBER_REL)
+		return NIL;
+
+	/* Only plain relations have constraints */
+	if (rte->rtekind != RTE_RELATION || rte->inh)
+		return NIL;
+
+	constraint_pred = get_relation_constraints(root, rte->relid, rel, true);
+
+	/* As in relation_excluded_by_constraints, ignore mutable constraints */
+	safe_constraints = NIL;
+	foreach(lc, constraint_pred)
+	{
+		Node	   *pred = (Node *) lfirst(lc);
+
+		if (!contain_mutable_functions(pred))
+			safe_constraints = lappend(safe_constraints, pred);
+	}
+
+	return safe_constraints;
+}
+
 
 /*
  * build_physical_tlist
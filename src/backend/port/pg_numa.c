@@ -0,0 +1,237 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_numa.c
+ *	  Minimal portability layer for NUMA memory and CPU placement.
+ *
+ * See src/include/port/pg_numa.h.  The routines here report failure by
+ * returning false (or -1) with errno set, and leave it to the caller to
+ * decide how loudly to complain; placement is only ever an optimization.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/port/pg_numa.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "port/pg_numa.h"
+
+#ifdef USE_PG_NUMA
+
+#include <sched.h>
+#include <unistd.h>
+
+/* From <linux/mempolicy.h>, which we'd rather not depend on */
+#define PG_MPOL_PREFERRED	1
+#define PG_MPOL_INTERLEAVE	3
+
+#define NODEMASK_WORDS	((PG_NUMA_MAX_NODES + 63) / 64)
+
+static bool parse_list(const char *path, bool *members, int nmembers);
+static bool set_node_policy(void *ptr, Size size, int mode,
+				const int *nodes, int nnodes);
+
+
+/*
+ * Read a sysfs list such as "0-3,8,10-11" from the given file, and set
+ * members[i] for each i in the list that is below nmembers.
+ */
+static bool
+parse_list(const char *path, bool *members, int nmembers)
+{
+	FILE	   *fp;
+	char		buf[1024];
+	char	   *p;
+
+	memset(members, 0, nmembers * sizeof(bool));
+
+	fp = fopen(path, "r");
+	if (fp == NULL)
+		return false;
+	if (fgets(buf, sizeof(buf), fp) == NULL)
+	{
+		fclose(fp);
+		errno = EINVAL;
+		return false;
+	}
+	fclose(fp);
+
+	p = buf;
+	while (*p != '\0' && *p != '\n')
+	{
+		char	   *end;
+		long		first;
+		long		last;
+		long		i;
+
+		first = strtol(p, &end, 10);
+		if (end == p)
+		{
+			errno = EINVAL;
+			return false;
+		}
+		last = first;
+		p = end;
+		if (*p == '-')
+		{
+			p++;
+			last = strtol(p, &end, 10);
+			if (end == p)
+			{
+				errno = EINVAL;
+				return false;
+			}
+			p = end;
+		}
+		for (i = Max(first, 0); i <= last && i < nmembers; i++)
+			members[i] = true;
+		if (*p == ',')
+			p++;
+	}
+
+	return true;
+}
+
+/*
+ * Apply a memory policy over the given nodes to a range of our address space.
+ * Pages already faulted in are not moved.
+ */
+static bool
+set_node_policy(void *ptr, Size size, int mode, const int *nodes, int nnodes)
+{
+	unsigned long nodemask[NODEMASK_WORDS];
+	int			i;
+
+	memset(nodemask, 0, sizeof(nodemask));
+	for (i = 0; i < nnodes; i++)
+	{
+		Assert(nodes[i] >= 0 && nodes[i] < PG_NUMA_MAX_NODES);
+		nodemask[nodes[i] / 64] |= 1UL << (nodes[i] % 64);
+	}
+
+	return syscall(SYS_mbind, ptr, (unsigned long) size, mode,
+				   nodemask, (unsigned long) PG_NUMA_MAX_NODES + 1, 0) == 0;
+}
+
+/*
+ * Fill nodes[] with the IDs of the online NUMA nodes, and return how many
+ * there are.  Returns 0 if the topology can't be determined.
+ */
+int
+pg_numa_get_nodes(int *nodes, int maxnodes)
+{
+	bool		online[PG_NUMA_MAX_NODES];
+	int			count = 0;
+	int			i;
+
+	if (!parse_list("/sys/devices/system/node/online",
+					online, PG_NUMA_MAX_NODES))
+		return 0;
+
+	for (i = 0; i < PG_NUMA_MAX_NODES && count < maxnodes; i++)
+	{
+		if (online[i])
+			nodes[count++] = i;
+	}
+
+	return count;
+}
+
+/*
+ * Spread the pages of a memory range round-robin across the given nodes.
+ */
+bool
+pg_numa_interleave(void *ptr, Size size, const int *nodes, int nnodes)
+{
+	return set_node_policy(ptr, size, PG_MPOL_INTERLEAVE, nodes, nnodes);
+}
+
+/*
+ * Ask for the pages of a memory range to be allocated on the given node,
+ * falling back to other nodes if it runs out of memory.
+ */
+bool
+pg_numa_prefer(void *ptr, Size size, int node)
+{
+	return set_node_policy(ptr, size, PG_MPOL_PREFERRED, &node, 1);
+}
+
+/*
+ * Return the node of the CPU we're currently running on, or -1 on failure.
+ */
+int
+pg_numa_current_node(void)
+{
+	unsigned int cpu;
+	unsigned int node;
+
+	if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0)
+		return -1;
+
+	return (int) node;
+}
+
+/*
+ * Restrict the calling process to the CPUs of the given node.
+ */
+bool
+pg_numa_run_on_node(int node)
+{
+	char		path[MAXPGPATH];
+	bool		cpus[CPU_SETSIZE];
+	cpu_set_t	set;
+	int			i;
+
+	snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist",
+			 node);
+	if (!parse_list(path, cpus, CPU_SETSIZE))
+		return false;
+
+	CPU_ZERO(&set);
+	for (i = 0; i < CPU_SETSIZE; i++)
+	{
+		if (cpus[i])
+			CPU_SET(i, &set);
+	}
+
+	return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+#else							/* !USE_PG_NUMA */
+
+int
+pg_numa_get_nodes(int *nodes, int maxnodes)
+{
+	return 0;
+}
+
+bool
+pg_numa_interleave(void *ptr, Size size, const int *nodes, int nnodes)
+{
+	errno = ENOSYS;
+	return false;
+}
+
+bool
+pg_numa_prefer(void *ptr, Size size, int node)
+{
+	errno = ENOSYS;
+	return false;
+}
+
+int
+pg_numa_current_node(void)
+{
+	return -1;
+}
+
+bool
+pg_numa_run_on_node(int node)
+{
+	errno = ENOSYS;
+	return false;
+}
+
+#endif   /* USE_PG_NUMA */
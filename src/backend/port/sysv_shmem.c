@@ -32,6 +32,7 @@
 #endif
 
 #include "miscadmin.h"
+#include "port/pg_numa.h"
 #include "portability/mem.h"
 #include "storage/dsm.h"
 #include "storage/fd.h"
@@ -73,6 +74,7 @@ typedef int IpcMemoryId;		/* shared memory ID returned by shmget(2) */
 
 unsigned long UsedShmemSegID = 0;
 void	   *UsedShmemSegAddr = NULL;
+Size		UsedShmemPageSize = 0;
 
 #ifdef USE_ANONYMOUS_SHMEM
 static Size AnonymousShmemSize;
@@ -461,6 +463,8 @@ CreateAnonymousSegment(Size *size)
 		if (huge_pages == HUGE_PAGES_TRY && ptr == MAP_FAILED)
 			elog(DEBUG1, "mmap(%zu) with MAP_HUGETLB failed, huge pages disabled: %m",
 				 allocsize);
+		if (ptr != MAP_FAILED)
+			UsedShmemPageSize = hugepagesize;
 	}
 #endif
 
@@ -474,6 +478,7 @@ CreateAnonymousSegment(Size *size)
 		ptr = mmap(NULL, allocsize, PROT_READ | PROT_WRITE,
 				   PG_MMAP_FLAGS, -1, 0);
 		mmap_errno = errno;
+		UsedShmemPageSize = sysconf(_SC_PAGESIZE);
 	}
 
 	if (ptr == MAP_FAILED)
@@ -491,6 +496,21 @@ CreateAnonymousSegment(Size *size)
 						 *size) : 0));
 	}
 
+	/*
+	 * If asked to, spread the segment across the NUMA nodes before any of it
+	 * is touched.  With partitioned placement, InitBufferPool() later
+	 * overrides this for the buffers themselves.
+	 */
+	if (numa_buffer_placement != NUMA_PLACEMENT_OFF)
+	{
+		int			nodes[PG_NUMA_MAX_NODES];
+		int			nnodes;
+
+		nnodes = pg_numa_get_nodes(nodes, PG_NUMA_MAX_NODES);
+		if (nnodes > 1 && !pg_numa_interleave(ptr, allocsize, nodes, nnodes))
+			elog(LOG, "could not interleave shared memory across NUMA nodes: %m");
+	}
+
 	*size = allocsize;
 	return ptr;
 }
@@ -565,6 +585,7 @@ PGSharedMemoryCreate(Size size, bool makePrivate, int port,
 	sysvsize = sizeof(PGShmemHeader);
 #else
 	sysvsize = size;
+	UsedShmemPageSize = sysconf(_SC_PAGESIZE);
 #endif
 
 	/* Make sure PGSharedMemoryAttach doesn't fail without need */
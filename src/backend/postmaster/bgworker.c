@@ -16,6 +16,7 @@
 
 #include "libpq/pqsignal.h"
 #include "access/parallel.h"
+#include "access/xlogparallel.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "port/atomics.h"
@@ -125,6 +126,7 @@ static const InternalBGWorkerMain InternalBGWorkers[] = {
 	{"ParallelWorkerMain", ParallelWorkerMain},
 	{"ApplyLauncherMain", ApplyLauncherMain},
 	{"ApplyWorkerMain", ApplyWorkerMain},
+	{"ParallelRedoWorkerMain", ParallelRedoWorkerMain},
 	/* Dummy entry marking end of the array. */
 	{NULL, NULL}
 };
@@ -3542,6 +3542,15 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_EXECUTE_GATHER:
 			event_name = "ExecuteGather";
 			break;
+		case WAIT_EVENT_HASH_BATCH_LOAD:
+			event_name = "HashBatchLoad";
+			break;
+		case WAIT_EVENT_HASH_BUILD:
+			event_name = "HashBuild";
+			break;
+		case WAIT_EVENT_HASH_GROW_BATCHES:
+			event_name = "HashGrowBatches";
+			break;
 		case WAIT_EVENT_MQ_INTERNAL:
 			event_name = "MessageQueueInternal";
 			break;
@@ -3560,6 +3569,12 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_PARALLEL_BITMAP_SCAN:
 			event_name = "ParallelBitmapScan";
 			break;
+		case WAIT_EVENT_PARALLEL_REDO_DISPATCH:
+			event_name = "ParallelRedoDispatch";
+			break;
+		case WAIT_EVENT_PARALLEL_REDO_DRAIN:
+			event_name = "ParallelRedoDrain";
+			break;
 		case WAIT_EVENT_SAFE_SNAPSHOT:
 			event_name = "SafeSnapshot";
 			break;
@@ -5995,6 +6010,9 @@ pgstat_recv_bgwriter(PgStat_MsgBgWriter *msg, int len)
 	globalStats.requested_checkpoints += msg->m_requested_checkpoints;
 	globalStats.checkpoint_write_time += msg->m_checkpoint_write_time;
 	globalStats.checkpoint_sync_time += msg->m_checkpoint_sync_time;
+	globalStats.checkpoint_early_sync_time += msg->m_checkpoint_early_sync_time;
+	globalStats.checkpoint_early_syncs += msg->m_checkpoint_early_syncs;
+	globalStats.checkpoint_syncs += msg->m_checkpoint_syncs;
 	globalStats.buf_written_checkpoints += msg->m_buf_written_checkpoints;
 	globalStats.buf_written_clean += msg->m_buf_written_clean;
 	globalStats.maxwritten_clean += msg->m_maxwritten_clean;
@@ -102,6 +102,12 @@ InitBufferPool(void)
 		ShmemInitStruct("Checkpoint BufferIds",
 						NBuffers * sizeof(CkptSortItem), &foundBufCkpt);
 
+	/*
+	 * Decide on NUMA placement of the buffers, before their memory is first
+	 * touched below.
+	 */
+	BufferNumaInitialize(!foundDescs);
+
 	if (foundDescs || foundBufs || foundIOLocks || foundBufCkpt)
 	{
 		/* should find all of these, or none of them */
@@ -173,6 +179,9 @@ BufferShmemSize(void)
 	/* size of stuff controlled by freelist.c */
 	size = add_size(size, StrategyShmemSize());
 
+	/* size of NUMA bookkeeping in buf_numa.c */
+	size = add_size(size, BufferNumaShmemSize());
+
 	/*
 	 * It would be nice to include the I/O locks in the BufferDesc, but that
 	 * would increase the size of a BufferDesc to more than one cache line,
@@ -0,0 +1,311 @@
+/*-------------------------------------------------------------------------
+ *
+ * buf_numa.c
+ *	  NUMA-aware placement of shared buffers.
+ *
+ * With numa_buffer_placement = partition, the shared buffers (both the
+ * pages and their descriptors) are divided into one contiguous range per
+ * NUMA node, and the memory of each range is placed on its node.  The
+ * clock sweep then prefers victims from the node the backend is running on,
+ * so that pages a backend reads in tend to end up in local memory, and
+ * numa_pin_backends can be used to keep backends from wandering between
+ * nodes.  We also count, per backend, how many buffer hits were on buffers
+ * of the local node and how many on remote ones.
+ *
+ * With numa_buffer_placement = interleave, the whole shared memory segment
+ * is simply interleaved across nodes when it is created (see sysv_shmem.c),
+ * which evens out memory bandwidth but does nothing for locality; none of
+ * the machinery here is active then, except for pinning backends.
+ *
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/buffer/buf_numa.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "miscadmin.h"
+#include "port/pg_numa.h"
+#include "storage/buf_internals.h"
+#include "storage/bufmgr.h"
+#include "storage/pg_shmem.h"
+#include "storage/proc.h"
+#include "storage/shmem.h"
+
+
+/*
+ * How many calls to BufferNumaLocalNode() to answer from the cached node
+ * before asking the kernel again, if the backend isn't pinned to a node.
+ */
+#define NUMA_NODE_RECHECK_INTERVAL	128
+
+/* Per-backend hit counters, for each node's buffers */
+typedef struct BufferNumaHitCounts
+{
+	uint64		local_hits;
+	uint64		remote_hits;
+} BufferNumaHitCounts;
+
+/* GUC variable */
+bool		numa_pin_backends = false;
+
+/*
+ * Layout of the buffer partitions.  This is computed the same way in every
+ * process, so it needn't be in shared memory.  BufferNumaNodes is zero if
+ * the buffers aren't partitioned.
+ */
+int			BufferNumaNodes = 0;
+int			BuffersPerNumaNode = 0;
+static int	NumaNodeIds[PG_NUMA_MAX_NODES];
+
+/* Partition of the node we're running on, or -1 if unknown */
+static int	MyNumaNode = -1;
+static int	MyNumaNodeChecks = 0;
+static bool MyNumaNodePinned = false;
+
+/* Shared array of hit counters, BufferNumaNodes entries per PGPROC */
+static BufferNumaHitCounts *BufferNumaHits = NULL;
+
+static int	BufferNumaComputeLayout(void);
+static int	BufferNumaProcSlots(void);
+static void BufferNumaPreferRange(char *start, char *end, int node);
+
+
+/*
+ * Work out how shared buffers are to be partitioned across nodes, and
+ * return the number of partitions (zero if we're not partitioning).
+ */
+static int
+BufferNumaComputeLayout(void)
+{
+	int			nnodes;
+
+	if (numa_buffer_placement != NUMA_PLACEMENT_PARTITION)
+		return 0;
+
+	nnodes = pg_numa_get_nodes(NumaNodeIds, PG_NUMA_MAX_NODES);
+	if (nnodes < 2)
+		return 0;
+
+	/* Give every partition the same size, except perhaps the last one */
+	BuffersPerNumaNode = (NBuffers + nnodes - 1) / nnodes;
+
+	return (NBuffers + BuffersPerNumaNode - 1) / BuffersPerNumaNode;
+}
+
+/*
+ * Number of PGPROC slots we keep hit counters for.  Prepared transactions'
+ * dummy PGPROCs never read buffers, so we leave them out.
+ */
+static int
+BufferNumaProcSlots(void)
+{
+	return MaxBackends + NUM_AUXILIARY_PROCS;
+}
+
+/*
+ * Estimate space needed for NUMA bookkeeping
+ */
+Size
+BufferNumaShmemSize(void)
+{
+	int			nnodes = BufferNumaComputeLayout();
+
+	if (nnodes == 0)
+		return 0;
+
+	return mul_size(mul_size(BufferNumaProcSlots(), nnodes),
+					sizeof(BufferNumaHitCounts));
+}
+
+/*
+ * Apply a preferred-node memory policy to a range of shared memory.  The
+ * range is shrunk to whole pages of the segment, leaving the pages at the
+ * edges to the segment-wide policy.
+ */
+static void
+BufferNumaPreferRange(char *start, char *end, int node)
+{
+	Size		pagesize = UsedShmemPageSize;
+
+	if (pagesize == 0)
+		return;
+
+	start = (char *) TYPEALIGN(pagesize, start);
+	end = (char *) TYPEALIGN_DOWN(pagesize, end);
+	if (end <= start)
+		return;
+
+	if (!pg_numa_prefer(start, end - start, node))
+		elog(LOG, "could not place shared buffers on NUMA node %d: %m", node);
+}
+
+/*
+ * Set up the partitioning of shared buffers across NUMA nodes.
+ *
+ * Called from InitBufferPool() once the buffer arrays have been allocated,
+ * but before they have been initialized; init is true if we're the process
+ * creating them.
+ */
+void
+BufferNumaInitialize(bool init)
+{
+	bool		found;
+	int			i;
+
+	BufferNumaNodes = BufferNumaComputeLayout();
+	if (BufferNumaNodes == 0)
+		return;
+
+	BufferNumaHits = (BufferNumaHitCounts *)
+		ShmemInitStruct("Buffer NUMA Hit Counts",
+						BufferNumaShmemSize(), &found);
+	if (found)
+		return;
+	Assert(init);
+
+	memset(BufferNumaHits, 0, BufferNumaShmemSize());
+
+	/*
+	 * Place each partition's pages and descriptors on its node.  Nothing has
+	 * touched that memory yet, so this determines where it's allocated.
+	 */
+	for (i = 0; i < BufferNumaNodes; i++)
+	{
+		int			first = BufferNumaNodeFirst(i);
+		int			nbuffers = BufferNumaNodeSize(i);
+
+		BufferNumaPreferRange(BufferBlocks + (Size) first * BLCKSZ,
+							  BufferBlocks + (Size) (first + nbuffers) * BLCKSZ,
+							  NumaNodeIds[i]);
+		BufferNumaPreferRange((char *) GetBufferDescriptor(first),
+							  (char *) GetBufferDescriptor(first) +
+							  (Size) nbuffers * sizeof(BufferDescPadded),
+							  NumaNodeIds[i]);
+	}
+}
+
+/*
+ * Return the buffer partition belonging to the node we're running on, or -1
+ * if buffers aren't partitioned or we can't tell.
+ */
+int
+BufferNumaLocalNode(void)
+{
+	if (BufferNumaNodes == 0)
+		return -1;
+
+	if (!MyNumaNodePinned && --MyNumaNodeChecks <= 0)
+	{
+		int			node = pg_numa_current_node();
+		int			i;
+
+		MyNumaNode = -1;
+		for (i = 0; i < BufferNumaNodes; i++)
+		{
+			if (NumaNodeIds[i] == node)
+			{
+				MyNumaNode = i;
+				break;
+			}
+		}
+		MyNumaNodeChecks = NUMA_NODE_RECHECK_INTERVAL;
+	}
+
+	return MyNumaNode;
+}
+
+/*
+ * Count a hit on the given shared buffer as local or remote.  Only to be
+ * called when buffers are partitioned; see BufferNumaCountHit().
+ */
+void
+BufferNumaCountHitInternal(int buf_id)
+{
+	BufferNumaHitCounts *counts;
+	int			node = BufferNumaNodeOf(buf_id);
+	int			local = BufferNumaLocalNode();
+
+	if (MyProc == NULL || MyProc->pgprocno >= BufferNumaProcSlots())
+		return;
+
+	/*
+	 * Only this backend ever writes its own counters, so no locking is
+	 * needed; readers may see slightly stale values.
+	 */
+	counts = &BufferNumaHits[MyProc->pgprocno * BufferNumaNodes + node];
+	if (node == local)
+		counts->local_hits++;
+	else
+		counts->remote_hits++;
+}
+
+/*
+ * Report a buffer partition's node, size, and the hits on its buffers from
+ * backends on the same node and on other nodes, summed over all backends.
+ */
+void
+BufferNumaGetStats(int node, int *os_node, int *nbuffers,
+				   uint64 *local_hits, uint64 *remote_hits)
+{
+	int			i;
+
+	Assert(node >= 0 && node < BufferNumaNodes);
+
+	*os_node = NumaNodeIds[node];
+	*nbuffers = BufferNumaNodeSize(node);
+	*local_hits = 0;
+	*remote_hits = 0;
+
+	for (i = 0; i < BufferNumaProcSlots(); i++)
+	{
+		BufferNumaHitCounts *counts = &BufferNumaHits[i * BufferNumaNodes + node];
+
+		*local_hits += counts->local_hits;
+		*remote_hits += counts->remote_hits;
+	}
+}
+
+/*
+ * If numa_pin_backends is set, restrict this backend to the CPUs of one NUMA
+ * node, chosen round-robin by PGPROC number so that backends are spread
+ * evenly.  Called once MyProc has been set up.
+ */
+void
+BufferNumaPinBackend(void)
+{
+	int			nodes[PG_NUMA_MAX_NODES];
+	int			nnodes;
+	int			index;
+
+	if (!numa_pin_backends || numa_buffer_placement == NUMA_PLACEMENT_OFF)
+		return;
+
+	nnodes = pg_numa_get_nodes(nodes, PG_NUMA_MAX_NODES);
+	if (nnodes < 2)
+		return;
+
+	/*
+	 * Use only nodes that hold a buffer partition, if any, so that all the
+	 * pinned backends have local buffers to use.
+	 */
+	if (BufferNumaNodes > 0)
+		nnodes = BufferNumaNodes;
+
+	index = MyProc->pgprocno % nnodes;
+	if (!pg_numa_run_on_node(nodes[index]))
+	{
+		elog(LOG, "could not bind process to NUMA node %d: %m", nodes[index]);
+		return;
+	}
+
+	if (BufferNumaNodes > 0)
+	{
+		MyNumaNode = index;
+		MyNumaNodePinned = true;
+	}
+}
@@ -3,11 +3,23 @@
  * buf_table.c
  *	  routines for mapping BufferTags to buffer indexes.
  *
- * Note: the routines in this file do no locking of their own.  The caller
- * must hold a suitable lock on the appropriate BufMappingLock, as specified
- * in the comments.  We can't do the locking inside these functions because
- * in most cases the caller needs to adjust the buffer header contents
- * before the lock is released (see notes in README).
+ * The mapping table is a purpose-built open-addressing hash table rather
+ * than a dynahash table.  It is divided into NUM_BUFFER_PARTITIONS segments,
+ * one per buffer mapping partition, and a tag is always stored in the
+ * segment of the partition its hash code belongs to.  Within a segment we
+ * use linear probing, and deletions shift later entries back to close the
+ * gap, so no tombstones are needed.
+ *
+ * Modifications are made only while holding the partition's BufMappingLock
+ * in exclusive mode; the routines in this file do no locking of their own
+ * for that, since in most cases the caller needs to adjust the buffer header
+ * contents before the lock is released (see notes in README).  Lookups,
+ * however, need no lock at all: each segment carries a change counter that
+ * writers advance to an odd value before modifying the segment and back to
+ * an even value afterwards, and readers retry whenever the counter was odd
+ * or changed while they were probing.  A lookup result is therefore only a
+ * hint unless the caller holds the partition lock; callers that don't must
+ * recheck the buffer's tag once they've pinned it.
  *
  *
  * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
@@ -21,20 +33,71 @@
  */
 #include "postgres.h"
 
+#include "access/hash.h"
+#include "port/atomics.h"
 #include "storage/bufmgr.h"
 #include "storage/buf_internals.h"
+#include "storage/shmem.h"
+#include "storage/s_lock.h"
+
 
+/*
+ * Each segment is sized for BUFTABLE_FILL_FACTOR times its expected share of
+ * the entries, so that probe sequences stay short and a segment receiving a
+ * statistically unlikely number of tags still has room.
+ */
+#define BUFTABLE_FILL_FACTOR		2
+#define BUFTABLE_MIN_SEGMENT_SIZE	16
 
 /* entry for buffer lookup hashtable */
 typedef struct
 {
 	BufferTag	key;			/* Tag of a disk page */
-	int			id;				/* Associated buffer ID */
+	uint32		hashcode;		/* hash code of key */
+	int			id;				/* Associated buffer ID, or -1 if unused */
 } BufferLookupEnt;
 
-static HTAB *SharedBufHash;
+/*
+ * Per-segment header.  Padded to a full cache line so that writers in one
+ * partition don't disturb readers of the neighbouring ones.
+ */
+typedef union BufTableSegment
+{
+	pg_atomic_uint32 changecount;	/* odd while the segment is modified */
+	char		pad[PG_CACHE_LINE_SIZE];
+} BufTableSegment;
+
+static BufTableSegment *BufTableSegments;
+static BufferLookupEnt *BufTableEntries;
+static uint32 BufTableSegmentMask;	/* entries per segment, minus one */
+
+#define BufTableSegmentEntries(partition) \
+	(&BufTableEntries[(Size) (partition) * (BufTableSegmentMask + 1)])
+#define BufTableHomeSlot(hashcode) \
+	(((hashcode) / NUM_BUFFER_PARTITIONS) & BufTableSegmentMask)
+
+static uint32 BufTableSegmentSize(int size);
+static int	BufTableProbe(BufferLookupEnt *entries, BufferTag *tagPtr,
+			  uint32 hashcode);
 
 
+/*
+ * Compute the number of entries in each segment, which is a power of 2
+ *		size is the desired hash table size (possibly more than NBuffers)
+ */
+static uint32
+BufTableSegmentSize(int size)
+{
+	uint32		per_segment;
+	uint32		result = BUFTABLE_MIN_SEGMENT_SIZE;
+
+	per_segment = (size + NUM_BUFFER_PARTITIONS - 1) / NUM_BUFFER_PARTITIONS;
+	while (result < per_segment * BUFTABLE_FILL_FACTOR)
+		result <<= 1;
+
+	return result;
+}
+
 /*
  * Estimate space needed for mapping hashtable
  *		size is the desired hash table size (possibly more than NBuffers)
@@ -42,7 +105,14 @@ static HTAB *SharedBufHash;
 Size
 BufTableShmemSize(int size)
 {
-	return hash_estimate_size(size, sizeof(BufferLookupEnt));
+	Size		sz;
+
+	sz = mul_size(NUM_BUFFER_PARTITIONS, sizeof(BufTableSegment));
+	sz = add_size(sz, mul_size(mul_size(NUM_BUFFER_PARTITIONS,
+										BufTableSegmentSize(size)),
+							   sizeof(BufferLookupEnt)));
+
+	return sz;
 }
 
 /*
@@ -52,19 +122,31 @@ BufTableShmemSize(int size)
 void
 InitBufTable(int size)
 {
-	HASHCTL		info;
+	uint32		segsize = BufTableSegmentSize(size);
+	Size		nentries = (Size) NUM_BUFFER_PARTITIONS * segsize;
+	bool		found;
+	char	   *ptr;
 
 	/* assume no locking is needed yet */
 
-	/* BufferTag maps to Buffer */
-	info.keysize = sizeof(BufferTag);
-	info.entrysize = sizeof(BufferLookupEnt);
-	info.num_partitions = NUM_BUFFER_PARTITIONS;
+	ptr = ShmemInitStruct("Shared Buffer Lookup Table",
+						  BufTableShmemSize(size), &found);
+
+	BufTableSegments = (BufTableSegment *) ptr;
+	BufTableEntries = (BufferLookupEnt *)
+		(ptr + NUM_BUFFER_PARTITIONS * sizeof(BufTableSegment));
+	BufTableSegmentMask = segsize - 1;
+
+	if (!found)
+	{
+		Size		i;
 
-	SharedBufHash = ShmemInitHash("Shared Buffer Lookup Table",
-								  size, size,
-								  &info,
-								  HASH_ELEM | HASH_BLOBS | HASH_PARTITION);
+		for (i = 0; i < NUM_BUFFER_PARTITIONS; i++)
+			pg_atomic_init_u32(&BufTableSegments[i].changecount, 0);
+
+		for (i = 0; i < nentries; i++)
+			BufTableEntries[i].id = -1;
+	}
 }
 
 /*
@@ -79,31 +161,83 @@ InitBufTable(int size)
 uint32
 BufTableHashCode(BufferTag *tagPtr)
 {
-	return get_hash_value(SharedBufHash, (void *) tagPtr);
+	return DatumGetUInt32(hash_any((const unsigned char *) tagPtr,
+								   sizeof(BufferTag)));
+}
+
+/*
+ * Find the slot holding the given tag in a segment, or -1 if there is none.
+ *
+ * The probe is bounded by the segment size, so that a reader racing with a
+ * writer can't loop forever on an inconsistent view of the segment.
+ */
+static int
+BufTableProbe(BufferLookupEnt *entries, BufferTag *tagPtr, uint32 hashcode)
+{
+	uint32		slot = BufTableHomeSlot(hashcode);
+	uint32		i;
+
+	for (i = 0; i <= BufTableSegmentMask; i++)
+	{
+		BufferLookupEnt *ent = &entries[slot];
+
+		if (ent->id < 0)
+			break;
+		if (ent->hashcode == hashcode && BUFFERTAGS_EQUAL(ent->key, *tagPtr))
+			return (int) slot;
+		slot = (slot + 1) & BufTableSegmentMask;
+	}
+
+	return -1;
 }
 
 /*
  * BufTableLookup
  *		Lookup the given BufferTag; return buffer ID, or -1 if not found
  *
- * Caller must hold at least share lock on BufMappingLock for tag's partition
+ * No lock is required.  If the caller holds at least share lock on the
+ * BufMappingLock for tag's partition, the result is exact; otherwise it
+ * reflects some recent state of the mapping, and the caller must verify the
+ * buffer's tag after pinning it.
  */
 int
 BufTableLookup(BufferTag *tagPtr, uint32 hashcode)
 {
-	BufferLookupEnt *result;
+	uint32		partition = BufTableHashPartition(hashcode);
+	BufTableSegment *seg = &BufTableSegments[partition];
+	BufferLookupEnt *entries = BufTableSegmentEntries(partition);
+	SpinDelayStatus delayStatus;
+
+	init_local_spin_delay(&delayStatus);
 
-	result = (BufferLookupEnt *)
-		hash_search_with_hash_value(SharedBufHash,
-									(void *) tagPtr,
-									hashcode,
-									HASH_FIND,
-									NULL);
+	for (;;)
+	{
+		uint32		before;
+		int			slot;
+		int			result = -1;
 
-	if (!result)
-		return -1;
+		before = pg_atomic_read_u32(&seg->changecount);
+		if (before & 1)
+		{
+			/* a writer is busy with this segment; wait for it to finish */
+			perform_spin_delay(&delayStatus);
+			continue;
+		}
 
-	return result->id;
+		pg_read_barrier();
+
+		slot = BufTableProbe(entries, tagPtr, hashcode);
+		if (slot >= 0)
+			result = entries[slot].id;
+
+		pg_read_barrier();
+
+		if (pg_atomic_read_u32(&seg->changecount) == before)
+		{
+			finish_spin_delay(&delayStatus);
+			return result;
+		}
+	}
 }
 
 /*
@@ -119,25 +253,46 @@ BufTableLookup(BufferTag *tagPtr, uint32 hashcode)
 int
 BufTableInsert(BufferTag *tagPtr, uint32 hashcode, int buf_id)
 {
-	BufferLookupEnt *result;
-	bool		found;
+	uint32		partition = BufTableHashPartition(hashcode);
+	BufTableSegment *seg = &BufTableSegments[partition];
+	BufferLookupEnt *entries = BufTableSegmentEntries(partition);
+	uint32		slot = BufTableHomeSlot(hashcode);
+	uint32		i;
 
 	Assert(buf_id >= 0);		/* -1 is reserved for not-in-table */
 	Assert(tagPtr->blockNum != P_NEW);	/* invalid tag */
+	Assert(LWLockHeldByMeInMode(BufMappingPartitionLock(hashcode),
+								LW_EXCLUSIVE));
 
-	result = (BufferLookupEnt *)
-		hash_search_with_hash_value(SharedBufHash,
-									(void *) tagPtr,
-									hashcode,
-									HASH_ENTER,
-									&found);
+	for (i = 0; i <= BufTableSegmentMask; i++)
+	{
+		BufferLookupEnt *ent = &entries[slot];
 
-	if (found)					/* found something already in the table */
-		return result->id;
+		if (ent->id < 0)
+		{
+			/* advancing the counter to an odd value also acts as a barrier */
+			pg_atomic_fetch_add_u32(&seg->changecount, 1);
+			ent->key = *tagPtr;
+			ent->hashcode = hashcode;
+			ent->id = buf_id;
+			pg_atomic_fetch_add_u32(&seg->changecount, 1);
 
-	result->id = buf_id;
+			return -1;
+		}
 
-	return -1;
+		/* found something already in the table */
+		if (ent->hashcode == hashcode && BUFFERTAGS_EQUAL(ent->key, *tagPtr))
+			return ent->id;
+
+		slot = (slot + 1) & BufTableSegmentMask;
+	}
+
+	ereport(ERROR,
+			(errcode(ERRCODE_OUT_OF_MEMORY),
+			 errmsg("out of shared memory"),
+			 errdetail("Shared buffer lookup table partition %u is full.",
+					   partition)));
+	return -1;					/* keep compiler quiet */
 }
 
 /*
@@ -149,15 +304,44 @@ BufTableInsert(BufferTag *tagPtr, uint32 hashcode, int buf_id)
 void
 BufTableDelete(BufferTag *tagPtr, uint32 hashcode)
 {
-	BufferLookupEnt *result;
+	uint32		partition = BufTableHashPartition(hashcode);
+	BufTableSegment *seg = &BufTableSegments[partition];
+	BufferLookupEnt *entries = BufTableSegmentEntries(partition);
+	int			found;
+	uint32		hole;
+	uint32		slot;
 
-	result = (BufferLookupEnt *)
-		hash_search_with_hash_value(SharedBufHash,
-									(void *) tagPtr,
-									hashcode,
-									HASH_REMOVE,
-									NULL);
+	Assert(LWLockHeldByMeInMode(BufMappingPartitionLock(hashcode),
+								LW_EXCLUSIVE));
 
-	if (!result)				/* shouldn't happen */
+	found = BufTableProbe(entries, tagPtr, hashcode);
+	if (found < 0)				/* shouldn't happen */
 		elog(ERROR, "shared buffer hash table corrupted");
+
+	pg_atomic_fetch_add_u32(&seg->changecount, 1);
+
+	/*
+	 * Move back any later entries of the same probe run that could live in
+	 * the vacated slot, so that lookups never stop short at an empty slot
+	 * in front of the entry they're looking for.  An entry can move into the
+	 * hole if the hole lies cyclically between its home slot and its current
+	 * slot.
+	 */
+	hole = (uint32) found;
+	slot = (hole + 1) & BufTableSegmentMask;
+	while (entries[slot].id >= 0)
+	{
+		uint32		home = BufTableHomeSlot(entries[slot].hashcode);
+
+		if (((slot - home) & BufTableSegmentMask) >=
+			((slot - hole) & BufTableSegmentMask))
+		{
+			entries[hole] = entries[slot];
+			hole = slot;
+		}
+		slot = (slot + 1) & BufTableSegmentMask;
+	}
+	entries[hole].id = -1;
+
+	pg_atomic_fetch_add_u32(&seg->changecount, 1);
 }
@@ -128,9 +128,19 @@ int			backend_flush_after = 0;
  */
 int			target_prefetch_pages = 0;
 
-/* local state for StartBufferIO and related functions */
-static BufferDesc *InProgressBuf = NULL;
-static bool IsForInput;
+/*
+ * local state for StartBufferIO and related functions
+ *
+ * A backend usually has I/O in progress on at most one buffer at a time.
+ * ReadBufferRange() however starts input on up to MAX_IO_COMBINE_BLOCKS
+ * buffers before reading them all at once, and allocating those buffers may
+ * require writing out a dirty victim buffer meanwhile.
+ */
+#define MAX_IN_PROGRESS_BUFS	(MAX_IO_COMBINE_BLOCKS + 1)
+
+static BufferDesc *InProgressBufs[MAX_IN_PROGRESS_BUFS];
+static bool InProgressIsForInput[MAX_IN_PROGRESS_BUFS];
+static int	NumInProgressBufs = 0;
 
 /* local state for LockBufferForCleanup */
 static BufferDesc *PinCountWaitBuf = NULL;
@@ -432,6 +442,8 @@ static Buffer ReadBuffer_common(SMgrRelation reln, char relpersistence,
 				  ForkNumber forkNum, BlockNumber blockNum,
 				  ReadBufferMode mode, BufferAccessStrategy strategy,
 				  bool *hit);
+static void ReadBufferRangeIO(SMgrRelation smgr, ForkNumber forkNum,
+				  BlockNumber blockNum, BufferDesc **bufs, int nbufs);
 static bool PinBuffer(BufferDesc *buf, BufferAccessStrategy strategy);
 static void PinBuffer_Locked(BufferDesc *buf);
 static void UnpinBuffer(BufferDesc *buf, bool fixOwner);
@@ -456,6 +468,9 @@ static void CheckForBufferLeaks(void);
 static int	rnode_comparator(const void *p1, const void *p2);
 static int	buffertag_comparator(const void *p1, const void *p2);
 static int	ckpt_buforder_comparator(const void *pa, const void *pb);
+static inline bool ckpt_same_segment(const CkptSortItem *a,
+				  const CkptSortItem *b);
+static void CheckpointSyncEarly(const CkptSortItem *item);
 static int	ts_ckpt_progress_comparator(Datum a, Datum b, void *arg);
 
 
@@ -548,41 +563,65 @@ PrefetchBuffer(Relation reln, ForkNumber forkNum, BlockNumber blockNum)
 	}
 	else
 	{
-		BufferTag	newTag;		/* identity of requested block */
-		uint32		newHash;	/* hash value for newTag */
-		LWLock	   *newPartitionLock;	/* buffer partition lock for it */
-		int			buf_id;
-
-		/* create a tag so we can lookup the buffer */
-		INIT_BUFFERTAG(newTag, reln->rd_smgr->smgr_rnode.node,
-					   forkNum, blockNum);
-
-		/* determine its hash code and partition lock ID */
-		newHash = BufTableHashCode(&newTag);
-		newPartitionLock = BufMappingPartitionLock(newHash);
-
-		/* see if the block is in the buffer pool already */
-		LWLockAcquire(newPartitionLock, LW_SHARED);
-		buf_id = BufTableLookup(&newTag, newHash);
-		LWLockRelease(newPartitionLock);
+		/* pass it to the shared buffer version */
+		(void) PrefetchSharedBuffer(reln->rd_smgr, forkNum, blockNum);
+	}
+#endif   /* USE_PREFETCH */
+}
 
-		/* If not in buffers, initiate prefetch */
-		if (buf_id < 0)
-			smgrprefetch(reln->rd_smgr, forkNum, blockNum);
+/*
+ * PrefetchSharedBuffer -- initiate asynchronous read of a block of a
+ *		relation that uses shared buffers
+ *
+ * This is the guts of PrefetchBuffer() for shared buffers, usable by callers
+ * that only have an SMgrRelation, such as WAL replay.  Returns true if a
+ * prefetch was issued, false if the block was found in shared buffers (or
+ * prefetching isn't compiled in).
+ */
+bool
+PrefetchSharedBuffer(SMgrRelation smgr_reln, ForkNumber forkNum,
+					 BlockNumber blockNum)
+{
+#ifdef USE_PREFETCH
+	BufferTag	newTag;			/* identity of requested block */
+	uint32		newHash;		/* hash value for newTag */
+	int			buf_id;
 
-		/*
-		 * If the block *is* in buffers, we do nothing.  This is not really
-		 * ideal: the block might be just about to be evicted, which would be
-		 * stupid since we know we are going to need it soon.  But the only
-		 * easy answer is to bump the usage_count, which does not seem like a
-		 * great solution: when the caller does ultimately touch the block,
-		 * usage_count would get bumped again, resulting in too much
-		 * favoritism for blocks that are involved in a prefetch sequence. A
-		 * real fix would involve some additional per-buffer state, and it's
-		 * not clear that there's enough of a problem to justify that.
-		 */
+	Assert(BlockNumberIsValid(blockNum));
+
+	/* create a tag so we can lookup the buffer */
+	INIT_BUFFERTAG(newTag, smgr_reln->smgr_rnode.node, forkNum, blockNum);
+
+	/* determine its hash code */
+	newHash = BufTableHashCode(&newTag);
+
+	/*
+	 * See if the block is in the buffer pool already.  We don't need the
+	 * mapping lock for this: the answer is only a hint anyway, since the
+	 * buffer could be evicted as soon as we looked.
+	 */
+	buf_id = BufTableLookup(&newTag, newHash);
+
+	/* If not in buffers, initiate prefetch */
+	if (buf_id < 0)
+	{
+		smgrprefetch(smgr_reln, forkNum, blockNum);
+		return true;
 	}
+
+	/*
+	 * If the block *is* in buffers, we do nothing.  This is not really
+	 * ideal: the block might be just about to be evicted, which would be
+	 * stupid since we know we are going to need it soon.  But the only easy
+	 * answer is to bump the usage_count, which does not seem like a great
+	 * solution: when the caller does ultimately touch the block, usage_count
+	 * would get bumped again, resulting in too much favoritism for blocks
+	 * that are involved in a prefetch sequence. A real fix would involve some
+	 * additional per-buffer state, and it's not clear that there's enough of
+	 * a problem to justify that.
+	 */
 #endif   /* USE_PREFETCH */
+	return false;
 }
 
 
@@ -693,6 +732,182 @@ ReadBufferWithoutRelcache(RelFileNode rnode, ForkNumber forkNum,
 							 mode, strategy, &hit);
 }
 
+/*
+ * ReadBufferRange -- pin a range of consecutive blocks of a relation
+ *
+ * This is like calling ReadBufferExtended() in RBM_NORMAL mode for each of
+ * blockNum .. blockNum + nblocks - 1, and storing the results in buffers[],
+ * but consecutive blocks that are not already in shared buffers are read
+ * from disk with a single smgrreadv() call, up to MAX_IO_COMBINE_BLOCKS at
+ * a time, rather than one block per system call.  All the blocks must exist.
+ *
+ * Since the caller gets all the pins at once, it should be prepared to
+ * release the pins on any pages it turns out not to need.
+ */
+void
+ReadBufferRange(Relation reln, ForkNumber forkNum, BlockNumber blockNum,
+				int nblocks, BufferAccessStrategy strategy, Buffer *buffers)
+{
+	SMgrRelation smgr;
+	BufferDesc *run[MAX_IO_COMBINE_BLOCKS];
+	BlockNumber runStart = InvalidBlockNumber;
+	int			nrun = 0;
+	int			i;
+
+	/* Open it at the smgr level if not already done */
+	RelationOpenSmgr(reln);
+	smgr = reln->rd_smgr;
+
+	/*
+	 * Local buffers are cheap to read one by one, and ReadBufferExtended
+	 * takes care of rejecting other sessions' temporary relations.
+	 */
+	if (SmgrIsTemp(smgr) || RELATION_IS_OTHER_TEMP(reln))
+	{
+		for (i = 0; i < nblocks; i++)
+			buffers[i] = ReadBufferExtended(reln, forkNum, blockNum + i,
+											RBM_NORMAL, strategy);
+		return;
+	}
+
+	for (i = 0; i < nblocks; i++)
+	{
+		BlockNumber blkno = blockNum + i;
+		BufferDesc *bufHdr;
+		bool		found;
+
+		/* Make sure we will have room to remember the buffer pin */
+		ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+
+		TRACE_POSTGRESQL_BUFFER_READ_START(forkNum, blkno,
+										   smgr->smgr_rnode.node.spcNode,
+										   smgr->smgr_rnode.node.dbNode,
+										   smgr->smgr_rnode.node.relNode,
+										   smgr->smgr_rnode.backend,
+										   false);
+
+		/*
+		 * Look up the buffer.  IO_IN_PROGRESS is set if the requested block
+		 * is not currently in memory.
+		 */
+		pgstat_count_buffer_read(reln);
+		bufHdr = BufferAlloc(smgr, reln->rd_rel->relpersistence, forkNum,
+							 blkno, strategy, &found);
+		buffers[i] = BufferDescriptorGetBuffer(bufHdr);
+
+		if (found)
+		{
+			/* A resident block ends the current run of blocks to read */
+			if (nrun > 0)
+			{
+				ReadBufferRangeIO(smgr, forkNum, runStart, run, nrun);
+				nrun = 0;
+			}
+
+			pgBufferUsage.shared_blks_hit++;
+			BufferNumaCountHit(bufHdr->buf_id);
+			pgstat_count_buffer_hit(reln);
+			VacuumPageHit++;
+			if (VacuumCostActive)
+				VacuumCostBalance += VacuumCostPageHit;
+
+			TRACE_POSTGRESQL_BUFFER_READ_DONE(forkNum, blkno,
+											  smgr->smgr_rnode.node.spcNode,
+											  smgr->smgr_rnode.node.dbNode,
+											  smgr->smgr_rnode.node.relNode,
+											  smgr->smgr_rnode.backend,
+											  false,
+											  found);
+			continue;
+		}
+
+		pgBufferUsage.shared_blks_read++;
+
+		if (nrun == 0)
+			runStart = blkno;
+		run[nrun++] = bufHdr;
+
+		if (nrun == MAX_IO_COMBINE_BLOCKS)
+		{
+			ReadBufferRangeIO(smgr, forkNum, runStart, run, nrun);
+			nrun = 0;
+		}
+	}
+
+	if (nrun > 0)
+		ReadBufferRangeIO(smgr, forkNum, runStart, run, nrun);
+}
+
+/*
+ * ReadBufferRangeIO -- subroutine for ReadBufferRange
+ *
+ * Read consecutive blocks, starting at blockNum, into the given shared
+ * buffers, which must all have I/O in progress started by BufferAlloc.
+ * On return, the buffers are valid and their I/O is terminated.
+ */
+static void
+ReadBufferRangeIO(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
+				  BufferDesc **bufs, int nbufs)
+{
+	char	   *blocks[MAX_IO_COMBINE_BLOCKS];
+	instr_time	io_start,
+				io_time;
+	int			i;
+
+	for (i = 0; i < nbufs; i++)
+		blocks[i] = (char *) BufHdrGetBlock(bufs[i]);
+
+	if (track_io_timing)
+		INSTR_TIME_SET_CURRENT(io_start);
+
+	smgrreadv(smgr, forkNum, blockNum, blocks, nbufs);
+
+	if (track_io_timing)
+	{
+		INSTR_TIME_SET_CURRENT(io_time);
+		INSTR_TIME_SUBTRACT(io_time, io_start);
+		pgstat_count_buffer_read_time(INSTR_TIME_GET_MICROSEC(io_time));
+		INSTR_TIME_ADD(pgBufferUsage.blk_read_time, io_time);
+	}
+
+	for (i = 0; i < nbufs; i++)
+	{
+		/* check for garbage data, as ReadBuffer_common does */
+		if (!PageIsVerified((Page) blocks[i], blockNum + i))
+		{
+			if (zero_damaged_pages)
+			{
+				ereport(WARNING,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("invalid page in block %u of relation %s; zeroing out page",
+								blockNum + i,
+								relpath(smgr->smgr_rnode, forkNum))));
+				MemSet(blocks[i], 0, BLCKSZ);
+			}
+			else
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("invalid page in block %u of relation %s",
+								blockNum + i,
+								relpath(smgr->smgr_rnode, forkNum))));
+		}
+
+		/* Set BM_VALID, terminate IO, and wake up any waiters */
+		TerminateBufferIO(bufs[i], false, BM_VALID);
+
+		VacuumPageMiss++;
+		if (VacuumCostActive)
+			VacuumCostBalance += VacuumCostPageMiss;
+
+		TRACE_POSTGRESQL_BUFFER_READ_DONE(forkNum, blockNum + i,
+										  smgr->smgr_rnode.node.spcNode,
+										  smgr->smgr_rnode.node.dbNode,
+										  smgr->smgr_rnode.node.relNode,
+										  smgr->smgr_rnode.backend,
+										  false,
+										  false);
+	}
+}
 
 /*
  * ReadBuffer_common -- common logic for all ReadBuffer variants
@@ -745,7 +960,10 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 		bufHdr = BufferAlloc(smgr, relpersistence, forkNum, blockNum,
 							 strategy, &found);
 		if (found)
+		{
 			pgBufferUsage.shared_blks_hit++;
+			BufferNumaCountHit(bufHdr->buf_id);
+		}
 		else
 			pgBufferUsage.shared_blks_read++;
 	}
@@ -1008,23 +1226,39 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	newHash = BufTableHashCode(&newTag);
 	newPartitionLock = BufMappingPartitionLock(newHash);
 
-	/* see if the block is in the buffer pool already */
-	LWLockAcquire(newPartitionLock, LW_SHARED);
+	/*
+	 * See if the block is in the buffer pool already.  The lookup doesn't
+	 * need the mapping lock, but then nothing stops the buffer from being
+	 * reassigned to another page before we manage to pin it.  So pin it, and
+	 * then recheck its tag: once pinned, its identity can't change anymore.
+	 * If somebody did get there first, just proceed as if we hadn't found
+	 * it; the insertion below copes with the page having been read in
+	 * meanwhile.
+	 */
 	buf_id = BufTableLookup(&newTag, newHash);
 	if (buf_id >= 0)
 	{
-		/*
-		 * Found it.  Now, pin the buffer so no one can steal it from the
-		 * buffer pool, and check to see if the correct data has been loaded
-		 * into the buffer.
-		 */
 		buf = GetBufferDescriptor(buf_id);
 
 		valid = PinBuffer(buf, strategy);
 
-		/* Can release the mapping lock as soon as we've pinned it */
-		LWLockRelease(newPartitionLock);
-
+		buf_state = LockBufHdr(buf);
+		if (!(buf_state & BM_TAG_VALID) || !BUFFERTAGS_EQUAL(buf->tag, newTag))
+		{
+			UnlockBufHdr(buf, buf_state);
+			UnpinBuffer(buf, true);
+			buf_id = -1;
+		}
+		else
+			UnlockBufHdr(buf, buf_state);
+	}
+	if (buf_id >= 0)
+	{
+		/*
+		 * Found it, and it's pinned so no one can steal it from the buffer
+		 * pool.  Check to see if the correct data has been loaded into the
+		 * buffer.
+		 */
 		*foundPtr = TRUE;
 
 		if (!valid)
@@ -1051,11 +1285,8 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 
 	/*
 	 * Didn't find it in the buffer pool.  We'll have to initialize a new
-	 * buffer.  Remember to unlock the mapping lock while doing the work.
+	 * buffer.  Loop here in case we have to try another victim buffer.
 	 */
-	LWLockRelease(newPartitionLock);
-
-	/* Loop here in case we have to try another victim buffer */
 	for (;;)
 	{
 		/*
@@ -1838,6 +2069,7 @@ BufferSync(int flags)
 			item = &CkptBufferIds[num_to_scan++];
 			item->buf_id = buf_id;
 			item->tsId = bufHdr->tag.rnode.spcNode;
+			item->dbNode = bufHdr->tag.rnode.dbNode;
 			item->relNode = bufHdr->tag.rnode.relNode;
 			item->forkNum = bufHdr->tag.forkNum;
 			item->blockNum = bufHdr->tag.blockNum;
@@ -1959,8 +2191,9 @@ BufferSync(int flags)
 		BufferDesc *bufHdr = NULL;
 		CkptTsStatus *ts_stat = (CkptTsStatus *)
 		DatumGetPointer(binaryheap_first(ts_heap));
+		CkptSortItem *item = &CkptBufferIds[ts_stat->index];
 
-		buf_id = CkptBufferIds[ts_stat->index].buf_id;
+		buf_id = item->buf_id;
 		Assert(buf_id != -1);
 
 		bufHdr = GetBufferDescriptor(buf_id);
@@ -2001,11 +2234,23 @@ BufferSync(int flags)
 		if (ts_stat->num_scanned == ts_stat->num_to_scan)
 		{
 			binaryheap_remove_first(ts_heap);
+			CheckpointSyncEarly(item);
 		}
 		else
 		{
 			/* update heap with the new progress */
 			binaryheap_replace_first(ts_heap, PointerGetDatum(ts_stat));
+
+			/*
+			 * As the buffers are sorted, the checkpoint won't write to this
+			 * segment again if the next buffer of the tablespace is in
+			 * another one.  Sync it now instead of leaving it for the end of
+			 * the checkpoint; the fsyncs are then spread over the write
+			 * phase and paced along with the writes, and interleave across
+			 * tablespaces just like the writes do.
+			 */
+			if (!ckpt_same_segment(item, &CkptBufferIds[ts_stat->index]))
+				CheckpointSyncEarly(item);
 		}
 
 		/*
@@ -2452,15 +2697,17 @@ InitBufferPoolAccess(void)
  * InitBufferPoolBackend --- second-stage initialization of a new backend
  *
  * This is called after we have acquired a PGPROC and so can safely get
- * LWLocks.  We don't currently need to do anything at this stage ...
- * except register a shmem-exit callback.  AtProcExit_Buffers needs LWLock
- * access, and thereby has to be called at the corresponding phase of
- * backend shutdown.
+ * LWLocks.  We register a shmem-exit callback: AtProcExit_Buffers needs
+ * LWLock access, and thereby has to be called at the corresponding phase of
+ * backend shutdown.  This is also the point where we bind the backend to a
+ * NUMA node, if so configured, since that's chosen by PGPROC number.
  */
 void
 InitBufferPoolBackend(void)
 {
 	on_shmem_exit(AtProcExit_Buffers, 0);
+
+	BufferNumaPinBackend();
 }
 
 /*
@@ -3876,7 +4123,7 @@ StartBufferIO(BufferDesc *buf, bool forInput)
 {
 	uint32		buf_state;
 
-	Assert(!InProgressBuf);
+	Assert(NumInProgressBufs < MAX_IN_PROGRESS_BUFS);
 
 	for (;;)
 	{
@@ -3915,8 +4162,9 @@ StartBufferIO(BufferDesc *buf, bool forInput)
 	buf_state |= BM_IO_IN_PROGRESS;
 	UnlockBufHdr(buf, buf_state);
 
-	InProgressBuf = buf;
-	IsForInput = forInput;
+	InProgressBufs[NumInProgressBufs] = buf;
+	InProgressIsForInput[NumInProgressBufs] = forInput;
+	NumInProgressBufs++;
 
 	return true;
 }
@@ -3942,8 +4190,14 @@ static void
 TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 {
 	uint32		buf_state;
+	int			i;
 
-	Assert(buf == InProgressBuf);
+	for (i = 0; i < NumInProgressBufs; i++)
+	{
+		if (InProgressBufs[i] == buf)
+			break;
+	}
+	Assert(i < NumInProgressBufs);
 
 	buf_state = LockBufHdr(buf);
 
@@ -3956,7 +4210,10 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 	buf_state |= set_flag_bits;
 	UnlockBufHdr(buf, buf_state);
 
-	InProgressBuf = NULL;
+	/* forget it, by moving the last entry into its place */
+	NumInProgressBufs--;
+	InProgressBufs[i] = InProgressBufs[NumInProgressBufs];
+	InProgressIsForInput[i] = InProgressIsForInput[NumInProgressBufs];
 
 	LWLockRelease(BufferDescriptorGetIOLock(buf));
 }
@@ -3973,10 +4230,11 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 void
 AbortBufferIO(void)
 {
-	BufferDesc *buf = InProgressBuf;
-
-	if (buf)
+	/* TerminateBufferIO removes each buffer from the array */
+	while (NumInProgressBufs > 0)
 	{
+		BufferDesc *buf = InProgressBufs[NumInProgressBufs - 1];
+		bool		IsForInput = InProgressIsForInput[NumInProgressBufs - 1];
 		uint32		buf_state;
 
 		/*
@@ -4182,6 +4440,11 @@ ckpt_buforder_comparator(const void *pa, const void *pb)
 		return -1;
 	else if (a->tsId > b->tsId)
 		return 1;
+	/* compare database */
+	if (a->dbNode < b->dbNode)
+		return -1;
+	else if (a->dbNode > b->dbNode)
+		return 1;
 	/* compare relation */
 	if (a->relNode < b->relNode)
 		return -1;
@@ -4199,6 +4462,37 @@ ckpt_buforder_comparator(const void *pa, const void *pb)
 		return 1;
 }
 
+/*
+ * Are two checkpoint sort items in the same segment of the same relation
+ * fork?
+ */
+static inline bool
+ckpt_same_segment(const CkptSortItem *a, const CkptSortItem *b)
+{
+	return a->tsId == b->tsId &&
+		a->dbNode == b->dbNode &&
+		a->relNode == b->relNode &&
+		a->forkNum == b->forkNum &&
+		a->blockNum / RELSEG_SIZE == b->blockNum / RELSEG_SIZE;
+}
+
+/*
+ * Ask the storage manager to sync the segment containing a buffer that
+ * BufferSync() is done with, ahead of the checkpoint's sync phase.
+ */
+static void
+CheckpointSyncEarly(const CkptSortItem *item)
+{
+	RelFileNode rnode;
+
+	rnode.spcNode = item->tsId;
+	rnode.dbNode = item->dbNode;
+	rnode.relNode = item->relNode;
+
+	smgrsyncearly(smgropen(rnode, InvalidBackendId), item->forkNum,
+				  item->blockNum);
+}
+
 /*
  * Comparator for a Min-Heap over the per-tablespace checkpoint completion
  * progress.
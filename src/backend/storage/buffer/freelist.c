@@ -15,13 +15,24 @@
  */
 #include "postgres.h"
 
+#include "miscadmin.h"
 #include "port/atomics.h"
+#include "port/pg_numa.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
 #include "storage/proc.h"
 
 #define INT_ACCESS_ONCE(var)	((int)(*((volatile int *)&(var))))
 
+/*
+ * Under the 2Q policy, at most this fraction of shared buffers can be in the
+ * protected set; the rest is left for pages on probation.
+ */
+#define BUFFER_2Q_PROTECTED_FRACTION	0.75
+
+/* GUC variable */
+int			buffer_replacement_policy = BUFFER_REPLACEMENT_CLOCK;
+
 
 /*
  * The shared freelist control information.
@@ -53,6 +64,25 @@ typedef struct
 	uint32		completePasses; /* Complete cycles of the clock sweep */
 	pg_atomic_uint32 numBufferAllocs;	/* Buffers allocated since last reset */
 
+	/*
+	 * Cumulative statistics for StrategyGetStats(); unlike numBufferAllocs,
+	 * these are never reset.
+	 */
+	pg_atomic_uint64 totalBufferAllocs;
+	pg_atomic_uint64 numRingReuses;
+	pg_atomic_uint64 numPromotions;
+	pg_atomic_uint64 numDemotions;
+
+	/* Number of buffers currently in the 2Q protected set */
+	pg_atomic_uint32 numProtected;
+
+	/*
+	 * Per-node clock hands, used instead of nextVictimBuffer when shared
+	 * buffers are partitioned across NUMA nodes.  Like nextVictimBuffer,
+	 * these only ever increase, and are taken modulo the partition size.
+	 */
+	pg_atomic_uint32 nodeVictimBuffer[PG_NUMA_MAX_NODES];
+
 	/*
 	 * Bgworker process to be notified upon activity or -1 if none. See
 	 * StrategyNotifyBgWriter.
@@ -63,6 +93,13 @@ typedef struct
 /* Pointers to shared state */
 static BufferStrategyControl *StrategyControl = NULL;
 
+/*
+ * Per-buffer flags recording whether a buffer is in the 2Q protected set.
+ * A buffer's entry is only examined or changed while holding its header
+ * spinlock.
+ */
+static bool *BufferProtected = NULL;
+
 /*
  * Private (non-shared) state for managing a ring of shared buffers to re-use.
  * This is currently the only kind of BufferAccessStrategy object, but someday
@@ -102,6 +139,25 @@ static BufferDesc *GetBufferFromRing(BufferAccessStrategy strategy,
 				  uint32 *buf_state);
 static void AddBufferToRing(BufferAccessStrategy strategy,
 				BufferDesc *buf);
+static inline void StrategyUnprotectBuffer(BufferDesc *buf);
+static bool ClockSweepConsider2Q(BufferDesc *buf, uint32 *buf_state);
+
+/*
+ * StrategyUnprotectBuffer - remove a buffer from the 2Q protected set
+ *
+ * Called with the buffer header spinlock held, for every buffer about to be
+ * handed out for a new page, whichever policy is in effect: the policy may
+ * have been changed since the buffer was promoted.
+ */
+static inline void
+StrategyUnprotectBuffer(BufferDesc *buf)
+{
+	if (BufferProtected[buf->buf_id])
+	{
+		BufferProtected[buf->buf_id] = false;
+		pg_atomic_fetch_sub_u32(&StrategyControl->numProtected, 1);
+	}
+}
 
 /*
  * ClockSweepTick - Helper routine for StrategyGetBuffer()
@@ -168,6 +224,23 @@ ClockSweepTick(void)
 	return victim;
 }
 
+/*
+ * ClockSweepTickNode - Helper routine for StrategyGetBuffer()
+ *
+ * Like ClockSweepTick(), but sweeps only the buffers of the given NUMA node
+ * partition.  The per-node hands don't take part in the completed-pass
+ * accounting StrategySyncStart() does for the bgwriter.
+ */
+static inline uint32
+ClockSweepTickNode(int node)
+{
+	uint32		victim;
+
+	victim = pg_atomic_fetch_add_u32(&StrategyControl->nodeVictimBuffer[node], 1);
+
+	return BufferNumaNodeFirst(node) + victim % BufferNumaNodeSize(node);
+}
+
 /*
  * StrategyGetBuffer
  *
@@ -185,6 +258,8 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 {
 	BufferDesc *buf;
 	int			bgwprocno;
+	int			node;
+	int			sweepsize;
 	int			trycounter;
 	uint32		local_buf_state;	/* to avoid repeated (de-)referencing */
 
@@ -231,6 +306,7 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 	 * strategy object are intentionally not counted here.
 	 */
 	pg_atomic_fetch_add_u32(&StrategyControl->numBufferAllocs, 1);
+	pg_atomic_fetch_add_u64(&StrategyControl->totalBufferAllocs, 1);
 
 	/*
 	 * First check, without acquiring the lock, whether there's buffers in the
@@ -285,6 +361,7 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 			if (BUF_STATE_GET_REFCOUNT(local_buf_state) == 0
 				&& BUF_STATE_GET_USAGECOUNT(local_buf_state) == 0)
 			{
+				StrategyUnprotectBuffer(buf);
 				if (strategy != NULL)
 					AddBufferToRing(strategy, buf);
 				*buf_state = local_buf_state;
@@ -295,36 +372,68 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 		}
 	}
 
-	/* Nothing on the freelist, so run the "clock sweep" algorithm */
-	trycounter = NBuffers;
+	/*
+	 * Nothing on the freelist, so run the "clock sweep" algorithm.  If shared
+	 * buffers are partitioned across NUMA nodes, sweep only our own node's
+	 * buffers at first, and fall back to the global sweep if they're all
+	 * pinned.
+	 */
+	node = BufferNumaLocalNode();
+	sweepsize = (node >= 0) ? BufferNumaNodeSize(node) : NBuffers;
+	trycounter = sweepsize;
 	for (;;)
 	{
-		buf = GetBufferDescriptor(ClockSweepTick());
+		if (node >= 0)
+			buf = GetBufferDescriptor(ClockSweepTickNode(node));
+		else
+			buf = GetBufferDescriptor(ClockSweepTick());
 
 		/*
 		 * If the buffer is pinned or has a nonzero usage_count, we cannot use
 		 * it; decrement the usage_count (unless pinned) and keep scanning.
+		 * The 2Q policy has its own rules for unpinned buffers.
 		 */
 		local_buf_state = LockBufHdr(buf);
 
-		if (BUF_STATE_GET_REFCOUNT(local_buf_state) == 0)
+		if (BUF_STATE_GET_REFCOUNT(local_buf_state) == 0 &&
+			buffer_replacement_policy == BUFFER_REPLACEMENT_2Q)
+		{
+			if (ClockSweepConsider2Q(buf, &local_buf_state))
+			{
+				/* Found a usable buffer */
+				if (strategy != NULL)
+					AddBufferToRing(strategy, buf);
+				*buf_state = local_buf_state;
+				return buf;
+			}
+			trycounter = sweepsize;
+		}
+		else if (BUF_STATE_GET_REFCOUNT(local_buf_state) == 0)
 		{
 			if (BUF_STATE_GET_USAGECOUNT(local_buf_state) != 0)
 			{
 				local_buf_state -= BUF_USAGECOUNT_ONE;
 
-				trycounter = NBuffers;
+				trycounter = sweepsize;
 			}
 			else
 			{
 				/* Found a usable buffer */
+				StrategyUnprotectBuffer(buf);
 				if (strategy != NULL)
 					AddBufferToRing(strategy, buf);
 				*buf_state = local_buf_state;
 				return buf;
 			}
 		}
-		else if (--trycounter == 0)
+		else if (--trycounter == 0 && node >= 0)
+		{
+			/* all of our node's buffers are pinned, so look further afield */
+			node = -1;
+			sweepsize = NBuffers;
+			trycounter = sweepsize;
+		}
+		else if (trycounter == 0)
 		{
 			/*
 			 * We've scanned all the buffers without making any state changes,
@@ -340,6 +449,61 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 	}
 }
 
+/*
+ * ClockSweepConsider2Q - Helper routine for StrategyGetBuffer()
+ *
+ * Apply the 2Q policy to an unpinned buffer under the clock hand, whose
+ * header spinlock is held and whose state is *buf_state.  Returns true if
+ * the buffer should be used as the victim; otherwise its usage_count or
+ * protection may have been adjusted in *buf_state, and the caller moves on.
+ *
+ * The policy approximates 2Q with the clock sweep: a page read in starts out
+ * on probation, and is evicted the first time the hand reaches it unless it
+ * has been used again in the meantime (usage_count of 2 or more).  Such a
+ * page is promoted to the protected set, where it ages like in the ordinary
+ * clock sweep; when its usage_count reaches zero it is demoted to probation
+ * again rather than evicted, giving it one more pass to prove itself.  Pages
+ * touched only once, as in a large scan, therefore never displace protected
+ * pages, and the hand rarely needs more than one step per victim.
+ */
+static bool
+ClockSweepConsider2Q(BufferDesc *buf, uint32 *buf_state)
+{
+	uint32		usage_count = BUF_STATE_GET_USAGECOUNT(*buf_state);
+
+	if (BufferProtected[buf->buf_id])
+	{
+		if (usage_count > 0)
+			*buf_state -= BUF_USAGECOUNT_ONE;
+		else
+		{
+			BufferProtected[buf->buf_id] = false;
+			pg_atomic_fetch_sub_u32(&StrategyControl->numProtected, 1);
+			pg_atomic_fetch_add_u64(&StrategyControl->numDemotions, 1);
+		}
+		return false;
+	}
+
+	if (usage_count <= 1)
+		return true;
+
+	/*
+	 * Used again while on probation.  Promote it if the protected set has
+	 * room, else let it age as the ordinary clock sweep would.  The limit is
+	 * checked without any lock, so it can be overshot slightly.
+	 */
+	if (pg_atomic_read_u32(&StrategyControl->numProtected) <
+		(uint32) (NBuffers * BUFFER_2Q_PROTECTED_FRACTION))
+	{
+		BufferProtected[buf->buf_id] = true;
+		pg_atomic_fetch_add_u32(&StrategyControl->numProtected, 1);
+		pg_atomic_fetch_add_u64(&StrategyControl->numPromotions, 1);
+	}
+	*buf_state -= BUF_USAGECOUNT_ONE;
+
+	return false;
+}
+
 /*
  * StrategyFreeBuffer: put a buffer on the freelist
  */
@@ -424,6 +588,33 @@ StrategyNotifyBgWriter(int bgwprocno)
 	SpinLockRelease(&StrategyControl->buffer_strategy_lock);
 }
 
+/*
+ * StrategyGetStats -- report cumulative replacement strategy statistics
+ *
+ * The counters are read without any interlock against each other, so they
+ * are only a loosely consistent snapshot.
+ */
+void
+StrategyGetStats(BufferStrategyStats *stats)
+{
+	uint32		nextVictimBuffer;
+	uint32		completePasses;
+
+	SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
+	nextVictimBuffer = pg_atomic_read_u32(&StrategyControl->nextVictimBuffer);
+	completePasses = StrategyControl->completePasses;
+	SpinLockRelease(&StrategyControl->buffer_strategy_lock);
+
+	/* c.f. StrategySyncStart() */
+	stats->clock_ticks = (uint64) completePasses * NBuffers + nextVictimBuffer;
+	stats->allocs = pg_atomic_read_u64(&StrategyControl->totalBufferAllocs);
+	stats->ring_reuses = pg_atomic_read_u64(&StrategyControl->numRingReuses);
+	stats->promotions = pg_atomic_read_u64(&StrategyControl->numPromotions);
+	stats->demotions = pg_atomic_read_u64(&StrategyControl->numDemotions);
+	stats->protected_buffers =
+		pg_atomic_read_u32(&StrategyControl->numProtected);
+}
+
 
 /*
  * StrategyShmemSize
@@ -444,6 +635,9 @@ StrategyShmemSize(void)
 	/* size of the shared replacement strategy control block */
 	size = add_size(size, MAXALIGN(sizeof(BufferStrategyControl)));
 
+	/* size of the 2Q protection flags */
+	size = add_size(size, mul_size(NBuffers, sizeof(bool)));
+
 	return size;
 }
 
@@ -458,6 +652,7 @@ void
 StrategyInitialize(bool init)
 {
 	bool		found;
+	int			i;
 
 	/*
 	 * Initialize the shared buffer lookup hashtable.
@@ -478,6 +673,10 @@ StrategyInitialize(bool init)
 		ShmemInitStruct("Buffer Strategy Status",
 						sizeof(BufferStrategyControl),
 						&found);
+	BufferProtected = (bool *)
+		ShmemInitStruct("Buffer Strategy Protection Flags",
+						NBuffers * sizeof(bool),
+						&found);
 
 	if (!found)
 	{
@@ -501,6 +700,17 @@ StrategyInitialize(bool init)
 		/* Clear statistics */
 		StrategyControl->completePasses = 0;
 		pg_atomic_init_u32(&StrategyControl->numBufferAllocs, 0);
+		pg_atomic_init_u64(&StrategyControl->totalBufferAllocs, 0);
+		pg_atomic_init_u64(&StrategyControl->numRingReuses, 0);
+		pg_atomic_init_u64(&StrategyControl->numPromotions, 0);
+		pg_atomic_init_u64(&StrategyControl->numDemotions, 0);
+
+		/* Nothing is protected yet */
+		pg_atomic_init_u32(&StrategyControl->numProtected, 0);
+		memset(BufferProtected, 0, NBuffers * sizeof(bool));
+
+		for (i = 0; i < PG_NUMA_MAX_NODES; i++)
+			pg_atomic_init_u32(&StrategyControl->nodeVictimBuffer[i], 0);
 
 		/* No pending notification */
 		StrategyControl->bgwprocno = -1;
@@ -584,6 +794,28 @@ FreeAccessStrategy(BufferAccessStrategy strategy)
 		pfree(strategy);
 }
 
+/*
+ * GetAccessStrategyPinLimit -- how many buffers a user of the strategy
+ *		should keep pinned at a time
+ *
+ * Buffers that are pinned can't be recycled from the ring, so a caller that
+ * pins many buffers ahead of time, like a scan reading several blocks with
+ * one I/O, must leave enough of the ring unpinned for the ring to keep
+ * working.  We allow half of it.  Without a strategy, we allow no more than
+ * this backend's share of shared_buffers, so that many backends pinning
+ * buffers ahead at once can't run the buffer pool out of unpinned buffers.
+ */
+int
+GetAccessStrategyPinLimit(BufferAccessStrategy strategy)
+{
+	int			limit = NBuffers / MaxBackends;
+
+	if (strategy != NULL)
+		limit = Min(limit, strategy->ring_size / 2);
+
+	return Max(limit, 1);
+}
+
 /*
  * GetBufferFromRing -- returns a buffer from the ring, or NULL if the
  *		ring is empty.
@@ -628,6 +860,8 @@ GetBufferFromRing(BufferAccessStrategy strategy, uint32 *buf_state)
 	if (BUF_STATE_GET_REFCOUNT(local_buf_state) == 0
 		&& BUF_STATE_GET_USAGECOUNT(local_buf_state) <= 1)
 	{
+		StrategyUnprotectBuffer(buf);
+		pg_atomic_fetch_add_u64(&StrategyControl->numRingReuses, 1);
 		strategy->current_was_in_ring = true;
 		*buf_state = local_buf_state;
 		return buf;
@@ -0,0 +1,244 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedfileset.c
+ *	  Shared temporary file management.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/file/sharedfileset.c
+ *
+ * NOTES:
+ *
+ * SharedFileSets provide a temporary namespace (think directory) so that
+ * files can be discovered by name, and a shared ownership semantics so that
+ * shared files survive until the last user detaches.
+ *
+ * All files of a set live directly in the temporary directory of one
+ * tablespace, and their names begin with PG_TEMP_FILE_PREFIX followed by
+ * the creating backend's PID and a per-backend set number.  That keeps them
+ * apart from the files of other sets, and lets RemovePgTempFiles() clean up
+ * after a crash without knowing anything about sets.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "catalog/pg_tablespace.h"
+#include "commands/tablespace.h"
+#include "miscadmin.h"
+#include "storage/dsm.h"
+#include "storage/sharedfileset.h"
+
+static void SharedFileSetOnDetach(dsm_segment *segment, Datum datum);
+static void SharedFileSetPrefix(char *prefix, SharedFileSet *fileset);
+static void SharedFilePath(char *path, SharedFileSet *fileset,
+			   const char *name);
+
+/*
+ * Initialize a space for temporary files that can be opened by other backends.
+ * Other backends must attach to it before accessing it.  Associate this
+ * SharedFileSet with 'seg'.  Any contained files will be deleted when the
+ * last backend detaches.
+ *
+ * Files will be placed in the first temporary tablespace of the caller, or
+ * in the database's default tablespace if temp_tablespaces is not set.
+ */
+void
+SharedFileSetInit(SharedFileSet *fileset, dsm_segment *seg)
+{
+	static uint32 counter = 0;
+
+	SpinLockInit(&fileset->mutex);
+	fileset->refcnt = 1;
+	fileset->creator_pid = MyProcPid;
+	fileset->number = counter++;
+
+	/* Capture the tablespace to use for all files of this set. */
+	PrepareTempTablespaces();
+	fileset->tablespace = GetNextTempTableSpace();
+	if (!OidIsValid(fileset->tablespace))
+		fileset->tablespace = MyDatabaseTableSpace ?
+			MyDatabaseTableSpace : DEFAULTTABLESPACE_OID;
+
+	/* Register our cleanup callback. */
+	on_dsm_detach(seg, SharedFileSetOnDetach, PointerGetDatum(fileset));
+}
+
+/*
+ * Attach to a set of files that was created with SharedFileSetInit.
+ */
+void
+SharedFileSetAttach(SharedFileSet *fileset, dsm_segment *seg)
+{
+	bool		success;
+
+	SpinLockAcquire(&fileset->mutex);
+	if (fileset->refcnt == 0)
+		success = false;
+	else
+	{
+		++fileset->refcnt;
+		success = true;
+	}
+	SpinLockRelease(&fileset->mutex);
+
+	if (!success)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not attach to a SharedFileSet that is already destroyed")));
+
+	/* Register our cleanup callback. */
+	on_dsm_detach(seg, SharedFileSetOnDetach, PointerGetDatum(fileset));
+}
+
+/*
+ * Create a new file in the given set.  The file is not deleted when it is
+ * closed, so that other backends can open it by name.
+ */
+File
+SharedFileSetCreate(SharedFileSet *fileset, const char *name)
+{
+	char		path[MAXPGPATH];
+	File		file;
+
+	SharedFilePath(path, fileset, name);
+	file = PathNameCreateTemporaryFile(path, false);
+
+	/* If we failed, see if we need to create the directory on demand. */
+	if (file <= 0)
+	{
+		char		tempdirpath[MAXPGPATH];
+
+		/*
+		 * Don't check for error from mkdir; it could fail if someone else
+		 * just did the same thing.  If it doesn't work then we'll bomb out on
+		 * the second create attempt, instead.
+		 */
+		TempTablespacePath(tempdirpath, fileset->tablespace);
+		mkdir(tempdirpath, S_IRWXU);
+
+		file = PathNameCreateTemporaryFile(path, true);
+	}
+
+	return file;
+}
+
+/*
+ * Open a file that was created with SharedFileSetCreate(), possibly in
+ * another backend.  Returns a value <= 0 if there is no such file.
+ */
+File
+SharedFileSetOpen(SharedFileSet *fileset, const char *name)
+{
+	char		path[MAXPGPATH];
+
+	SharedFilePath(path, fileset, name);
+
+	return PathNameOpenTemporaryFile(path);
+}
+
+/*
+ * Delete a file that was created with SharedFileSetCreate().
+ * Return true if the file existed, false if it didn't.
+ */
+bool
+SharedFileSetDelete(SharedFileSet *fileset, const char *name,
+					bool error_on_failure)
+{
+	char		path[MAXPGPATH];
+
+	SharedFilePath(path, fileset, name);
+
+	return PathNameDeleteTemporaryFile(path, error_on_failure);
+}
+
+/*
+ * Delete all files in the set.
+ */
+void
+SharedFileSetDeleteAll(SharedFileSet *fileset)
+{
+	char		tempdirpath[MAXPGPATH];
+	char		prefix[MAXPGPATH];
+	char		path[MAXPGPATH];
+	DIR		   *dir;
+	struct dirent *de;
+
+	TempTablespacePath(tempdirpath, fileset->tablespace);
+	SharedFileSetPrefix(prefix, fileset);
+
+	/* Nothing to do if no file was ever created in this tablespace. */
+	dir = AllocateDir(tempdirpath);
+	if (dir == NULL)
+		return;
+
+	while ((de = ReadDir(dir, tempdirpath)) != NULL)
+	{
+		if (strncmp(de->d_name, prefix, strlen(prefix)) != 0)
+			continue;
+
+		snprintf(path, sizeof(path), "%s/%s", tempdirpath, de->d_name);
+		PathNameDeleteTemporaryFile(path, false);
+	}
+
+	FreeDir(dir);
+}
+
+/*
+ * Callback function that will be invoked when this backend detaches from a
+ * DSM segment holding a SharedFileSet that it has created or attached to.  If
+ * we are the last to detach, then try to remove the files.  During abort
+ * some of the files may still be open, since the resource owner releases
+ * files after DSM segments, but on POSIX systems unlinking an open file is
+ * harmless.
+ */
+static void
+SharedFileSetOnDetach(dsm_segment *segment, Datum datum)
+{
+	bool		unlink_all = false;
+	SharedFileSet *fileset = (SharedFileSet *) DatumGetPointer(datum);
+
+	SpinLockAcquire(&fileset->mutex);
+	Assert(fileset->refcnt > 0);
+	if (--fileset->refcnt == 0)
+		unlink_all = true;
+	SpinLockRelease(&fileset->mutex);
+
+	/*
+	 * If we are the last to detach, we delete the files.  Any errors are only
+	 * logged, since we may be running during abort.
+	 */
+	if (unlink_all)
+		SharedFileSetDeleteAll(fileset);
+}
+
+/*
+ * Build the file name prefix shared by all files of a set.
+ */
+static void
+SharedFileSetPrefix(char *prefix, SharedFileSet *fileset)
+{
+	snprintf(prefix, MAXPGPATH, "%s%lu.%u.sharedfileset.",
+			 PG_TEMP_FILE_PREFIX, (unsigned long) fileset->creator_pid,
+			 fileset->number);
+}
+
+/*
+ * Build the path of a file in a set.
+ */
+static void
+SharedFilePath(char *path, SharedFileSet *fileset, const char *name)
+{
+	char		tempdirpath[MAXPGPATH];
+	char		prefix[MAXPGPATH];
+
+	TempTablespacePath(tempdirpath, fileset->tablespace);
+	SharedFileSetPrefix(prefix, fileset);
+	snprintf(path, MAXPGPATH, "%s/%s%s", tempdirpath, prefix, name);
+}
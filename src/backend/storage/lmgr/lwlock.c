@@ -128,9 +128,9 @@ LWLockPadded *MainLWLockArray = NULL;
  * We use this structure to keep track of locked LWLocks for release
  * during error recovery.  Normally, only a few will be held at once, but
  * occasionally the number can be much higher; for example, the pg_buffercache
- * extension locks all buffer partitions simultaneously.
+ * extension locks all buffer partitions simultaneously.  The limit on that
+ * number, MAX_SIMUL_LWLOCKS, is in lwlock.h.
  */
-#define MAX_SIMUL_LWLOCKS	200
 
 /* struct representing the LWLocks we're holding */
 typedef struct LWLockHandle
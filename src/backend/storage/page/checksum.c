@@ -13,11 +13,172 @@
  */
 #include "postgres.h"
 
+#ifdef HAVE__GET_CPUID
+#include <cpuid.h>
+#endif
+
+#ifdef HAVE__CPUID
+#include <intrin.h>
+#endif
+
 #include "storage/checksum.h"
 
+static uint32 pg_checksum_block_choose(char *data, uint32 size);
+
+/*
+ * The block checksum implementation used by pg_checksum_page.  This starts
+ * out pointing to pg_checksum_block_choose, which replaces it with the
+ * fastest implementation supported by the processor on the first call.
+ */
+static pg_checksum_block_fn pg_checksum_block_impl = pg_checksum_block_choose;
+
+#define PG_CHECKSUM_BLOCK(data, size) pg_checksum_block_impl(data, size)
+
 /*
  * The actual code is in storage/checksum_impl.h.  This is done so that
  * external programs can incorporate the checksum code by #include'ing
  * that file from the exported Postgres headers.  (Compare our CRC code.)
  */
 #include "storage/checksum_impl.h"
+
+/* Implementations usable on this processor, fastest last */
+static ChecksumImpl checksum_impls[3];
+static int	n_checksum_impls = 0;
+
+#if defined(USE_AVX2_CHECKSUM_WITH_RUNTIME_CHECK) || defined(USE_AVX512_CHECKSUM_WITH_RUNTIME_CHECK)
+/*
+ * Check which of the vector instruction sets we have implementations for
+ * are supported by the processor, and enabled by the operating system.
+ */
+static void
+pg_checksum_cpu_features(bool *avx2, bool *avx512)
+{
+	unsigned int exx[4] = {0, 0, 0, 0};
+	uint64		xcr0;
+
+	*avx2 = false;
+	*avx512 = false;
+
+#if defined(HAVE__GET_CPUID)
+	__get_cpuid(1, &exx[0], &exx[1], &exx[2], &exx[3]);
+#elif defined(HAVE__CPUID)
+	__cpuid(exx, 1);
+#else
+#error cpuid instruction not available
+#endif
+
+	/* The OS must save the vector registers on context switch (OSXSAVE) */
+	if ((exx[2] & (1 << 27)) == 0)
+		return;
+
+#if defined(HAVE__GET_CPUID)
+	{
+		uint32		eax,
+					edx;
+
+		__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		xcr0 = ((uint64) edx << 32) | eax;
+	}
+#else
+	xcr0 = _xgetbv(0);
+#endif
+
+	/* XMM and YMM state are needed for anything */
+	if ((xcr0 & 0x06) != 0x06)
+		return;
+
+	/* The instruction sets themselves are reported in leaf 7 */
+#if defined(HAVE__GET_CPUID)
+	if (__get_cpuid_max(0, NULL) < 7)
+		return;
+	__cpuid_count(7, 0, exx[0], exx[1], exx[2], exx[3]);
+#else
+	__cpuid(exx, 0);
+	if (exx[0] < 7)
+		return;
+	__cpuidex(exx, 7, 0);
+#endif
+
+	*avx2 = (exx[1] & (1 << 5)) != 0;
+	/* AVX-512F also needs the opmask and ZMM state */
+	*avx512 = (exx[1] & (1 << 16)) != 0 && (xcr0 & 0xe0) == 0xe0;
+}
+#endif
+
+/*
+ * Return the block checksum implementations usable on this processor, in
+ * order of increasing speed.  The first one is always the portable code.
+ */
+int
+pg_checksum_available_impls(const ChecksumImpl **impls)
+{
+	if (n_checksum_impls == 0)
+	{
+#if defined(USE_AVX2_CHECKSUM_WITH_RUNTIME_CHECK) || defined(USE_AVX512_CHECKSUM_WITH_RUNTIME_CHECK)
+		bool		avx2;
+		bool		avx512;
+#endif
+		int			n = 0;
+
+		checksum_impls[n].name = "generic";
+		checksum_impls[n++].fn = pg_checksum_block_generic;
+
+#if defined(USE_AVX2_CHECKSUM_WITH_RUNTIME_CHECK) || defined(USE_AVX512_CHECKSUM_WITH_RUNTIME_CHECK)
+		pg_checksum_cpu_features(&avx2, &avx512);
+#endif
+#ifdef USE_AVX2_CHECKSUM_WITH_RUNTIME_CHECK
+		if (avx2)
+		{
+			checksum_impls[n].name = "avx2";
+			checksum_impls[n++].fn = pg_checksum_block_avx2;
+		}
+#endif
+#ifdef USE_AVX512_CHECKSUM_WITH_RUNTIME_CHECK
+		if (avx512)
+		{
+			checksum_impls[n].name = "avx512";
+			checksum_impls[n++].fn = pg_checksum_block_avx512;
+		}
+#endif
+		n_checksum_impls = n;
+	}
+
+	*impls = checksum_impls;
+	return n_checksum_impls;
+}
+
+/*
+ * Return the name of the implementation used by pg_checksum_page.
+ */
+const char *
+pg_checksum_selected_impl(void)
+{
+	const ChecksumImpl *impls;
+	int			n = pg_checksum_available_impls(&impls);
+
+	return impls[n - 1].name;
+}
+
+/*
+ * This gets called on the first call. It replaces the function pointer
+ * so that subsequent calls are routed directly to the chosen implementation.
+ */
+static uint32
+pg_checksum_block_choose(char *data, uint32 size)
+{
+	const ChecksumImpl *impls;
+	int			n = pg_checksum_available_impls(&impls);
+
+	pg_checksum_block_impl = impls[n - 1].fn;
+
+	return pg_checksum_block_impl(data, size);
+}
+
+/*
+ * The portable implementation, for comparison with the others.
+ */
+uint32
+pg_checksum_block_generic(char *data, uint32 size)
+{
+	return pg_checksum_block(data, size);
+}
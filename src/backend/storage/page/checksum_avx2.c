@@ -0,0 +1,80 @@
+/*-------------------------------------------------------------------------
+ *
+ * checksum_avx2.c
+ *	  Data page checksum computed using AVX2 instructions.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/page/checksum_avx2.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <immintrin.h>
+
+#include "storage/checksum.h"
+
+#define PG_CHECKSUM_CONSTANTS_ONLY
+#include "storage/checksum_impl.h"
+
+/* number of 256-bit vectors needed to hold the partial checksums */
+#define N_VECS (N_SUMS / 8)
+
+/*
+ * Calculate one round of the checksum for 8 partial checksums at once.
+ */
+#define CHECKSUM_COMP_AVX2(checksum, value) \
+do { \
+	__m256i __tmp = _mm256_xor_si256((checksum), (value)); \
+	(checksum) = _mm256_xor_si256(_mm256_mullo_epi32(__tmp, prime), \
+								  _mm256_srli_epi32(__tmp, 17)); \
+} while (0)
+
+/*
+ * Block checksum algorithm, see pg_checksum_block in checksum_impl.h.  Each
+ * row of N_SUMS values is held in N_VECS vector registers, so all the
+ * partial checksums are advanced with a handful of instructions.
+ */
+uint32
+pg_checksum_block_avx2(char *data, uint32 size)
+{
+	const __m256i prime = _mm256_set1_epi32(FNV_PRIME);
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i		sums[N_VECS];
+	uint32		partial[N_SUMS];
+	uint32		result = 0;
+	uint32		i,
+				j;
+
+	/* ensure that the size is compatible with the algorithm */
+	Assert((size % (sizeof(uint32) * N_SUMS)) == 0);
+
+	/* initialize partial checksums to their corresponding offsets */
+	for (j = 0; j < N_VECS; j++)
+		sums[j] = _mm256_loadu_si256((const __m256i *) &checksumBaseOffsets[j * 8]);
+
+	/* main checksum calculation */
+	for (i = 0; i < size / sizeof(uint32) / N_SUMS; i++)
+	{
+		const __m256i *row = (const __m256i *) (data + i * sizeof(uint32) * N_SUMS);
+
+		for (j = 0; j < N_VECS; j++)
+			CHECKSUM_COMP_AVX2(sums[j], _mm256_loadu_si256(row + j));
+	}
+
+	/* finally add in two rounds of zeroes for additional mixing */
+	for (i = 0; i < 2; i++)
+		for (j = 0; j < N_VECS; j++)
+			CHECKSUM_COMP_AVX2(sums[j], zero);
+
+	/* xor fold partial checksums together */
+	for (j = 0; j < N_VECS; j++)
+		_mm256_storeu_si256((__m256i *) &partial[j * 8], sums[j]);
+	for (i = 0; i < N_SUMS; i++)
+		result ^= partial[i];
+
+	return result;
+}
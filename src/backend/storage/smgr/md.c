@@ -662,7 +662,15 @@ mdprefetch(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum)
 	off_t		seekpos;
 	MdfdVec    *v;
 
-	v = _mdfd_getseg(reln, forknum, blocknum, false, EXTENSION_FAIL);
+	/*
+	 * During WAL replay, blocks are prefetched ahead of the records that
+	 * reference them, and the relation may not exist yet, or may already
+	 * have been dropped; quietly do nothing in that case.
+	 */
+	v = _mdfd_getseg(reln, forknum, blocknum, false,
+					 InRecovery ? EXTENSION_RETURN_NULL : EXTENSION_FAIL);
+	if (v == NULL)
+		return;
 
 	seekpos = (off_t) BLCKSZ *(blocknum % ((BlockNumber) RELSEG_SIZE));
 
@@ -791,6 +799,64 @@ mdread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	}
 }
 
+/*
+ *	mdreadv() -- Read a range of consecutive blocks from a relation.
+ *
+ *		The blocks are read with one FileReadV() call per segment file and
+ *		FILE_READV_MAX_BUFFERS blocks.  If such a read comes up short, the
+ *		blocks it didn't fully read are retried with mdread(), which knows
+ *		how to deal with reads at or past EOF.
+ */
+void
+mdreadv(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		char **buffers, int nblocks)
+{
+	while (nblocks > 0)
+	{
+		off_t		seekpos;
+		int			nbytes;
+		int			nthis;
+		int			nread;
+		MdfdVec    *v;
+
+		v = _mdfd_getseg(reln, forknum, blocknum, false,
+						 EXTENSION_FAIL | EXTENSION_CREATE_RECOVERY);
+
+		/* don't read across a segment boundary */
+		nthis = Min(nblocks, FILE_READV_MAX_BUFFERS);
+		nthis = Min(nthis,
+					RELSEG_SIZE - (int) (blocknum % ((BlockNumber) RELSEG_SIZE)));
+
+		seekpos = (off_t) BLCKSZ *(blocknum % ((BlockNumber) RELSEG_SIZE));
+
+		Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+
+		if (FileSeek(v->mdfd_vfd, seekpos, SEEK_SET) != seekpos)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not seek to block %u in file \"%s\": %m",
+							blocknum, FilePathName(v->mdfd_vfd))));
+
+		nbytes = FileReadV(v->mdfd_vfd, buffers, nthis, BLCKSZ,
+						   WAIT_EVENT_DATA_FILE_READ);
+
+		if (nbytes < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read blocks %u..%u in file \"%s\": %m",
+							blocknum, blocknum + nthis - 1,
+							FilePathName(v->mdfd_vfd))));
+
+		/* Let mdread() handle blocks past a short read */
+		for (nread = nbytes / BLCKSZ; nread < nthis; nread++)
+			mdread(reln, forknum, blocknum + nread, buffers[nread]);
+
+		blocknum += nthis;
+		buffers += nthis;
+		nblocks -= nthis;
+	}
+}
+
 /*
  *	mdwrite() -- Write the supplied block at the appropriate location.
  *
@@ -1047,6 +1113,88 @@ mdimmedsync(SMgrRelation reln, ForkNumber forknum)
 	}
 }
 
+/*
+ *	mdsyncearly() -- Sync one segment ahead of the checkpoint's sync phase.
+ *
+ * If an fsync request is pending for the segment containing blocknum, it is
+ * removed from the table and the segment is fsync'd now.  This lets the
+ * checkpointer spread the fsyncs over the write phase, one segment at a
+ * time as it finishes writing each, instead of issuing them all in mdsync().
+ * The request is removed before the fsync starts, so any request that is
+ * absorbed meanwhile (or later) stays in the table for mdsync() as usual.
+ *
+ * If the segment can't be fsync'd because it has been deleted, we just put
+ * the request back: mdsync() knows how to tell that case apart from a real
+ * failure.  Any other failure is reported right away, as mdsync() would.
+ */
+void
+mdsyncearly(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum)
+{
+	PendingOperationEntry *entry;
+	BlockNumber segno = blocknum / ((BlockNumber) RELSEG_SIZE);
+	MdfdVec    *seg;
+	MemoryContext oldcxt;
+	instr_time	sync_start,
+				sync_end;
+
+	/* Only the process doing checkpoints has anything to do */
+	if (!pendingOpsTable || !enableFsync)
+		return;
+
+	entry = (PendingOperationEntry *) hash_search(pendingOpsTable,
+												  &reln->smgr_rnode.node,
+												  HASH_FIND,
+												  NULL);
+	if (entry == NULL || !bms_is_member(segno, entry->requests[forknum]))
+		return;
+
+	entry->requests[forknum] = bms_del_member(entry->requests[forknum], segno);
+	if (bms_is_empty(entry->requests[forknum]))
+	{
+		bms_free(entry->requests[forknum]);
+		entry->requests[forknum] = NULL;
+	}
+
+	seg = _mdfd_getseg(reln, forknum, blocknum, false,
+					   EXTENSION_RETURN_NULL | EXTENSION_DONT_CHECK_SIZE);
+
+	INSTR_TIME_SET_CURRENT(sync_start);
+
+	if (seg != NULL &&
+		FileSync(seg->mdfd_vfd, WAIT_EVENT_DATA_FILE_SYNC) >= 0)
+	{
+		/* Success; update statistics about sync timing */
+		INSTR_TIME_SET_CURRENT(sync_end);
+		INSTR_TIME_SUBTRACT(sync_end, sync_start);
+		CheckpointStats.ckpt_early_sync_rels++;
+		CheckpointStats.ckpt_early_sync_time +=
+			INSTR_TIME_GET_MICROSEC(sync_end);
+		if (log_checkpoints)
+			elog(DEBUG1, "checkpoint early sync: number=%d file=%s time=%.3f msec",
+				 CheckpointStats.ckpt_early_sync_rels,
+				 FilePathName(seg->mdfd_vfd),
+				 (double) INSTR_TIME_GET_MICROSEC(sync_end) / 1000);
+		return;
+	}
+
+	/* Leave the request for mdsync() */
+	oldcxt = MemoryContextSwitchTo(pendingOpsCxt);
+	entry->requests[forknum] = bms_add_member(entry->requests[forknum], segno);
+	MemoryContextSwitchTo(oldcxt);
+
+	if (!FILE_POSSIBLY_DELETED(errno))
+	{
+		char	   *path;
+		int			save_errno = errno;
+
+		path = _mdfd_segpath(reln, forknum, segno);
+		errno = save_errno;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not fsync file \"%s\": %m", path)));
+	}
+}
+
 /*
  *	mdsync() -- Sync previous writes to stable storage.
  */
@@ -51,6 +51,8 @@ typedef struct f_smgr
 											  BlockNumber blocknum);
 	void		(*smgr_read) (SMgrRelation reln, ForkNumber forknum,
 										  BlockNumber blocknum, char *buffer);
+	void		(*smgr_readv) (SMgrRelation reln, ForkNumber forknum,
+							BlockNumber blocknum, char **buffers, int nblocks);
 	void		(*smgr_write) (SMgrRelation reln, ForkNumber forknum,
 						 BlockNumber blocknum, char *buffer, bool skipFsync);
 	void		(*smgr_writeback) (SMgrRelation reln, ForkNumber forknum,
@@ -59,6 +61,8 @@ typedef struct f_smgr
 	void		(*smgr_truncate) (SMgrRelation reln, ForkNumber forknum,
 											  BlockNumber nblocks);
 	void		(*smgr_immedsync) (SMgrRelation reln, ForkNumber forknum);
+	void		(*smgr_sync_early) (SMgrRelation reln, ForkNumber forknum,
+												BlockNumber blocknum);	/* may be NULL */
 	void		(*smgr_pre_ckpt) (void);		/* may be NULL */
 	void		(*smgr_sync) (void);	/* may be NULL */
 	void		(*smgr_post_ckpt) (void);		/* may be NULL */
@@ -68,8 +72,8 @@ typedef struct f_smgr
 static const f_smgr smgrsw[] = {
 	/* magnetic disk */
 	{mdinit, NULL, mdclose, mdcreate, mdexists, mdunlink, mdextend,
-		mdprefetch, mdread, mdwrite, mdwriteback, mdnblocks, mdtruncate,
-		mdimmedsync, mdpreckpt, mdsync, mdpostckpt
+		mdprefetch, mdread, mdreadv, mdwrite, mdwriteback, mdnblocks, mdtruncate,
+		mdimmedsync, mdsyncearly, mdpreckpt, mdsync, mdpostckpt
 	}
 };
 
@@ -628,6 +632,21 @@ smgrread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	(*(smgrsw[reln->smgr_which].smgr_read)) (reln, forknum, blocknum, buffer);
 }
 
+/*
+ *	smgrreadv() -- read a range of consecutive blocks from a relation into
+ *				   the supplied buffers.
+ *
+ *		Like smgrread() for each of blocknum .. blocknum + nblocks - 1, but
+ *		the storage manager can combine the reads into fewer, larger I/Os.
+ */
+void
+smgrreadv(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		  char **buffers, int nblocks)
+{
+	(*(smgrsw[reln->smgr_which].smgr_readv)) (reln, forknum, blocknum,
+											   buffers, nblocks);
+}
+
 /*
  *	smgrwrite() -- Write the supplied buffer out.
  *
@@ -737,6 +756,22 @@ smgrimmedsync(SMgrRelation reln, ForkNumber forknum)
 }
 
 
+/*
+ *	smgrsyncearly() -- Sync writes to part of a relation during checkpoint.
+ *
+ *		The checkpointer calls this while writing out buffers, for a block
+ *		it has written and whose neighbours it won't write again during this
+ *		checkpoint.  The storage manager may then force the pending writes
+ *		covering that block to disk right away, rather than leaving all of
+ *		them for smgrsync() at the end of the checkpoint.
+ */
+void
+smgrsyncearly(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum)
+{
+	if (smgrsw[reln->smgr_which].smgr_sync_early)
+		(*(smgrsw[reln->smgr_which].smgr_sync_early)) (reln, forknum, blocknum);
+}
+
 /*
  *	smgrpreckpt() -- Prepare for checkpoint.
  */
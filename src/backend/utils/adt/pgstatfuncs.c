@@ -1526,6 +1526,25 @@ pg_stat_get_checkpoint_sync_time(PG_FUNCTION_ARGS)
 	PG_RETURN_FLOAT8((double) pgstat_fetch_global()->checkpoint_sync_time);
 }
 
+Datum
+pg_stat_get_checkpoint_early_sync_time(PG_FUNCTION_ARGS)
+{
+	/* time is already in msec, just convert to double for presentation */
+	PG_RETURN_FLOAT8((double) pgstat_fetch_global()->checkpoint_early_sync_time);
+}
+
+Datum
+pg_stat_get_checkpoint_early_syncs(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_INT64(pgstat_fetch_global()->checkpoint_early_syncs);
+}
+
+Datum
+pg_stat_get_checkpoint_syncs(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_INT64(pgstat_fetch_global()->checkpoint_syncs);
+}
+
 Datum
 pg_stat_get_bgwriter_stat_reset_time(PG_FUNCTION_ARGS)
 {
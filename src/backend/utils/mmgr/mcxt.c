@@ -426,6 +426,38 @@ MemoryContextIsEmpty(MemoryContext context)
 	return (*context->methods->is_empty) (context);
 }
 
+/*
+ * MemoryContextMemAllocated
+ *		Return the total memory obtained from malloc() by the specified
+ *		context, and optionally by all its descendants.
+ *
+ * This walks the contexts' block lists, so it isn't free; callers that need
+ * to watch memory consumption closely should avoid calling it for every
+ * allocation.
+ */
+Size
+MemoryContextMemAllocated(MemoryContext context, bool recurse)
+{
+	MemoryContextCounters totals;
+
+	AssertArg(MemoryContextIsValid(context));
+
+	memset(&totals, 0, sizeof(totals));
+	(*context->methods->stats) (context, 0, false, &totals);
+
+	if (recurse)
+	{
+		MemoryContext child;
+
+		for (child = context->firstchild;
+			 child != NULL;
+			 child = child->nextchild)
+			totals.totalspace += MemoryContextMemAllocated(child, true);
+	}
+
+	return totals.totalspace;
+}
+
 /*
  * MemoryContextStats
  *		Print statistics about the named context and all its descendants.
@@ -325,6 +325,7 @@ typedef struct xl_heap_freeze_page
 typedef struct xl_heap_visible
 {
 	TransactionId cutoff_xid;
+	TransactionId oldest_xid;	/* oldest unfrozen XID on the page */
 	uint8		flags;
 } xl_heap_visible;
 
@@ -397,6 +398,7 @@ extern bool heap_prepare_freeze_tuple(HeapTupleHeader tuple,
 extern void heap_execute_freeze_tuple(HeapTupleHeader tuple,
 						  xl_heap_freeze_tuple *xlrec_tp);
 extern XLogRecPtr log_heap_visible(RelFileNode rnode, Buffer heap_buffer,
-				 Buffer vm_buffer, TransactionId cutoff_xid, uint8 flags);
+				 Buffer vm_buffer, TransactionId cutoff_xid,
+				 TransactionId oldest_xid, uint8 flags);
 
 #endif   /* HEAPAM_XLOG_H */
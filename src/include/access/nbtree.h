@@ -16,11 +16,14 @@
 
 #include "access/amapi.h"
 #include "access/itup.h"
+#include "access/nbtxlog.h"
 #include "access/sdir.h"
 #include "access/xlogreader.h"
 #include "catalog/pg_index.h"
 #include "lib/stringinfo.h"
 #include "storage/bufmgr.h"
+#include "storage/dsm.h"
+#include "storage/shm_toc.h"
 
 /* There's room for a 16-bit vacuum cycle ID in BTPageOpaqueData */
 typedef uint16 BTCycleId;
@@ -153,8 +156,13 @@ typedef struct BTMetaPageData
 #define BTTidSame(i1, i2)	\
 	((ItemPointerGetBlockNumber(&(i1)) == ItemPointerGetBlockNumber(&(i2))) && \
 	 (ItemPointerGetOffsetNumber(&(i1)) == ItemPointerGetOffsetNumber(&(i2))))
+
+/*
+ * Only the block number part of a downlink is compared, because the offset
+ * number of a truncated pivot tuple holds its number of attributes instead.
+ */
 #define BTEntrySame(i1, i2) \
-	BTTidSame((i1)->t_tid, (i2)->t_tid)
+	(BTreeInnerTupleGetDownLink(i1) == BTreeInnerTupleGetDownLink(i2))
 
 
 /*
@@ -203,6 +211,112 @@ typedef struct BTMetaPageData
 #define P_FIRSTKEY			((OffsetNumber) 2)
 #define P_FIRSTDATAKEY(opaque)	(P_RIGHTMOST(opaque) ? P_HIKEY : P_FIRSTKEY)
 
+/*
+ *	Posting list tuples.
+ *
+ *	In a non-unique index, a leaf page can hold many items whose keys are
+ *	identical and that differ only in their heap TID.  Before splitting such
+ *	a page we merge runs of them into a single "posting list" tuple, which
+ *	stores the key once followed by a sorted array of heap TIDs (see
+ *	nbtdedup.c).  Since a leaf tuple's t_tid is otherwise always a heap TID,
+ *	we mark posting list tuples with the INDEX_ALT_TID_MASK bit in t_info, and
+ *	reuse t_tid to describe the posting list: the block number holds the
+ *	offset of the TID array from the start of the tuple, and the offset
+ *	number holds the number of TIDs together with the BT_IS_POSTING flag.
+ *	The TID array starts at a MAXALIGN'd offset, so the key portion of the
+ *	tuple is laid out exactly like an ordinary index tuple.
+ *
+ *	Posting list tuples only ever appear as data items on leaf pages.  High
+ *	keys and downlinks never have a posting list.
+ */
+#define INDEX_ALT_TID_MASK			INDEX_AM_RESERVED_BIT
+
+#define BT_OFFSET_MASK				0x0FFF
+#define BT_IS_POSTING				0x2000
+
+#define BTreeTupleIsPosting(itup) \
+	(((itup)->t_info & INDEX_ALT_TID_MASK) != 0 && \
+	 (ItemPointerGetOffsetNumberNoCheck(&(itup)->t_tid) & BT_IS_POSTING) != 0)
+#define BTreeTupleGetNPosting(itup) \
+	((int) (ItemPointerGetOffsetNumberNoCheck(&(itup)->t_tid) & BT_OFFSET_MASK))
+#define BTreeTupleGetPostingOffset(itup) \
+	((Size) ItemPointerGetBlockNumberNoCheck(&(itup)->t_tid))
+#define BTreeTupleSetPosting(itup, nhtids, off) \
+	do { \
+		Assert((nhtids) > 1 && (nhtids) <= BT_OFFSET_MASK); \
+		(itup)->t_info |= INDEX_ALT_TID_MASK; \
+		ItemPointerSetBlockNumber(&(itup)->t_tid, (off)); \
+		ItemPointerSetOffsetNumber(&(itup)->t_tid, \
+								   (nhtids) | BT_IS_POSTING); \
+	} while (0)
+#define BTreeTupleGetPosting(itup) \
+	((ItemPointer) ((char *) (itup) + BTreeTupleGetPostingOffset(itup)))
+#define BTreeTupleGetPostingN(itup, n) \
+	(BTreeTupleGetPosting(itup) + (n))
+
+/* Size of the key portion of a leaf tuple, excluding any posting list */
+#define BTreeTupleGetKeySize(itup) \
+	(BTreeTupleIsPosting(itup) ? BTreeTupleGetPostingOffset(itup) : \
+	 IndexTupleSize(itup))
+
+/* Number of heap TIDs a leaf tuple points to */
+#define BTreeTupleGetNHeapTids(itup) \
+	(BTreeTupleIsPosting(itup) ? BTreeTupleGetNPosting(itup) : 1)
+
+/* The heap TID of a leaf tuple, or the lowest one of a posting list tuple */
+#define BTreeTupleGetHeapTID(itup) \
+	(BTreeTupleIsPosting(itup) ? BTreeTupleGetPosting(itup) : &(itup)->t_tid)
+
+/*
+ *	Truncated pivot tuples.
+ *
+ *	High keys and downlinks ("pivot" tuples) only need to separate the keys
+ *	on either side of them.  When a leaf page is split, the new high key of
+ *	the left half keeps only as many leading attributes as are needed to
+ *	distinguish the last item on the left from the first item on the right
+ *	(see _bt_truncate()); the attributes that were cut off are treated as
+ *	"minus infinity" by _bt_compare().  This makes internal pages of indexes
+ *	on wide, multi-column keys much denser.
+ *
+ *	A truncated pivot tuple has INDEX_ALT_TID_MASK set, and the offset number
+ *	of its t_tid holds the number of attributes it has.  The block number is
+ *	the downlink, as usual.  Pivot tuples that have all the attributes of the
+ *	index keep the old format.  Code that sets or reads a downlink must
+ *	therefore only touch the block number.
+ */
+#define BTreeTupleIsTruncated(itup) \
+	(((itup)->t_info & INDEX_ALT_TID_MASK) != 0 && \
+	 (ItemPointerGetOffsetNumberNoCheck(&(itup)->t_tid) & BT_IS_POSTING) == 0)
+#define BTreeTupleGetNAtts(itup, rel) \
+	(BTreeTupleIsTruncated(itup) ? \
+	 (int) (ItemPointerGetOffsetNumberNoCheck(&(itup)->t_tid) & BT_OFFSET_MASK) : \
+	 RelationGetNumberOfAttributes(rel))
+#define BTreeTupleSetNAtts(itup, natts) \
+	do { \
+		Assert((natts) > 0 && (natts) <= BT_OFFSET_MASK); \
+		(itup)->t_info |= INDEX_ALT_TID_MASK; \
+		ItemPointerSetOffsetNumber(&(itup)->t_tid, (natts)); \
+	} while (0)
+
+#define BTreeInnerTupleGetDownLink(itup) \
+	ItemPointerGetBlockNumberNoCheck(&(itup)->t_tid)
+#define BTreeInnerTupleSetDownLink(itup, blkno) \
+	do { \
+		if (BTreeTupleIsTruncated(itup)) \
+			ItemPointerSetBlockNumber(&(itup)->t_tid, (blkno)); \
+		else \
+			ItemPointerSet(&(itup)->t_tid, (blkno), P_HIKEY); \
+	} while (0)
+
+/*
+ * The largest number of heap TIDs that a single leaf page can point to.  A
+ * scan saves one BTScanPosItem per heap TID, so with posting lists this is
+ * more than MaxIndexTuplesPerPage.
+ */
+#define MaxTIDsPerBTreePage \
+	((int) ((BLCKSZ - SizeOfPageHeaderData - sizeof(BTPageOpaqueData)) / \
+			sizeof(ItemPointerData)))
+
 
 /*
  *	Operator strategy numbers for B-tree have been moved to access/stratnum.h,
@@ -324,7 +438,7 @@ typedef struct BTScanPosData
 	int			lastItem;		/* last valid index in items[] */
 	int			itemIndex;		/* current index in items[] */
 
-	BTScanPosItem items[MaxIndexTuplesPerPage]; /* MUST BE LAST */
+	BTScanPosItem items[MaxTIDsPerBTreePage];	/* MUST BE LAST */
 } BTScanPosData;
 
 typedef BTScanPosData *BTScanPos;
@@ -429,8 +543,6 @@ typedef BTScanOpaqueData *BTScanOpaque;
 /*
  * external entry points for btree, in nbtree.c
  */
-extern IndexBuildResult *btbuild(Relation heap, Relation index,
-		struct IndexInfo *indexInfo);
 extern void btbuildempty(Relation index);
 extern bool btinsert(Relation rel, Datum *values, bool *isnull,
 		 ItemPointer ht_ctid, Relation heapRel,
@@ -471,6 +583,16 @@ extern bool _bt_doinsert(Relation rel, IndexTuple itup,
 extern Buffer _bt_getstackbuf(Relation rel, BTStack stack, int access);
 extern void _bt_finish_split(Relation rel, Buffer bbuf, BTStack stack);
 
+/*
+ * prototypes for functions in nbtdedup.c
+ */
+extern bool _bt_dedup_one_page(Relation rel, Buffer buf);
+extern Page _bt_dedup_build_page(Page page, BTDedupInterval *intervals,
+					 int nintervals);
+extern IndexTuple _bt_form_posting(IndexTuple base, ItemPointer htids,
+				 int nhtids);
+extern IndexTuple _bt_strip_posting(IndexTuple itup);
+
 /*
  * prototypes for functions in nbtpage.c
  */
@@ -489,7 +611,8 @@ extern void _bt_delitems_delete(Relation rel, Buffer buf,
 					OffsetNumber *itemnos, int nitems, Relation heapRel);
 extern void _bt_delitems_vacuum(Relation rel, Buffer buf,
 					OffsetNumber *itemnos, int nitems,
-					BlockNumber lastBlockVacuumed);
+					OffsetNumber *updatenos, IndexTuple *updated,
+					int nupdated, BlockNumber lastBlockVacuumed);
 extern int	_bt_pagedel(Relation rel, Buffer buf);
 
 /*
@@ -537,6 +660,8 @@ extern bytea *btoptions(Datum reloptions, bool validate);
 extern bool btproperty(Oid index_oid, int attno,
 		   IndexAMProperty prop, const char *propname,
 		   bool *res, bool *isnull);
+extern IndexTuple _bt_truncate(Relation rel, IndexTuple lastleft,
+			 IndexTuple firstright);
 
 /*
  * prototypes for functions in nbtvalidate.c
@@ -546,13 +671,8 @@ extern bool btvalidate(Oid opclassoid);
 /*
  * prototypes for functions in nbtsort.c
  */
-typedef struct BTSpool BTSpool; /* opaque type known only within nbtsort.c */
-
-extern BTSpool *_bt_spoolinit(Relation heap, Relation index,
-			  bool isunique, bool isdead);
-extern void _bt_spooldestroy(BTSpool *btspool);
-extern void _bt_spool(BTSpool *btspool, ItemPointer self,
-		  Datum *values, bool *isnull);
-extern void _bt_leafbuild(BTSpool *btspool, BTSpool *spool2);
+extern IndexBuildResult *btbuild(Relation heap, Relation index,
+		struct IndexInfo *indexInfo);
+extern void _bt_parallel_build_main(dsm_segment *seg, shm_toc *toc);
 
 #endif   /* NBTREE_H */
@@ -39,6 +39,7 @@
 										 * vacuum */
 #define XLOG_BTREE_REUSE_PAGE	0xD0	/* old page is about to be reused from
 										 * FSM */
+#define XLOG_BTREE_DEDUP		0xE0	/* merge duplicates into posting lists */
 
 /*
  * All that we need to regenerate the meta-data page
@@ -88,9 +89,9 @@ typedef struct xl_btree_insert
  *
  * The left page's data portion contains the new item, if it's the _L variant.
  * (In the _R variants, the new item is one of the right page's tuples.)
- * If level > 0, an IndexTuple representing the HIKEY of the left page
- * follows.  We don't need this on leaf pages, because it's the same as the
- * leftmost key in the new right page.
+ * An IndexTuple representing the HIKEY of the left page follows.  On leaf
+ * pages it is a suffix-truncated copy of the leftmost key in the new right
+ * page, so it can't be derived from the right page's tuples.
  *
  * Backup Blk 1: new right page
  *
@@ -139,10 +140,34 @@ typedef struct xl_btree_reuse_page
 
 #define SizeOfBtreeReusePage	(sizeof(xl_btree_reuse_page))
 
+/*
+ * This is what we need to know about merging runs of duplicates on a leaf
+ * page into posting list tuples.  Each interval names the offset of the
+ * first item of a run and the number of items merged into it; redo rebuilds
+ * the page from the same intervals with _bt_dedup_build_page().
+ *
+ * Backup Blk 0: leaf page (data contains the array of intervals)
+ */
+typedef struct xl_btree_dedup
+{
+	uint16		nintervals;
+
+	/* BTDedupInterval ARRAY FOLLOWS */
+} xl_btree_dedup;
+
+#define SizeOfBtreeDedup	(offsetof(xl_btree_dedup, nintervals) + sizeof(uint16))
+
+typedef struct BTDedupInterval
+{
+	OffsetNumber baseoff;		/* offset of first item in the run */
+	uint16		nitems;			/* number of items merged */
+} BTDedupInterval;
+
 /*
  * This is what we need to know about vacuum of individual leaf index tuples.
  * The WAL record can represent deletion of any number of index tuples on a
- * single index page when executed by VACUUM.
+ * single index page when executed by VACUUM, as well as the replacement of
+ * posting list tuples some but not all of whose heap TIDs were removed.
  *
  * For MVCC scans, lastBlockVacuumed will be set to InvalidBlockNumber.
  * For a non-MVCC index scans there is an additional correctness requirement
@@ -160,16 +185,24 @@ typedef struct xl_btree_reuse_page
  * block numbers aren't given.
  *
  * Note that the *last* WAL record in any vacuum of an index is allowed to
- * have a zero length array of offsets. Earlier records must have at least one.
+ * have zero length arrays of offsets. Earlier records must delete or update
+ * at least one item.
+ *
+ * Backup Blk 0: index page (data contains the offsets and tuples)
  */
 typedef struct xl_btree_vacuum
 {
 	BlockNumber lastBlockVacuumed;
+	uint16		ndeleted;
+	uint16		nupdated;
 
-	/* TARGET OFFSET NUMBERS FOLLOW */
+	/*
+	 * DELETED TARGET OFFSET NUMBERS FOLLOW, THEN UPDATED TARGET OFFSET
+	 * NUMBERS, THEN THE REPLACEMENT TUPLES (each MAXALIGN'd)
+	 */
 } xl_btree_vacuum;
 
-#define SizeOfBtreeVacuum	(offsetof(xl_btree_vacuum, lastBlockVacuumed) + sizeof(BlockNumber))
+#define SizeOfBtreeVacuum	(offsetof(xl_btree_vacuum, nupdated) + sizeof(uint16))
 
 /*
  * This is what we need to know about marking an empty branch for deletion.
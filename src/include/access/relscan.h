@@ -19,6 +19,7 @@
 #include "access/htup_details.h"
 #include "access/itup.h"
 #include "access/tupdesc.h"
+#include "storage/bufmgr.h"
 #include "storage/spin.h"
 
 /*
@@ -71,6 +72,13 @@ typedef struct HeapScanDescData
 	/* NB: if rs_cbuf is not InvalidBuffer, we hold a pin on that buffer */
 	ParallelHeapScanDesc rs_parallel;	/* parallel scan information */
 
+	/* pages read ahead by a sequential scan, see heap_read_page() */
+	int			rs_ra_next;		/* next entry of rs_ra_buffers to use */
+	int			rs_ra_nbuffers; /* number of entries read into rs_ra_buffers */
+	BlockNumber rs_ra_block;	/* block in rs_ra_buffers[rs_ra_next], if any */
+	Buffer		rs_ra_buffers[MAX_IO_COMBINE_BLOCKS];
+	/* NB: we hold pins on entries rs_ra_next .. rs_ra_nbuffers - 1 */
+
 	/* these fields only used in page-at-a-time mode and for bitmap scans */
 	int			rs_cindex;		/* current tuple's index in vistuples */
 	int			rs_ntuples;		/* number of visible tuples on page */
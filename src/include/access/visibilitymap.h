@@ -17,6 +17,7 @@
 #include "access/xlogdefs.h"
 #include "storage/block.h"
 #include "storage/buf.h"
+#include "storage/bufpage.h"
 #include "utils/relcache.h"
 
 /* Number of bits for one heap page */
@@ -28,6 +29,17 @@
 #define VISIBILITYMAP_VALID_BITS	0x03		/* OR of all valid
 												 * visibilitymap flags bits */
 
+/* Number of heap blocks covered by one map page, and one freeze horizon */
+#define VISIBILITYMAP_HEAPBLOCKS_PER_PAGE \
+	((BLCKSZ - MAXALIGN(SizeOfPageHeaderData)) * \
+	 (BITS_PER_BYTE / BITS_PER_HEAPBLOCK))
+
+/*
+ * Freeze horizon stored by VACUUM while it recomputes it; see visibilitymap.c.
+ * It isn't a normal XID, so it counts as unknown.
+ */
+#define VISIBILITYMAP_HORIZON_PENDING	BootstrapTransactionId
+
 /* Macros for visibilitymap test */
 #define VM_ALL_VISIBLE(r, b, v) \
 	((visibilitymap_get_status((r), (b), (v)) & VISIBILITYMAP_ALL_VISIBLE) != 0)
@@ -41,8 +53,18 @@ extern void visibilitymap_pin(Relation rel, BlockNumber heapBlk,
 extern bool visibilitymap_pin_ok(BlockNumber heapBlk, Buffer vmbuf);
 extern void visibilitymap_set(Relation rel, BlockNumber heapBlk, Buffer heapBuf,
 				  XLogRecPtr recptr, Buffer vmBuf, TransactionId cutoff_xid,
-				  uint8 flags);
+				  TransactionId oldest_xid, uint8 flags);
 extern uint8 visibilitymap_get_status(Relation rel, BlockNumber heapBlk, Buffer *vmbuf);
+extern TransactionId visibilitymap_get_freeze_horizon(Relation rel,
+								 BlockNumber heapBlk, Buffer *vmbuf);
+extern TransactionId visibilitymap_begin_freeze_horizon(Relation rel,
+								   BlockNumber heapBlk, Buffer vmBuf);
+extern void visibilitymap_raise_freeze_horizon(Relation rel,
+								   BlockNumber heapBlk, Buffer vmBuf,
+								   TransactionId horizon);
+extern TransactionId visibilitymap_horizon_min(TransactionId a,
+						  TransactionId b);
+extern void visibilitymap_page_init(Page page);
 extern void visibilitymap_count(Relation rel, BlockNumber *all_visible, BlockNumber *all_frozen);
 extern void visibilitymap_truncate(Relation rel, BlockNumber nheapblocks);
 
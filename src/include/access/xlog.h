@@ -93,18 +93,26 @@ extern PGDLLIMPORT XLogRecPtr XactLastCommitEnd;
 
 extern bool reachedConsistency;
 
+/*
+ * Upper limit for wal_insert_locks.  A backend occasionally holds all of the
+ * insertion locks at once, in addition to others, so this must stay well
+ * below MAX_SIMUL_LWLOCKS.
+ */
+#define MAX_XLOGINSERT_LOCKS	100
+
 /* these variables are GUC parameters related to XLOG */
 extern int	min_wal_size;
 extern int	max_wal_size;
 extern int	wal_keep_segments;
 extern int	XLOGbuffers;
+extern int	num_xloginsert_locks;
 extern int	XLogArchiveTimeout;
 extern int	wal_retrieve_retry_interval;
 extern char *XLogArchiveCommand;
 extern bool EnableHotStandby;
 extern bool fullPageWrites;
 extern bool wal_log_hints;
-extern bool wal_compression;
+extern int	wal_compression;
 extern bool *wal_consistency_checking;
 extern char *wal_consistency_checking_string;
 extern bool log_checkpoints;
@@ -120,6 +128,15 @@ typedef enum ArchiveMode
 } ArchiveMode;
 extern int	XLogArchiveMode;
 
+/* Compression methods for full-page images */
+typedef enum WalCompression
+{
+	WAL_COMPRESSION_NONE = 0,
+	WAL_COMPRESSION_PGLZ,
+	WAL_COMPRESSION_LZ4,
+	WAL_COMPRESSION_ZSTD
+} WalCompression;
+
 /* WAL levels */
 typedef enum WalLevel
 {
@@ -214,6 +231,10 @@ typedef struct CheckpointStatsData
 										 * times, which is not necessarily the
 										 * same as the total elapsed time for
 										 * the entire sync phase. */
+
+	int			ckpt_early_sync_rels;	/* # of relations synced while
+										 * writing buffers */
+	uint64		ckpt_early_sync_time;	/* The sum of their sync times */
 } CheckpointStatsData;
 
 extern CheckpointStatsData CheckpointStats;
@@ -0,0 +1,30 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogparallel.h
+ *		Declarations for parallel WAL redo on standbys.
+ *
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/access/xlogparallel.h
+ *-------------------------------------------------------------------------
+ */
+#ifndef XLOGPARALLEL_H
+#define XLOGPARALLEL_H
+
+#include "access/xlogreader.h"
+
+/* GUC variable */
+extern int	recovery_parallel_workers;
+
+/* Is this process a parallel redo worker? */
+extern bool InParallelRedoWorker;
+
+extern bool ParallelRedoDispatch(XLogReaderState *record);
+extern void ParallelRedoDrain(void);
+extern void ParallelRedoShutdown(void);
+
+extern void ParallelRedoWorkerMain(Datum main_arg);
+
+#endif   /* XLOGPARALLEL_H */
@@ -2913,6 +2913,12 @@ DATA(insert OID = 3160 ( pg_stat_get_checkpoint_write_time PGNSP PGUID 12 1 0 0
 DESCR("statistics: checkpoint time spent writing buffers to disk, in milliseconds");
 DATA(insert OID = 3161 ( pg_stat_get_checkpoint_sync_time PGNSP PGUID 12 1 0 0 0 f f f f t f s r 0 0 701 "" _null_ _null_ _null_ _null_ _null_ pg_stat_get_checkpoint_sync_time _null_ _null_ _null_ ));
 DESCR("statistics: checkpoint time spent synchronizing buffers to disk, in milliseconds");
+DATA(insert OID = 3402 ( pg_stat_get_checkpoint_early_sync_time PGNSP PGUID 12 1 0 0 0 f f f f t f s r 0 0 701 "" _null_ _null_ _null_ _null_ _null_ pg_stat_get_checkpoint_early_sync_time _null_ _null_ _null_ ));
+DESCR("statistics: checkpoint time spent synchronizing files to disk while writing buffers, in milliseconds");
+DATA(insert OID = 3403 ( pg_stat_get_checkpoint_early_syncs PGNSP PGUID 12 1 0 0 0 f f f f t f s r 0 0 20 "" _null_ _null_ _null_ _null_ _null_ pg_stat_get_checkpoint_early_syncs _null_ _null_ _null_ ));
+DESCR("statistics: number of files synchronized to disk by checkpoints while writing buffers");
+DATA(insert OID = 3404 ( pg_stat_get_checkpoint_syncs PGNSP PGUID 12 1 0 0 0 f f f f t f s r 0 0 20 "" _null_ _null_ _null_ _null_ _null_ pg_stat_get_checkpoint_syncs _null_ _null_ _null_ ));
+DESCR("statistics: number of files synchronized to disk by checkpoints after writing buffers");
 DATA(insert OID = 2775 ( pg_stat_get_buf_written_backend PGNSP PGUID 12 1 0 0 0 f f f f t f s r 0 0 20 "" _null_ _null_ _null_ _null_ _null_ pg_stat_get_buf_written_backend _null_ _null_ _null_ ));
 DESCR("statistics: number of buffers written by backends");
 DATA(insert OID = 3063 ( pg_stat_get_buf_fsync_backend PGNSP PGUID 12 1 0 0 0 f f f f t f s r 0 0 20 "" _null_ _null_ _null_ _null_ _null_ pg_stat_get_buf_fsync_backend _null_ _null_ _null_ ));
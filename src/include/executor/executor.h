@@ -491,6 +491,8 @@ extern void UnregisterExprContextCallback(ExprContext *econtext,
 							  Datum arg);
 
 extern void ExecLockNonLeafAppendTables(List *partitioned_rels, EState *estate);
+extern void ExecPruneAppendSubplans(PlanState *planstate, List *prune_quals,
+						List *constraints, bool *valid_subplans);
 
 extern Datum GetAttributeByName(HeapTupleHeader tuple, const char *attname,
 				   bool *isNull);
@@ -15,7 +15,12 @@
 #define HASHJOIN_H
 
 #include "nodes/execnodes.h"
+#include "port/atomics.h"
+#include "storage/barrier.h"
 #include "storage/buffile.h"
+#include "storage/sharedfileset.h"
+#include "storage/spin.h"
+#include "utils/dsa.h"
 
 /* ----------------------------------------------------------------
  *				hash-join hash table structures
@@ -54,6 +59,13 @@
  * inner batch file.  Subsequently, while reading either inner or outer batch
  * files, we might find tuples that no longer belong to the current batch;
  * if so, we just dump them out to the correct batch file.
+ *
+ * A hash join whose Hash node is parallel-aware builds its hash tables in
+ * the query's dynamic shared memory area instead, and all participating
+ * processes fill them cooperatively and then probe them.  In that case
+ * tuples and buckets are addressed by dsa_pointer rather than by ordinary
+ * pointers, and batch files are shared BufFiles that any participant can
+ * read; see the comments for ParallelHashJoinState below.
  * ----------------------------------------------------------------
  */
 
@@ -63,7 +75,12 @@
 
 typedef struct HashJoinTupleData
 {
-	struct HashJoinTupleData *next;		/* link to next tuple in same bucket */
+	/* link to next tuple in same bucket */
+	union
+	{
+		struct HashJoinTupleData *unshared;
+		dsa_pointer shared;
+	}			next;
 	uint32		hashvalue;		/* tuple's hash code */
 	/* Tuple data, in MinimalTuple format, follows on a MAXALIGN boundary */
 }	HashJoinTupleData;
@@ -112,8 +129,12 @@ typedef struct HashMemoryChunkData
 	size_t		maxlen;			/* size of the buffer holding the tuples */
 	size_t		used;			/* number of buffer bytes already used */
 
-	struct HashMemoryChunkData *next;	/* pointer to the next chunk (linked
-										 * list) */
+	/* pointer to the next chunk (linked list) */
+	union
+	{
+		struct HashMemoryChunkData *unshared;
+		dsa_pointer shared;
+	}			next;
 
 	char		data[FLEXIBLE_ARRAY_MEMBER];	/* buffer allocated at the end */
 }	HashMemoryChunkData;
@@ -121,8 +142,128 @@ typedef struct HashMemoryChunkData
 typedef struct HashMemoryChunkData *HashMemoryChunk;
 
 #define HASH_CHUNK_SIZE			(32 * 1024L)
+#define HASH_CHUNK_HEADER_SIZE	(offsetof(HashMemoryChunkData, data))
 #define HASH_CHUNK_THRESHOLD	(HASH_CHUNK_SIZE / 4)
 
+/*
+ * Shared state for a parallel-aware hash join, kept in the DSM segment of
+ * the parallel query.
+ *
+ * Processes attach to the build as they reach the Hash node, and move
+ * through the phases of build_barrier together:
+ *
+ * PHJ_BUILD_ELECTING     -- one participant is elected to set up the batches
+ * PHJ_BUILD_ALLOCATING   -- ... and does so, while the others wait
+ * PHJ_BUILD_HASHING_INNER -- everyone reads inner tuples; those of batch 0
+ *                           are copied into chunks of shared memory, and the
+ *                           rest are written to shared batch files
+ * PHJ_BUILD_SIZING       -- one participant allocates the buckets of batch 0
+ * PHJ_BUILD_INSERTING    -- everyone links batch 0's tuples into the buckets
+ * PHJ_BUILD_HASHING_OUTER -- if there is more than one batch, everyone reads
+ *                           all outer tuples and writes them to batch files
+ * PHJ_BUILD_DONE         -- the batches are ready to be joined
+ *
+ * If batch 0 outgrows space_allowed while inner tuples are being read, the
+ * participant that notices sets growth to PHJ_GROWTH_NEED_MORE_BATCHES, and
+ * every participant that is reading inner tuples joins in on doubling the
+ * number of batches, moving through the phases of grow_batches_barrier:
+ *
+ * PHJ_GROW_BATCHES_ELECTING -- everyone stops writing to their batch files
+ * PHJ_GROW_BATCHES_ALLOCATING -- one participant sets up the new batches
+ * PHJ_GROW_BATCHES_REPARTITIONING -- everyone moves tuples from the old
+ *                           chunks and batch files to the new ones
+ * PHJ_GROW_BATCHES_DECIDING -- one participant decides whether growing any
+ *                           further could help
+ *
+ * Inner batch files are named after the number of batches at the time they
+ * were written, so that the files being repartitioned and the files being
+ * written never clash.  Each participant writes files of its own, one per
+ * batch, and files are claimed for reading one at a time by atomically
+ * incrementing a counter, so that no file is ever read by two processes.
+ *
+ * Once the build is done, each participant attaches to the batch_barrier of
+ * one batch at a time, and moves through its phases together with any other
+ * participants that chose the same batch:
+ *
+ * PHJ_BATCH_ELECTING     -- one participant is elected to allocate buckets
+ * PHJ_BATCH_ALLOCATING   -- ... and does so, while the others wait
+ * PHJ_BATCH_LOADING      -- everyone loads the batch's inner tuples
+ * PHJ_BATCH_PROBING      -- everyone probes it with the batch's outer tuples
+ * PHJ_BATCH_DONE         -- the last participant to finish probing has freed
+ *                           the batch's memory
+ *
+ * Batch 0 is loaded by the build itself, and starts out in PHJ_BATCH_PROBING.
+ * A participant never waits for the others on a barrier once it may have
+ * emitted tuples, since they might in turn be waiting for the process that
+ * consumes our output: after probing, a participant detaches from the batch
+ * and moves on, and the last one to detach frees the batch's memory.  Batches
+ * other than 0 are never split further, so they may exceed space_allowed.
+ *
+ * Parallel-aware hash joins don't support right or full outer joins, and
+ * don't use skew optimization.
+ */
+#define PHJ_BUILD_ELECTING				0
+#define PHJ_BUILD_ALLOCATING			1
+#define PHJ_BUILD_HASHING_INNER			2
+#define PHJ_BUILD_SIZING				3
+#define PHJ_BUILD_INSERTING				4
+#define PHJ_BUILD_HASHING_OUTER			5
+#define PHJ_BUILD_DONE					6
+
+/* The phases of grow_batches_barrier repeat for each growth. */
+#define PHJ_GROW_BATCHES_ELECTING		0
+#define PHJ_GROW_BATCHES_ALLOCATING		1
+#define PHJ_GROW_BATCHES_REPARTITIONING 2
+#define PHJ_GROW_BATCHES_DECIDING		3
+#define PHJ_GROW_BATCHES_PHASE(n)		((n) % 4)
+
+#define PHJ_BATCH_ELECTING				0
+#define PHJ_BATCH_ALLOCATING			1
+#define PHJ_BATCH_LOADING				2
+#define PHJ_BATCH_PROBING				3
+#define PHJ_BATCH_DONE					4
+
+typedef enum ParallelHashGrowth
+{
+	PHJ_GROWTH_OK,				/* batch 0 may still trigger growth */
+	PHJ_GROWTH_NEED_MORE_BATCHES,	/* batch 0 doesn't fit; grow now */
+	PHJ_GROWTH_DISABLED			/* growing is pointless or too late */
+} ParallelHashGrowth;
+
+/* Per-batch shared state, kept in an array in the DSA area. */
+typedef struct ParallelHashJoinBatch
+{
+	Barrier		batch_barrier;	/* PHJ_BATCH_xxx */
+	dsa_pointer buckets;		/* array of dsa_pointer_atomic */
+	dsa_pointer chunks;			/* chunks holding this batch's tuples */
+	dsa_pointer inserted_chunks;	/* batch 0's chunks once in buckets */
+	Size		size;			/* memory used by chunks (and buckets) */
+	double		ntuples;		/* # tuples in retired chunks */
+	pg_atomic_uint32 next_inner_file;	/* next inner file to load */
+	pg_atomic_uint32 next_outer_file;	/* next outer file to probe with */
+} ParallelHashJoinBatch;
+
+typedef struct ParallelHashJoinState
+{
+	slock_t		mutex;			/* protects the fields below */
+	dsa_pointer batches;		/* array of ParallelHashJoinBatch */
+	int			nbatch;			/* number of batches */
+	int			old_nbatch;		/* nbatch before the current growth */
+	int			nbuckets;		/* # buckets per batch, fixed once nbatch > 1 */
+	int			nparticipants;	/* max # participants, for file names */
+	ParallelHashGrowth growth;	/* see above */
+	dsa_pointer old_chunks;		/* chunks waiting to be repartitioned */
+	double		total_tuples;	/* # inner tuples read by all participants */
+	long		ninmemory;		/* # batch 0 tuples seen by a growth */
+	long		nfreed;			/* # of them moved to later batches */
+	Size		space_allowed;	/* memory budget for batch 0 */
+	pg_atomic_uint32 distributor;	/* hands out files and batches */
+	Barrier		build_barrier;	/* PHJ_BUILD_xxx */
+	Barrier		grow_batches_barrier;	/* PHJ_GROW_BATCHES_xxx */
+	dsm_handle	segment;		/* segment holding this struct */
+	SharedFileSet fileset;		/* space for the shared batch files */
+} ParallelHashJoinState;
+
 typedef struct HashJoinTableData
 {
 	int			nbuckets;		/* # buckets in the in-memory hash table */
@@ -134,8 +275,13 @@ typedef struct HashJoinTableData
 	int			log2_nbuckets_optimal;	/* log2(nbuckets_optimal) */
 
 	/* buckets[i] is head of list of tuples in i'th in-memory bucket */
-	struct HashJoinTupleData **buckets;
-	/* buckets array is per-batch storage, as are all the tuples */
+	union
+	{
+		/* unshared array is per-batch storage, as are all the tuples */
+		struct HashJoinTupleData **unshared;
+		/* shared array is per-query DSA area, as are all the tuples */
+		dsa_pointer_atomic *shared;
+	}			buckets;
 
 	bool		keepNulls;		/* true to store unmatchable NULL tuples */
 
@@ -154,6 +300,7 @@ typedef struct HashJoinTableData
 	bool		growEnabled;	/* flag to shut off nbatch increases */
 
 	double		totalTuples;	/* # tuples obtained from inner plan */
+	double		partialTuples;	/* # tuples obtained by this process */
 	double		skewTuples;		/* # tuples inserted into skew tuples */
 
 	/*
@@ -186,6 +333,17 @@ typedef struct HashJoinTableData
 
 	/* used for dense allocation of tuples (into linked chunks) */
 	HashMemoryChunk chunks;		/* one list for the whole batch */
+
+	/* Shared and private state for a parallel-aware hash table */
+	ParallelHashJoinState *parallel_state;	/* NULL if not shared */
+	ParallelHashJoinBatch *batches; /* shared state of each batch */
+	bool	   *batch_done;		/* batches we have finished with */
+	dsa_area   *area;			/* area holding the shared table */
+	int			participant;	/* our number among the participants */
+	HashMemoryChunk current_chunk;	/* chunk we are currently filling */
+	dsa_pointer current_chunk_shared;	/* ... and its dsa_pointer */
+	BufFile    *read_file;		/* shared batch file we are reading */
+	int			read_participant;	/* ... and the participant who wrote it */
 }	HashJoinTableData;
 
 #endif   /* HASHJOIN_H */
@@ -22,6 +22,11 @@ extern TupleTableSlot *ExecSeqScan(SeqScanState *node);
 extern void ExecEndSeqScan(SeqScanState *node);
 extern void ExecReScanSeqScan(SeqScanState *node);
 
+/* support for parents that take the tuples a page at a time */
+extern bool ExecSeqScanCanBatch(SeqScanState *node);
+extern int	ExecSeqScanBatch(SeqScanState *node);
+extern TupleTableSlot *ExecSeqScanBatchSlot(SeqScanState *node, int i);
+
 /* parallel scan support */
 extern void ExecSeqScanEstimate(SeqScanState *node, ParallelContext *pcxt);
 extern void ExecSeqScanInitializeDSM(SeqScanState *node, ParallelContext *pcxt);
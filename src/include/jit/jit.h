@@ -0,0 +1,87 @@
+/*-------------------------------------------------------------------------
+ * jit.h
+ *	  Provider independent JIT infrastructure.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ *
+ * src/include/jit/jit.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef JIT_H
+#define JIT_H
+
+#include "executor/instrument.h"
+
+
+/*
+ * Flags determining what kind of JIT operations to perform.  These are only
+ * requests to the provider; core code does not act on them itself.
+ */
+#define PGJIT_NONE	   0
+#define PGJIT_PERFORM  (1 << 0)
+#define PGJIT_EXPR	   (1 << 1)
+#define PGJIT_DEFORM   (1 << 2)
+
+
+/*
+ * State of JIT compilation for one query.  A provider creates this on first
+ * use, embedding it at the start of its own, larger struct, and attaches it
+ * to the query's EState with jit_attach_context().
+ */
+typedef struct JitContext
+{
+	/* see PGJIT_* above */
+	int			flags;
+
+	/* number of emitted functions */
+	size_t		created_functions;
+
+	/* accumulated time to generate code */
+	instr_time	generation_counter;
+} JitContext;
+
+typedef struct JitProviderCallbacks JitProviderCallbacks;
+
+struct ExprState;
+struct EState;
+
+/*
+ * A JIT provider is a loadable module whose _PG_jit_provider_init function
+ * fills in the callbacks below.
+ *
+ * compile_expr is called for every expression prepared within a query whose
+ * plan cost exceeded jit_above_cost.  It may either set state->evalfunc to
+ * natively compiled code and return true, or return false to leave the
+ * expression to the interpreter.  If the context's flags include
+ * PGJIT_DEFORM, the provider may also generate code to deform tuples with
+ * the known descriptor of the slots the expression's EEOP_*_FETCHSOME steps
+ * read from.
+ *
+ * release_context is called when the query's JitContext goes away, be it
+ * normally or due to an error, and must free any resources associated with
+ * it.
+ */
+typedef void (*JitProviderInit) (JitProviderCallbacks *cb);
+typedef void (*JitProviderReleaseContextCB) (JitContext *context);
+typedef bool (*JitProviderCompileExprCB) (struct ExprState *state);
+
+struct JitProviderCallbacks
+{
+	JitProviderReleaseContextCB release_context;
+	JitProviderCompileExprCB compile_expr;
+};
+
+
+/* GUCs */
+extern bool jit_enabled;
+extern char *jit_provider;
+extern bool jit_expressions;
+extern bool jit_tuple_deforming;
+extern double jit_above_cost;
+
+
+extern void jit_attach_context(struct EState *estate, JitContext *context);
+extern bool jit_compile_expr(struct ExprState *state);
+
+#endif   /* JIT_H */
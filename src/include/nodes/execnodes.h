@@ -94,6 +94,9 @@ typedef struct ExprState
 
 	Datum	   *innermost_domainval;
 	bool	   *innermost_domainnull;
+
+	/* parent PlanState node, if any */
+	struct PlanState *parent;
 } ExprState;
 
 
@@ -121,11 +124,12 @@ typedef struct ExprState
  *		ReadyForInserts		is it valid for inserts?
  *		Concurrent			are we doing a concurrent index build?
  *		BrokenHotChain		did we detect any broken HOT chains?
+ *		ParallelWorkers		# of workers requested (excludes leader)
  *		AmCache				private cache area for index AM
  *		Context				memory context holding this IndexInfo
  *
- * ii_Concurrent and ii_BrokenHotChain are used only during index build;
- * they're conventionally set to false otherwise.
+ * ii_Concurrent, ii_BrokenHotChain, and ii_ParallelWorkers are used only
+ * during index build; they're conventionally zeroed otherwise.
  * ----------------
  */
 typedef struct IndexInfo
@@ -147,6 +151,7 @@ typedef struct IndexInfo
 	bool		ii_ReadyForInserts;
 	bool		ii_Concurrent;
 	bool		ii_BrokenHotChain;
+	int			ii_ParallelWorkers;
 	void	   *ii_AmCache;
 	MemoryContext ii_Context;
 } IndexInfo;
@@ -476,6 +481,15 @@ typedef struct EState
 
 	/* The per-query shared memory area to use for parallel execution. */
 	struct dsa_area   *es_query_dsa;
+
+	/*
+	 * JIT information.  es_jit_flags indicates whether JIT should be
+	 * performed and with which options (see PGJIT_* in jit/jit.h).  es_jit
+	 * is created on demand by the JIT provider, when compiling the first
+	 * expression.
+	 */
+	int			es_jit_flags;
+	struct JitContext *es_jit;
 } EState;
 
 
@@ -942,6 +956,9 @@ typedef struct ModifyTableState
  *
  *		nplans			how many plans are in the array
  *		whichplan		which plan is being executed (0 .. n-1)
+ *		valid_subplans	subplans not pruned at runtime, or NULL if the
+ *						node does no runtime partition pruning
+ *		prune_pending	valid_subplans must be recomputed before use
  * ----------------
  */
 typedef struct AppendState
@@ -950,6 +967,8 @@ typedef struct AppendState
 	PlanState **appendplans;	/* array of PlanStates for my inputs */
 	int			as_nplans;
 	int			as_whichplan;
+	bool	   *as_valid_subplans;	/* array of length as_nplans, or NULL */
+	bool		as_prune_pending;
 } AppendState;
 
 /* ----------------
@@ -961,6 +980,9 @@ typedef struct AppendState
  *		slots			current output tuple of each subplan
  *		heap			heap of active tuples
  *		initialized		true if we have fetched first tuple from each subplan
+ *		valid_subplans	subplans not pruned at runtime, or NULL if the
+ *						node does no runtime partition pruning
+ *		prune_pending	valid_subplans must be recomputed before use
  * ----------------
  */
 typedef struct MergeAppendState
@@ -973,6 +995,8 @@ typedef struct MergeAppendState
 	TupleTableSlot **ms_slots;	/* array of length ms_nplans */
 	struct binaryheap *ms_heap; /* binary heap of slot indices */
 	bool		ms_initialized; /* are subplans started? */
+	bool	   *ms_valid_subplans;	/* array of length ms_nplans, or NULL */
+	bool		ms_prune_pending;
 } MergeAppendState;
 
 /* ----------------
@@ -1058,6 +1082,10 @@ typedef struct SeqScanState
 {
 	ScanState	ss;				/* its first field is NodeTag */
 	Size		pscan_len;		/* size of parallel heap scan descriptor */
+	bool		use_batch;		/* fetch heap tuples a page at a time? */
+	HeapTuple	batch;			/* tuples of the current page, if so */
+	int			batch_ntuples;	/* number of valid entries in batch */
+	int			batch_next;		/* index of next entry of batch to return */
 } SeqScanState;
 
 /* ----------------
@@ -1753,6 +1781,10 @@ typedef struct AggState
 	Tuplesortstate *sort_in;	/* sorted input to phases > 1 */
 	Tuplesortstate *sort_out;	/* input is copied here for next phase */
 	TupleTableSlot *sort_slot;	/* slot for sort results */
+	/* these fields are used when reading a SeqScan a page at a time: */
+	SeqScanState *input_scan;	/* the scan, or NULL if not batching */
+	int			input_ntuples;	/* number of tuples in current batch */
+	int			input_next;		/* index of next tuple of batch to use */
 	/* these fields are used in AGG_PLAIN and AGG_SORTED modes: */
 	AggStatePerGroup pergroup;	/* per-Aggref-per-group working state */
 	HeapTuple	grp_firstTuple; /* copy of first tuple of current group */
@@ -1761,6 +1793,20 @@ typedef struct AggState
 	int			num_hashes;
 	AggStatePerHash perhash;
 	AggStatePerGroup *hash_pergroup;	/* array of per-group pointers */
+	/* these fields are used to spill AGG_HASHED input to disk: */
+	bool		hash_spill_enabled;	/* may tuples of new groups be spilled? */
+	bool		hash_spill_mode;	/* currently spilling new groups? */
+	bool		hash_ever_spilled;	/* has the current scan spilled? */
+	Size		hash_mem_limit;	/* spill once hash tables exceed this */
+	int			hash_ngroups_check;	/* new groups since last memory check */
+	double		hash_ngroups_current;	/* # groups in current hash table */
+	double		hash_input_groups;	/* estimated # groups in current input */
+	int			hash_used_bits;	/* hash bits used to partition input */
+	struct HashAggSpill *hash_spill;	/* partitions now being written */
+	List	   *hash_batches;	/* spilled partitions not yet processed */
+	TupleTableSlot *hash_spill_slot;	/* slot for reading spilled tuples */
+	int			hash_batches_used;	/* # batches processed, for EXPLAIN */
+	long		hash_disk_used;	/* kB of temp file space used, for EXPLAIN */
 	/* support for evaluation of agg inputs */
 	TupleTableSlot *evalslot;	/* slot for agg inputs */
 	ProjectionInfo *evalproj;	/* projection machinery */
@@ -1909,6 +1955,8 @@ typedef struct HashState
 	HashJoinTable hashtable;	/* hash table for the hashjoin */
 	List	   *hashkeys;		/* list of ExprState nodes */
 	/* hashkeys is same as parent's hj_InnerHashKeys */
+	/* shared state, if parallel-aware; else NULL */
+	struct ParallelHashJoinState *parallel_state;
 } HashState;
 
 /* ----------------
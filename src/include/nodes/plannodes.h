@@ -58,6 +58,8 @@ typedef struct PlannedStmt
 
 	bool		parallelModeNeeded;		/* parallel mode required to execute? */
 
+	int			jitFlags;		/* which forms of JIT should be performed */
+
 	struct Plan *planTree;		/* tree of Plan nodes */
 
 	List	   *rtable;			/* list of RangeTblEntry nodes */
@@ -235,6 +237,9 @@ typedef struct Append
 	/* RT indexes of non-leaf tables in a partition tree */
 	List	   *partitioned_rels;
 	List	   *appendplans;
+	/* for runtime partition pruning, NIL if not used; see createplan.c */
+	List	   *part_prune_quals;	/* per subplan, Param-dependent clauses */
+	List	   *part_constraints;	/* per subplan, partition constraint */
 } Append;
 
 /* ----------------
@@ -248,6 +253,9 @@ typedef struct MergeAppend
 	/* RT indexes of non-leaf tables in a partition tree */
 	List	   *partitioned_rels;
 	List	   *mergeplans;
+	/* for runtime partition pruning, NIL if not used; see createplan.c */
+	List	   *part_prune_quals;	/* per subplan, Param-dependent clauses */
+	List	   *part_constraints;	/* per subplan, partition constraint */
 	/* remaining fields are just like the sort-key info in struct Sort */
 	int			numCols;		/* number of sort-key columns */
 	AttrNumber *sortColIdx;		/* their indexes in the target list */
@@ -849,6 +857,7 @@ typedef struct Hash
 	bool		skewInherit;	/* is outer join rel an inheritance tree? */
 	Oid			skewColType;	/* datatype of the outer key column */
 	int32		skewColTypmod;	/* typmod of the outer key column */
+	double		rows_total;		/* estimated total rows if parallel_aware */
 	/* all other info is in the parent HashJoin node */
 } Hash;
 
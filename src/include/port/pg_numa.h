@@ -0,0 +1,37 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_numa.h
+ *	  Minimal portability layer for NUMA memory and CPU placement.
+ *
+ * Only Linux is supported at present.  We issue the system calls directly
+ * and read the topology from sysfs, rather than depending on libnuma.  On
+ * other platforms, the system is treated as having a single node and the
+ * placement routines do nothing.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ *
+ * src/include/port/pg_numa.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef PG_NUMA_H
+#define PG_NUMA_H
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#if defined(SYS_mbind) && defined(SYS_getcpu)
+#define USE_PG_NUMA 1
+#endif
+#endif
+
+/* Upper limit on the number of nodes we're prepared to deal with */
+#define PG_NUMA_MAX_NODES	64
+
+extern int	pg_numa_get_nodes(int *nodes, int maxnodes);
+extern bool pg_numa_interleave(void *ptr, Size size,
+				   const int *nodes, int nnodes);
+extern bool pg_numa_prefer(void *ptr, Size size, int node);
+extern int	pg_numa_current_node(void);
+extern bool pg_numa_run_on_node(int node);
+
+#endif   /* PG_NUMA_H */
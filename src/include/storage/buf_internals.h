@@ -289,6 +289,7 @@ extern BufferDesc *LocalBufferDescriptors;
 typedef struct CkptSortItem
 {
 	Oid			tsId;
+	Oid			dbNode;
 	Oid			relNode;
 	ForkNumber	forkNum;
 	BlockNumber blockNum;
@@ -297,6 +298,20 @@ typedef struct CkptSortItem
 
 extern CkptSortItem *CkptBufferIds;
 
+/*
+ * Cumulative statistics about the buffer replacement strategy, as returned
+ * by StrategyGetStats().  All counts are since server start.
+ */
+typedef struct BufferStrategyStats
+{
+	uint64		allocs;			/* buffers allocated by StrategyGetBuffer */
+	uint64		ring_reuses;	/* buffers recycled from a strategy ring */
+	uint64		clock_ticks;	/* buffers examined by the clock sweep */
+	uint64		promotions;		/* 2Q: buffers moved to the protected set */
+	uint64		demotions;		/* 2Q: buffers moved back to probation */
+	uint32		protected_buffers;	/* 2Q: current size of protected set */
+} BufferStrategyStats;
+
 /*
  * Internal buffer management routines
  */
@@ -314,10 +329,40 @@ extern bool StrategyRejectBuffer(BufferAccessStrategy strategy,
 
 extern int	StrategySyncStart(uint32 *complete_passes, uint32 *num_buf_alloc);
 extern void StrategyNotifyBgWriter(int bgwprocno);
+extern void StrategyGetStats(BufferStrategyStats *stats);
 
 extern Size StrategyShmemSize(void);
 extern void StrategyInitialize(bool init);
 
+/* buf_numa.c */
+extern PGDLLIMPORT int BufferNumaNodes;
+extern PGDLLIMPORT int BuffersPerNumaNode;
+
+/*
+ * When shared buffers are partitioned across NUMA nodes, each partition is a
+ * contiguous range of buffer IDs; all but the last have the same size.
+ */
+#define BufferNumaNodeOf(buf_id) \
+	((buf_id) / BuffersPerNumaNode)
+#define BufferNumaNodeFirst(node) \
+	((node) * BuffersPerNumaNode)
+#define BufferNumaNodeSize(node) \
+	Min(BuffersPerNumaNode, NBuffers - BufferNumaNodeFirst(node))
+
+#define BufferNumaCountHit(buf_id) \
+	do { \
+		if (BufferNumaNodes > 0) \
+			BufferNumaCountHitInternal(buf_id); \
+	} while (0)
+
+extern Size BufferNumaShmemSize(void);
+extern void BufferNumaInitialize(bool init);
+extern int	BufferNumaLocalNode(void);
+extern void BufferNumaCountHitInternal(int buf_id);
+extern void BufferNumaPinBackend(void);
+extern void BufferNumaGetStats(int node, int *os_node, int *nbuffers,
+				   uint64 *local_hits, uint64 *remote_hits);
+
 /* buf_table.c */
 extern Size BufTableShmemSize(int size);
 extern void InitBufTable(int size);
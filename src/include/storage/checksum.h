@@ -21,4 +21,28 @@
  */
 extern uint16 pg_checksum_page(char *page, BlockNumber blkno);
 
+/*
+ * Implementations of the block checksum underlying pg_checksum_page.  The
+ * server uses the fastest one the processor supports; they are exposed so
+ * that they can be tested against each other and benchmarked.
+ */
+typedef uint32 (*pg_checksum_block_fn) (char *data, uint32 size);
+
+typedef struct ChecksumImpl
+{
+	const char *name;
+	pg_checksum_block_fn fn;
+} ChecksumImpl;
+
+extern uint32 pg_checksum_block_generic(char *data, uint32 size);
+#ifdef USE_AVX2_CHECKSUM_WITH_RUNTIME_CHECK
+extern uint32 pg_checksum_block_avx2(char *data, uint32 size);
+#endif
+#ifdef USE_AVX512_CHECKSUM_WITH_RUNTIME_CHECK
+extern uint32 pg_checksum_block_avx512(char *data, uint32 size);
+#endif
+
+extern int	pg_checksum_available_impls(const ChecksumImpl **impls);
+extern const char *pg_checksum_selected_impl(void);
+
 #endif   /* CHECKSUM_H */
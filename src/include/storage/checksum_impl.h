@@ -77,7 +77,11 @@
  * available on x86 SSE4.1 extensions (pmulld) and ARM NEON (vmul.i32).
  * Vectorization requires a compiler to do the vectorization for us. For recent
  * GCC versions the flags -msse4.1 -funroll-loops -ftree-vectorize are enough
- * to achieve vectorization.
+ * to achieve vectorization.  The server doesn't rely on that alone: it also
+ * has explicit AVX2 and AVX-512 implementations of pg_checksum_block (see
+ * src/backend/storage/page/checksum.c), chosen at runtime when the processor
+ * supports them.  They must produce exactly the same result as the portable
+ * code below.
  *
  * The optimal amount of parallelism to use depends on CPU specific instruction
  * latency, SIMD instruction width, throughput and the amount of registers
@@ -131,6 +135,20 @@ do { \
 	(checksum) = __tmp * FNV_PRIME ^ (__tmp >> 17); \
 } while (0)
 
+/*
+ * Files implementing pg_checksum_block with SIMD instructions define
+ * PG_CHECKSUM_CONSTANTS_ONLY to get just the definitions above.
+ */
+#ifndef PG_CHECKSUM_CONSTANTS_ONLY
+
+/*
+ * The block checksum used by pg_checksum_page.  A caller can substitute an
+ * equivalent implementation by defining this before including this file.
+ */
+#ifndef PG_CHECKSUM_BLOCK
+#define PG_CHECKSUM_BLOCK(data, size) pg_checksum_block(data, size)
+#endif
+
 /*
  * Block checksum algorithm.  The data argument must be aligned on a 4-byte
  * boundary.
@@ -193,7 +211,7 @@ pg_checksum_page(char *page, BlockNumber blkno)
 	 */
 	save_checksum = phdr->pd_checksum;
 	phdr->pd_checksum = 0;
-	checksum = pg_checksum_block(page, BLCKSZ);
+	checksum = PG_CHECKSUM_BLOCK(page, BLCKSZ);
 	phdr->pd_checksum = save_checksum;
 
 	/* Mix in the block number to detect transposed pages */
@@ -205,3 +223,5 @@ pg_checksum_page(char *page, BlockNumber blkno)
 	 */
 	return (checksum % 65535) + 1;
 }
+
+#endif   /* PG_CHECKSUM_CONSTANTS_ONLY */
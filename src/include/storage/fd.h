@@ -51,6 +51,12 @@ typedef char *FileName;
 typedef int File;
 
 
+/*
+ * Maximum number of buffers FileReadV accepts.  POSIX guarantees that
+ * readv() supports at least this many.
+ */
+#define FILE_READV_MAX_BUFFERS	16
+
 /* GUC parameter */
 extern int	max_files_per_process;
 
@@ -70,6 +76,8 @@ extern File OpenTemporaryFile(bool interXact);
 extern void FileClose(File file);
 extern int	FilePrefetch(File file, off_t offset, int amount, uint32 wait_event_info);
 extern int	FileRead(File file, char *buffer, int amount, uint32 wait_event_info);
+extern int	FileReadV(File file, char **buffers, int nbuffers, int amount,
+		  uint32 wait_event_info);
 extern int	FileWrite(File file, char *buffer, int amount, uint32 wait_event_info);
 extern int	FileSync(File file, uint32 wait_event_info);
 extern off_t FileSeek(File file, off_t offset, int whence);
@@ -80,6 +88,11 @@ extern int	FileGetRawDesc(File file);
 extern int	FileGetRawFlags(File file);
 extern int	FileGetRawMode(File file);
 
+/* Operations used for sharing named temporary files */
+extern File PathNameCreateTemporaryFile(const char *name, bool error_on_failure);
+extern File PathNameOpenTemporaryFile(const char *name);
+extern bool PathNameDeleteTemporaryFile(const char *name, bool error_on_failure);
+
 /* Operations that allow use of regular stdio --- USE WITH CAUTION */
 extern FILE *AllocateFile(const char *name, const char *mode);
 extern int	FreeFile(FILE *file);
@@ -107,6 +120,7 @@ extern void closeAllVfds(void);
 extern void SetTempTablespaces(Oid *tableSpaces, int numSpaces);
 extern bool TempTablespacesAreSet(void);
 extern Oid	GetNextTempTableSpace(void);
+extern void TempTablespacePath(char *path, Oid tablespace);
 extern void AtEOXact_Files(void);
 extern void AtEOSubXact_Files(bool isCommit, SubTransactionId mySubid,
 				  SubTransactionId parentSubid);
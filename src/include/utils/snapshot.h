@@ -110,6 +110,14 @@ typedef struct SnapshotData
 
 	TimestampTz whenTaken;		/* timestamp when snapshot was taken */
 	XLogRecPtr	lsn;			/* position in the WAL stream when taken */
+
+	/*
+	 * The transaction completion count at the time GetSnapshotData() built
+	 * this snapshot.  Allows to avoid re-computing static snapshots when no
+	 * transactions completed since the last GetSnapshotData().  Zero if the
+	 * snapshot's contents didn't come from GetSnapshotData().
+	 */
+	uint64		snapXactCompletionCount;
 } SnapshotData;
 
 /*
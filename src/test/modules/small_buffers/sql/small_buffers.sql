@@ -0,0 +1,50 @@
+--
+-- Scans of a table much larger than shared_buffers, with so few buffers
+-- that scans can pin only a few pages ahead
+--
+-- Scans read ahead no more than half of the BULKREAD ring, and no more than
+-- this backend's share of shared_buffers.  Check that this still lets them
+-- read at least two pages with one I/O.
+SELECT least(s.setting::int / 8, 256 * 1024 / 8192) / 2 >= 2 AND
+       s.setting::int / (current_setting('max_connections')::int +
+                         current_setting('autovacuum_max_workers')::int + 1 +
+                         current_setting('max_worker_processes')::int) >= 2
+         AS reads_ahead
+  FROM pg_settings s WHERE s.name = 'shared_buffers';
+
+CREATE TABLE small_buffers_test (a int, b text);
+INSERT INTO small_buffers_test
+  SELECT g, repeat('x', 100) FROM generate_series(1, 20000) g;
+
+SELECT count(*), sum(a) FROM small_buffers_test;
+
+-- Keep concurrent scans from starting in the middle of the table
+SET synchronize_seqscans = off;
+
+-- Several scans in progress at once, each holding its own pins
+BEGIN;
+DECLARE c1 CURSOR FOR SELECT a FROM small_buffers_test;
+DECLARE c2 CURSOR FOR SELECT a FROM small_buffers_test;
+DECLARE c3 SCROLL CURSOR FOR SELECT a FROM small_buffers_test;
+MOVE 5000 IN c1;
+MOVE 7000 IN c2;
+MOVE 10000 IN c3;
+FETCH 1 FROM c1;
+FETCH 1 FROM c2;
+FETCH BACKWARD 1 FROM c3;
+FETCH 1 FROM c3;
+MOVE FORWARD ALL IN c1;
+MOVE FORWARD ALL IN c3;
+FETCH 1 FROM c2;
+FETCH BACKWARD 1 FROM c3;
+COMMIT;
+
+RESET synchronize_seqscans;
+
+VACUUM small_buffers_test;
+DELETE FROM small_buffers_test WHERE a % 2 = 0;
+VACUUM small_buffers_test;
+
+SELECT count(*), sum(a) FROM small_buffers_test;
+
+DROP TABLE small_buffers_test;
@@ -0,0 +1,28 @@
+CREATE EXTENSION test_buf_table;
+
+--
+-- The timings reported are not interesting here; we check that every block
+-- of a freshly filled table is found, with and without the mapping locks,
+-- and that the mapping table stays consistent with the buffer headers as
+-- buffers are invalidated and reused.
+--
+CREATE TABLE buf_table_test (a int);
+INSERT INTO buf_table_test SELECT generate_series(1, 10000);
+
+SELECT hits = 10 * pg_relation_size('buf_table_test') / current_setting('block_size')::int8 AS all_found, misses
+  FROM test_buf_table_lookup('buf_table_test', 10);
+SELECT hits = 10 * pg_relation_size('buf_table_test') / current_setting('block_size')::int8 AS all_found, misses
+  FROM test_buf_table_lookup('buf_table_test', 10, true);
+
+SELECT test_buf_table_verify() > 0 AS verified;
+
+TRUNCATE buf_table_test;
+SELECT hits, misses FROM test_buf_table_lookup('buf_table_test');
+
+INSERT INTO buf_table_test SELECT generate_series(1, 10000);
+DROP TABLE buf_table_test;
+
+SELECT test_buf_table_verify() > 0 AS verified;
+
+-- Probe runs that wrap around the end of a segment, and deletions from them
+SELECT test_buf_table_probe_runs();
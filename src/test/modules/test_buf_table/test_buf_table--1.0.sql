@@ -0,0 +1,21 @@
+/* src/test/modules/test_buf_table/test_buf_table--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION test_buf_table" to load this file. \quit
+
+CREATE FUNCTION test_buf_table_lookup(rel pg_catalog.regclass,
+					   loops pg_catalog.int4 default 1,
+					   locked pg_catalog.bool default false,
+					   OUT hits pg_catalog.int8,
+					   OUT misses pg_catalog.int8,
+					   OUT elapsed_ms pg_catalog.float8)
+    RETURNS record STRICT
+	AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION test_buf_table_verify()
+    RETURNS pg_catalog.int4 STRICT
+	AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION test_buf_table_probe_runs()
+    RETURNS pg_catalog.int4 STRICT
+	AS 'MODULE_PATHNAME' LANGUAGE C;
@@ -0,0 +1,328 @@
+/*--------------------------------------------------------------------------
+ *
+ * test_buf_table.c
+ *		Test and benchmark harness for the shared buffer mapping table.
+ *
+ * Copyright (c) 2017, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/test/modules/test_buf_table/test_buf_table.c
+ *
+ * -------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "fmgr.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "portability/instr_time.h"
+#include "storage/buf_internals.h"
+#include "storage/bufmgr.h"
+#include "utils/rel.h"
+
+PG_MODULE_MAGIC;
+
+PG_FUNCTION_INFO_V1(test_buf_table_lookup);
+PG_FUNCTION_INFO_V1(test_buf_table_verify);
+PG_FUNCTION_INFO_V1(test_buf_table_probe_runs);
+
+/*
+ * Number of tags test_buf_table_probe_runs puts into each of the two probe
+ * runs it builds, and the number of home slot bits it matches.  Matching 12
+ * bits puts the tags on the same home slot in any segment of up to 4096
+ * entries, which covers shared_buffers of up to about 2GB.
+ */
+#define PROBE_RUN_TAGS		4
+#define PROBE_HOME_BITS		12
+
+static int	check_probe_runs(BufferTag *tags, bool *present, int ntags,
+				 char **failure);
+
+/*
+ * Look up every block of the main fork of a relation in the buffer mapping
+ * table, "loops" times over, and report how many lookups found a buffer and
+ * how long it all took.
+ *
+ * If "locked" is true, each lookup is done while holding the mapping
+ * partition lock in share mode, as was required before lookups became
+ * lock-free; comparing the two gives an idea of what the lock costs,
+ * especially when run from many sessions at once.
+ */
+Datum
+test_buf_table_lookup(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	int32		loops = PG_GETARG_INT32(1);
+	bool		locked = PG_GETARG_BOOL(2);
+	Relation	rel;
+	BlockNumber nblocks;
+	RelFileNode rnode;
+	int64		hits = 0;
+	int64		misses = 0;
+	instr_time	start_time;
+	instr_time	elapsed;
+	int32		i;
+	TupleDesc	tupdesc;
+	Datum		values[3];
+	bool		nulls[3];
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	if (loops < 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("loop count must not be negative")));
+
+	rel = relation_open(relid, AccessShareLock);
+	if (RELATION_IS_OTHER_TEMP(rel) || RelationUsesLocalBuffers(rel))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("relation \"%s\" does not use shared buffers",
+						RelationGetRelationName(rel))));
+	nblocks = RelationGetNumberOfBlocks(rel);
+	rnode = rel->rd_node;
+
+	INSTR_TIME_SET_CURRENT(start_time);
+
+	for (i = 0; i < loops; i++)
+	{
+		BlockNumber blkno;
+
+		for (blkno = 0; blkno < nblocks; blkno++)
+		{
+			BufferTag	tag;
+			uint32		hashcode;
+			int			buf_id;
+
+			INIT_BUFFERTAG(tag, rnode, MAIN_FORKNUM, blkno);
+			hashcode = BufTableHashCode(&tag);
+
+			if (locked)
+			{
+				LWLock	   *partitionLock = BufMappingPartitionLock(hashcode);
+
+				LWLockAcquire(partitionLock, LW_SHARED);
+				buf_id = BufTableLookup(&tag, hashcode);
+				LWLockRelease(partitionLock);
+			}
+			else
+				buf_id = BufTableLookup(&tag, hashcode);
+
+			if (buf_id >= 0)
+				hits++;
+			else
+				misses++;
+		}
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	INSTR_TIME_SET_CURRENT(elapsed);
+	INSTR_TIME_SUBTRACT(elapsed, start_time);
+
+	relation_close(rel, AccessShareLock);
+
+	values[0] = Int64GetDatum(hits);
+	values[1] = Int64GetDatum(misses);
+	values[2] = Float8GetDatum(INSTR_TIME_GET_MILLISEC(elapsed));
+	memset(nulls, 0, sizeof(nulls));
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
+/*
+ * Cross-check the buffer mapping table against the buffer headers.
+ *
+ * Every buffer with a valid tag must be found under that tag, and a lookup
+ * must not turn up any buffer whose tag differs.  Returns the number of
+ * buffers checked; throws an error on the first inconsistency.
+ */
+Datum
+test_buf_table_verify(PG_FUNCTION_ARGS)
+{
+	int			i;
+	int32		nchecked = 0;
+
+	for (i = 0; i < NBuffers; i++)
+	{
+		BufferDesc *buf = GetBufferDescriptor(i);
+		BufferTag	tag;
+		uint32		buf_state;
+		uint32		hashcode;
+		LWLock	   *partitionLock;
+		int			buf_id;
+
+		/*
+		 * The tag can't change while we hold the partition lock, but we
+		 * don't know which partition to lock until we've read the tag; so
+		 * read it, lock, and make sure it's still the same.
+		 */
+		buf_state = LockBufHdr(buf);
+		tag = buf->tag;
+		UnlockBufHdr(buf, buf_state);
+
+		if (!(buf_state & BM_TAG_VALID))
+			continue;
+
+		hashcode = BufTableHashCode(&tag);
+		partitionLock = BufMappingPartitionLock(hashcode);
+
+		LWLockAcquire(partitionLock, LW_SHARED);
+		buf_state = LockBufHdr(buf);
+		if ((buf_state & BM_TAG_VALID) && BUFFERTAGS_EQUAL(buf->tag, tag))
+		{
+			UnlockBufHdr(buf, buf_state);
+			buf_id = BufTableLookup(&tag, hashcode);
+			if (buf_id != i)
+				elog(ERROR, "buffer %d is mapped as %d", i, buf_id);
+			nchecked++;
+		}
+		else
+			UnlockBufHdr(buf, buf_state);
+		LWLockRelease(partitionLock);
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	PG_RETURN_INT32(nchecked);
+}
+
+/*
+ * Build two adjacent probe runs in one segment of the mapping table out of
+ * made-up tags, and check that lookups find exactly the tags that should be
+ * there as the runs are built and taken apart again.
+ *
+ * The tags of the first run all hash to the last slot of the segment, and
+ * those of the second to the first slot, so the first run wraps around the
+ * end of the segment and pushes the second one further along.  Deleting
+ * from the middle of the runs then has to move the later entries back, each
+ * no further than its home slot.  Lookups are made without the partition
+ * lock, but nothing changes the segment under them since we hold it.
+ *
+ * The tags belong to relfilenode 0, which no buffer can ever be assigned
+ * to, so they can't disturb anyone else, and they are all removed again
+ * before we report any failure.  Returns the number of lookups checked.
+ */
+Datum
+test_buf_table_probe_runs(PG_FUNCTION_ARGS)
+{
+	BufferTag	tags[2 * PROBE_RUN_TAGS];
+	uint32		hashcodes[2 * PROBE_RUN_TAGS];
+	bool		present[2 * PROBE_RUN_TAGS];
+	int			ntags = 2 * PROBE_RUN_TAGS;
+	int			nfound[2] = {0, 0};
+	uint32		home_mask = (1 << PROBE_HOME_BITS) - 1;
+	RelFileNode rnode = {InvalidOid, InvalidOid, InvalidOid};
+	BlockNumber blkno;
+	LWLock	   *partitionLock;
+	char	   *failure = NULL;
+	int			nchecked = 0;
+	int			i;
+
+	/* find tags whose home slots are the last and the first of segment 0 */
+	for (blkno = 0; nfound[0] < PROBE_RUN_TAGS || nfound[1] < PROBE_RUN_TAGS;
+		 blkno++)
+	{
+		BufferTag	tag;
+		uint32		hashcode;
+		uint32		home;
+		int			run;
+
+		INIT_BUFFERTAG(tag, rnode, MAIN_FORKNUM, blkno);
+		hashcode = BufTableHashCode(&tag);
+		if (BufTableHashPartition(hashcode) != 0)
+			continue;
+
+		home = (hashcode / NUM_BUFFER_PARTITIONS) & home_mask;
+		if (home == home_mask)
+			run = 0;
+		else if (home == 0)
+			run = 1;
+		else
+			continue;
+
+		if (nfound[run] < PROBE_RUN_TAGS)
+		{
+			i = run * PROBE_RUN_TAGS + nfound[run]++;
+			tags[i] = tag;
+			hashcodes[i] = hashcode;
+			present[i] = false;
+		}
+
+		if ((blkno & 0xFFFF) == 0)
+			CHECK_FOR_INTERRUPTS();
+	}
+
+	partitionLock = BufMappingPartitionLock(hashcodes[0]);
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+
+	/* build the runs, the wrapping one first */
+	for (i = 0; i < ntags; i++)
+	{
+		if (BufTableInsert(&tags[i], hashcodes[i], i) != -1 &&
+			failure == NULL)
+			failure = psprintf("tag %d was already present", i);
+		present[i] = true;
+	}
+	nchecked += check_probe_runs(tags, present, ntags, &failure);
+
+	/* a second insertion must find the existing entry */
+	if (BufTableInsert(&tags[2], hashcodes[2], ntags) != 2 &&
+		failure == NULL)
+		failure = psprintf("conflicting insertion of tag 2 not detected");
+
+	/* delete the head of the wrapping run, and one from the middle */
+	BufTableDelete(&tags[0], hashcodes[0]);
+	present[0] = false;
+	nchecked += check_probe_runs(tags, present, ntags, &failure);
+
+	BufTableDelete(&tags[PROBE_RUN_TAGS + 1], hashcodes[PROBE_RUN_TAGS + 1]);
+	present[PROBE_RUN_TAGS + 1] = false;
+	nchecked += check_probe_runs(tags, present, ntags, &failure);
+
+	/* put the head back; it now goes to the end of the runs */
+	BufTableInsert(&tags[0], hashcodes[0], 0);
+	present[0] = true;
+	nchecked += check_probe_runs(tags, present, ntags, &failure);
+
+	/* and take everything apart again */
+	for (i = 0; i < ntags; i++)
+	{
+		if (!present[i])
+			continue;
+		BufTableDelete(&tags[i], hashcodes[i]);
+		present[i] = false;
+		nchecked += check_probe_runs(tags, present, ntags, &failure);
+	}
+
+	LWLockRelease(partitionLock);
+
+	if (failure != NULL)
+		elog(ERROR, "%s", failure);
+
+	PG_RETURN_INT32(nchecked);
+}
+
+/*
+ * Look up each of the tags, which are mapped to their own index if present.
+ * Remember the first failure in *failure.  Returns the number of lookups.
+ */
+static int
+check_probe_runs(BufferTag *tags, bool *present, int ntags, char **failure)
+{
+	int			i;
+
+	for (i = 0; i < ntags; i++)
+	{
+		int			buf_id;
+
+		buf_id = BufTableLookup(&tags[i], BufTableHashCode(&tags[i]));
+		if (buf_id != (present[i] ? i : -1) && *failure == NULL)
+			*failure = psprintf("tag %d is mapped as %d", i, buf_id);
+	}
+
+	return ntags;
+}
@@ -0,0 +1,12 @@
+CREATE EXTENSION test_checksum;
+
+--
+-- Which implementations are available depends on the processor, and the
+-- timings are not interesting here; we check that the benchmark runs every
+-- implementation, and that exactly one of them is in use.
+--
+SELECT count(*) > 0 AS has_impls,
+       bool_or(impl = 'generic') AS has_generic,
+       count(*) FILTER (WHERE selected) AS selected,
+       bool_and(elapsed_ms >= 0) AS timed
+  FROM test_checksum_bench(16, 2);
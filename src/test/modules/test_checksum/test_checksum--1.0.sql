@@ -0,0 +1,13 @@
+/* src/test/modules/test_checksum/test_checksum--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION test_checksum" to load this file. \quit
+
+CREATE FUNCTION test_checksum_bench(pages pg_catalog.int4 default 1024,
+					   loops pg_catalog.int4 default 100,
+					   OUT impl pg_catalog.text,
+					   OUT selected pg_catalog.bool,
+					   OUT elapsed_ms pg_catalog.float8,
+					   OUT mb_per_sec pg_catalog.float8)
+    RETURNS SETOF record STRICT
+	AS 'MODULE_PATHNAME' LANGUAGE C;
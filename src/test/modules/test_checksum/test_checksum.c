@@ -0,0 +1,165 @@
+/*--------------------------------------------------------------------------
+ *
+ * test_checksum.c
+ *		Benchmark harness for the data page checksum implementations.
+ *
+ * The implementations are checked against each other by
+ * test_checksum_impls() in the main regression tests; this module only
+ * times them.
+ *
+ * Copyright (c) 2017, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/test/modules/test_checksum/test_checksum.c
+ *
+ * -------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "fmgr.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "portability/instr_time.h"
+#include "storage/checksum.h"
+#include "utils/builtins.h"
+#include "utils/memutils.h"
+#include "utils/tuplestore.h"
+
+PG_MODULE_MAGIC;
+
+PG_FUNCTION_INFO_V1(test_checksum_bench);
+
+/*
+ * Fill "npages" pages with pseudo-random data.  A private generator is used
+ * so that the contents are the same on every run and the session's random()
+ * state is left alone.
+ */
+static char *
+make_test_pages(int32 npages)
+{
+	char	   *pages;
+	uint32	   *p;
+	uint32		state = 0x2545F491;
+	Size		i;
+
+	if (npages <= 0 || npages > MaxAllocSize / BLCKSZ)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("page count must be between 1 and %d",
+						(int) (MaxAllocSize / BLCKSZ))));
+
+	pages = palloc((Size) npages * BLCKSZ);
+	p = (uint32 *) pages;
+	for (i = 0; i < (Size) npages * BLCKSZ / sizeof(uint32); i++)
+	{
+		/* xorshift32 */
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		p[i] = state;
+	}
+
+	return pages;
+}
+
+/*
+ * Checksum "pages" pages of data "loops" times over with each implementation
+ * usable on this processor, and report the elapsed time and throughput of
+ * each.  The implementation used by the server is marked as selected.
+ */
+Datum
+test_checksum_bench(PG_FUNCTION_ARGS)
+{
+	int32		npages = PG_GETARG_INT32(0);
+	int32		loops = PG_GETARG_INT32(1);
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	const ChecksumImpl *impls;
+	int			nimpls;
+	const char *selected;
+	char	   *pages;
+	int			k;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	if (loops < 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("loop count must not be negative")));
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	pages = make_test_pages(npages);
+	nimpls = pg_checksum_available_impls(&impls);
+	selected = pg_checksum_selected_impl();
+
+	for (k = 0; k < nimpls; k++)
+	{
+		instr_time	start_time;
+		instr_time	elapsed;
+		uint32		dummy = 0;
+		double		elapsed_ms;
+		Datum		values[4];
+		bool		nulls[4];
+		int32		i;
+		int32		j;
+
+		INSTR_TIME_SET_CURRENT(start_time);
+
+		for (i = 0; i < loops; i++)
+		{
+			for (j = 0; j < npages; j++)
+				dummy ^= impls[k].fn(pages + (Size) j * BLCKSZ, BLCKSZ);
+
+			CHECK_FOR_INTERRUPTS();
+		}
+
+		INSTR_TIME_SET_CURRENT(elapsed);
+		INSTR_TIME_SUBTRACT(elapsed, start_time);
+		elapsed_ms = INSTR_TIME_GET_MILLISEC(elapsed);
+
+		/* keep the compiler from optimizing the loop away */
+		if (dummy == 0xFFFFFFFF)
+			elog(DEBUG5, "checksum fold is all ones");
+
+		values[0] = CStringGetTextDatum(impls[k].name);
+		values[1] = BoolGetDatum(strcmp(impls[k].name, selected) == 0);
+		values[2] = Float8GetDatum(elapsed_ms);
+		memset(nulls, 0, sizeof(nulls));
+		if (elapsed_ms > 0)
+			values[3] = Float8GetDatum((double) npages * loops * BLCKSZ /
+									   (elapsed_ms * 1000.0));
+		else
+			nulls[3] = true;
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	pfree(pages);
+
+	return (Datum) 0;
+}
@@ -0,0 +1,40 @@
+CREATE EXTENSION test_jit_provider;
+
+-- With jit off, the provider is never called
+SELECT sum(g) FROM generate_series(1, 100) g WHERE g % 3 = 0;
+SELECT * FROM test_jit_provider_counts();
+
+-- Each expression of a query costing more than jit_above_cost is offered to
+-- the provider, and the query's JIT context is released at its end
+SET jit_above_cost = 0;
+SET jit = on;
+SELECT sum(g) FROM generate_series(1, 100) g WHERE g % 3 = 0;
+SET jit = off;
+SELECT contexts_created, contexts_released, expressions > 0 AS compiled,
+       deform_requested
+  FROM test_jit_provider_counts();
+
+-- jit_tuple_deforming only changes the flags the provider is given
+SET jit_tuple_deforming = off;
+SET jit = on;
+SELECT sum(g) FROM generate_series(1, 100) g WHERE g % 3 = 0;
+SET jit = off;
+SELECT contexts_created, contexts_released, deform_requested
+  FROM test_jit_provider_counts();
+RESET jit_tuple_deforming;
+
+-- Nothing is offered for queries below jit_above_cost
+SET jit_above_cost = 1e9;
+SET jit = on;
+SELECT sum(g) FROM generate_series(1, 100) g WHERE g % 3 = 0;
+SET jit = off;
+SELECT contexts_created, contexts_released
+  FROM test_jit_provider_counts();
+SET jit_above_cost = 0;
+
+-- The context is released also when the query fails
+SET jit = on;
+SELECT sum(1 / (g - 50)) FROM generate_series(1, 100) g;
+SET jit = off;
+SELECT contexts_created, contexts_released
+  FROM test_jit_provider_counts();
@@ -0,0 +1,11 @@
+/* src/test/modules/test_jit_provider/test_jit_provider--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION test_jit_provider" to load this file. \quit
+
+CREATE FUNCTION test_jit_provider_counts(OUT contexts_created pg_catalog.int8,
+					   OUT contexts_released pg_catalog.int8,
+					   OUT expressions pg_catalog.int8,
+					   OUT deform_requested pg_catalog.int8)
+    RETURNS pg_catalog.record STRICT
+	AS 'MODULE_PATHNAME' LANGUAGE C;
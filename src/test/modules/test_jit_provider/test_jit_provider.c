@@ -0,0 +1,112 @@
+/*--------------------------------------------------------------------------
+ *
+ * test_jit_provider.c
+ *		JIT provider used to test the JIT provider hooks.
+ *
+ * This provider doesn't generate any code.  It accepts every expression it
+ * is offered, prepares it for the interpreter itself, and keeps count of
+ * what it was asked to do, so that the regression test can check that core
+ * code calls the provider, and releases its contexts, as documented in
+ * jit/jit.h.
+ *
+ * Copyright (c) 2017, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/test/modules/test_jit_provider/test_jit_provider.c
+ *
+ * -------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "executor/execExpr.h"
+#include "fmgr.h"
+#include "funcapi.h"
+#include "jit/jit.h"
+#include "nodes/execnodes.h"
+
+PG_MODULE_MAGIC;
+
+/* Entrypoint of the provider */
+void		_PG_jit_provider_init(JitProviderCallbacks *cb);
+
+PG_FUNCTION_INFO_V1(test_jit_provider_counts);
+
+/* what we've been asked to do in this session */
+static int64 contexts_created = 0;
+static int64 contexts_released = 0;
+static int64 expressions = 0;
+static int64 deform_requested = 0;
+
+static bool test_jit_compile_expr(ExprState *state);
+static void test_jit_release_context(JitContext *context);
+
+void
+_PG_jit_provider_init(JitProviderCallbacks *cb)
+{
+	cb->compile_expr = test_jit_compile_expr;
+	cb->release_context = test_jit_release_context;
+}
+
+/*
+ * "Compile" an expression, creating the query's JIT context on first use.
+ */
+static bool
+test_jit_compile_expr(ExprState *state)
+{
+	EState	   *estate = state->parent->state;
+	JitContext *context = estate->es_jit;
+	instr_time	starttime;
+	instr_time	endtime;
+
+	if (context == NULL)
+	{
+		context = MemoryContextAllocZero(estate->es_query_cxt,
+										 sizeof(JitContext));
+		context->flags = estate->es_jit_flags;
+		jit_attach_context(estate, context);
+
+		contexts_created++;
+		if (context->flags & PGJIT_DEFORM)
+			deform_requested++;
+	}
+
+	INSTR_TIME_SET_CURRENT(starttime);
+	ExecReadyInterpretedExpr(state);
+	INSTR_TIME_SET_CURRENT(endtime);
+	INSTR_TIME_ACCUM_DIFF(context->generation_counter, endtime, starttime);
+
+	context->created_functions++;
+	expressions++;
+
+	return true;
+}
+
+static void
+test_jit_release_context(JitContext *context)
+{
+	contexts_released++;
+}
+
+/*
+ * SQL-callable function returning the counts.
+ */
+Datum
+test_jit_provider_counts(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Datum		values[4];
+	bool		nulls[4];
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+	tupdesc = BlessTupleDesc(tupdesc);
+
+	values[0] = Int64GetDatum(contexts_created);
+	values[1] = Int64GetDatum(contexts_released);
+	values[2] = Int64GetDatum(expressions);
+	values[3] = Int64GetDatum(deform_requested);
+	memset(nulls, 0, sizeof(nulls));
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
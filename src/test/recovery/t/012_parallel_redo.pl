@@ -0,0 +1,98 @@
+# Test replay of WAL by parallel redo workers on a standby
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 7;
+
+# Initialize master node
+my $node_master = get_new_node('master');
+$node_master->init(allows_streaming => 1);
+$node_master->start;
+my $backup_name = 'my_backup';
+
+$node_master->safe_psql('postgres',
+	"CREATE TABLE tab_redo (a int PRIMARY KEY, b text) WITH (fillfactor = 50)");
+
+# Take backup
+$node_master->backup($backup_name);
+
+# Create streaming standby, replaying with two workers
+my $node_standby = get_new_node('standby');
+$node_standby->init_from_backup($node_master, $backup_name,
+	has_streaming => 1);
+$node_standby->append_conf('postgresql.conf', qq{
+recovery_parallel_workers = 2
+max_worker_processes = 8
+});
+$node_standby->start;
+
+# Generate single-page heap and btree records (inserts, HOT updates,
+# deletes) interleaved with records replayed by the startup process.
+$node_master->safe_psql('postgres', qq{
+DO \$\$
+BEGIN
+  FOR i IN 1..2000 LOOP
+    INSERT INTO tab_redo VALUES (i, 'row ' || i);
+  END LOOP;
+END
+\$\$;
+UPDATE tab_redo SET b = b || ' updated' WHERE a % 3 = 0;
+DELETE FROM tab_redo WHERE a % 7 = 0;
+INSERT INTO tab_redo SELECT g, 'bulk ' || g FROM generate_series(2001, 5000) g;
+});
+
+# Wait for standby to catch up
+$node_master->wait_for_catchup($node_standby, 'replay',
+	$node_master->lsn('insert'));
+
+my $query = qq{SELECT count(*), sum(a), sum(length(b)) FROM tab_redo};
+my $expected = $node_master->safe_psql('postgres', $query);
+my $result = $node_standby->safe_psql('postgres', $query);
+is($result, $expected, 'heap contents match after parallel redo');
+
+$query = qq{SET enable_seqscan = off; SET enable_bitmapscan = off;
+SELECT count(*) FROM tab_redo WHERE a BETWEEN 100 AND 4000};
+$expected = $node_master->safe_psql('postgres', $query);
+$result = $node_standby->safe_psql('postgres', $query);
+is($result, $expected, 'index contents match after parallel redo');
+
+ok(TestLib::slurp_file($node_standby->logfile) =~
+	  qr/parallel redo started with 2 workers/,
+	'parallel redo workers were used');
+
+# Many small transactions.  Their commits wait only for their own records,
+# not for all the workers.
+$node_master->safe_psql('postgres',
+	join('', map { "INSERT INTO tab_redo VALUES ($_, 'small $_');\n" }
+		  (5001 .. 5500)));
+$node_master->wait_for_catchup($node_standby, 'replay',
+	$node_master->lsn('insert'));
+$query = qq{SELECT count(*), sum(length(b)) FROM tab_redo WHERE a > 5000};
+$expected = $node_master->safe_psql('postgres', $query);
+$result = $node_standby->safe_psql('postgres', $query);
+is($result, $expected, 'small transactions are all visible after commit');
+
+# Promotion must apply everything the workers were given
+$node_master->safe_psql('postgres',
+	"UPDATE tab_redo SET b = 'final' WHERE a % 5 = 0");
+$node_master->wait_for_catchup($node_standby, 'replay',
+	$node_master->lsn('insert'));
+$expected = $node_master->safe_psql('postgres',
+	"SELECT count(*) FROM tab_redo WHERE b = 'final'");
+$node_standby->promote;
+$node_standby->poll_query_until('postgres',
+	"SELECT NOT pg_is_in_recovery()")
+  or die "Timed out while waiting for promotion";
+$result = $node_standby->safe_psql('postgres',
+	"SELECT count(*) FROM tab_redo WHERE b = 'final'");
+is($result, $expected, 'changes are all present after promotion');
+
+# The startup process reports how it waited for the workers
+my $log = TestLib::slurp_file($node_standby->logfile);
+ok( $log =~
+	  qr/parallel redo finished: (\d+) records replayed by workers, (\d+) full barriers, (\d+) transaction ends/,
+	'parallel redo statistics were logged');
+my ($nbarriers, $nxactends) = ($2, $3);
+ok($nxactends >= 500 && $nbarriers < $nxactends,
+	'commits did not drain all the workers');
@@ -0,0 +1,65 @@
+# Test replay of full-page images compressed with each wal_compression method
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 6;
+
+# Initialize master node
+my $node_master = get_new_node('master');
+$node_master->init(allows_streaming => 1);
+$node_master->start;
+my $backup_name = 'my_backup';
+
+$node_master->safe_psql('postgres',
+	"CREATE TABLE tab_compress AS SELECT g AS a, repeat('x', 100) AS b
+	 FROM generate_series(1, 10000) g");
+
+# Take backup
+$node_master->backup($backup_name);
+
+# Create streaming standby
+my $node_standby = get_new_node('standby');
+$node_standby->init_from_backup($node_master, $backup_name,
+	has_streaming => 1);
+$node_standby->start;
+
+# The methods this build supports
+my $enumvals = $node_master->safe_psql('postgres',
+	"SELECT enumvals FROM pg_settings WHERE name = 'wal_compression'");
+
+foreach my $method ('pglz', 'lz4', 'zstd')
+{
+  SKIP:
+	{
+		skip "wal_compression = $method not supported by this build", 2
+		  unless $enumvals =~ /\b$method\b/;
+
+		# Updating every page right after a checkpoint logs full-page
+		# images, compressed with the method set for the session.
+		$node_master->safe_psql('postgres', 'CHECKPOINT');
+		my $start_lsn = $node_master->lsn('insert');
+		$node_master->safe_psql('postgres', qq{
+SET wal_compression = $method;
+UPDATE tab_compress SET b = '$method' || a;
+});
+		my $end_lsn = $node_master->lsn('insert');
+
+		my ($stdout, $stderr);
+		IPC::Run::run(
+			[   'pg_waldump', '-p', $node_master->data_dir . '/pg_wal',
+				'-s', $start_lsn, '-e', $end_lsn, '-b' ],
+			'>', \$stdout, '2>', \$stderr);
+		ok($stdout =~ /method: $method/,
+			"full-page images compressed with $method");
+
+		$node_master->wait_for_catchup($node_standby, 'replay', $end_lsn);
+
+		my $query = qq{SELECT count(*), sum(length(b)) FROM tab_compress
+WHERE b = '$method' || a};
+		my $expected = $node_master->safe_psql('postgres', $query);
+		my $result = $node_standby->safe_psql('postgres', $query);
+		is($result, $expected,
+			"standby replays images compressed with $method");
+	}
+}
@@ -31,6 +31,7 @@
 #include "executor/spi.h"
 #include "miscadmin.h"
 #include "port/atomics.h"
+#include "storage/checksum.h"
 #include "utils/builtins.h"
 #include "utils/geo_decls.h"
 #include "utils/rel.h"
@@ -1102,3 +1103,110 @@ test_atomic_ops(PG_FUNCTION_ARGS)
 
 	PG_RETURN_BOOL(true);
 }
+
+
+/*
+ * Checksums of fixed data computed by the portable pg_checksum_block(), for
+ * test_checksum_impls.  The data is described in terms of uint32 words, so
+ * that the checksums don't depend on byte order.
+ */
+typedef enum
+{
+	CHECKSUM_DATA_ZEROES,		/* all zeroes */
+	CHECKSUM_DATA_ONES,			/* all ones */
+	CHECKSUM_DATA_LAST_WORD,	/* zeroes, but the last word is 1 */
+	CHECKSUM_DATA_COUNTER,		/* word i is i */
+	CHECKSUM_DATA_RANDOM		/* xorshift32 sequence */
+} ChecksumTestData;
+
+static const struct
+{
+	ChecksumTestData data;
+	uint32		size;
+	uint32		checksum;
+}	checksum_tests[] =
+{
+	{CHECKSUM_DATA_ZEROES, 128, 0x8FBF3C9E},
+	{CHECKSUM_DATA_ONES, 128, 0xB552D7EA},
+	{CHECKSUM_DATA_LAST_WORD, 128, 0xCE8A15B1},
+	{CHECKSUM_DATA_COUNTER, 128, 0x3B5BEADE},
+	{CHECKSUM_DATA_RANDOM, 128, 0x8EF645A0},
+	{CHECKSUM_DATA_ZEROES, 8192, 0x54AF71FA},
+	{CHECKSUM_DATA_ONES, 8192, 0x226FE1DD},
+	{CHECKSUM_DATA_LAST_WORD, 8192, 0x6B071C9D},
+	{CHECKSUM_DATA_COUNTER, 8192, 0x16CAA374},
+	{CHECKSUM_DATA_RANDOM, 8192, 0xA0B98154},
+	{CHECKSUM_DATA_ZEROES, 32768, 0x06A334CE},
+	{CHECKSUM_DATA_ONES, 32768, 0x25F16D33},
+	{CHECKSUM_DATA_LAST_WORD, 32768, 0x9C53A144},
+	{CHECKSUM_DATA_COUNTER, 32768, 0xC48AC6AD},
+	{CHECKSUM_DATA_RANDOM, 32768, 0x00F175B7}
+};
+
+static void
+fill_checksum_data(uint32 *words, uint32 nwords, ChecksumTestData data)
+{
+	uint32		state = 0x2545F491;
+	uint32		i;
+
+	for (i = 0; i < nwords; i++)
+	{
+		switch (data)
+		{
+			case CHECKSUM_DATA_ZEROES:
+				words[i] = 0;
+				break;
+			case CHECKSUM_DATA_ONES:
+				words[i] = 0xFFFFFFFF;
+				break;
+			case CHECKSUM_DATA_LAST_WORD:
+				words[i] = (i == nwords - 1) ? 1 : 0;
+				break;
+			case CHECKSUM_DATA_COUNTER:
+				words[i] = i;
+				break;
+			case CHECKSUM_DATA_RANDOM:
+				state ^= state << 13;
+				state ^= state >> 17;
+				state ^= state << 5;
+				words[i] = state;
+				break;
+		}
+	}
+}
+
+/*
+ * Check that every data page checksum implementation usable on this
+ * processor, vectorized or not, computes the known checksums.
+ */
+PG_FUNCTION_INFO_V1(test_checksum_impls);
+Datum
+test_checksum_impls(PG_FUNCTION_ARGS)
+{
+	const ChecksumImpl *impls;
+	int			nimpls = pg_checksum_available_impls(&impls);
+	uint32	   *words = palloc(32768);
+	int			i;
+	int			k;
+
+	for (i = 0; i < lengthof(checksum_tests); i++)
+	{
+		uint32		size = checksum_tests[i].size;
+
+		fill_checksum_data(words, size / sizeof(uint32),
+						   checksum_tests[i].data);
+
+		for (k = 0; k < nimpls; k++)
+		{
+			uint32		result = impls[k].fn((char *) words, size);
+
+			if (result != checksum_tests[i].checksum)
+				elog(ERROR, "checksum implementation \"%s\" computed %08X for test %d, expected %08X",
+					 impls[k].name, result, i, checksum_tests[i].checksum);
+		}
+	}
+
+	pfree(words);
+
+	PG_RETURN_BOOL(true);
+}
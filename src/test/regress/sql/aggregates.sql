@@ -824,3 +824,36 @@ create aggregate my_half_sum(int4)
 select my_sum(one),my_half_sum(one) from (values(1),(2),(3),(4)) t(one);
 
 rollback;
+
+--
+-- Hashed aggregation that exceeds work_mem spills to disk
+--
+set work_mem = '64kB';
+set enable_sort = false;
+select count(*) as groups, sum(k) as sum_k, sum(s) as sum_s,
+       min(c) as min_c, max(c) as max_c
+  from (select g % 10000 as k, sum(g) as s, count(*) as c
+          from generate_series(1, 40000) g group by 1) ss;
+
+-- EXPLAIN ANALYZE shows the batches; the exact numbers depend on memory
+-- accounting details, so hide them.
+create function explain_hashagg(query text) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in
+        execute 'explain (analyze, costs off, timing off, summary off) ' ||
+            query
+    loop
+        return next regexp_replace(ln, 'Batches: \d+  Disk Usage: \d+kB',
+                                   'Batches: N  Disk Usage: NkB');
+    end loop;
+end;
+$$;
+select * from explain_hashagg('select g % 10000 as k, sum(g), count(*)
+  from generate_series(1, 40000) g group by 1');
+drop function explain_hashagg(text);
+reset enable_sort;
+reset work_mem;
@@ -92,3 +92,83 @@ vacuum btree_tall_tbl;
 -- need to insert some rows to cause the fast root page to split.
 insert into btree_tall_tbl (id, t)
   select g, repeat('x', 100) from generate_series(1, 500) g;
+
+--
+-- Test parallel index build
+--
+create table btree_parallel_tbl (a int4, b text);
+insert into btree_parallel_tbl
+  select i % 1000, 'row ' || i from generate_series(1, 20000) i;
+alter table btree_parallel_tbl set (parallel_workers = 4);
+set max_parallel_maintenance_workers = 4;
+create index btree_parallel_a_idx on btree_parallel_tbl (a);
+create unique index btree_parallel_b_idx on btree_parallel_tbl (b);
+-- duplicates may be spread across several participants' sorts
+\set VERBOSITY terse
+create unique index btree_parallel_a_uniq on btree_parallel_tbl (a);
+\set VERBOSITY default
+set enable_seqscan to false;
+set enable_bitmapscan to false;
+select count(*) from btree_parallel_tbl where a = 42;
+select a, b from btree_parallel_tbl where b = 'row 4242';
+reset enable_seqscan;
+reset enable_bitmapscan;
+reset max_parallel_maintenance_workers;
+drop table btree_parallel_tbl;
+
+--
+-- Test deduplication of duplicate keys into posting lists, and VACUUM
+-- removing some of the heap TIDs of a posting list
+--
+create table btree_dedup_tbl (a int4, b int4);
+create index btree_dedup_a_idx on btree_dedup_tbl (a);
+create index btree_dedup_b_idx on btree_dedup_tbl (b);
+insert into btree_dedup_tbl select i % 3, i from generate_series(1, 10000) i;
+-- with only three distinct keys, merging duplicates makes the index smaller
+select pg_relation_size('btree_dedup_a_idx') <
+       pg_relation_size('btree_dedup_b_idx') as smaller;
+set enable_seqscan to false;
+set enable_bitmapscan to false;
+select count(*) from btree_dedup_tbl where a = 1;
+select count(*) from (select * from btree_dedup_tbl where a = 2
+                      order by a desc) s;
+select a, count(*) from btree_dedup_tbl group by a order by a;
+delete from btree_dedup_tbl where b % 2 = 0;
+vacuum btree_dedup_tbl;
+select a, count(*) from btree_dedup_tbl group by a order by a;
+select count(*) from btree_dedup_tbl where a = 1 and b % 6 = 1;
+reset enable_seqscan;
+reset enable_bitmapscan;
+drop table btree_dedup_tbl;
+
+--
+-- Test suffix truncation of pivot tuples, with indexes built both by
+-- inserts (page splits) and by CREATE INDEX.  Each tenant has only a few
+-- rows, so most splits fall between tenants and the high keys keep just
+-- the leading column.
+--
+create table btree_trunc_tbl (tenant int4, created int4, pad text);
+create index btree_trunc_split_idx on btree_trunc_tbl (tenant, pad, created desc);
+insert into btree_trunc_tbl
+  select i / 3, i, repeat('p', 200) from generate_series(1, 5000) i;
+insert into btree_trunc_tbl
+  select 25, null, repeat('p', 200) from generate_series(1, 100);
+create index btree_trunc_build_idx on btree_trunc_tbl (tenant, pad, created desc);
+create unique index btree_trunc_uniq on btree_trunc_tbl (tenant, created);
+set enable_seqscan to false;
+set enable_bitmapscan to false;
+select count(*) from btree_trunc_tbl where tenant = 25;
+select count(*) from btree_trunc_tbl where tenant between 10 and 19;
+select created from btree_trunc_tbl
+  where tenant = 7 and pad = repeat('p', 200) order by created desc limit 3;
+select count(*) from btree_trunc_tbl where tenant = 25 and created is null;
+insert into btree_trunc_tbl values (1666, 4999, 'dup');
+-- deleting most of the index makes VACUUM delete pages
+delete from btree_trunc_tbl where tenant < 1500;
+vacuum btree_trunc_tbl;
+select count(*) from btree_trunc_tbl where tenant >= 0;
+select tenant, count(*) from btree_trunc_tbl
+  where tenant between 1498 and 1501 group by tenant order by tenant;
+reset enable_seqscan;
+reset enable_bitmapscan;
+drop table btree_trunc_tbl;
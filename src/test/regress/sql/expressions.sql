@@ -34,3 +34,15 @@ SELECT current_schema;
 SET search_path = 'pg_catalog';
 SELECT current_schema;
 RESET search_path;
+
+
+--
+-- Tests for ScalarArrayOpExpr with a constant array large enough to be
+-- evaluated by hash lookup
+--
+select x, x in (1, 2, 3, 4, 5, 6, 7, 8, 9) as "in"
+  from (values (1), (5), (9), (10), (null::int)) v(x);
+select x, x in (1, 2, 3, 4, 5, 6, 7, 8, null) as "in"
+  from (values (1), (10), (null::int)) v(x);
+select x, x = any ('{a,b,c,d,e,f,g,h,i}'::text[]) as "any"
+  from (values ('a'), ('i'), ('j')) v(x);
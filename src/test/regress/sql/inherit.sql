@@ -641,5 +641,57 @@ explain (costs off) select * from range_list_parted where b is null;
 explain (costs off) select * from range_list_parted where a is not null and a < 67;
 explain (costs off) select * from range_list_parted where a >= 30;
 
+-- Params can be used to prune partitions at execution time; check that the
+-- results are unaffected
+insert into range_list_parted values (5, 'ab'), (15, 'cd'), (25, 'ab'), (45, null);
+select * from range_list_parted where a = (select 15);
+select * from range_list_parted where a > (select 20) order by a;
+prepare range_list_q (int) as select * from range_list_parted where a = $1;
+execute range_list_q(5);
+execute range_list_q(15);
+execute range_list_q(25);
+execute range_list_q(35);
+execute range_list_q(45);
+execute range_list_q(5);
+deallocate range_list_q;
+
+-- Subplans pruned at execution time are never executed
+explain (analyze, costs off, summary off, timing off)
+select * from range_list_parted where a = (select 15);
+
+-- Params of a correlated subquery change every time it is rescanned, and
+-- the subplans to run are recomputed each time.  Only show which partitions
+-- were scanned, as the filters print the outer query's Params.
+create function explain_scanned(query text) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in
+        execute 'explain (analyze, costs off, summary off, timing off) ' ||
+            query
+    loop
+        if ln ~ 'Seq Scan on part_' then
+            return next ltrim(ln);
+        end if;
+    end loop;
+end;
+$$;
+select * from explain_scanned('select (select count(*) from range_list_parted where a = k)
+  from (values (5), (25)) v(k)');
+select k, (select count(*) from range_list_parted where a = k)
+  from (values (5), (25), (35)) v(k);
+drop function explain_scanned(text);
+
+-- Pruned subplans must be skipped when scanning backwards, too
+begin;
+declare range_list_c scroll cursor for
+  select * from range_list_parted where a < (select 30);
+fetch all from range_list_c;
+fetch backward all from range_list_c;
+fetch all from range_list_c;
+commit;
+
 drop table list_parted;
 drop table range_list_parted;
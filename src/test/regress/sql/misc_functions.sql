@@ -29,3 +29,9 @@ SELECT num_nulls(VARIADIC '{}'::int[]);
 -- should fail, one or more arguments is required
 SELECT num_nonnulls();
 SELECT num_nulls();
+
+--
+-- Data page checksum implementations
+--
+
+SELECT test_checksum_impls();
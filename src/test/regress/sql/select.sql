@@ -254,3 +254,24 @@ drop function sillysrf(int);
 -- (see bug #5084)
 select * from (values (2),(null),(1)) v(k) where k = k order by k;
 select * from (values (2),(null),(1)) v(k) where k = k;
+
+--
+-- A sequential scan hands out the visible tuples of each heap page from a
+-- batch.  Check that every tuple is returned once, in physical order, and
+-- that the scan can be restarted in the middle of a page.
+--
+select count(*) as tuples, count(distinct ctid) as tids,
+       sum(case when ctid <= prev then 1 else 0 end) as out_of_order
+  from (select ctid, lag(ctid) over () as prev from tenk1) ss;
+select sum((select count(*) from (select 1 from tenk1 limit o.ten * 7) ss))
+  from onek o;
+
+--
+-- An aggregate reads a sequential scan below it a page at a time, with the
+-- scan's qual evaluated over the whole page.  Check plain and hashed
+-- aggregation, and that a change of parameter rescans the scan.
+--
+select count(*), sum(unique1) from tenk1 where unique1 % 7 = 0;
+select ten, count(*) from tenk1 where unique1 % 7 = 0 group by ten order by ten;
+select unique1, (select count(*) from tenk1 t where t.unique1 < o.unique1 * 1000)
+  from onek o where o.unique1 < 3 order by unique1;
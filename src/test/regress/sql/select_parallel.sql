@@ -5,6 +5,12 @@
 create or replace function parallel_restricted(int) returns int as
   $$begin return $1; end$$ language plpgsql parallel restricted;
 
+-- a table whose filtered size is badly underestimated, for parallel hash
+create table phj_big as
+  select g as id, 0 as zero, repeat('x', 100) as pad
+  from generate_series(1, 20000) g;
+analyze phj_big;
+
 -- Serializable isolation would disable parallel query, so explicitly use an
 -- arbitrary other level.
 begin isolation level repeatable read;
@@ -85,6 +91,35 @@ select  count(*) from tenk1, tenk2 where tenk1.unique1 = tenk2.unique1;
 reset enable_hashjoin;
 reset enable_nestloop;
 
+-- test parallel hash join path.
+set enable_mergejoin to off;
+set enable_nestloop to off;
+select  count(*) from tenk1, tenk2 where tenk1.unique1 = tenk2.unique1;
+select  count(*) from tenk1 left join tenk2 on tenk1.unique1 = tenk2.hundred;
+
+-- both sides are scanned in parallel, and the hash table is shared.
+set enable_indexscan to off;
+set enable_indexonlyscan to off;
+set enable_bitmapscan to off;
+explain (costs off)
+	select  count(*) from tenk1, tenk2 where tenk1.unique1 = tenk2.unique1;
+
+-- a shared hash table that is estimated to fit in work_mem, but doesn't,
+-- is split into batches while it is being built.  The filter's selectivity
+-- is badly underestimated.
+set work_mem to '64kB';
+explain (costs off)
+	select  count(*) from tenk1, phj_big
+	where tenk1.unique1 = phj_big.id and phj_big.zero + 0 = 0;
+select  count(*) from tenk1, phj_big
+	where tenk1.unique1 = phj_big.id and phj_big.zero + 0 = 0;
+reset work_mem;
+reset enable_indexscan;
+reset enable_indexonlyscan;
+reset enable_bitmapscan;
+reset enable_mergejoin;
+reset enable_nestloop;
+
 --test gather merge
 set enable_hashagg to off;
 
@@ -104,3 +139,5 @@ explain (costs off)
 select stringu1::int2 from tenk1 where unique1 = 1;
 
 rollback;
+
+drop table phj_big;
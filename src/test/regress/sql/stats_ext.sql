@@ -6,6 +6,11 @@
 SET max_parallel_workers = 0;
 SET max_parallel_workers_per_gather = 0;
 SET work_mem = '128kB';
+-- The GROUP BY tests below tell whether the number of groups was estimated
+-- well by whether the planner picks HashAggregate (the groups fit in
+-- work_mem) or GroupAggregate (they don't).  A hash aggregate that may spill
+-- to disk can be chosen either way, so disallow that.
+SET enable_hashagg_disk = off;
 
 -- Ensure stats are dropped sanely
 CREATE TABLE ab1 (a INTEGER, b INTEGER, c INTEGER);
@@ -74,3 +74,45 @@ VACUUM (ANALYZE) vacparted;
 VACUUM (FULL) vacparted;
 VACUUM (FREEZE) vacparted;
 DROP TABLE vacparted;
+
+-- parallel index vacuuming
+CREATE TABLE vacparallel (a int, b int, c text);
+CREATE INDEX vacparallel_a ON vacparallel (a);
+CREATE INDEX vacparallel_b ON vacparallel (b);
+CREATE INDEX vacparallel_c ON vacparallel (c);
+INSERT INTO vacparallel SELECT g, g % 100, 'row ' || g FROM generate_series(1, 10000) g;
+DELETE FROM vacparallel WHERE a % 3 = 0;
+SET min_parallel_index_scan_size = 0;
+SET max_parallel_maintenance_workers = 2;
+-- check that both index passes are done in parallel
+SET trace_parallel_vacuum = on;
+SET client_min_messages = log;
+VACUUM vacparallel;
+RESET client_min_messages;
+RESET trace_parallel_vacuum;
+UPDATE vacparallel SET b = b + 1 WHERE a % 5 = 0;
+VACUUM vacparallel;
+RESET max_parallel_maintenance_workers;
+RESET min_parallel_index_scan_size;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*) FROM vacparallel WHERE a > 0;
+SELECT count(*), sum(b) FROM vacparallel WHERE b >= 0;
+SELECT count(*) FROM vacparallel WHERE c >= 'row';
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+-- an index that uses maintenance_work_mem while vacuuming limits the workers
+CREATE INDEX vacparallel_gin ON vacparallel USING gin ((ARRAY[a, b]));
+DELETE FROM vacparallel WHERE a % 5 = 1;
+SET min_parallel_index_scan_size = 0;
+SET max_parallel_maintenance_workers = 2;
+SET maintenance_work_mem = '1MB';
+SET trace_parallel_vacuum = on;
+SET client_min_messages = log;
+VACUUM vacparallel;
+RESET client_min_messages;
+RESET trace_parallel_vacuum;
+RESET maintenance_work_mem;
+RESET max_parallel_maintenance_workers;
+RESET min_parallel_index_scan_size;
+DROP TABLE vacparallel;